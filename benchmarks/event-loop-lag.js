@@ -0,0 +1,57 @@
+#!/usr/bin/env node
+// Measures event loop delay while native calls are running, sync exports vs their *Async variants.
+// Sync calls block the loop for every X server round-trip, async ones should keep delay near timer resolution.
+// Options: --iterations=2000 --concurrency=8 --windows=20
+
+const {monitorEventLoopDelay} = require('perf_hooks');
+const {ensureXvfb, loadNative, argNumber} = require('./utils');
+
+// Keeps `concurrency` requests in flight like concurrent HTTP clients would
+async function run(call, iterations, concurrency) {
+  let next = 0;
+  const worker = async() => {
+    while (next < iterations) {
+      await call(next++);
+      // Lets timers and I/O run between requests the same way separate HTTP requests would
+      await new Promise((resolve) => setImmediate(resolve));
+    }
+  };
+  const histogram = monitorEventLoopDelay({resolution: 1});
+  histogram.enable();
+  const start = process.hrtime.bigint();
+  await Promise.all(Array.from({length: concurrency}, worker));
+  const elapsedMs = Number(process.hrtime.bigint() - start) / 1e6;
+  histogram.disable();
+  const ms = (ns) => (ns / 1e6).toFixed(2);
+  return {
+    'calls/s': Math.round(iterations / elapsedMs * 1000),
+    'lag p50': ms(histogram.percentile(50)),
+    'lag p99': ms(histogram.percentile(99)),
+    'lag max': ms(histogram.max),
+  };
+}
+
+(async function main() {
+  const stopXvfb = await ensureXvfb();
+  try {
+    const native = loadNative();
+    const iterations = argNumber('iterations', 2000);
+    const concurrency = argNumber('concurrency', 8);
+    const windowsCount = argNumber('windows', 20);
+    const wids = Array.from({length: windowsCount}, () => native.createTestWindow());
+    const wid = (i) => wids[i % wids.length];
+
+    const results = {
+      'getWindowInfo': await run((i) => native.getWindowInfo(wid(i)), iterations, concurrency),
+      'getMousePosition': await run(() => native.getMousePosition(), iterations, concurrency),
+    };
+    if (native.getWindowInfoAsync) {
+      results['getWindowInfoAsync'] = await run((i) => native.getWindowInfoAsync(wid(i)), iterations, concurrency);
+      results['getMousePositionAsync'] = await run(() => native.getMousePositionAsync(), iterations, concurrency);
+    }
+    console.log(`${iterations} calls, ${concurrency} in flight, DISPLAY=${process.env.DISPLAY} (lag in milliseconds)`);
+    console.table(results);
+  } finally {
+    stopXvfb();
+  }
+})();
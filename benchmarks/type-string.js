@@ -0,0 +1,24 @@
+#!/usr/bin/env node
+// Measures how long native typeString takes to inject a block of text into Xvfb.
+// Options: --iterations=50 --length=1000
+
+const {ensureXvfb, loadNative, measure, argNumber} = require('./utils');
+
+(async function main() {
+  const stopXvfb = await ensureXvfb();
+  try {
+    const native = loadNative();
+    const iterations = argNumber('iterations', 50);
+    const length = argNumber('length', 1000);
+    const alphabet = 'The quick brown fox jumps over the lazy dog. 0123456789 !@#$%^&*()';
+    const text = Array.from({length}, (_, i) => alphabet[i % alphabet.length]).join('');
+
+    const results = {
+      [`typeString(${length} chars)`]: measure(() => native.typeString(text), iterations),
+    };
+    console.log(`${iterations} iterations, DISPLAY=${process.env.DISPLAY} (microseconds)`);
+    console.table(results);
+  } finally {
+    stopXvfb();
+  }
+})();
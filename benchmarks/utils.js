@@ -0,0 +1,59 @@
+const {spawn} = require('child_process');
+
+/**
+ * Starts Xvfb on a free display unless DISPLAY is already set, so benchmarks can run on CI or headless servers.
+ * Returns a function that stops the server.
+ */
+async function ensureXvfb(display = ':99') {
+  if (process.platform !== 'linux' || process.env.DISPLAY) {
+    return () => {};
+  }
+  console.log(`Starting Xvfb on ${display} ...`);
+  const xvfb = spawn('Xvfb', [display, '-screen', '0', '1920x1080x24', '-nolisten', 'tcp'], {stdio: 'ignore'});
+  process.env.DISPLAY = display;
+  await new Promise((resolve) => setTimeout(resolve, 500));
+  return () => xvfb.kill();
+}
+
+/**
+ * Loads the native addon the same way NativeModule does in dev mode
+ */
+function loadNative() {
+  return require('bindings')('native');
+}
+
+/**
+ * Runs fn iterations times after a warmup and returns latency percentiles in microseconds
+ */
+function measure(fn, iterations) {
+  for (let i = 0; i < Math.min(100, iterations); i++) {
+    fn(i);
+  }
+  const samples = new Float64Array(iterations);
+  for (let i = 0; i < iterations; i++) {
+    const start = process.hrtime.bigint();
+    fn(i);
+    samples[i] = Number(process.hrtime.bigint() - start) / 1000;
+  }
+  return summarize(samples);
+}
+
+function summarize(samples) {
+  const sorted = Float64Array.from(samples).sort();
+  const at = (p) => sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+  const mean = sorted.reduce((a, b) => a + b, 0) / sorted.length;
+  return {
+    mean: mean.toFixed(1),
+    p50: at(0.5).toFixed(1),
+    p95: at(0.95).toFixed(1),
+    p99: at(0.99).toFixed(1),
+    max: sorted[sorted.length - 1].toFixed(1),
+  };
+}
+
+function argNumber(name, defaultValue) {
+  const arg = process.argv.find((a) => a.startsWith(`--${name}=`));
+  return arg ? parseInt(arg.split('=')[1], 10) : defaultValue;
+}
+
+module.exports = {ensureXvfb, loadNative, measure, summarize, argNumber};
@@ -0,0 +1,29 @@
+#!/usr/bin/env node
+// Measures latency of native getWindowInfo (GET /window/by-wid/:wid) against Xvfb.
+// Run it on two builds to compare: `yarn cmake && yarn benchmark:window-info`
+// Options: --iterations=5000 --windows=20
+
+const {ensureXvfb, loadNative, measure, argNumber} = require('./utils');
+
+(async function main() {
+  const stopXvfb = await ensureXvfb();
+  try {
+    const native = loadNative();
+    const iterations = argNumber('iterations', 5000);
+    const windowsCount = argNumber('windows', 20);
+    const wids = Array.from({length: windowsCount}, () => native.createTestWindow());
+
+    const results = {
+      getWindowInfo: measure((i) => native.getWindowInfo(wids[i % wids.length]), iterations),
+    };
+    if (native.getWindowsInfo) {
+      const batchIterations = Math.max(1, Math.round(iterations / windowsCount));
+      results[`getWindowInfo x${windowsCount}`] = measure(() => wids.forEach((wid) => native.getWindowInfo(wid)), batchIterations);
+      results[`getWindowsInfo(${windowsCount})`] = measure(() => native.getWindowsInfo(wids), batchIterations);
+    }
+    console.log(`${iterations} iterations on ${windowsCount} windows, DISPLAY=${process.env.DISPLAY} (microseconds)`);
+    console.table(results);
+  } finally {
+    stopXvfb();
+  }
+})();
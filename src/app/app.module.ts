@@ -2,11 +2,13 @@ import {MiddlewareConsumer, Module, NestModule} from '@nestjs/common';
 import {AppController} from '@/app/app-controller';
 import {KeyboardModule} from '@/keyboard/keyboard-module';
 import {MouseModule} from '@/mouse/mouse-module';
+import {InputModule} from '@/input/input-module';
 import {RequestIdMiddleware} from '@/app/request-id-middleware';
 import {WindowModule} from '@/window/window-module';
 import {NativeModule} from '@/native/native-module';
 import {MonitorModule} from '@/monitor/monitor-module';
 import {ProcessModule} from '@/process/process-module';
+import {CaptureModule} from '@/capture/capture-module';
 import {GlobalModule} from '@/global/global-module';
 import {AsyncStorageModule} from '@/asyncstore/async-storage.module';
 
@@ -15,9 +17,11 @@ import {AsyncStorageModule} from '@/asyncstore/async-storage.module';
     GlobalModule,
     KeyboardModule,
     MouseModule,
+    InputModule,
     WindowModule,
     MonitorModule,
     ProcessModule,
+    CaptureModule,
     AsyncStorageModule,
     NativeModule,
   ],
@@ -0,0 +1,141 @@
+import {Body, Controller, Delete, Get, Header, HttpCode, Post, Query, Res, StreamableFile} from '@nestjs/common';
+import {ApiOperation, ApiProduces, ApiResponse, ApiTags} from '@nestjs/swagger';
+import type {Response} from 'express';
+import {CaptureService} from '@/capture/capture-service';
+import {CaptureStreamService} from '@/capture/capture-stream-service';
+import {
+  CaptureQueryDto,
+  StreamQueryDto,
+  FindTemplateRequestDto,
+  TemplateMatchResponseDto,
+  GetPixelsRequestDto,
+  PixelQueryDto,
+  PixelResponseDto,
+  WaitForPixelRequestDto,
+  WaitForPixelResponseDto,
+  WaitForIdleRequestDto,
+  WaitForIdleResponseDto,
+  FrameSocketRequestDto,
+  FrameSocketResponseDto,
+} from '@/capture/capture-dto';
+
+const CONTENT_TYPES = {
+  png: 'image/png',
+  jpeg: 'image/jpeg',
+  qoi: 'image/qoi',
+};
+
+@ApiTags('Capture')
+@Controller('capture')
+export class CaptureController {
+  constructor(
+    private readonly captureService: CaptureService,
+    private readonly captureStreamService: CaptureStreamService,
+  ) {}
+
+  @Get()
+  @ApiOperation({summary: 'Capture the screen, a monitor or an area. Size of the image is in X-Image-* headers'})
+  @ApiProduces('application/octet-stream', ...Object.values(CONTENT_TYPES))
+  @ApiResponse({status: 200, description: 'Encoded image, or rows of X-Image-Stride bytes with 4 bytes per pixel in B, G, R, A order for raw format'})
+  @Header('Cache-Control', 'no-store')
+  async captureScreen(
+    @Query() query: CaptureQueryDto,
+    @Res({passthrough: true}) res: Response,
+  ): Promise<StreamableFile> {
+    if (query.format === 'raw') {
+      const frame = await this.captureService.captureScreen(query);
+      res.set({
+        'X-Image-X': String(frame.x),
+        'X-Image-Y': String(frame.y),
+        'X-Image-Width': String(frame.width),
+        'X-Image-Height': String(frame.height),
+        'X-Image-Stride': String(frame.stride),
+        'X-Image-Format': frame.format,
+      });
+      return new StreamableFile(frame.data, {type: 'application/octet-stream', length: frame.data.length});
+    }
+    const image = await this.captureService.captureImage(query);
+    res.set({
+      'X-Image-Width': String(image.width),
+      'X-Image-Height': String(image.height),
+      'X-Image-Format': image.format,
+    });
+    return new StreamableFile(image.data, {type: CONTENT_TYPES[image.format], length: image.data.length});
+  }
+
+  @Get('stream')
+  @ApiOperation({summary: 'Live stream of the screen, a monitor or an area. Frames are sent only when the screen changes'})
+  @ApiProduces('multipart/x-mixed-replace', 'multipart/mixed')
+  @ApiResponse({status: 200, description: 'JPEG parts until the client disconnects. In tiles mode parts are changed tiles with X-Tile-* headers, a part with X-Frame-Full: true covers the whole area. Size of the area is in X-Image-* headers'})
+  streamScreen(@Query() query: StreamQueryDto, @Res() res: Response): void {
+    const key = this.captureStreamService.openStream(query);
+    this.captureStreamService.addViewer(key, res);
+  }
+
+  @Get('pixel')
+  @ApiOperation({summary: 'Get color of a screen pixel'})
+  @ApiResponse({type: PixelResponseDto})
+  async getPixel(@Query() query: PixelQueryDto): Promise<PixelResponseDto> {
+    return this.captureService.getPixel(query.x, query.y);
+  }
+
+  @Post('pixels')
+  @HttpCode(200)
+  @ApiOperation({summary: 'Get colors of multiple screen pixels in one request'})
+  @ApiResponse({type: PixelResponseDto, isArray: true})
+  async getPixels(@Body() body: GetPixelsRequestDto): Promise<PixelResponseDto[]> {
+    return this.captureService.getPixels(body.points);
+  }
+
+  @Post('pixel/wait')
+  @HttpCode(200)
+  @ApiOperation({summary: 'Wait until a pixel of the region gets the color, the region is polled on the server'})
+  @ApiResponse({type: WaitForPixelResponseDto})
+  async waitForPixel(@Body() body: WaitForPixelRequestDto): Promise<WaitForPixelResponseDto> {
+    return this.captureService.waitForPixel(body);
+  }
+
+  @Post('idle')
+  @HttpCode(200)
+  @ApiOperation({summary: 'Wait until a window or a screen area stops redrawing, without polling screenshots'})
+  @ApiResponse({type: WaitForIdleResponseDto})
+  async waitForIdle(@Body() body: WaitForIdleRequestDto): Promise<WaitForIdleResponseDto> {
+    return this.captureService.waitForIdle(body);
+  }
+
+  @Post('socket')
+  @HttpCode(200)
+  @ApiOperation({summary: 'Share captures with processes on this host over a Unix socket, without encoding or copying'})
+  @ApiResponse({
+    type: FrameSocketResponseDto,
+    description: 'Clients connect with SOCK_SEQPACKET and receive the ring memfd with a hello (magic, version, slots, slotSize, ringSize). ' +
+      'Every request (x, y, width, height as int32, zeros for the whole screen) is answered with ' +
+      '(status, slot, offset, sequence, x, y, width, height, stride) of a BGRA frame in the ring. See frame-socket.h',
+  })
+  startFrameSocket(@Body() body: FrameSocketRequestDto): FrameSocketResponseDto {
+    return this.captureService.startFrameSocket(body);
+  }
+
+  @Delete('socket')
+  @HttpCode(204)
+  @ApiOperation({summary: 'Stop sharing captures over the Unix socket'})
+  stopFrameSocket(): void {
+    this.captureService.stopFrameSocket();
+  }
+
+  @Post('find')
+  @HttpCode(200)
+  @ApiOperation({summary: 'Find an image on the screen, e.g. a button. Returns matches with the best first'})
+  @ApiResponse({type: TemplateMatchResponseDto, isArray: true})
+  async findTemplate(@Body() body: FindTemplateRequestDto): Promise<TemplateMatchResponseDto[]> {
+    return this.captureService.findTemplate(body);
+  }
+
+  @Post('find/click')
+  @HttpCode(200)
+  @ApiOperation({summary: 'Find an image on the screen and left click its center. Returns 404 if it is not found'})
+  @ApiResponse({type: TemplateMatchResponseDto})
+  async clickTemplate(@Body() body: FindTemplateRequestDto): Promise<TemplateMatchResponseDto> {
+    return this.captureService.clickTemplate(body);
+  }
+}
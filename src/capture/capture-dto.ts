@@ -0,0 +1,232 @@
+import {z} from 'zod';
+import {createZodDto} from '@anatine/zod-nestjs';
+
+const rectKeys = ['x', 'y', 'width', 'height'] as const;
+
+type AreaQuery = Partial<Record<typeof rectKeys[number] | 'monitor', number>>;
+
+function refineArea(data: AreaQuery, ctx: z.RefinementCtx): void {
+  const rectCount = rectKeys.filter((key) => data[key] !== undefined).length;
+  if (data.monitor !== undefined && rectCount > 0) {
+    ctx.addIssue({
+      code: z.ZodIssueCode.custom,
+      message: 'monitor can not be combined with x, y, width, height',
+    });
+  } else if (rectCount > 0 && rectCount < rectKeys.length) {
+    ctx.addIssue({
+      code: z.ZodIssueCode.custom,
+      message: 'x, y, width, height must be provided together',
+    });
+  }
+}
+
+const captureQuerySchema = z.object({
+  monitor: z.coerce.number().int().nonnegative().optional().describe('Monitor id from GET /monitor, captures the whole monitor'),
+  x: z.coerce.number().int().optional().describe('Left position of the captured area in screen coordinates (pixels)'),
+  y: z.coerce.number().int().optional().describe('Top position of the captured area in screen coordinates (pixels)'),
+  width: z.coerce.number().int().positive().optional().describe('Width of the captured area in pixels'),
+  height: z.coerce.number().int().positive().optional().describe('Height of the captured area in pixels'),
+  format: z.enum(['raw', 'png', 'jpeg', 'qoi']).default('raw').describe('raw returns BGRA pixels as they are captured, others encode the image'),
+  quality: z.coerce.number().int().min(1).max(100).optional().describe('JPEG quality, 80 by default'),
+  compression: z.coerce.number().int().min(0).max(9).optional().describe('PNG compression level, 6 by default'),
+  resizeWidth: z.coerce.number().int().positive().max(16384).optional().describe('Width of the encoded image, keeps aspect ratio if resizeHeight is not set'),
+  resizeHeight: z.coerce.number().int().positive().max(16384).optional().describe('Height of the encoded image, keeps aspect ratio if resizeWidth is not set'),
+}).strict().superRefine((data, ctx) => {
+  if (data.format === 'raw' && (data.resizeWidth !== undefined || data.resizeHeight !== undefined)) {
+    ctx.addIssue({
+      code: z.ZodIssueCode.custom,
+      message: 'raw format can not be resized',
+    });
+  }
+  refineArea(data, ctx);
+}).describe('Captured area. Whole screen when nothing is specified');
+
+const streamQuerySchema = z.object({
+  monitor: z.coerce.number().int().nonnegative().optional().describe('Monitor id from GET /monitor, streams the whole monitor'),
+  x: z.coerce.number().int().optional().describe('Left position of the streamed area in screen coordinates (pixels)'),
+  y: z.coerce.number().int().optional().describe('Top position of the streamed area in screen coordinates (pixels)'),
+  width: z.coerce.number().int().positive().optional().describe('Width of the streamed area in pixels'),
+  height: z.coerce.number().int().positive().optional().describe('Height of the streamed area in pixels'),
+  mode: z.enum(['frames', 'tiles']).default('frames').describe('frames sends whole JPEG frames (MJPEG, viewable in a browser), tiles sends only changed tiles'),
+  quality: z.coerce.number().int().min(1).max(100).default(70).describe('JPEG quality'),
+  maxFps: z.coerce.number().int().min(1).max(60).default(10).describe('Frames are sent only when the screen changes, but not more often than this'),
+  tileSize: z.coerce.number().int().min(16).max(1024).default(128).describe('Side of a tile in pixels, tiles mode only'),
+}).strict().superRefine(refineArea).describe('Streamed area. Whole screen when nothing is specified');
+
+const colorSchema = z.string().regex(/^#[\dA-Fa-f]{6}$/u, 'Color must be in #RRGGBB format').describe('Color in #RRGGBB format');
+
+const pixelQuerySchema = z.object({
+  x: z.coerce.number().int().nonnegative().describe('Horizontal position in screen coordinates (pixels)'),
+  y: z.coerce.number().int().nonnegative().describe('Vertical position in screen coordinates (pixels)'),
+}).strict();
+
+const pixelResponseSchema = z.object({
+  x: z.number().describe('Horizontal position in screen coordinates (pixels)'),
+  y: z.number().describe('Vertical position in screen coordinates (pixels)'),
+  color: colorSchema,
+}).describe('Color of a screen pixel');
+
+const getPixelsRequestSchema = z.object({
+  points: z.array(z.object({
+    x: z.number().int().nonnegative(),
+    y: z.number().int().nonnegative(),
+  })).min(1).max(10000).describe('Screen points to read, nearby ones are read with a single capture'),
+}).strict();
+
+const waitForPixelRequestSchema = z.object({
+  region: z.object({
+    x: z.number().int(),
+    y: z.number().int(),
+    width: z.number().int().positive(),
+    height: z.number().int().positive(),
+  }).refine((region) => region.width * region.height <= 1024 * 1024, 'Region must be at most 1048576 pixels')
+    .describe('Polled area in screen coordinates, keep it small'),
+  color: colorSchema,
+  tolerance: z.number().int().min(0).max(255).default(0).describe('Largest difference of a channel that still matches'),
+  timeoutMs: z.number().int().min(0).max(600000).describe('Resolves with matched = false after this time'),
+  intervalMs: z.number().int().min(1).max(10000).default(50).describe('Delay between polls'),
+}).strict().describe('Waits until a pixel of the region gets the color');
+
+const waitForPixelResponseSchema = z.object({
+  matched: z.boolean().describe('False if timeout has passed'),
+  x: z.number().optional().describe('Horizontal position of the first matched pixel'),
+  y: z.number().optional().describe('Vertical position of the first matched pixel'),
+  color: colorSchema.optional().describe('Actual color of the matched pixel'),
+  elapsedMs: z.number().describe('Time from the request to the match or timeout'),
+});
+
+const findTemplateRequestSchema = z.object({
+  image: z.string().base64().min(1).describe('Base64 encoded PNG or JPEG of what to look for, e.g. a cropped screenshot of a button'),
+  region: z.union([
+    z.object({
+      monitor: z.number().int().nonnegative().describe('Monitor id from GET /monitor'),
+    }).strict(),
+    z.object({
+      x: z.number().int(),
+      y: z.number().int(),
+      width: z.number().int().positive(),
+      height: z.number().int().positive(),
+    }).strict(),
+  ]).optional().describe('Searched area, whole screen by default'),
+  threshold: z.number().min(0).max(1).default(0.9).describe('Lowest similarity score 0..1 of a returned match'),
+  maxResults: z.number().int().min(1).max(100).default(1).describe('Maximum number of matches, best first'),
+}).strict().describe('Looks for an image on the screen');
+
+const waitForIdleRequestSchema = z.object({
+  wid: z.number().int().positive().optional().describe('Window id to watch'),
+  region: z.object({
+    x: z.number().int(),
+    y: z.number().int(),
+    width: z.number().int().positive(),
+    height: z.number().int().positive(),
+  }).strict().optional().describe('Area of the screen to watch'),
+  quietMs: z.number().int().min(1).max(60000).default(500).describe('How long nothing must be drawn'),
+  timeoutMs: z.number().int().min(0).max(600000).describe('Resolves with idle = false after this time'),
+}).strict().superRefine((value, ctx) => {
+  if ((value.wid === undefined) === (value.region === undefined)) {
+    ctx.addIssue({
+      code: z.ZodIssueCode.custom,
+      message: 'Either wid or region must be specified',
+    });
+  }
+}).describe('Waits until a window or a screen area stops changing, e.g. a page finished loading');
+
+const waitForIdleResponseSchema = z.object({
+  idle: z.boolean().describe('False if timeout has passed'),
+  elapsedMs: z.number().describe('Time from the request to the idle period end or timeout'),
+  damageEvents: z.number().describe('Number of redraws noticed while waiting'),
+});
+
+const frameSocketRequestSchema = z.object({
+  name: z.string()
+    .max(64)
+    .regex(/^[\w.-]+$/u, 'Name must be a file name of letters, digits, ".", "_" and "-"')
+    .refine((name) => name !== '.' && name !== '..', 'Name must be a file name')
+    .default('screen-frames.sock')
+    .describe('Socket file name, it is created in $XDG_RUNTIME_DIR/http-remote-pc-control of the server'),
+  slots: z.number().int().min(1).max(16).default(4).describe('Ring slots, every connected client holds one frame'),
+}).strict().describe('Shares captures with processes on this host over a Unix socket');
+
+const frameSocketResponseSchema = z.object({
+  path: z.string().describe('Absolute path of the Unix socket'),
+  slots: z.number().describe('Ring slots'),
+  slotSize: z.number().describe('Bytes of a ring slot, it fits the whole screen'),
+});
+
+const templateMatchSchema = z.object({
+  x: z.number().describe('Left position of the match in screen coordinates'),
+  y: z.number().describe('Top position of the match in screen coordinates'),
+  width: z.number().describe('Width of the match in pixels'),
+  height: z.number().describe('Height of the match in pixels'),
+  score: z.number().describe('Similarity 0..1, 1 is an exact match'),
+});
+
+class CaptureQueryDto extends createZodDto(captureQuerySchema) {}
+class StreamQueryDto extends createZodDto(streamQuerySchema) {}
+class PixelQueryDto extends createZodDto(pixelQuerySchema) {}
+class PixelResponseDto extends createZodDto(pixelResponseSchema) {}
+class GetPixelsRequestDto extends createZodDto(getPixelsRequestSchema) {}
+class WaitForPixelRequestDto extends createZodDto(waitForPixelRequestSchema) {}
+class WaitForPixelResponseDto extends createZodDto(waitForPixelResponseSchema) {}
+class WaitForIdleRequestDto extends createZodDto(waitForIdleRequestSchema) {}
+class WaitForIdleResponseDto extends createZodDto(waitForIdleResponseSchema) {}
+class FrameSocketRequestDto extends createZodDto(frameSocketRequestSchema) {}
+class FrameSocketResponseDto extends createZodDto(frameSocketResponseSchema) {}
+class FindTemplateRequestDto extends createZodDto(findTemplateRequestSchema) {}
+class TemplateMatchResponseDto extends createZodDto(templateMatchSchema) {}
+
+type CaptureQuery = z.infer<typeof captureQuerySchema>;
+type StreamQuery = z.infer<typeof streamQuerySchema>;
+type PixelResponse = z.infer<typeof pixelResponseSchema>;
+type WaitForPixelRequest = z.infer<typeof waitForPixelRequestSchema>;
+type WaitForPixelResponse = z.infer<typeof waitForPixelResponseSchema>;
+type WaitForIdleRequest = z.infer<typeof waitForIdleRequestSchema>;
+type WaitForIdleResponse = z.infer<typeof waitForIdleResponseSchema>;
+type FrameSocketRequest = z.infer<typeof frameSocketRequestSchema>;
+type FrameSocketResponse = z.infer<typeof frameSocketResponseSchema>;
+type FindTemplateRequest = z.infer<typeof findTemplateRequestSchema>;
+type TemplateMatchResponse = z.infer<typeof templateMatchSchema>;
+
+export {
+  captureQuerySchema,
+  CaptureQueryDto,
+  streamQuerySchema,
+  StreamQueryDto,
+  colorSchema,
+  pixelQuerySchema,
+  pixelResponseSchema,
+  getPixelsRequestSchema,
+  waitForPixelRequestSchema,
+  waitForPixelResponseSchema,
+  PixelQueryDto,
+  PixelResponseDto,
+  GetPixelsRequestDto,
+  WaitForPixelRequestDto,
+  WaitForPixelResponseDto,
+  waitForIdleRequestSchema,
+  waitForIdleResponseSchema,
+  WaitForIdleRequestDto,
+  WaitForIdleResponseDto,
+  frameSocketRequestSchema,
+  frameSocketResponseSchema,
+  FrameSocketRequestDto,
+  FrameSocketResponseDto,
+  findTemplateRequestSchema,
+  templateMatchSchema,
+  FindTemplateRequestDto,
+  TemplateMatchResponseDto,
+};
+
+export type {
+  CaptureQuery,
+  StreamQuery,
+  PixelResponse,
+  WaitForPixelRequest,
+  WaitForPixelResponse,
+  WaitForIdleRequest,
+  WaitForIdleResponse,
+  FrameSocketRequest,
+  FrameSocketResponse,
+  FindTemplateRequest,
+  TemplateMatchResponse,
+};
@@ -0,0 +1,14 @@
+import {Logger, Module} from '@nestjs/common';
+import {CaptureController} from '@/capture/capture-controller';
+import {CaptureService} from '@/capture/capture-service';
+import {CaptureStreamService} from '@/capture/capture-stream-service';
+import {MouseModule} from '@/mouse/mouse-module';
+
+@Module({
+  imports: [MouseModule],
+  providers: [CaptureService, CaptureStreamService, Logger],
+  controllers: [CaptureController],
+  exports: [CaptureService],
+})
+export class CaptureModule {
+}
@@ -0,0 +1,165 @@
+import {Inject, Injectable, Logger, NotFoundException} from '@nestjs/common';
+import {
+  CaptureFrame,
+  CaptureNativeModule,
+  CaptureTarget,
+  DamageNativeModule,
+  EncodedImage,
+  FrameSocketNativeModule,
+  Native,
+  PixelColor,
+  PixelNativeModule,
+  TemplateMatch,
+  TemplateMatchNativeModule,
+} from '@/native/native-model';
+import {
+  CaptureQuery,
+  FindTemplateRequest,
+  PixelResponse,
+  WaitForPixelRequest,
+  WaitForPixelResponse,
+  WaitForIdleRequest,
+  WaitForIdleResponse,
+  FrameSocketRequest,
+  FrameSocketResponse,
+} from '@/capture/capture-dto';
+import {MouseService} from '@/mouse/mouse-service';
+import {Safe400} from '@/utils/decorators';
+import {OS_INJECT} from '@/global/global-model';
+
+@Injectable()
+export class CaptureService {
+  constructor(
+    readonly logger: Logger,
+    @Inject(OS_INJECT)
+    readonly os: NodeJS.Platform,
+    @Inject(Native)
+    private readonly addon: CaptureNativeModule & PixelNativeModule & TemplateMatchNativeModule & DamageNativeModule &
+      FrameSocketNativeModule,
+    private readonly mouseService: MouseService,
+  ) {
+  }
+
+  @Safe400(['linux'])
+  public async captureScreen(query: CaptureQuery): Promise<CaptureFrame> {
+    const frame = await this.addon.captureScreenAsync!(this.toTarget(query));
+    return this.withoutDataInLogs(frame);
+  }
+
+  @Safe400(['linux'])
+  public async captureImage(query: CaptureQuery): Promise<EncodedImage> {
+    const image = await this.addon.captureImageAsync!(this.toTarget(query), {
+      format: query.format as EncodedImage['format'],
+      quality: query.quality,
+      compression: query.compression,
+      width: query.resizeWidth,
+      height: query.resizeHeight,
+    });
+    return this.withoutDataInLogs(image);
+  }
+
+  @Safe400(['linux'])
+  public async getPixel(x: number, y: number): Promise<PixelResponse> {
+    const color = await this.addon.getPixelAsync!(x, y);
+    return {x, y, color: this.toHex(color)};
+  }
+
+  @Safe400(['linux'])
+  public async getPixels(points: {x: number; y: number}[]): Promise<PixelResponse[]> {
+    const colors = await this.addon.getPixelsAsync!(points);
+    return points.map((point, i) => ({...point, color: this.toHex(colors[i])}));
+  }
+
+  @Safe400(['linux'])
+  public async waitForPixel(body: WaitForPixelRequest): Promise<WaitForPixelResponse> {
+    const result = await this.addon.waitForPixelAsync!({
+      region: body.region,
+      color: this.fromHex(body.color),
+      tolerance: body.tolerance,
+      timeoutMs: body.timeoutMs,
+      intervalMs: body.intervalMs,
+    });
+    return {...result, color: result.color && this.toHex(result.color)};
+  }
+
+  @Safe400(['linux'])
+  public async waitForIdle(body: WaitForIdleRequest): Promise<WaitForIdleResponse> {
+    return this.addon.waitForIdleAsync!({
+      wid: body.wid,
+      region: body.region,
+      quietMs: body.quietMs,
+      timeoutMs: body.timeoutMs,
+    });
+  }
+
+  @Safe400(['linux'])
+  public startFrameSocket(body: FrameSocketRequest): FrameSocketResponse {
+    return this.addon.startFrameSocket!({name: body.name, slots: body.slots});
+  }
+
+  @Safe400(['linux'])
+  public stopFrameSocket(): void {
+    this.addon.stopFrameSocket!();
+  }
+
+  public async findTemplate(body: FindTemplateRequest): Promise<TemplateMatch[]> {
+    return this.matchTemplate(this.withoutImageInLogs(body));
+  }
+
+  /**
+   * Left clicks the center of the best match
+   */
+  public async clickTemplate(body: FindTemplateRequest): Promise<TemplateMatch> {
+    const [match] = await this.matchTemplate(this.withoutImageInLogs({...body, maxResults: 1}));
+    if (!match) {
+      throw new NotFoundException(`Image is not found on the screen with threshold ${body.threshold}`);
+    }
+    await this.mouseService.moveLeftClick({
+      x: match.x + Math.floor(match.width / 2),
+      y: match.y + Math.floor(match.height / 2),
+    });
+    return match;
+  }
+
+  // Safe400 logs its arguments, the request must not carry the base64 image there
+  @Safe400(['linux'])
+  private async matchTemplate(body: FindTemplateRequest): Promise<TemplateMatch[]> {
+    return this.addon.findTemplateAsync!(Buffer.from(body.image, 'base64'), {
+      region: body.region,
+      threshold: body.threshold,
+      maxResults: body.maxResults,
+    });
+  }
+
+  private toHex(color: PixelColor): string {
+    return `#${[color.r, color.g, color.b].map((channel) => channel.toString(16).padStart(2, '0')).join('')}`;
+  }
+
+  private fromHex(color: string): PixelColor {
+    const value = parseInt(color.slice(1), 16);
+    return {r: value >> 16 & 0xFF, g: value >> 8 & 0xFF, b: value & 0xFF};
+  }
+
+  // Keeps megabytes of pixels out of the logs
+  private withoutDataInLogs<T extends {data: Buffer}>(image: T): T {
+    return Object.defineProperty(image, 'toJSON', {
+      value: () => ({...image, data: `<${image.data.length} bytes>`}),
+    });
+  }
+
+  private withoutImageInLogs(body: FindTemplateRequest): FindTemplateRequest {
+    return Object.defineProperty({...body}, 'toJSON', {
+      value: () => ({...body, image: `<${body.image.length} base64 chars>`}),
+    });
+  }
+
+  private toTarget(query: CaptureQuery): CaptureTarget | undefined {
+    if (query.monitor !== undefined) {
+      return {monitor: query.monitor};
+    }
+    if (query.x !== undefined) {
+      return {x: query.x, y: query.y!, width: query.width!, height: query.height!};
+    }
+    return undefined;
+  }
+}
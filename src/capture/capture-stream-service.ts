@@ -0,0 +1,203 @@
+import {Inject, Injectable, Logger} from '@nestjs/common';
+import type {Response} from 'express';
+import {
+  CaptureTarget,
+  Native,
+  ScreenStreamInfo,
+  ScreenStreamNativeModule,
+  StreamFrame,
+} from '@/native/native-model';
+import {StreamQuery} from '@/capture/capture-dto';
+import {Safe400} from '@/utils/decorators';
+import {OS_INJECT} from '@/global/global-model';
+
+const BOUNDARY = 'frame';
+
+interface StreamViewer {
+  res: Response;
+  // Joined or skipped tiles, it can only continue from a frame with every tile
+  needsFull: boolean;
+}
+
+interface StreamHub {
+  key: string;
+  stream: ScreenStreamInfo;
+  tiles: boolean;
+  viewers: Set<StreamViewer>;
+  // Frames sent so far, numbers tiles that belong to the same frame
+  sequence: number;
+  running: boolean;
+  closed: boolean;
+}
+
+/**
+ * Screen streams shared by viewers of the same area and settings. A single loop per stream pulls frames from
+ * the addon, which resolves them only when the screen changes, and writes them to every viewer.
+ * Viewers whose sockets are still busy with the previous frame skip frames, the loop waits only when all of them are
+ */
+@Injectable()
+export class CaptureStreamService {
+  private readonly hubs = new Map<string, StreamHub>();
+
+  constructor(
+    readonly logger: Logger,
+    @Inject(OS_INJECT)
+    readonly os: NodeJS.Platform,
+    @Inject(Native)
+    private readonly addon: ScreenStreamNativeModule,
+  ) {
+  }
+
+  /**
+   * Opens a stream of the query or reuses the running one, returns its key for addViewer
+   */
+  @Safe400(['linux'])
+  public openStream(query: StreamQuery): string {
+    const key = JSON.stringify(query);
+    if (!this.hubs.has(key)) {
+      const stream = this.addon.openScreenStream!(this.toTarget(query), {
+        tiles: query.mode === 'tiles',
+        tileSize: query.tileSize,
+        quality: query.quality,
+        maxFps: query.maxFps,
+      });
+      this.hubs.set(key, {
+        key,
+        stream,
+        tiles: query.mode === 'tiles',
+        viewers: new Set(),
+        sequence: 0,
+        running: false,
+        closed: false,
+      });
+    }
+    return key;
+  }
+
+  /**
+   * Streams frames to res as a multipart response until the client disconnects
+   */
+  public addViewer(key: string, res: Response): void {
+    const hub = this.hubs.get(key)!;
+    res.status(200).set({
+      // Every frame replaces the previous one in a browser, tiles are applied on top of each other by the client
+      'Content-Type': `multipart/${hub.tiles ? 'mixed' : 'x-mixed-replace'}; boundary=${BOUNDARY}`,
+      'Cache-Control': 'no-store',
+      'X-Image-X': String(hub.stream.x),
+      'X-Image-Y': String(hub.stream.y),
+      'X-Image-Width': String(hub.stream.width),
+      'X-Image-Height': String(hub.stream.height),
+    });
+    res.flushHeaders();
+    const viewer: StreamViewer = {res, needsFull: true};
+    hub.viewers.add(viewer);
+    res.on('close', () => this.removeViewer(hub, viewer));
+    if (!hub.running) {
+      void this.run(hub);
+    }
+  }
+
+  private removeViewer(hub: StreamHub, viewer: StreamViewer): void {
+    hub.viewers.delete(viewer);
+    if (hub.viewers.size === 0) {
+      this.close(hub);
+    }
+  }
+
+  private close(hub: StreamHub): void {
+    if (hub.closed) {
+      return;
+    }
+    hub.closed = true;
+    this.hubs.delete(hub.key);
+    // Rejects the pending frame, which ends the loop
+    this.addon.closeScreenStream!(hub.stream.id);
+  }
+
+  private async run(hub: StreamHub): Promise<void> {
+    hub.running = true;
+    try {
+      while (!hub.closed) {
+        const ready = [...hub.viewers].filter((viewer) => !viewer.res.writableNeedDrain);
+        if (ready.length === 0) {
+          await this.drained(hub);
+          continue;
+        }
+        const frame = await this.addon.nextScreenFrameAsync!(hub.stream.id, ready.some((viewer) => viewer.needsFull));
+        hub.sequence++;
+        for (const viewer of hub.viewers) {
+          this.send(hub, viewer, frame);
+        }
+      }
+    } catch (e: unknown) {
+      if (!hub.closed) {
+        this.logger.error(`Screen stream ${hub.stream.id} failed: ${(e as Error)?.message ?? e}`, (e as Error)?.stack);
+        for (const viewer of hub.viewers) {
+          viewer.res.end();
+        }
+        this.close(hub);
+      }
+    }
+  }
+
+  private send(hub: StreamHub, viewer: StreamViewer, frame: StreamFrame): void {
+    if (viewer.res.writableNeedDrain) {
+      // Tiles of the skipped frame are lost for this viewer
+      viewer.needsFull = hub.tiles;
+      return;
+    }
+    if (hub.tiles && viewer.needsFull && !frame.full) {
+      // The full frame requested for it is the next one
+      return;
+    }
+    for (const tile of frame.tiles) {
+      const headers = [
+        `--${BOUNDARY}`,
+        'Content-Type: image/jpeg',
+        `Content-Length: ${tile.data.length}`,
+      ];
+      if (hub.tiles) {
+        headers.push(
+          `X-Frame: ${hub.sequence}`,
+          `X-Frame-Full: ${frame.full}`,
+          `X-Tile-X: ${tile.x}`,
+          `X-Tile-Y: ${tile.y}`,
+          `X-Tile-Width: ${tile.width}`,
+          `X-Tile-Height: ${tile.height}`,
+        );
+      }
+      viewer.res.write(`${headers.join('\r\n')}\r\n\r\n`);
+      viewer.res.write(tile.data);
+      viewer.res.write('\r\n');
+    }
+    viewer.needsFull = false;
+  }
+
+  // Resolves once a viewer can take more data or leaves
+  private async drained(hub: StreamHub): Promise<void> {
+    const responses = [...hub.viewers].map((viewer) => viewer.res);
+    return new Promise((resolve) => {
+      const done = (): void => {
+        for (const res of responses) {
+          res.off('drain', done);
+          res.off('close', done);
+        }
+        resolve();
+      };
+      for (const res of responses) {
+        res.once('drain', done);
+        res.once('close', done);
+      }
+    });
+  }
+
+  private toTarget(query: StreamQuery): CaptureTarget | undefined {
+    if (query.monitor !== undefined) {
+      return {monitor: query.monitor};
+    }
+    if (query.x !== undefined) {
+      return {x: query.x, y: query.y!, width: query.width!, height: query.height!};
+    }
+    return undefined;
+  }
+}
@@ -0,0 +1,29 @@
+import {Body, Controller, Delete, HttpCode, NotFoundException, Param, ParseIntPipe, Post} from '@nestjs/common';
+import {ApiOperation, ApiResponse, ApiTags} from '@nestjs/swagger';
+import {InputService} from '@/input/input-service';
+import {PlayTimelineRequestDto, PlayTimelineResponseDto} from '@/input/input-dto';
+
+@ApiTags('Input')
+@Controller('input')
+export class InputController {
+  constructor(
+    private readonly inputService: InputService,
+  ) {
+  }
+
+  @Post('timeline')
+  @ApiOperation({summary: 'Replays keyboard and mouse events at microsecond offsets. Responds when all events are sent or timeline is cancelled'})
+  @ApiResponse({type: PlayTimelineResponseDto})
+  async playTimeline(@Body() body: PlayTimelineRequestDto): Promise<PlayTimelineResponseDto> {
+    return this.inputService.playTimeline(body);
+  }
+
+  @Delete('timeline/:id')
+  @ApiOperation({summary: 'Cancels a queued or playing timeline. Already sent events are not reverted'})
+  @HttpCode(204)
+  cancelTimeline(@Param('id', ParseIntPipe) id: number): void {
+    if (!this.inputService.cancelTimeline(id)) {
+      throw new NotFoundException(`Timeline ${id} is not running`);
+    }
+  }
+}
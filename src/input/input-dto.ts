@@ -0,0 +1,80 @@
+import {z} from 'zod';
+import {createZodDto} from '@anatine/zod-nestjs';
+import {keySchema} from '@/keyboard/keyboard-dto';
+import {mouseButtonSchema} from '@/mouse/mouse-dto';
+
+// One timeline holds the timeline queue, so it can't run for longer than this
+const MAX_OFFSET_US = 10 * 60 * 1000 * 1000;
+const MAX_TIMELINE_EVENTS = 10000;
+
+const offsetUsSchema = z.number()
+  .int()
+  .min(0)
+  .max(MAX_OFFSET_US)
+  .describe('Offset from the timeline start in microseconds, at most 10 minutes. ' +
+    'Events with equal offsets are sent in the request order');
+
+const timelineEventSchema = z.discriminatedUnion('type', [
+  z.object({
+    type: z.literal('key'),
+    offsetUs: offsetUsSchema,
+    key: keySchema,
+    down: z.boolean().describe('Whether to press or release the key'),
+  }).strict().describe('Presses or releases a key'),
+  z.object({
+    type: z.literal('button'),
+    offsetUs: offsetUsSchema,
+    button: mouseButtonSchema,
+    down: z.boolean().describe('Whether to press or release the button'),
+  }).strict().describe('Presses or releases a mouse button'),
+  z.object({
+    type: z.literal('move'),
+    offsetUs: offsetUsSchema,
+    x: z.number().int().describe('X coordinate to move mouse to'),
+    y: z.number().int().describe('Y coordinate to move mouse to'),
+  }).strict().describe('Moves mouse to the point, absolute coordinate for all monitors'),
+  z.object({
+    type: z.literal('text'),
+    offsetUs: offsetUsSchema,
+    text: z.string(),
+  }).strict().describe('Types text as fast as possible'),
+]);
+
+const timelineIdSchema = z.number()
+  .int()
+  .min(0)
+  .max(0x7FFFFFFF)
+  .describe('Id to cancel the timeline with. Generated if not provided');
+
+const playTimelineRequestSchema = z.object({
+  id: timelineIdSchema.optional(),
+  events: z.array(timelineEventSchema).min(1).max(MAX_TIMELINE_EVENTS),
+}).strict().describe('Keyboard and mouse events replayed natively at their offsets');
+
+const playTimelineResponseSchema = z.object({
+  id: z.number().describe('Timeline id'),
+  cancelled: z.boolean().describe('Whether timeline was cancelled before all events were sent'),
+  events: z.array(z.object({
+    requestedUs: z.number().describe('Requested offset in microseconds'),
+    actualUs: z.number().optional().describe('Offset the event was actually sent at. Absent if it was skipped because of cancellation'),
+  })).describe('Timings of every event in the request order'),
+}).describe('Result of the timeline replay');
+
+class PlayTimelineRequestDto extends createZodDto(playTimelineRequestSchema) {}
+class PlayTimelineResponseDto extends createZodDto(playTimelineResponseSchema) {}
+
+type PlayTimelineRequest = z.infer<typeof playTimelineRequestSchema>;
+type PlayTimelineResponse = z.infer<typeof playTimelineResponseSchema>;
+
+export {
+  timelineEventSchema,
+  playTimelineRequestSchema,
+  playTimelineResponseSchema,
+  PlayTimelineRequestDto,
+  PlayTimelineResponseDto,
+};
+
+export type {
+  PlayTimelineRequest,
+  PlayTimelineResponse,
+};
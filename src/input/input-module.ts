@@ -0,0 +1,11 @@
+import {Logger, Module} from '@nestjs/common';
+import {InputController} from '@/input/input-controller';
+import {InputService} from '@/input/input-service';
+
+@Module({
+  providers: [InputService, Logger],
+  controllers: [InputController],
+  exports: [InputService],
+})
+export class InputModule {
+}
@@ -0,0 +1,55 @@
+import {Inject, Injectable, Logger} from '@nestjs/common';
+import {InputNativeModule, InputTimelineEvent, InputTimelineResult, Native} from '@/native/native-model';
+import {PlayTimelineRequest, PlayTimelineResponse} from '@/input/input-dto';
+import {Safe400} from '@/utils/decorators';
+import {OS_INJECT} from '@/global/global-model';
+
+// Ids above client ones, so generated ids never collide with requested
+const GENERATED_ID_START = 0x80000000;
+const GENERATED_ID_END = 0xFFFFFFFF;
+
+@Injectable()
+export class InputService {
+  private nextId = GENERATED_ID_START;
+
+  constructor(
+    readonly logger: Logger,
+    @Inject(OS_INJECT)
+    readonly os: NodeJS.Platform,
+    @Inject(Native)
+    private readonly addon: InputNativeModule,
+  ) {
+  }
+
+  /**
+   * Whether the platform replays timelines natively
+   */
+  public get timelineSupported(): boolean {
+    return !!this.addon.playInputTimelineAsync;
+  }
+
+  public async play(events: InputTimelineEvent[], id: number = this.generateId()): Promise<InputTimelineResult> {
+    if (!this.addon.playInputTimelineAsync) {
+      throw new Error('Input timelines are not supported on this platform');
+    }
+    return this.addon.playInputTimelineAsync(id, events);
+  }
+
+  @Safe400(['linux'])
+  public async playTimeline(body: PlayTimelineRequest): Promise<PlayTimelineResponse> {
+    const id = body.id ?? this.generateId();
+    const result = await this.play(body.events, id);
+    return {id, ...result};
+  }
+
+  @Safe400(['linux'])
+  public cancelTimeline(id: number): boolean {
+    return this.addon.cancelInputTimeline!(id);
+  }
+
+  private generateId(): number {
+    const id = this.nextId;
+    this.nextId = id === GENERATED_ID_END ? GENERATED_ID_START : id + 1;
+    return id;
+  }
+}
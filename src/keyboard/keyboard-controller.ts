@@ -28,7 +28,7 @@ export class KeyboardController {
   @Post('set-layout')
   @ApiOperation({summary: 'Change keyboard layout'})
   @HttpCode(204)
-  setLayout(@Body() body: SetKeyboardLayoutRequestDto): void {
-    this.keyboardService.setLayout(body);
+  async setLayout(@Body() body: SetKeyboardLayoutRequestDto): Promise<void> {
+    await this.keyboardService.setLayout(body);
   }
 }
@@ -2,9 +2,10 @@ import {Module} from '@nestjs/common';
 import {KeyboardController} from '@/keyboard/keyboard-controller';
 import {KeyboardService} from '@/keyboard/keyboard-service';
 import {RandomModule} from '@/random/random.module';
+import {InputModule} from '@/input/input-module';
 
 @Module({
-  imports: [RandomModule],
+  imports: [RandomModule, InputModule],
   controllers: [KeyboardController],
   providers: [
     KeyboardService,
@@ -1,10 +1,14 @@
 import {Inject, Injectable, Logger} from '@nestjs/common';
-import {KeyboardNativeModule, Native} from '@/native/native-model';
+import {InputTimelineEvent, KeyboardNativeModule, Native} from '@/native/native-model';
 import {sleep} from '@/app/shared';
 import {RandomService} from '@/random/random-service';
 import {KeyPressRequest, SetKeyboardLayoutRequest, TypeTextRequest} from '@/keyboard/keyboard-dto';
 import {Safe400} from '@/utils/decorators';
 import {OS_INJECT} from '@/global/global-model';
+import {InputService} from '@/input/input-service';
+
+// Pause after every key down/up of keyPress, in milliseconds
+const KEY_PRESS_GAP = 100;
 
 @Injectable()
 export class KeyboardService {
@@ -14,7 +18,8 @@ export class KeyboardService {
     readonly os: NodeJS.Platform,
     @Inject(Native)
     private readonly addon: KeyboardNativeModule,
-    private readonly rs: RandomService
+    private readonly rs: RandomService,
+    private readonly inputService: InputService,
   ) {
   }
 
@@ -23,6 +28,10 @@ export class KeyboardService {
   public async typeText(body: TypeTextRequest): Promise<void> {
     this.logger.log(`Type: \u001b[35m${body.text}`);
     if (body.keyDelay) {
+      if (this.inputService.timelineSupported) {
+        await this.inputService.play(this.typeTextTimeline(body));
+        return;
+      }
       let realDelay = body.keyDelay;
       for (const char of body.text.split('')) {
         if (body.keyDelayDeviation) {
@@ -30,41 +39,76 @@ export class KeyboardService {
         }
         await sleep(realDelay); // sleep before, in case we are typing on the same pc the shorcut was triggered from
         // to avoid meta keys in keystrokes
-        this.addon.typeString(char);
+        await this.addon.typeStringAsync(char);
       }
     } else {
-      this.addon.typeString(body.text);
+      await this.addon.typeStringAsync(body.text);
     }
   }
 
   @Safe400(['win32', 'linux'])
-  public setLayout(body: SetKeyboardLayoutRequest): void {
-    this.addon.setKeyboardLayout(body.layout);
+  public async setLayout(body: SetKeyboardLayoutRequest): Promise<void> {
+    await this.addon.setKeyboardLayoutAsync(body.layout);
   }
 
   @Safe400(['win32', 'linux'])
   public async keyPress(body: KeyPressRequest): Promise<void> {
+    if (this.inputService.timelineSupported) {
+      await this.inputService.play(this.keyPressTimeline(body));
+      return;
+    }
     for (const key of (body.holdKeys ?? [])) {
       this.logger.log(`HoldKey: \u001b[35m${key}`);
       // libnut.keyToggle(key, 'down', [])
-      this.addon.keyToggle(key, [], true);
-      await sleep(100);
+      await this.addon.keyToggleAsync(key, [], true);
+      await sleep(KEY_PRESS_GAP);
     }
     for (const key of body.keys) {
       this.logger.log(`KeyPress: \u001b[35m${key}`);
       if (body.duration) {
-        this.addon.keyToggle(key, [], true);
+        await this.addon.keyToggleAsync(key, [], true);
         await sleep(body.duration);
-        this.addon.keyToggle(key, [], false);
+        await this.addon.keyToggleAsync(key, [], false);
       } else {
-        this.addon.keyTap(key, []);
+        await this.addon.keyTapAsync(key, []);
       }
-      await sleep(100);
+      await sleep(KEY_PRESS_GAP);
     }
     for (const key of (body.holdKeys ?? [])) {
       this.logger.log(`ReleaseKey: \u001b[35m${key}`);
-      this.addon.keyToggle(key, [], false);
-      await sleep(100);
+      await this.addon.keyToggleAsync(key, [], false);
+      await sleep(KEY_PRESS_GAP);
+    }
+  }
+
+  private keyPressTimeline(body: KeyPressRequest): InputTimelineEvent[] {
+    const events: InputTimelineEvent[] = [];
+    let offsetUs = 0;
+    for (const key of (body.holdKeys ?? [])) {
+      events.push({type: 'key', key, down: true, offsetUs});
+      offsetUs += KEY_PRESS_GAP * 1000;
     }
+    for (const key of body.keys) {
+      events.push({type: 'key', key, down: true, offsetUs});
+      offsetUs += (body.duration ?? 0) * 1000;
+      events.push({type: 'key', key, down: false, offsetUs});
+      offsetUs += KEY_PRESS_GAP * 1000;
+    }
+    for (const key of (body.holdKeys ?? [])) {
+      events.push({type: 'key', key, down: false, offsetUs});
+      offsetUs += KEY_PRESS_GAP * 1000;
+    }
+    this.logger.log(`KeyPress: \u001b[35m${[...(body.holdKeys ?? []), ...body.keys].join('+')}`);
+    return events;
+  }
+
+  private typeTextTimeline(body: TypeTextRequest): InputTimelineEvent[] {
+    let offsetUs = 0;
+    return body.text.split('').map((text) => {
+      // delay goes before every character, in case we are typing on the same pc the shorcut was triggered from
+      const delay = body.keyDelayDeviation ? this.rs.calcDeviation(body.keyDelay!, body.keyDelayDeviation) : body.keyDelay!;
+      offsetUs += delay * 1000;
+      return {type: 'text', text, offsetUs};
+    });
   }
 }
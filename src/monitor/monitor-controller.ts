@@ -11,14 +11,21 @@ export class MonitorController {
   @Get()
   @ApiOperation({summary: 'List monitors'})
   @ApiResponse({type: Number, isArray: true})
-  getMonitors(): number[] {
+  async getMonitors(): Promise<number[]> {
     return this.monitorService.getMonitors();
   }
 
+  @Get('window/:wid')
+  @ApiOperation({summary: 'Get id of the monitor that holds the largest part of the window'})
+  @ApiResponse({type: Number})
+  async getMonitorFromWindow(@Param('wid', ParseIntPipe) wid: number): Promise<number> {
+    return this.monitorService.getMonitorFromWindow(wid);
+  }
+
   @Get(':mid/info')
   @ApiOperation({summary: 'Get monitor info'})
   @ApiResponse({type: MonitorInfoResponseDto})
-  getMonitorInfo(@Param('mid', ParseIntPipe) mid: number): MonitorInfoResponseDto {
+  async getMonitorInfo(@Param('mid', ParseIntPipe) mid: number): Promise<MonitorInfoResponseDto> {
     return this.monitorService.getMonitorInfo(mid);
   }
 }
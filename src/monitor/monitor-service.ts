@@ -13,18 +13,18 @@ export class MonitorService {
   ) {}
 
 
-  @Safe400(['win32'])
-  public getMonitors(): number[] {
-    return this.addon.getMonitors!();
+  @Safe400(['win32', 'linux'])
+  public async getMonitors(): Promise<number[]> {
+    return this.addon.getMonitorsAsync!();
   }
 
   @Safe400(['win32', 'linux'])
-  public getMonitorInfo(mid: number): MonitorInfo {
-    return this.addon.getMonitorInfo(mid);
+  public async getMonitorInfo(mid: number): Promise<MonitorInfo> {
+    return this.addon.getMonitorInfoAsync(mid);
   }
 
-  @Safe400(['win32'])
-  public getMonitorFromWindow(wid: number): number {
-    return this.addon.getMonitorFromWindow!(wid);
+  @Safe400(['win32', 'linux'])
+  public async getMonitorFromWindow(wid: number): Promise<number> {
+    return this.addon.getMonitorFromWindowAsync!(wid);
   }
 }
@@ -18,22 +18,22 @@ export class MouseController {
   @Get('position')
   @ApiOperation({summary: 'Returns X,Y of current mouse position, absolute to all monitors'})
   @ApiResponse({type: MousePositionRRDto})
-  getPosition(): MousePositionRRDto {
+  async getPosition(): Promise<MousePositionRRDto> {
     return this.mouseService.getPosition();
   }
 
   @Post('move-left-click')
   @ApiOperation({summary: 'Instantly moves mouse to the position and performs a left click there'})
   @HttpCode(204)
-  moveLeftClick(@Body() event: MousePositionRRDto): void {
-    this.mouseService.moveLeftClick(event);
+  async moveLeftClick(@Body() event: MousePositionRRDto): Promise<void> {
+    await this.mouseService.moveLeftClick(event);
   }
 
   @Post('move')
   @ApiOperation({summary: 'Mouse move to the point, absolute coordinate for all monitors'})
   @HttpCode(204)
-  setMousePosition(@Body() event: MousePositionRRDto): void {
-    this.mouseService.setMousePosition(event);
+  async setMousePosition(@Body() event: MousePositionRRDto): Promise<void> {
+    await this.mouseService.setMousePosition(event);
   }
 
   @Post('move-human')
@@ -46,7 +46,7 @@ export class MouseController {
   @Post('click')
   @ApiOperation({summary: 'Click mouse on the current position'})
   @HttpCode(204)
-  click(@Body() event: MouseClickRequestDto): void {
-    this.mouseService.click(event);
+  async click(@Body() event: MouseClickRequestDto): Promise<void> {
+    await this.mouseService.click(event);
   }
 }
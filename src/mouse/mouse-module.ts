@@ -5,6 +5,7 @@ import {MouseService} from '@/mouse/mouse-service';
 @Module({
   providers: [MouseService, Logger],
   controllers: [MouseController],
+  exports: [MouseService],
 })
 export class MouseModule {
 }
@@ -20,34 +20,37 @@ export class MouseService {
   }
 
   @Safe400(['win32', 'linux'])
-  // eslint-disable-next-line @typescript-eslint/require-await
-  moveLeftClick(pos: MousePositionRR): void {
+  async moveLeftClick(pos: MousePositionRR): Promise<void> {
     this.logger.log(`Left click: \u001b[35m${JSON.stringify(pos)}`);
-    this.addon.setMousePosition(pos);
-    this.addon.setMouseButtonToState(MouseButton.LEFT, true);
-    this.addon.setMouseButtonToState(MouseButton.LEFT, false);
+    await this.addon.setMousePositionAsync(pos);
+    await this.addon.setMouseButtonToStateAsync(MouseButton.LEFT, true);
+    await this.addon.setMouseButtonToStateAsync(MouseButton.LEFT, false);
   }
 
   @Safe400(['win32', 'linux'])
-  setMousePosition(pos: MousePositionRR): void {
-    this.addon.setMousePosition(pos);
+  async setMousePosition(pos: MousePositionRR): Promise<void> {
+    await this.addon.setMousePositionAsync(pos);
   }
 
   @Safe400(['win32', 'linux'])
-  getPosition(): MousePositionRR {
-    return this.addon.getMousePosition();
+  async getPosition(): Promise<MousePositionRR> {
+    return this.addon.getMousePositionAsync();
   }
 
   @Safe400(['win32', 'linux'])
-  click(body: MouseClickRequest): void {
-    this.addon.setMouseButtonToState(body.button, true);
-    this.addon.setMouseButtonToState(body.button, false);
+  async click(body: MouseClickRequest): Promise<void> {
+    await this.addon.setMouseButtonToStateAsync(body.button, true);
+    await this.addon.setMouseButtonToStateAsync(body.button, false);
   }
 
   @Safe400(['win32', 'linux'])
   async mouseMoveHuman(event: MouseMoveHumanClickRequest): Promise<void> {
     this.logger.log(`Mouse human: \u001b[35m[${event.x},${event.y}]`);
-    const {x: x1, y: y1} = this.addon.getMousePosition();
+    if (this.addon.mouseMoveHumanAsync) {
+      await this.addon.mouseMoveHumanAsync(event);
+      return;
+    }
+    const {x: x1, y: y1} = await this.addon.getMousePositionAsync();
     let x2 = event.x;
     let y2 = event.y;
 
@@ -81,12 +84,12 @@ export class MouseService {
       // Get point on the smooth curve
       const {x, y} = this.getCurvePoint(t, x1, y1, x2, y2, curveIntensity);
       // Move to the calculated position
-      this.addon.setMousePosition({x: Math.round(x), y: Math.round(y)});
+      await this.addon.setMousePositionAsync({x: Math.round(x), y: Math.round(y)});
       await sleep(event.delayBetweenIterations ?? 5);
     }
 
     // Ensure we hit the target exactly
-    this.addon.setMousePosition({x:x2, y:y2});
+    await this.addon.setMousePositionAsync({x:x2, y:y2});
   }
 
   /**
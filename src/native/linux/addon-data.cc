@@ -0,0 +1,35 @@
+#include "./headers/addon-data.h"
+
+static thread_local AddonData* threadAddonData = nullptr;
+
+AddonData::~AddonData() {
+  // Frames still held by JS outlive the connection, their segments are only detached locally
+  closeCapturePool(*capturePool);
+  disconnectXcbWindowContext(windowContext);
+  if (display) {
+    XCloseDisplay(display);
+  }
+}
+
+void addonDataInit(Napi::Env env) {
+  AddonData* data = new AddonData();
+  // Finalizer runs at env teardown, after the cleanup hooks that stop threads of the instance
+  env.SetInstanceData<AddonData>(data);
+  bindAddonData(data);
+  keymapInit(env);
+}
+
+AddonData& addonData() {
+  if (!threadAddonData) {
+    throw NativeError("Native module is not initialized on this thread");
+  }
+  return *threadAddonData;
+}
+
+AddonData* currentAddonData() {
+  return threadAddonData;
+}
+
+void bindAddonData(AddonData* data) {
+  threadAddonData = data;
+}
@@ -0,0 +1,381 @@
+#include "./headers/capture.h"
+#include "./headers/addon-data.h"
+#include "./headers/display.h"
+#include "./headers/image-encode.h"
+#include "./headers/logger.h"
+#include "./headers/monitor.h"
+#include "./headers/native-queue.h"
+#include "./headers/validators.h"
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+// Largest side of a resized image, guards against allocating gigabytes by mistake
+static const uint32_t MAX_RESIZE_SIDE = 16384;
+
+// Free segments kept for reuse, e.g. a full screen one and a couple of region ones
+static const size_t MAX_FREE_SEGMENTS = 4;
+// Segments held by frames at the same time. JS releases them only on GC, clients that keep capturing
+// would otherwise run into shmmax/shmall with 33MB per 4K frame
+static const size_t MAX_LIVE_SEGMENTS = 8;
+
+template <typename T>
+using XcbReply = std::unique_ptr<T, decltype(&free)>;
+
+static void destroySegment(CapturePool& pool, ShmSegment* segment) {
+  if (!pool.closed) {
+    xcb_shm_detach(pool.connection, segment->seg);
+    xcb_flush(pool.connection);
+  }
+  shmdt(segment->data);
+  delete segment;
+}
+
+// Returns frame's segment to the pool
+static void releaseSegment(const std::shared_ptr<CapturePool>& pool, ShmSegment* segment) {
+  std::lock_guard<std::mutex> lock(pool->mutex);
+  pool->liveSegments--;
+  if (!pool->closed && pool->segments.size() < MAX_FREE_SEGMENTS) {
+    pool->segments.push_back(segment);
+    return;
+  }
+  destroySegment(*pool, segment);
+}
+
+CaptureFrame::CaptureFrame(CaptureFrame&& other) noexcept
+  : pool(std::move(other.pool)), segment(other.segment), pixels(std::move(other.pixels)),
+    rect(other.rect), stride(other.stride) {
+  other.segment = nullptr;
+}
+
+CaptureFrame& CaptureFrame::operator=(CaptureFrame&& other) noexcept {
+  if (this != &other) {
+    if (segment) {
+      releaseSegment(pool, segment);
+    }
+    pool = std::move(other.pool);
+    segment = other.segment;
+    pixels = std::move(other.pixels);
+    rect = other.rect;
+    stride = other.stride;
+    other.segment = nullptr;
+  }
+  return *this;
+}
+
+CaptureFrame::~CaptureFrame() {
+  if (segment) {
+    releaseSegment(pool, segment);
+  }
+}
+
+void closeCapturePool(CapturePool& pool) {
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  for (ShmSegment* segment : pool.segments) {
+    destroySegment(pool, segment);
+  }
+  pool.segments.clear();
+  pool.closed = true;
+}
+
+// Creates a segment and attaches it to the server, nullptr if the server can't use it
+static ShmSegment* createSegment(xcb_connection_t* connection, size_t size) {
+  int shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+  if (shmid < 0) {
+    throw NativeError("Failed to allocate shared memory for capture: " + std::string(strerror(errno)));
+  }
+  void* data = shmat(shmid, nullptr, 0);
+  if (data == reinterpret_cast<void*>(-1)) {
+    shmctl(shmid, IPC_RMID, nullptr);
+    throw NativeError("Failed to attach shared memory for capture: " + std::string(strerror(errno)));
+  }
+  xcb_shm_seg_t seg = xcb_generate_id(connection);
+  xcb_generic_error_t* error = xcb_request_check(connection, xcb_shm_attach_checked(connection, seg, shmid, 0));
+  // Segment is destroyed once both the server and this process have detached it, even if the process crashes
+  shmctl(shmid, IPC_RMID, nullptr);
+  if (error) {
+    free(error);
+    shmdt(data);
+    return nullptr;
+  }
+  return new ShmSegment{shmid, seg, static_cast<uint8_t*>(data), size};
+}
+
+// Smallest free segment that fits, a new one if none does. nullptr when MIT-SHM can't be used
+// or frames hold MAX_LIVE_SEGMENTS already
+static ShmSegment* acquireSegment(CapturePool& pool, xcb_connection_t* connection, size_t size) {
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  if (pool.shmUnavailable) {
+    return nullptr;
+  }
+  pool.connection = connection;
+  auto best = pool.segments.end();
+  for (auto it = pool.segments.begin(); it != pool.segments.end(); ++it) {
+    if ((*it)->size >= size && (best == pool.segments.end() || (*it)->size < (*best)->size)) {
+      best = it;
+    }
+  }
+  if (best != pool.segments.end()) {
+    ShmSegment* segment = *best;
+    pool.segments.erase(best);
+    pool.liveSegments++;
+    return segment;
+  }
+  if (pool.liveSegments >= MAX_LIVE_SEGMENTS) {
+    return nullptr;
+  }
+
+  const xcb_query_extension_reply_t* shm = xcb_get_extension_data(connection, &xcb_shm_id);
+  ShmSegment* segment = shm && shm->present ? createSegment(connection, size) : nullptr;
+  if (!segment) {
+    LOG("MIT-SHM is not available, screen is captured with GetImage");
+    pool.shmUnavailable = true;
+    return nullptr;
+  }
+  pool.liveSegments++;
+  return segment;
+}
+
+static uint32_t bitsPerPixel(const xcb_setup_t* setup, uint8_t depth) {
+  for (xcb_format_iterator_t it = xcb_setup_pixmap_formats_iterator(setup); it.rem; xcb_format_next(&it)) {
+    if (it.data->depth == depth) {
+      return it.data->bits_per_pixel;
+    }
+  }
+  return 0;
+}
+
+static CaptureRect resolveTarget(const CaptureTarget& target, const xcb_screen_t* screen) {
+  CaptureRect root = {0, 0, screen->width_in_pixels, screen->height_in_pixels};
+  CaptureRect rect = root;
+  if (target.type == CaptureTarget::Type::Monitor) {
+    MonitorRect bounds = queryMonitorInfo(target.monitor).bounds;
+    rect = {bounds.x, bounds.y, bounds.width, bounds.height};
+  } else if (target.type == CaptureTarget::Type::Rect) {
+    rect = target.rect;
+  }
+  int left = std::max(rect.x, 0);
+  int top = std::max(rect.y, 0);
+  int right = std::min(rect.x + rect.width, root.width);
+  int bottom = std::min(rect.y + rect.height, root.height);
+  if (right <= left || bottom <= top) {
+    throw NativeError("Capture area is outside of the screen");
+  }
+  return {left, top, right - left, bottom - top};
+}
+
+static void getImageIntoSegment(xcb_connection_t* connection, const xcb_screen_t* screen, const CaptureRect& rect,
+  xcb_shm_seg_t seg, uint32_t offset) {
+  xcb_generic_error_t* error = nullptr;
+  XcbReply<xcb_shm_get_image_reply_t> reply(xcb_shm_get_image_reply(connection, xcb_shm_get_image(
+    connection, screen->root, rect.x, rect.y, rect.width, rect.height,
+    ~0u, XCB_IMAGE_FORMAT_Z_PIXMAP, seg, offset), &error), free);
+  if (!reply) {
+    std::string errorMsg = xcbErrorMessage("Failed to capture screen", error);
+    free(error);
+    throw NativeError(errorMsg);
+  }
+}
+
+CaptureRect resolveCaptureTarget(const CaptureTarget& target) {
+  xcb_connection_t* connection = xGetMainConnection();
+  return resolveTarget(target, xcb_setup_roots_iterator(xcb_get_setup(connection)).data);
+}
+
+CaptureFrame captureScreen(const CaptureTarget& target) {
+  AddonData& data = addonData();
+  xcb_connection_t* connection = xGetMainConnection();
+  const xcb_setup_t* setup = xcb_get_setup(connection);
+  const xcb_screen_t* screen = xcb_setup_roots_iterator(setup).data;
+  if (bitsPerPixel(setup, screen->root_depth) != 32) {
+    throw NativeError("Capture supports only 32 bits per pixel screens");
+  }
+
+  CaptureFrame frame;
+  frame.pool = data.capturePool;
+  frame.rect = resolveTarget(target, screen);
+  frame.stride = static_cast<uint32_t>(frame.rect.width) * 4;
+
+  frame.segment = acquireSegment(*frame.pool, connection, frame.size());
+  if (frame.segment) {
+    getImageIntoSegment(connection, screen, frame.rect, frame.segment->seg, 0);
+    return frame;
+  }
+
+  xcb_generic_error_t* error = nullptr;
+  XcbReply<xcb_get_image_reply_t> reply(xcb_get_image_reply(connection, xcb_get_image(
+    connection, XCB_IMAGE_FORMAT_Z_PIXMAP, screen->root, frame.rect.x, frame.rect.y,
+    frame.rect.width, frame.rect.height, ~0u), &error), free);
+  if (!reply) {
+    std::string errorMsg = xcbErrorMessage("Failed to capture screen", error);
+    free(error);
+    throw NativeError(errorMsg);
+  }
+  const uint8_t* pixels = xcb_get_image_data(reply.get());
+  frame.pixels.assign(pixels, pixels + std::min<size_t>(xcb_get_image_data_length(reply.get()), frame.size()));
+  frame.pixels.resize(frame.size());
+  return frame;
+}
+
+CaptureRect captureScreenInto(const CaptureTarget& target, xcb_shm_seg_t seg, uint32_t offset, size_t capacity) {
+  xcb_connection_t* connection = xGetMainConnection();
+  const xcb_setup_t* setup = xcb_get_setup(connection);
+  const xcb_screen_t* screen = xcb_setup_roots_iterator(setup).data;
+  if (bitsPerPixel(setup, screen->root_depth) != 32) {
+    throw NativeError("Capture supports only 32 bits per pixel screens");
+  }
+  CaptureRect rect = resolveTarget(target, screen);
+  if (static_cast<size_t>(rect.width) * rect.height * 4 > capacity) {
+    throw NativeError("Capture area doesn't fit into the shared memory slot");
+  }
+  getImageIntoSegment(connection, screen, rect, seg, offset);
+  return rect;
+}
+
+CaptureTarget parseCaptureTarget(const Napi::CallbackInfo& info, size_t index) {
+  CaptureTarget target;
+  if (info.Length() <= index || info[index].IsUndefined() || info[index].IsNull()) {
+    return target;
+  }
+  GET_OBJECT(info, index, area);
+  if (area.Has("monitor")) {
+    ASSERT_OBJECT_NUMBER(info, index, monitor);
+    target.type = CaptureTarget::Type::Monitor;
+    target.monitor = area.Get("monitor").As<Napi::Number>().Uint32Value();
+    return target;
+  }
+  ASSERT_OBJECT_NUMBER(info, index, x);
+  ASSERT_OBJECT_NUMBER(info, index, y);
+  ASSERT_OBJECT_NUMBER(info, index, width);
+  ASSERT_OBJECT_NUMBER(info, index, height);
+  target.type = CaptureTarget::Type::Rect;
+  target.rect = {
+    area.Get("x").As<Napi::Number>().Int32Value(),
+    area.Get("y").As<Napi::Number>().Int32Value(),
+    area.Get("width").As<Napi::Number>().Int32Value(),
+    area.Get("height").As<Napi::Number>().Int32Value(),
+  };
+  if (target.rect.width <= 0 || target.rect.height <= 0) {
+    throw Napi::Error::New(info.Env(), "Capture width and height must be positive");
+  }
+  return target;
+}
+
+// Pixels are handed to JS without a copy, the frame lives until the Buffer is garbage collected.
+// Its size is reported to V8, so frames dropped by JS are collected before they pile up
+static Napi::Value captureFrameToObject(Napi::Env env, CaptureFrame& captured) {
+  CaptureFrame* frame = new CaptureFrame(std::move(captured));
+  int64_t size = static_cast<int64_t>(frame->size());
+  Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(
+    env, frame->data(), frame->size(), [size](Napi::Env env, uint8_t*, CaptureFrame* hint) {
+      Napi::MemoryManagement::AdjustExternalMemory(env, -size);
+      delete hint;
+    }, frame);
+  Napi::MemoryManagement::AdjustExternalMemory(env, size);
+
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("x", frame->rect.x);
+  obj.Set("y", frame->rect.y);
+  obj.Set("width", frame->rect.width);
+  obj.Set("height", frame->rect.height);
+  obj.Set("stride", frame->stride);
+  obj.Set("format", "bgra");
+  obj.Set("data", buffer);
+  return obj;
+}
+
+// Resolves with {x, y, width, height, stride, format: 'bgra', data: Buffer}.
+// Buffer memory is shared with the X server until it's garbage collected, don't keep it longer than needed
+static Napi::Value captureScreenAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CaptureTarget target = parseCaptureTarget(info, 0);
+  return runOnNativeQueue<CaptureFrame>(env, [=] { return captureScreen(target); }, captureFrameToObject);
+}
+
+int32_t getIntOption(Napi::Env env, Napi::Object options, const char* name, int32_t min, int32_t max,
+  int32_t fallback) {
+  Napi::Value value = options.Get(name);
+  if (value.IsUndefined()) {
+    return fallback;
+  }
+  if (!value.IsNumber()) {
+    throw Napi::TypeError::New(env, std::string("Option '") + name + "' must be a number");
+  }
+  int32_t number = value.As<Napi::Number>().Int32Value();
+  if (number < min || number > max) {
+    throw Napi::RangeError::New(env, std::string("Option '") + name + "' must be in range " +
+      std::to_string(min) + ".." + std::to_string(max));
+  }
+  return number;
+}
+
+static ImageEncodeOptions parseImageEncodeOptions(const Napi::CallbackInfo& info, size_t index) {
+  Napi::Env env = info.Env();
+  GET_OBJECT(info, index, object);
+  ImageEncodeOptions options;
+  Napi::Value format = object.Get("format");
+  std::string name = format.IsString() ? format.As<Napi::String>().Utf8Value() : "";
+  if (name == "png") {
+    options.format = ImageFormat::Png;
+  } else if (name == "jpeg") {
+    options.format = ImageFormat::Jpeg;
+  } else if (name == "qoi") {
+    options.format = ImageFormat::Qoi;
+  } else {
+    throw Napi::TypeError::New(env, "Option 'format' must be one of png, jpeg, qoi");
+  }
+  options.quality = getIntOption(env, object, "quality", 1, 100, options.quality);
+  options.compression = getIntOption(env, object, "compression", 0, 9, options.compression);
+  options.width = getIntOption(env, object, "width", 0, MAX_RESIZE_SIDE, 0);
+  options.height = getIntOption(env, object, "height", 0, MAX_RESIZE_SIDE, 0);
+  return options;
+}
+
+// Encoded bytes are handed to JS without a copy, the vector lives until the Buffer is garbage collected
+static Napi::Value encodedImageToObject(Napi::Env env, EncodedImage& encoded) {
+  std::vector<uint8_t>* bytes = new std::vector<uint8_t>(std::move(encoded.data));
+  Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(
+    env, bytes->data(), bytes->size(), [](Napi::Env, uint8_t*, std::vector<uint8_t>* hint) { delete hint; }, bytes);
+
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("width", encoded.width);
+  obj.Set("height", encoded.height);
+  obj.Set("format", imageFormatName(encoded.format));
+  obj.Set("data", buffer);
+  return obj;
+}
+
+// Captures like captureScreenAsync, then resizes and encodes the frame.
+// Resolves with {width, height, format, data: Buffer}
+static Napi::Value captureImageAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CaptureTarget target = parseCaptureTarget(info, 0);
+  ImageEncodeOptions options = parseImageEncodeOptions(info, 1);
+  addonData().encodeWorkers.start(env);
+  return runOnNativeQueue<CaptureFrame>(env, [=] { return captureScreen(target); },
+    [options](Napi::Env env, CaptureFrame& captured) -> Napi::Value {
+      // Encoding doesn't use X, the native queue is free for the next request while it runs.
+      // The capture promise adopts the encoding one
+      std::shared_ptr<CaptureFrame> frame = std::make_shared<CaptureFrame>(std::move(captured));
+      AddonData& data = addonData();
+      WorkerPool* pool = &data.encodeWorkers;
+      return runOnQueue<EncodedImage>(data.encodeQueue, env, [frame, options, pool] {
+        RawImage image = {frame->data(), static_cast<uint32_t>(frame->rect.width),
+          static_cast<uint32_t>(frame->rect.height), frame->stride};
+        EncodedImage encoded = encodeImage(image, options, *pool);
+        // Segment goes back to the pool right away instead of when the task is settled
+        *frame = CaptureFrame();
+        return encoded;
+      }, encodedImageToObject);
+    });
+}
+
+Napi::Object captureInit(Napi::Env env, Napi::Object exports) {
+  exports.Set("captureScreenAsync", Napi::Function::New(env, captureScreenAsync));
+  exports.Set("captureImageAsync", Napi::Function::New(env, captureImageAsync));
+  return exports;
+}
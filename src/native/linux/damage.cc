@@ -0,0 +1,435 @@
+#include "./headers/damage.h"
+#include "./headers/addon-data.h"
+#include "./headers/logger.h"
+#include "./headers/validators.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+static bool intersects(const CaptureRect& region, const xcb_rectangle_t& area) {
+  return area.x < region.x + region.width && region.x < area.x + area.width &&
+    area.y < region.y + region.height && region.y < area.y + area.height;
+}
+
+DamageTiles::DamageTiles(const CaptureRect& area, int tileSize)
+  : area(area),
+    tileSize(tileSize),
+    columns((area.width + tileSize - 1) / tileSize),
+    rows((area.height + tileSize - 1) / tileSize),
+    dirty(static_cast<size_t>(columns) * rows, 0) {}
+
+void DamageTiles::mark(const xcb_rectangle_t& rect) {
+  int left = std::max<int>(rect.x, area.x) - area.x;
+  int top = std::max<int>(rect.y, area.y) - area.y;
+  int right = std::min<int>(rect.x + rect.width, area.x + area.width) - area.x;
+  int bottom = std::min<int>(rect.y + rect.height, area.y + area.height) - area.y;
+  if (right <= left || bottom <= top) {
+    return;
+  }
+  for (int row = top / tileSize; row <= (bottom - 1) / tileSize; row++) {
+    std::fill_n(dirty.begin() + row * columns + left / tileSize, (right - 1) / tileSize - left / tileSize + 1, 1);
+  }
+  any = true;
+}
+
+void DamageTiles::markAll() {
+  std::fill(dirty.begin(), dirty.end(), 1);
+  any = true;
+}
+
+DamageWatcher::~DamageWatcher() {
+  // Same as NativeQueue, the cleanup hook joins the thread before the instance is deleted
+  if (thread.joinable()) {
+    thread.detach();
+  }
+}
+
+void DamageWatcher::settle(Napi::Env env, Napi::Function, IdleWait* wait) {
+  std::unique_ptr<IdleWait> owned(wait);
+  if (env == nullptr) {
+    return;
+  }
+  if (wait->failed) {
+    wait->deferred.Reject(Napi::Error::New(env, wait->error).Value());
+  } else {
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("idle", wait->idle);
+    result.Set("damageEvents", wait->damageEvents);
+    result.Set("elapsedMs", std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - wait->started).count());
+    wait->deferred.Resolve(result);
+  }
+  if (--wait->watcher->pendingWaits == 0) {
+    wait->watcher->completion.Unref(env);
+  }
+}
+
+void DamageWatcher::finish(IdleWait* wait) {
+  if (wait->damage != XCB_NONE) {
+    // Server frees the damage along with its window, destroying it again only yields an ignored error
+    xcb_damage_destroy(context.connection, wait->damage);
+  }
+  if (completion.BlockingCall(wait, settle) != napi_ok) {
+    delete wait;
+  }
+}
+
+void DamageWatcher::addWait(IdleWait* wait) {
+  xcb_connection_t* connection = context.connection;
+  xcb_drawable_t drawable = wait->window == XCB_NONE ? context.rootWindow : wait->window;
+  wait->damage = xcb_generate_id(connection);
+  // Bounding box level sends one event until the damage is subtracted, a busy window doesn't flood the socket
+  xcb_generic_error_t* error = xcb_request_check(connection, xcb_damage_create_checked(
+    connection, wait->damage, drawable, XCB_DAMAGE_REPORT_LEVEL_BOUNDING_BOX));
+  if (error) {
+    wait->damage = XCB_NONE;
+    wait->failed = true;
+    wait->error = xcbErrorMessage("Failed to watch damage of window " + std::to_string(drawable), error);
+    free(error);
+    finish(wait);
+    return;
+  }
+  waits.push_back(wait);
+}
+
+void DamageWatcher::damaged(const xcb_damage_notify_event_t* event, std::chrono::steady_clock::time_point now) {
+  for (IdleWait* wait : waits) {
+    if (wait->damage != event->damage) {
+      continue;
+    }
+    // Area is relative to the drawable, which is the root for region waits
+    if (wait->window != XCB_NONE || intersects(wait->region, event->area)) {
+      wait->lastDamage = now;
+      wait->damageEvents++;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::shared_ptr<DamageSubscription>& subscription : subscriptions) {
+      if (subscription->damage == event->damage) {
+        subscription->tiles.mark(event->area);
+      }
+    }
+  }
+  xcb_damage_subtract(context.connection, event->damage, XCB_NONE, XCB_NONE);
+}
+
+std::chrono::steady_clock::time_point DamageWatcher::updateSubscriptions(std::chrono::steady_clock::time_point now) {
+  auto next = std::chrono::steady_clock::time_point::max();
+  for (auto it = subscriptions.begin(); it != subscriptions.end();) {
+    DamageSubscription& subscription = **it;
+    if (subscription.removed) {
+      if (subscription.damage != XCB_NONE) {
+        xcb_damage_destroy(context.connection, subscription.damage);
+      }
+      it = subscriptions.erase(it);
+      continue;
+    }
+    if (subscription.damage == XCB_NONE) {
+      // Root damage always exists, there's nothing to check
+      subscription.damage = xcb_generate_id(context.connection);
+      xcb_damage_create(context.connection, subscription.damage, context.rootWindow, XCB_DAMAGE_REPORT_LEVEL_BOUNDING_BOX);
+    }
+    if (subscription.requested && subscription.tiles.any) {
+      if (now >= subscription.notBefore) {
+        subscription.requested = false;
+        DamageTiles tiles(subscription.tiles.area, subscription.tiles.tileSize);
+        std::swap(tiles, subscription.tiles);
+        subscription.ready(std::move(tiles));
+      } else {
+        next = std::min(next, subscription.notBefore);
+      }
+    }
+    ++it;
+  }
+  return next;
+}
+
+void DamageWatcher::lose(const char* error, std::chrono::steady_clock::time_point now) {
+  std::vector<IdleWait*> failed;
+  failed.swap(waits);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    lost = true;
+    failed.insert(failed.end(), added.begin(), added.end());
+    added.clear();
+    // Subscribers get everything damaged, their full captures then fail on their own
+    for (const std::shared_ptr<DamageSubscription>& subscription : subscriptions) {
+      subscription->tiles.markAll();
+      subscription->notBefore = now;
+    }
+    updateSubscriptions(now);
+  }
+  for (IdleWait* wait : failed) {
+    wait->damage = XCB_NONE;
+    wait->failed = true;
+    wait->error = error;
+    finish(wait);
+  }
+}
+
+void DamageWatcher::run() {
+  xcb_connection_t* connection = context.connection;
+  struct pollfd fds[2];
+  fds[0].fd = xcb_get_file_descriptor(connection);
+  fds[0].events = POLLIN;
+  fds[1].fd = wakeFd;
+  fds[1].events = POLLIN;
+
+  while (true) {
+    std::vector<IdleWait*> incoming;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (stopping) {
+        break;
+      }
+      incoming.swap(added);
+    }
+    for (IdleWait* wait : incoming) {
+      addWait(wait);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    xcb_generic_event_t* event;
+    while ((event = xcb_poll_for_event(connection))) {
+      if ((event->response_type & ~0x80) == damageEventBase + XCB_DAMAGE_NOTIFY) {
+        damaged(reinterpret_cast<xcb_damage_notify_event_t*>(event), now);
+      }
+      free(event);
+    }
+    if (xcb_connection_has_error(connection)) {
+      LOG("Damage watcher lost X connection");
+      lose("Lost X connection while waiting for idle", now);
+      break;
+    }
+
+    std::chrono::steady_clock::time_point next;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      next = updateSubscriptions(now);
+    }
+    for (auto it = waits.begin(); it != waits.end();) {
+      IdleWait* wait = *it;
+      if (now - wait->lastDamage >= wait->quiet || now >= wait->deadline) {
+        wait->idle = now - wait->lastDamage >= wait->quiet;
+        it = waits.erase(it);
+        finish(wait);
+        continue;
+      }
+      next = std::min(next, std::min(wait->lastDamage + wait->quiet, wait->deadline));
+      ++it;
+    }
+
+    int timeout = -1;
+    if (next != std::chrono::steady_clock::time_point::max()) {
+      // Rounded up, waking before the expiry would just poll again
+      timeout = static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(next - now).count());
+    }
+    xcb_flush(connection);
+    if (poll(fds, 2, timeout) < 0 && errno != EINTR) {
+      LOG("Damage watcher poll failed: %s", strerror(errno));
+      lose("Damage watcher failed while waiting for idle", std::chrono::steady_clock::now());
+      break;
+    }
+    if (fds[1].revents & POLLIN) {
+      uint64_t value;
+      if (read(wakeFd, &value, sizeof(value)) < 0) {
+        LOG("Failed to reset damage watcher wake up");
+      }
+    }
+  }
+}
+
+void DamageWatcher::stop(void* data) {
+  DamageWatcher* watcher = static_cast<DamageWatcher*>(data);
+  {
+    std::lock_guard<std::mutex> lock(watcher->mutex);
+    watcher->stopping = true;
+  }
+  uint64_t value = 1;
+  if (write(watcher->wakeFd, &value, sizeof(value)) < 0) {
+    LOG("Failed to stop damage watcher thread");
+  }
+  if (watcher->thread.joinable()) {
+    watcher->thread.join();
+  }
+  for (IdleWait* wait : watcher->waits) {
+    delete wait;
+  }
+  watcher->waits.clear();
+  for (IdleWait* wait : watcher->added) {
+    delete wait;
+  }
+  watcher->added.clear();
+  watcher->subscriptions.clear();
+  close(watcher->wakeFd);
+  watcher->wakeFd = -1;
+  disconnectXcbWindowContext(watcher->context);
+  watcher->completion.Release();
+}
+
+void DamageWatcher::start(Napi::Env env) {
+  if (thread.joinable()) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (lost) {
+      throw Napi::Error::New(env, "Damage watcher lost X connection");
+    }
+    return;
+  }
+  if (context.connection == nullptr) {
+    std::string errorMsg = connectXcbWindowContext(context);
+    if (!errorMsg.empty()) {
+      throw Napi::Error::New(env, errorMsg);
+    }
+  }
+  const xcb_query_extension_reply_t* extension = xcb_get_extension_data(context.connection, &xcb_damage_id);
+  if (!extension || !extension->present) {
+    throw Napi::Error::New(env, "X server doesn't support DAMAGE extension");
+  }
+  damageEventBase = extension->first_event;
+  // Server rejects damage requests of clients that didn't announce their version
+  free(xcb_damage_query_version_reply(context.connection,
+    xcb_damage_query_version(context.connection, XCB_DAMAGE_MAJOR_VERSION, XCB_DAMAGE_MINOR_VERSION), nullptr));
+  wakeFd = eventfd(0, EFD_CLOEXEC);
+  if (wakeFd < 0) {
+    throw Napi::Error::New(env, "Failed to create damage watcher eventfd");
+  }
+  completion = Napi::ThreadSafeFunction::New(
+    env, Napi::Function::New(env, [](const Napi::CallbackInfo&) {}), "damageWatcher", 0, 1);
+  completion.Unref(env);
+  thread = std::thread(&DamageWatcher::run, this);
+  napi_add_env_cleanup_hook(env, stop, this);
+}
+
+void DamageWatcher::wake() {
+  // Stopped already, e.g. streams are closed by a later cleanup hook
+  if (wakeFd < 0) {
+    return;
+  }
+  uint64_t value = 1;
+  if (write(wakeFd, &value, sizeof(value)) < 0) {
+    LOG("Failed to wake damage watcher up");
+  }
+}
+
+Napi::Promise DamageWatcher::watch(Napi::Env env, IdleWait* wait) {
+  std::unique_ptr<IdleWait> owned(wait);
+  start(env);
+  wait->watcher = this;
+  Napi::Promise promise = wait->deferred.Promise();
+  if (pendingWaits++ == 0) {
+    completion.Ref(env);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!lost) {
+      added.push_back(owned.release());
+    }
+  }
+  if (owned) {
+    // Thread has exited since start()
+    if (--pendingWaits == 0) {
+      completion.Unref(env);
+    }
+    wait->deferred.Reject(Napi::Error::New(env, "Damage watcher lost X connection").Value());
+    return promise;
+  }
+  wake();
+  return promise;
+}
+
+void DamageWatcher::subscribe(Napi::Env env, const std::shared_ptr<DamageSubscription>& subscription) {
+  start(env);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    subscriptions.push_back(subscription);
+  }
+  wake();
+}
+
+void DamageWatcher::request(const std::shared_ptr<DamageSubscription>& subscription, bool full,
+  std::chrono::steady_clock::time_point notBefore) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (full) {
+      subscription->tiles.markAll();
+    }
+    subscription->requested = true;
+    subscription->notBefore = notBefore;
+    if (lost) {
+      subscription->tiles.markAll();
+      subscription->notBefore = std::chrono::steady_clock::now();
+      updateSubscriptions(subscription->notBefore);
+    }
+  }
+  wake();
+}
+
+void DamageWatcher::unsubscribe(const std::shared_ptr<DamageSubscription>& subscription) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    subscription->removed = true;
+  }
+  wake();
+}
+
+// waitForIdleAsync({wid} | {region: {x, y, width, height}}, quietMs, timeoutMs) resolves with
+// {idle, elapsedMs, damageEvents} once nothing was drawn to the window or the screen region for quietMs,
+// or with {idle: false} after timeoutMs. A window destroyed while waiting stops reporting damage and goes idle
+static Napi::Value waitForIdleAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_OBJECT(info, 0, request);
+  for (const char* key : {"quietMs", "timeoutMs"}) {
+    if (!request.Get(key).IsNumber()) {
+      throw Napi::TypeError::New(env, std::string(key) + " must be a number");
+    }
+  }
+  Napi::Value wid = request.Get("wid");
+  Napi::Value region = request.Get("region");
+  if (wid.IsNumber() == region.IsObject()) {
+    throw Napi::TypeError::New(env, "Either wid or region must be given");
+  }
+
+  std::unique_ptr<IdleWait> wait(new IdleWait{
+    XCB_NONE,
+    {0, 0, 0, 0},
+    std::chrono::milliseconds(std::max<int64_t>(1, request.Get("quietMs").ToNumber().Int64Value())),
+    {}, {}, {},
+    Napi::Promise::Deferred::New(env),
+  });
+  if (wid.IsNumber()) {
+    wait->window = wid.ToNumber().Uint32Value();
+    if (wait->window == XCB_NONE) {
+      throw Napi::RangeError::New(env, "wid must not be 0");
+    }
+  } else {
+    Napi::Object regionObj = region.As<Napi::Object>();
+    for (const char* key : {"x", "y", "width", "height"}) {
+      if (!regionObj.Get(key).IsNumber()) {
+        throw Napi::TypeError::New(env, std::string("region.") + key + " must be a number");
+      }
+    }
+    wait->region = {
+      regionObj.Get("x").ToNumber().Int32Value(),
+      regionObj.Get("y").ToNumber().Int32Value(),
+      regionObj.Get("width").ToNumber().Int32Value(),
+      regionObj.Get("height").ToNumber().Int32Value(),
+    };
+    if (wait->region.width <= 0 || wait->region.height <= 0) {
+      throw Napi::RangeError::New(env, "region must not be empty");
+    }
+  }
+  wait->started = std::chrono::steady_clock::now();
+  wait->lastDamage = wait->started;
+  wait->deadline = wait->started + std::chrono::milliseconds(std::max<int64_t>(0, request.Get("timeoutMs").ToNumber().Int64Value()));
+  return addonData().damageWatcher.watch(env, wait.release());
+}
+
+Napi::Object damageInit(Napi::Env env, Napi::Object exports) {
+  exports.Set("waitForIdleAsync", Napi::Function::New(env, waitForIdleAsync));
+  return exports;
+}
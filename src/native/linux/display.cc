@@ -1,39 +1,42 @@
 #include "./headers/display.h"
+#include "./headers/addon-data.h"
 #include "./headers/logger.h"
+#include "./headers/native-queue.h"
+#include <X11/Xlib-xcb.h>
 #include <iostream>
 #include <napi.h>
 
-Display* mainDisplay = NULL;
-int registered = 0;
-char* displayName = NULL;
-int hasDisplayNameChanged = 0;
+Display* xGetMainDisplay() {
+  AddonData& data = addonData();
+  std::lock_guard<std::mutex> lock(data.displayMutex);
+  if (data.display == NULL) {
+    data.display = XOpenDisplay(NULL);
 
-void xCloseMainDisplay(void) {
-  if (mainDisplay != NULL) {
-    XCloseDisplay(mainDisplay);
-    mainDisplay = NULL;
+    if (data.display == NULL) {
+      throw NativeError("Couldn't open main display");
+    }
   }
-}
 
-Display* xGetMainDisplay(Napi::Env env) {
-  /* Close the display if displayName has changed */
-  if (hasDisplayNameChanged) {
-    xCloseMainDisplay();
-    hasDisplayNameChanged = 0;
-  }
+  return data.display;
+}
 
-  if (mainDisplay == NULL) {
-    /* First try the user set displayName */
-    mainDisplay = XOpenDisplay(displayName);
+xcb_connection_t* xGetMainConnection() {
+  return XGetXCBConnection(xGetMainDisplay());
+}
 
-    if (mainDisplay == NULL) {
-      throw Napi::Error::New(env, "Couldn't open main display");
-    }
-    if (!registered) {
-      atexit(&xCloseMainDisplay);
-      registered = 1;
-    }
-  }
+// Errors of requests nobody waits for, e.g. XTest input or window configuration, arrive here
+// when the connection is read next. The default handler would exit the process.
+static int logXError(Display* display, XErrorEvent* error) {
+  char text[256];
+  XGetErrorText(display, error->error_code, text, sizeof(text));
+  LOG("X11 error: %s, request %d.%d, resource 0x%lx, sequence %lu",
+      text, error->request_code, error->minor_code, error->resourceid, error->serial);
+  return 0;
+}
 
-  return mainDisplay;
-}
\ No newline at end of file
+void displayInit() {
+  // Must precede any other Xlib call, the JS thread and queue threads of an instance share its display.
+  // Repeated calls by instances loaded later do nothing
+  XInitThreads();
+  XSetErrorHandler(logXError);
+}
@@ -0,0 +1,348 @@
+#include "./headers/frame-socket.h"
+#include "./headers/addon-data.h"
+#include "./headers/display.h"
+#include "./headers/logger.h"
+#include "./headers/native-queue.h"
+#include "./headers/validators.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Every client holds a slot, more of them would only wait for each other
+static const size_t MAX_CLIENTS = 16;
+static const uint32_t MAX_SLOTS = 16;
+// Subdirectory of $XDG_RUNTIME_DIR that holds the sockets, only this server writes there
+static const char* SOCKET_DIRECTORY = "http-remote-pc-control";
+
+template <typename T>
+using XcbReply = std::unique_ptr<T, decltype(&free)>;
+
+struct FrameClient {
+  int fd;
+  // Slot of the last frame sent to the client, -1 if it holds none
+  int64_t slot = -1;
+};
+
+static std::string errnoMessage(const std::string& message) {
+  return message + ": " + strerror(errno);
+}
+
+// Private directory of the server for its sockets, created on first use. Files in it were created by the server,
+// so a stale socket there can be replaced without removing sockets of other programs
+static std::string socketDirectory() {
+  const char* runtime = getenv("XDG_RUNTIME_DIR");
+  if (runtime == nullptr || runtime[0] != '/') {
+    throw NativeError("XDG_RUNTIME_DIR must be set to an absolute path to start the frame socket");
+  }
+  std::string directory = std::string(runtime) + "/" + SOCKET_DIRECTORY;
+  if (mkdir(directory.c_str(), 0700) < 0 && errno != EEXIST) {
+    throw NativeError(errnoMessage("Failed to create " + directory));
+  }
+  struct stat info;
+  if (lstat(directory.c_str(), &info) < 0) {
+    throw NativeError(errnoMessage("Failed to check " + directory));
+  }
+  if (!S_ISDIR(info.st_mode) || info.st_uid != geteuid() || (info.st_mode & 0077) != 0) {
+    throw NativeError(directory + " must be a directory of this user accessible only by it");
+  }
+  return directory;
+}
+
+// Attaches the ring memfd as the SCM_RIGHTS payload of hello
+static bool sendHello(int fd, const FrameRingHello& hello, int memFd) {
+  struct iovec iov = {const_cast<FrameRingHello*>(&hello), sizeof(hello)};
+  char control[CMSG_SPACE(sizeof(int))];
+  memset(control, 0, sizeof(control));
+  struct msghdr message = {};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &memFd, sizeof(int));
+  return sendmsg(fd, &message, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(hello));
+}
+
+// Reads one request of client and answers it, false if the client must be disconnected
+static bool serveRequest(FrameClient& client, const std::vector<FrameClient>& clients, xcb_shm_seg_t seg,
+  uint32_t slots, uint64_t slotSize, uint64_t& sequence) {
+  FrameRequest request;
+  ssize_t received = recv(client.fd, &request, sizeof(request), 0);
+  if (received < 0 && (errno == EINTR || errno == EAGAIN)) {
+    return true;
+  }
+  if (received != static_cast<ssize_t>(sizeof(request))) {
+    return false;
+  }
+  // Asking for the next frame releases the previous one
+  client.slot = -1;
+
+  FrameReady ready = {};
+  ready.status = FRAME_BUSY;
+  for (uint32_t slot = 0; slot < slots; slot++) {
+    bool held = false;
+    for (const FrameClient& other : clients) {
+      held = held || other.slot == slot;
+    }
+    if (held) {
+      continue;
+    }
+    CaptureTarget target;
+    if (request.width > 0 && request.height > 0) {
+      target.type = CaptureTarget::Type::Rect;
+      target.rect = {request.x, request.y, request.width, request.height};
+    }
+    try {
+      CaptureRect rect = captureScreenInto(target, seg, static_cast<uint32_t>(slot * slotSize), slotSize);
+      ready.status = FRAME_OK;
+      ready.slot = slot;
+      ready.offset = slot * slotSize;
+      ready.sequence = ++sequence;
+      ready.x = rect.x;
+      ready.y = rect.y;
+      ready.width = rect.width;
+      ready.height = rect.height;
+      ready.stride = static_cast<uint32_t>(rect.width) * 4;
+      client.slot = slot;
+    } catch (const std::exception& e) {
+      LOG("Frame socket capture failed: %s", e.what());
+      ready.status = FRAME_FAILED;
+    }
+    break;
+  }
+  return send(client.fd, &ready, sizeof(ready), MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(ready));
+}
+
+FrameSocket::~FrameSocket() {
+  // Same as NativeQueue, the cleanup hook joins the thread before the instance is deleted
+  if (thread.joinable()) {
+    thread.detach();
+  }
+}
+
+void FrameSocket::run(AddonData* data) {
+  bindAddonData(data);
+  std::vector<FrameClient> clients;
+  std::vector<struct pollfd> fds;
+  uint64_t sequence = 0;
+  FrameRingHello hello = {FRAME_RING_MAGIC, FRAME_RING_VERSION, slots, 0, slotBytes, slotBytes * slots};
+
+  while (true) {
+    fds.clear();
+    fds.push_back({wakeFd, POLLIN, 0});
+    fds.push_back({listenFd, POLLIN, 0});
+    for (const FrameClient& client : clients) {
+      fds.push_back({client.fd, POLLIN, 0});
+    }
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG("Frame socket poll failed: %s", strerror(errno));
+      break;
+    }
+    if (fds[0].revents & POLLIN) {
+      break;
+    }
+    // Backwards, so erasing a client doesn't shift the ones not served yet
+    for (size_t i = clients.size(); i-- > 0;) {
+      short revents = fds[i + 2].revents;
+      if (revents == 0) {
+        continue;
+      }
+      if (!(revents & POLLIN) ||
+        !serveRequest(clients[i], clients, seg, slots, slotBytes, sequence)) {
+        ::close(clients[i].fd);
+        clients.erase(clients.begin() + i);
+      }
+    }
+    if (fds[1].revents & POLLIN) {
+      int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd < 0) {
+        LOG("Frame socket accept failed: %s", strerror(errno));
+      } else if (clients.size() >= MAX_CLIENTS || !sendHello(fd, hello, memFd)) {
+        ::close(fd);
+      } else {
+        clients.push_back({fd});
+      }
+    }
+  }
+  for (const FrameClient& client : clients) {
+    ::close(client.fd);
+  }
+}
+
+void FrameSocket::start(Napi::Env env, const std::string& name, uint32_t slotCount) {
+  if (running()) {
+    throw NativeError("Frame socket is already listening on " + path);
+  }
+  if (name.empty() || name == "." || name == ".." || name.find('/') != std::string::npos) {
+    throw NativeError("Socket name must be a file name without '/'");
+  }
+  std::string socketPath = socketDirectory() + "/" + name;
+  struct sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path)) {
+    throw NativeError("Socket path " + socketPath + " is longer than " +
+      std::to_string(sizeof(address.sun_path) - 1) + " characters");
+  }
+  memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+  xcb_connection_t* conn = xGetMainConnection();
+  const xcb_query_extension_reply_t* shm = xcb_get_extension_data(conn, &xcb_shm_id);
+  if (!shm || !shm->present) {
+    throw NativeError("X server doesn't support MIT-SHM");
+  }
+  XcbReply<xcb_shm_query_version_reply_t> version(
+    xcb_shm_query_version_reply(conn, xcb_shm_query_version(conn), nullptr), free);
+  if (!version || version->major_version < 1 || (version->major_version == 1 && version->minor_version < 2)) {
+    throw NativeError("MIT-SHM 1.2 is required to share memory by file descriptor");
+  }
+  const xcb_screen_t* screen = xcb_setup_roots_iterator(xcb_get_setup(conn)).data;
+  uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  uint64_t bytes = (static_cast<uint64_t>(screen->width_in_pixels) * screen->height_in_pixels * 4 + page - 1) / page * page;
+  slotCount = std::min(std::max<uint32_t>(slotCount, 1), MAX_SLOTS);
+  // ShmGetImage offsets are 32 bit
+  if (bytes * slotCount > UINT32_MAX) {
+    throw NativeError("Frame ring of " + std::to_string(slotCount) + " screens exceeds 4GB, use fewer slots");
+  }
+
+  int ringFd = memfd_create("screen-frame-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (ringFd < 0) {
+    throw NativeError(errnoMessage("Failed to create frame ring"));
+  }
+  if (ftruncate(ringFd, static_cast<off_t>(bytes * slotCount)) < 0) {
+    std::string errorMsg = errnoMessage("Failed to allocate frame ring");
+    ::close(ringFd);
+    throw NativeError(errorMsg);
+  }
+  // Size is fixed, so a client mapping can't hit SIGBUS
+  fcntl(ringFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+  // Clients get a read only descriptor of the same memory, they can't scribble over slots of each other
+  int readOnlyFd = open(("/proc/self/fd/" + std::to_string(ringFd)).c_str(), O_RDONLY | O_CLOEXEC);
+  if (readOnlyFd < 0) {
+    std::string errorMsg = errnoMessage("Failed to reopen frame ring read only");
+    ::close(ringFd);
+    throw NativeError(errorMsg);
+  }
+  xcb_shm_seg_t ringSeg = xcb_generate_id(conn);
+  // XCB closes the descriptor once it's sent, the server keeps its own mapping
+  xcb_generic_error_t* error = xcb_request_check(conn, xcb_shm_attach_fd_checked(conn, ringSeg, ringFd, 0));
+  if (error) {
+    std::string errorMsg = xcbErrorMessage("Failed to share frame ring with X server", error);
+    free(error);
+    ::close(readOnlyFd);
+    throw NativeError(errorMsg);
+  }
+
+  std::string errorMsg;
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  struct stat existing;
+  if (fd < 0) {
+    errorMsg = errnoMessage("Failed to create frame socket");
+  } else if (lstat(socketPath.c_str(), &existing) == 0 && !S_ISSOCK(existing.st_mode)) {
+    errorMsg = socketPath + " exists and is not a socket";
+  } else {
+    // Left by a previous run, nothing else creates files in the directory
+    unlink(socketPath.c_str());
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+      errorMsg = errnoMessage("Failed to bind frame socket to " + socketPath);
+    } else if (chmod(socketPath.c_str(), 0600) < 0 || listen(fd, static_cast<int>(MAX_CLIENTS)) < 0) {
+      errorMsg = errnoMessage("Failed to listen on " + socketPath);
+      unlink(socketPath.c_str());
+    } else if ((wakeFd = eventfd(0, EFD_CLOEXEC)) < 0) {
+      errorMsg = errnoMessage("Failed to create frame socket eventfd");
+      unlink(socketPath.c_str());
+    }
+  }
+  if (!errorMsg.empty()) {
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    xcb_shm_detach(conn, ringSeg);
+    xcb_flush(conn);
+    ::close(readOnlyFd);
+    throw NativeError(errorMsg);
+  }
+
+  path = socketPath;
+  listenFd = fd;
+  memFd = readOnlyFd;
+  connection = conn;
+  seg = ringSeg;
+  slots = slotCount;
+  slotBytes = bytes;
+  thread = std::thread(&FrameSocket::run, this, currentAddonData());
+  if (!cleanupHook) {
+    napi_add_env_cleanup_hook(env, stop, this);
+    cleanupHook = true;
+  }
+}
+
+void FrameSocket::close() {
+  if (!running()) {
+    return;
+  }
+  uint64_t value = 1;
+  if (write(wakeFd, &value, sizeof(value)) < 0) {
+    LOG("Failed to stop frame socket thread");
+  }
+  thread.join();
+  ::close(listenFd);
+  unlink(path.c_str());
+  ::close(wakeFd);
+  // Clients keep their mappings, the memory is freed when the last one unmaps it
+  xcb_shm_detach(connection, seg);
+  xcb_flush(connection);
+  ::close(memFd);
+  listenFd = -1;
+  wakeFd = -1;
+  memFd = -1;
+}
+
+void FrameSocket::stop(void* socket) {
+  static_cast<FrameSocket*>(socket)->close();
+}
+
+// startFrameSocket({name, slots}) returns {path, slots, slotSize}, see FrameRingHello for the protocol
+static Napi::Value startFrameSocket(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_OBJECT(info, 0, options);
+  if (!options.Get("name").IsString()) {
+    throw Napi::TypeError::New(env, "name must be a string");
+  }
+  std::string name = options.Get("name").As<Napi::String>().Utf8Value();
+  uint32_t slots = static_cast<uint32_t>(getIntOption(env, options, "slots", 1, MAX_SLOTS, 4));
+  FrameSocket& socket = addonData().frameSocket;
+  callNative(env, [&] { socket.start(env, name, slots); });
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("path", socket.socketPath());
+  result.Set("slots", socket.slotCount());
+  result.Set("slotSize", static_cast<double>(socket.slotSize()));
+  return result;
+}
+
+static Napi::Value stopFrameSocket(const Napi::CallbackInfo& info) {
+  addonData().frameSocket.close();
+  return info.Env().Undefined();
+}
+
+Napi::Object frameSocketInit(Napi::Env env, Napi::Object exports) {
+  exports.Set("startFrameSocket", Napi::Function::New(env, startFrameSocket));
+  exports.Set("stopFrameSocket", Napi::Function::New(env, stopFrameSocket));
+  return exports;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <napi.h>
+#include <X11/Xlib.h>
+#include <mutex>
+#include "./native-queue.h"
+#include "./window-info.h"
+#include "./window-cache.h"
+#include "./keymap.h"
+#include "./monitor.h"
+#include "./input-timeline.h"
+#include "./capture.h"
+#include "./worker-pool.h"
+#include "./pixel.h"
+#include "./template-match.h"
+#include "./damage.h"
+#include "./screen-stream.h"
+#include "./frame-socket.h"
+#include "./process-sampler.h"
+#include "./process-table.h"
+#include "./process-supervisor.h"
+
+// Everything one instance of the addon owns. Node loads a separate instance into the main thread and into every
+// worker_thread, each one gets its own X connection, keymap and threads, so instances never wait for each other.
+struct AddonData {
+  // Opened on first use by xGetMainDisplay, closed when the instance is deleted
+  Display* display = nullptr;
+  std::mutex displayMutex;
+  // Atoms and root of the display connection, shared with XTest and XKB requests
+  XcbWindowContext windowContext;
+  WindowCache windowCache;
+  MonitorCache monitors;
+  KeymapState keymap;
+  TimelineRegistry timelines;
+  // Shared memory segments of screen captures, frames handed to JS keep it alive
+  std::shared_ptr<CapturePool> capturePool = std::make_shared<CapturePool>();
+  // X requests and input events, they must not be reordered or interleaved
+  NativeQueue queue{"nativeQueue"};
+  // Human mouse moves, so a long move doesn't hold the queue
+  NativeQueue motionQueue{"mouseMotionQueue"};
+  // Input timelines, they run one at a time
+  NativeQueue timelineQueue{"inputTimelineQueue"};
+  // Image encoding, so captures don't wait for the previous screenshot to be encoded
+  NativeQueue encodeQueue{"imageEncodeQueue"};
+  // Template searches, they share the encoding pool
+  NativeQueue matchQueue{"templateMatchQueue"};
+  // /proc scans and kills, a process given time to exit doesn't hold X requests
+  NativeQueue processQueue{"processTableQueue"};
+  // Stripes and bands of the images being encoded or searched
+  WorkerPool encodeWorkers;
+  TemplateHits templateHits;
+  // Regions of pending waitForPixel calls
+  PixelWatcher pixelWatcher;
+  // Drawables of pending waitForIdle calls and areas of screen streams
+  DamageWatcher damageWatcher;
+  ScreenStreams screenStreams;
+  // Frame ring shared with local consumers over a Unix socket
+  FrameSocket frameSocket;
+  // CPU and memory history of processes, sampled on its own thread
+  ProcessSampler processSampler;
+  // Descendants of launched processes, they often own the windows
+  ProcessTree processTree;
+  // pidfds of launched and adopted processes, waited for on one epoll thread
+  ProcessSupervisor processSupervisor;
+
+  ~AddonData();
+};
+
+// Creates the instance of env, stores it as the env instance data and binds it to the calling (JS) thread.
+// Threads and the display are released by env cleanup hooks and the instance data finalizer.
+void addonDataInit(Napi::Env env);
+
+// Instance the calling thread belongs to: the JS thread of its env or a thread started by the instance.
+// Throws NativeError on threads that belong to no instance
+AddonData& addonData();
+
+// Instance of the calling thread or nullptr, threads started for an instance bind it with bindAddonData
+AddonData* currentAddonData();
+void bindAddonData(AddonData* data);
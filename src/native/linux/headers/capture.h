@@ -0,0 +1,92 @@
+#pragma once
+
+#include <napi.h>
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// System V shared memory segment attached to the X server, the server writes captured pixels right into it
+struct ShmSegment {
+  int shmid;
+  xcb_shm_seg_t seg;
+  uint8_t* data;
+  size_t size;
+};
+
+// Segments of an addon instance. A captured frame owns its segment until JS drops its Buffer,
+// then the segment returns here and is reused by the next capture of the same or smaller size.
+// Shared with the frames, they can outlive the instance during env teardown.
+struct CapturePool {
+  std::mutex mutex;
+  xcb_connection_t* connection = nullptr;
+  // Set when the X connection is closed, segments are then only detached locally
+  bool closed = false;
+  // MIT-SHM is missing or can't be used (e.g. remote X server), captures fall back to GetImage
+  bool shmUnavailable = false;
+  std::vector<ShmSegment*> segments;
+  // Segments held by frames, new captures copy pixels out of GetImage replies once there are too many
+  size_t liveSegments = 0;
+};
+
+struct CaptureRect {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+// Captured BGRA pixels, rows are stride bytes long
+struct CaptureFrame {
+  std::shared_ptr<CapturePool> pool;
+  // Either the segment the server wrote to, or pixels copied out of a GetImage reply
+  ShmSegment* segment = nullptr;
+  std::vector<uint8_t> pixels;
+  CaptureRect rect = {0, 0, 0, 0};
+  uint32_t stride = 0;
+
+  CaptureFrame() = default;
+  CaptureFrame(CaptureFrame&& other) noexcept;
+  CaptureFrame& operator=(CaptureFrame&& other) noexcept;
+  ~CaptureFrame();
+
+  uint8_t* data() {
+    return segment ? segment->data : pixels.data();
+  }
+  size_t size() const {
+    return static_cast<size_t>(stride) * rect.height;
+  }
+};
+
+// What to capture: the whole root window, a monitor, or a rectangle in root coordinates.
+// Rectangles are clipped to the root window.
+struct CaptureTarget {
+  enum class Type { Root, Monitor, Rect };
+  Type type = Type::Root;
+  uint32_t monitor = 0;
+  CaptureRect rect = {0, 0, 0, 0};
+};
+
+// Area the target covers on the root window of the calling thread's instance. Throws NativeError
+CaptureRect resolveCaptureTarget(const CaptureTarget& target);
+
+// Captures the target from the root window of the calling thread's instance. Throws NativeError
+CaptureFrame captureScreen(const CaptureTarget& target);
+
+// Captures the target straight into a segment the caller has attached to the main connection, e.g. memory shared
+// with another process. Rows are width * 4 bytes long. Throws NativeError, also when the area exceeds capacity
+CaptureRect captureScreenInto(const CaptureTarget& target, xcb_shm_seg_t seg, uint32_t offset, size_t capacity);
+
+// Parses capture target out of an optional {monitor} or {x, y, width, height} object argument
+CaptureTarget parseCaptureTarget(const Napi::CallbackInfo& info, size_t index);
+
+// Reads an optional integer property of options in min..max, returns fallback when it's absent
+int32_t getIntOption(Napi::Env env, Napi::Object options, const char* name, int32_t min, int32_t max, int32_t fallback);
+
+// Detaches segments that are not in use, frames still held by JS detach theirs locally when released
+void closeCapturePool(CapturePool& pool);
+
+Napi::Object captureInit(Napi::Env env, Napi::Object exports);
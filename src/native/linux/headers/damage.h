@@ -0,0 +1,122 @@
+#pragma once
+
+#include <napi.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <xcb/damage.h>
+#include "./capture.h"
+#include "./window-info.h"
+
+class DamageWatcher;
+
+struct IdleWait {
+  // XCB_NONE waits for the region of the root window
+  xcb_window_t window;
+  CaptureRect region;
+  std::chrono::milliseconds quiet;
+  std::chrono::steady_clock::time_point started;
+  std::chrono::steady_clock::time_point deadline;
+  std::chrono::steady_clock::time_point lastDamage;
+  Napi::Promise::Deferred deferred;
+  xcb_damage_damage_t damage = XCB_NONE;
+  uint32_t damageEvents = 0;
+  bool idle = false;
+  bool failed = false;
+  std::string error;
+  DamageWatcher* watcher = nullptr;
+};
+
+// Damaged parts of a screen area, split into tiles of tileSize pixels
+struct DamageTiles {
+  CaptureRect area;
+  int tileSize;
+  int columns;
+  int rows;
+  // columns * rows flags, row by row
+  std::vector<uint8_t> dirty;
+  bool any = false;
+
+  DamageTiles(const CaptureRect& area, int tileSize);
+  // Marks tiles intersecting rect, which is in root coordinates
+  void mark(const xcb_rectangle_t& rect);
+  void markAll();
+};
+
+// Damage of a screen area collected for its owner, e.g. a screen stream.
+// Damage is accumulated all the time, the owner asks for it with DamageWatcher::request when it's ready for more
+struct DamageSubscription {
+  // Called on the damage thread with the tiles damaged since the previous call. It runs once per request,
+  // as soon as a tile is damaged but not before notBefore. Must not block, it's called with the watcher mutex held
+  std::function<void(DamageTiles&&)> ready;
+  // Guarded by the watcher mutex
+  DamageTiles tiles;
+  bool requested = false;
+  std::chrono::steady_clock::time_point notBefore;
+  bool removed = false;
+  // Owned by the damage thread
+  xcb_damage_damage_t damage = XCB_NONE;
+
+  DamageSubscription(const CaptureRect& area, int tileSize, std::function<void(DamageTiles&&)> ready)
+    : ready(std::move(ready)), tiles(area, tileSize) {}
+};
+
+// Thread with its own XCB connection that listens to XDamage of the drawables JS waits for and of subscribed areas.
+// Main connection can't be used: its events are read by Xlib. The thread sleeps in poll until damage,
+// a new wait or the nearest quiet period or timeout expires, so idle screens cost no captures at all.
+// Starts with the first wait or subscription, stops in an env cleanup hook.
+class DamageWatcher {
+public:
+  ~DamageWatcher();
+
+  // Takes ownership of wait, its promise is settled on the JS thread when idle, on timeout or on error
+  Napi::Promise watch(Napi::Env env, IdleWait* wait);
+
+  // Starts collecting damage of the subscription area. Throws Napi::Error if DAMAGE can't be used
+  void subscribe(Napi::Env env, const std::shared_ptr<DamageSubscription>& subscription);
+  // Asks for the next ready call, full marks the whole area damaged, e.g. for a new viewer
+  void request(const std::shared_ptr<DamageSubscription>& subscription, bool full,
+    std::chrono::steady_clock::time_point notBefore);
+  // ready is never called after it returns
+  void unsubscribe(const std::shared_ptr<DamageSubscription>& subscription);
+
+private:
+  static void stop(void* watcher);
+  static void settle(Napi::Env env, Napi::Function, IdleWait* wait);
+  void start(Napi::Env env);
+  void wake();
+  void run();
+  void addWait(IdleWait* wait);
+  // Creates damage objects of new subscriptions and destroys the ones of removed subscriptions,
+  // returns the nearest notBefore of a ready subscription. Called with mutex locked
+  std::chrono::steady_clock::time_point updateSubscriptions(std::chrono::steady_clock::time_point now);
+  void damaged(const xcb_damage_notify_event_t* event, std::chrono::steady_clock::time_point now);
+  void finish(IdleWait* wait);
+  // Fails every pending wait and marks subscriptions fully damaged before the thread exits on an error,
+  // later waits are rejected right away
+  void lose(const char* error, std::chrono::steady_clock::time_point now);
+
+  XcbWindowContext context;
+  uint8_t damageEventBase = 0;
+  std::thread thread;
+  // Wakes the thread up on new waits, subscription changes and on stop
+  int wakeFd = -1;
+  std::mutex mutex;
+  std::vector<IdleWait*> added;
+  std::vector<std::shared_ptr<DamageSubscription>> subscriptions;
+  bool stopping = false;
+  // Set when the thread has exited on a broken connection or a failed poll
+  bool lost = false;
+  // Owned by the thread
+  std::vector<IdleWait*> waits;
+  Napi::ThreadSafeFunction completion;
+  // Waits not settled yet, completion is referenced only while there are any
+  size_t pendingWaits = 0;
+};
+
+Napi::Object damageInit(Napi::Env env, Napi::Object exports);
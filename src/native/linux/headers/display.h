@@ -1,7 +1,16 @@
 #pragma once
 #include <napi.h>
 #include <X11/Xlib.h>
+#include <xcb/xcb.h>
 
-void xCloseMainDisplay();
+// Display of the calling thread's addon instance, opened on first use. Shared by the JS thread and
+// the queue threads of the instance, Xlib is put in threaded mode by displayInit.
+// Throws NativeError when the display can't be opened
+Display* xGetMainDisplay();
 
-Display* xGetMainDisplay(Napi::Env);
\ No newline at end of file
+// XCB connection underneath the instance display. Xlib and XCB requests go through the same socket in the order they
+// are made, so e.g. focusing a window and typing into it can't be reordered by the server.
+// Xlib owns the event queue, use xcb only for requests and replies.
+xcb_connection_t* xGetMainConnection();
+
+void displayInit();
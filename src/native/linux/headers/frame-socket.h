@@ -0,0 +1,101 @@
+#pragma once
+
+#include <napi.h>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <xcb/shm.h>
+
+struct AddonData;
+
+// Wire format of the frame socket. Every message is a single SOCK_SEQPACKET packet in host byte order.
+// A new client receives FrameRingHello with the memfd of the ring attached (SCM_RIGHTS) and maps it read only.
+// Then it sends a FrameRequest, the X server writes the frame straight into a free slot of the ring and the client
+// gets FrameReady. The slot stays untouched until the same client sends its next request or disconnects.
+static const uint32_t FRAME_RING_MAGIC = 0x474E5246;
+static const uint32_t FRAME_RING_VERSION = 1;
+
+struct FrameRingHello {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slots;
+  uint32_t reserved;
+  uint64_t slotSize;
+  uint64_t ringSize;
+};
+
+struct FrameRequest {
+  // Area in root coordinates, zero width or height captures the whole screen
+  int32_t x;
+  int32_t y;
+  int32_t width;
+  int32_t height;
+};
+
+enum FrameStatus : int32_t {
+  FRAME_OK = 0,
+  // Every slot is held by other clients
+  FRAME_BUSY = 1,
+  FRAME_FAILED = 2,
+};
+
+struct FrameReady {
+  int32_t status;
+  uint32_t slot;
+  // Byte offset of the slot in the ring
+  uint64_t offset;
+  // Increases with every frame of the ring
+  uint64_t sequence;
+  int32_t x;
+  int32_t y;
+  int32_t width;
+  int32_t height;
+  // BGRA rows of stride bytes
+  uint32_t stride;
+  uint32_t reserved;
+};
+
+// Hands captured frames to processes on the same host without encoding or copying: the ring is a memfd attached
+// to the X server with MIT-SHM 1.2, consumers map the same memory. One thread accepts clients and serves requests.
+// Started from JS, stopped from JS or in an env cleanup hook.
+class FrameSocket {
+public:
+  ~FrameSocket();
+
+  // Creates the ring of slots that fit the whole screen and listens on the socket called name in the runtime
+  // directory of the server. name can't contain '/', clients don't choose where the socket goes. Throws NativeError
+  void start(Napi::Env env, const std::string& name, uint32_t slots);
+  // Disconnects clients and removes the socket file, does nothing if it's not running
+  void close();
+
+  bool running() const {
+    return thread.joinable();
+  }
+  const std::string& socketPath() const {
+    return path;
+  }
+  uint32_t slotCount() const {
+    return slots;
+  }
+  uint64_t slotSize() const {
+    return slotBytes;
+  }
+
+private:
+  static void stop(void* socket);
+  void run(AddonData* data);
+
+  std::string path;
+  int listenFd = -1;
+  // Wakes the thread up on stop
+  int wakeFd = -1;
+  int memFd = -1;
+  xcb_connection_t* connection = nullptr;
+  xcb_shm_seg_t seg = 0;
+  uint32_t slots = 0;
+  uint64_t slotBytes = 0;
+  std::thread thread;
+  bool cleanupHook = false;
+};
+
+Napi::Object frameSocketInit(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 8 bit luma, rows are width bytes long
+struct GrayImage {
+  std::vector<uint8_t> pixels;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+// Decodes a PNG (8 bit, not interlaced) or JPEG file into luma. Throws NativeError
+GrayImage decodeImageToGray(const uint8_t* data, size_t size);
+
+// Luma of BGRA pixels with BT.601 weights
+void bgraToGray(const uint8_t* src, uint8_t* dst, size_t pixels);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "./worker-pool.h"
+
+enum class ImageFormat { Png, Jpeg, Qoi };
+
+struct ImageEncodeOptions {
+  ImageFormat format = ImageFormat::Png;
+  // JPEG quality 1..100
+  int quality = 80;
+  // zlib level 0..9 of PNG
+  int compression = 6;
+  // Output size, 0 keeps the source size. If only one is set the other one keeps the aspect ratio
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+// BGRA pixels as captured from X, the alpha byte is ignored
+struct RawImage {
+  const uint8_t* pixels;
+  uint32_t width;
+  uint32_t height;
+  uint32_t stride;
+};
+
+struct EncodedImage {
+  std::vector<uint8_t> data;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  ImageFormat format = ImageFormat::Png;
+};
+
+// Resizes and encodes image, splitting the work between the pool threads where the format allows.
+// Throws NativeError
+EncodedImage encodeImage(const RawImage& image, const ImageEncodeOptions& options, WorkerPool& pool);
+
+// Packs BGRA pixels into RGB with SIMD where the CPU supports it
+void bgraToRgb(const uint8_t* src, uint8_t* dst, size_t pixels);
+
+// "png", "jpeg" or "qoi"
+const char* imageFormatName(ImageFormat format);
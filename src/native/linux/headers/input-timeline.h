@@ -0,0 +1,25 @@
+#pragma once
+
+#include <napi.h>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+struct TimelineControl {
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool cancelled = false;
+};
+
+// Queued and playing timelines of an addon instance by id
+struct TimelineRegistry {
+  std::mutex mutex;
+  std::unordered_map<uint32_t, std::shared_ptr<TimelineControl>> controls;
+  // Set by the cleanup hook, timelines queued later start cancelled
+  bool stopping = false;
+  bool cleanupHook = false;
+};
+
+Napi::Object inputTimelineInit(Napi::Env env, Napi::Object exports);
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <map>
 #include <X11/keysymdef.h>
 #include <X11/X.h>
 
@@ -10,5 +9,3 @@ typedef struct {
 } KeyNames;
 
 extern KeyNames keyNames[];
-extern std::map<char, KeySym> xShiftRequiredMap;
-extern std::map<char, KeySym> xSpecialCharacterMap;
\ No newline at end of file
@@ -1,6 +1,5 @@
 #pragma once
 
-#include <napi.h>
 #include <vector>
 #include <string>
 #include <cstdint>
@@ -19,6 +18,6 @@ std::vector<KdeLayout> getKdeAvailableLayouts();
 bool switchToKdeLayout(uint32_t layoutIndex);
 
 // Fallback method using XKB group switching for non-KDE systems
-bool fallbackLayoutSwitch(Napi::Env env);
+bool fallbackLayoutSwitch();
 
 // Main keyboard layout switching function (Napi wrapper)
\ No newline at end of file
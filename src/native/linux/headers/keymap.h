@@ -0,0 +1,71 @@
+#pragma once
+
+#include <napi.h>
+#include <X11/Xlib.h>
+#include <X11/XKBlib.h>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Key press that produces a keysym: keycode plus modifiers that select its shift level
+struct KeyStroke {
+  KeyCode keycode;
+  unsigned int modifiers;
+};
+
+// Keycode without keysyms in the layout, used to type keysyms that no key produces
+struct SpareKey {
+  KeyCode keycode;
+  KeySym keysym;
+  // Batch the binding was last used in, bindings of the current batch are never replaced
+  uint64_t batch;
+};
+
+// Keymap cache of an addon instance display, shared by the JS thread and the queue threads of the instance
+struct KeymapState {
+  std::mutex mutex;
+  bool built = false;
+  bool eventsSelected = false;
+  int xkbEventBase = 0;
+  int activeGroup = 0;
+  std::unordered_map<KeySym, KeyStroke> strokes[XkbNumKbdGroups];
+  KeyStroke charStrokes[XkbNumKbdGroups][128];
+  // Keycodes of modifier keys, indexed by modifier bit (ShiftMapIndex ... Mod5MapIndex)
+  KeyCode modifierKeyCodes[8] = {};
+  std::vector<SpareKey> spareKeys;
+  uint64_t currentBatch = 1;
+};
+
+// Functions below work with the keymap of the calling thread's addon instance.
+// Applies pending MappingNotify and XKB map/group events of the display to the keymap cache,
+// building it on the first call. Call once before a series of lookups.
+void keymapSync(Display* display);
+
+// Keycode and modifiers for keysym in the active XKB group, false if no key produces it
+bool keymapLookup(KeySym keysym, KeyStroke& stroke);
+
+// Keycode of a key that sets the modifier (ShiftMask, Mod5Mask, ...), 0 if there's none
+KeyCode keymapModifierKeyCode(unsigned int modifier);
+
+// Keysym typed by an ASCII character, NoSymbol for unsupported characters
+KeySym keysymForChar(char c);
+
+// Keysym typed by a Unicode code point, NoSymbol for control characters that can't be typed
+KeySym keysymForCodepoint(uint32_t codepoint);
+
+// Like keymapLookup for keysyms[first...], appending to strokes, but keysyms that no key produces are bound to
+// spare keycodes (ones without keysyms). Bindings are kept for later calls, the least recently used one is
+// replaced when all spares are bound. Spares used since keymapBeginBatch are never replaced, the call stops
+// at the first keysym that needs one when all of them are. Returns the number of keysyms resolved.
+// The keymap is changed once per run of adjacent spare keycodes bound by the call.
+size_t keymapResolveBatch(Display* display, const std::vector<KeySym>& keysyms, size_t first,
+  std::vector<KeyStroke>& strokes);
+
+// Starts a new batch of keymapResolve calls. Events typed with spares from the previous batch must be
+// processed by clients first, rebinding a spare changes what its pending events type.
+void keymapBeginBatch();
+
+// Registers the env cleanup hook that unbinds spare keycodes of the calling thread's instance.
+// Called on instance creation, before any queue registers its hook
+void keymapInit(Napi::Env env);
@@ -1,8 +1,19 @@
 #pragma once
 
 #include "napi.h"
+#include <X11/X.h>
+#include <string>
 
 Napi::Object keyboardInit(Napi::Env env, Napi::Object exports);
 
+// Keysym of a key name accepted by keyTap/keyToggle, 0 for unknown names
+unsigned int assignKeyCode(std::string& keyName);
+
+// Presses or releases the key producing keysym with flags modifiers held, throws NativeError
+void toggleKeyCode(KeySym code, const bool down, unsigned int flags);
+
+// Types unicode text, throws NativeError
+void typeText(const std::string& text);
+
 // Set keyboard layout by layout ID (e.g., "us" for US English, "ru" for Russian)
 Napi::Value SetKeyboardLayout(const Napi::CallbackInfo& info);
\ No newline at end of file
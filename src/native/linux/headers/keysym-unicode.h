@@ -0,0 +1,8 @@
+#pragma once
+
+#include <X11/X.h>
+#include <cstdint>
+
+// Unicode code point a keysym types: Latin-1 and Unicode keysyms (0x01000000 | code point) directly,
+// legacy ones (Cyrillic_a, Greek_alpha, hebrew_aleph, ...) through a table. 0 for keysyms that type no character
+uint32_t keysymToCodepoint(KeySym keysym);
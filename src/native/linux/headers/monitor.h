@@ -1,5 +1,37 @@
 #pragma once
 
 #include <napi.h>
+#include <xcb/xcb.h>
+#include <cstdint>
+#include <mutex>
+#include <vector>
 
-Napi::Object monitorInit(Napi::Env env, Napi::Object exports);
\ No newline at end of file
+struct MonitorRect {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+// Active RandR CRTC, its XID is the monitor id
+struct MonitorInfoData {
+  uint32_t id;
+  MonitorRect bounds;
+  MonitorRect workArea;
+  double scale;
+  bool isPrimary;
+};
+
+// Monitor layout of an addon instance. Valid while the window cache thread watches the screen
+// and its screenGeneration equals generation, so repeated queries cost no round-trips
+struct MonitorCache {
+  std::mutex mutex;
+  bool valid = false;
+  uint64_t generation = 0;
+  std::vector<MonitorInfoData> monitors;
+};
+
+// Monitor of the calling thread's instance by id, throws NativeError if there's no such monitor
+MonitorInfoData queryMonitorInfo(uint32_t id);
+
+Napi::Object monitorInit(Napi::Env env, Napi::Object exports);
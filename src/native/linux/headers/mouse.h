@@ -1,4 +1,12 @@
 #pragma once
 #include "napi.h"
+#include <string>
 
-Napi::Object mouseInit(Napi::Env env, Napi::Object exports);
\ No newline at end of file
+Napi::Object mouseInit(Napi::Env env, Napi::Object exports);
+
+// X button number for 'LEFT', 'RIGHT' or 'MIDDLE', 0 for other names
+int mouseButtonFromName(const std::string& button);
+
+// Send a fake XTest event and flush it, throw NativeError
+void sendMouseButton(int button, bool isDown);
+void sendMouseMotion(int x, int y);
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <napi.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+// Error raised by native code that runs without Napi::Env (e.g. on the native queue thread).
+// Sync exports convert it to Napi::Error, async ones reject their promise with it.
+class NativeError : public std::runtime_error {
+public:
+  explicit NativeError(const std::string& message) : std::runtime_error(message) {}
+};
+
+// Runs fn on the JS thread, converting NativeError into a JS exception
+template <typename Fn>
+auto callNative(Napi::Env env, Fn fn) -> decltype(fn()) {
+  try {
+    return fn();
+  } catch (const NativeError& e) {
+    throw Napi::Error::New(env, e.what());
+  }
+}
+
+struct NativeTask;
+struct AddonData;
+
+// Raised when a queue is stopping. Long tasks (paced input, waits for other processes) check it,
+// so the cleanup hook joining the queue thread doesn't wait for them to run to the end.
+class QueueStop {
+public:
+  QueueStop();
+  ~QueueStop();
+
+  bool requested() const { return stopped.load(std::memory_order_acquire); }
+  // Readable once stop is requested, to be polled together with other fds
+  int fd() const { return eventFd; }
+  void request();
+
+private:
+  std::atomic<bool> stopped{false};
+  int eventFd;
+};
+
+// Stop token of the queue running the calling thread, one that is never requested elsewhere
+QueueStop& currentQueueStop();
+
+// Thread that runs tasks one by one in the order they were queued and settles their promises on the JS thread.
+// The thread starts with the first task, bound to the addon instance of the thread that queued it,
+// and stops in an env cleanup hook.
+class NativeQueue {
+public:
+  explicit NativeQueue(const char* name) : name(name) {}
+  ~NativeQueue();
+
+  // Schedules execute on the queue thread and returns a promise settled on the JS thread.
+  // resolve builds the result value, it's called on the JS thread after execute has finished.
+  Napi::Promise enqueue(
+    Napi::Env env,
+    std::function<void()> execute,
+    std::function<Napi::Value(Napi::Env)> resolve
+  );
+
+private:
+  static void stop(void* queue);
+  static void settle(Napi::Env env, Napi::Function, NativeTask* task);
+  void run(AddonData* data);
+
+  const char* name;
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<NativeTask*> tasks;
+  bool stopping = false;
+  // Requested before the thread is joined, tasks get it from currentQueueStop()
+  QueueStop stopToken;
+  // Delivers finished tasks back to the JS thread
+  Napi::ThreadSafeFunction completion;
+  // Tasks queued but not yet settled, completion is referenced only while there are any
+  size_t pendingTasks = 0;
+};
+
+// Queue of the calling thread's addon instance for X requests and input events,
+// they must not be reordered or interleaved
+NativeQueue& nativeQueue();
+
+// Promise resolved with undefined once execute has finished
+inline Napi::Promise runOnQueue(NativeQueue& queue, Napi::Env env, std::function<void()> execute) {
+  return queue.enqueue(env, std::move(execute), [](Napi::Env env) { return env.Undefined(); });
+}
+
+// Promise resolved with resolve(env, result) where result is the value returned by execute
+template <typename T, typename Execute, typename Resolve>
+Napi::Promise runOnQueue(NativeQueue& queue, Napi::Env env, Execute execute, Resolve resolve) {
+  auto result = std::make_shared<T>();
+  return queue.enqueue(
+    env,
+    [result, execute]() { *result = execute(); },
+    [result, resolve](Napi::Env env) -> Napi::Value { return resolve(env, *result); }
+  );
+}
+
+inline Napi::Promise runOnNativeQueue(Napi::Env env, std::function<void()> execute) {
+  return runOnQueue(nativeQueue(), env, std::move(execute));
+}
+
+template <typename T, typename Execute, typename Resolve>
+Napi::Promise runOnNativeQueue(Napi::Env env, Execute execute, Resolve resolve) {
+  return runOnQueue<T>(nativeQueue(), env, execute, resolve);
+}
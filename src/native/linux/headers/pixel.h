@@ -0,0 +1,68 @@
+#pragma once
+
+#include <napi.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./capture.h"
+
+struct AddonData;
+class PixelWatcher;
+
+struct PixelColor {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+};
+
+struct PixelWait {
+  CaptureRect region;
+  PixelColor color;
+  // Largest difference of a channel that still matches
+  uint8_t tolerance;
+  std::chrono::milliseconds interval;
+  std::chrono::steady_clock::time_point started;
+  std::chrono::steady_clock::time_point deadline;
+  std::chrono::steady_clock::time_point nextPoll;
+  Napi::Promise::Deferred deferred;
+  bool matched = false;
+  // First matching pixel, scanned row by row
+  int x = 0;
+  int y = 0;
+  PixelColor found = {0, 0, 0};
+  bool failed = false;
+  std::string error;
+  PixelWatcher* watcher = nullptr;
+};
+
+// Thread that polls the regions of pending waitForPixel calls, each one at its own interval.
+// Regions are small, so every poll is a tiny capture instead of a screenshot going over the network.
+// Starts with the first wait, stops in an env cleanup hook.
+class PixelWatcher {
+public:
+  ~PixelWatcher();
+
+  // Takes ownership of wait, its promise is settled on the JS thread on match, timeout or error
+  Napi::Promise watch(Napi::Env env, PixelWait* wait);
+
+private:
+  static void stop(void* watcher);
+  static void settle(Napi::Env env, Napi::Function, PixelWait* wait);
+  void run(AddonData* data);
+  void finish(PixelWait* wait);
+
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<PixelWait*> waits;
+  bool stopping = false;
+  Napi::ThreadSafeFunction completion;
+  // Waits not settled yet, completion is referenced only while there are any
+  size_t pendingWaits = 0;
+};
+
+Napi::Object pixelInit(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <napi.h>
+#include <sys/types.h>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct ProcessSample {
+  // Unix time in ms
+  double time;
+  // Percent of one core since the previous sample, above 100 for processes busy on several cores
+  double cpu;
+  uint64_t residentBytes;
+  // Equal to residentBytes unless proportional memory is sampled and readable
+  uint64_t proportionalBytes;
+  // Bytes read from and written to storage since the process has started, only when io is set
+  uint64_t readBytes;
+  uint64_t writeBytes;
+  bool io;
+  uint32_t threadCount;
+};
+
+struct ProcessSamplerOptions {
+  // Every process when empty
+  std::vector<pid_t> pids;
+  uint32_t intervalMs;
+  // Samples kept per process
+  uint32_t historySize;
+  // Read PSS from smaps_rollup, it walks page tables of every process and costs far more than the rest
+  bool proportional;
+};
+
+struct ProcessHistory {
+  pid_t pid;
+  // Oldest first
+  std::vector<ProcessSample> samples;
+};
+
+// Thread that reads /proc of the sampled processes every interval and keeps their last samples in rings.
+// Readers never touch /proc, they copy the rings under the mutex. Started from JS, stopped from JS
+// or in an env cleanup hook.
+class ProcessSampler {
+public:
+  ~ProcessSampler();
+
+  // Starts sampling, replaces the options and drops the history if it's already running
+  void start(Napi::Env env, const ProcessSamplerOptions& options);
+  // Stops the thread and drops the history, does nothing if it's not running
+  void close();
+
+  // Last limit samples of the pids that are sampled, of every sampled process when pids is empty.
+  // Processes without samples yet are left out
+  std::vector<ProcessHistory> history(const std::vector<pid_t>& pids, size_t limit);
+
+  bool running() const {
+    return thread.joinable();
+  }
+
+private:
+  struct Track {
+    // Tells the process from a later one with the same pid
+    unsigned long long startTime;
+    unsigned long long cpuTicks;
+    // Steady clock ms of cpuTicks
+    double time;
+    // Ring of options.historySize samples, next is where the next one goes
+    std::vector<ProcessSample> ring;
+    size_t next;
+    size_t count;
+    // Sweep that has seen the process last, gone processes are dropped
+    uint64_t sweep;
+  };
+
+  static void stop(void* sampler);
+  void run();
+  void sample(uint64_t sweep);
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping = false;
+  ProcessSamplerOptions options;
+  std::unordered_map<pid_t, Track> tracks;
+  std::thread thread;
+  bool cleanupHook = false;
+};
+
+Napi::Object processSamplerInit(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <napi.h>
+#include <sys/types.h>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class RestartPolicy {
+  Never,
+  // Non zero exit code or a signal
+  OnFailure,
+  // Any exit, a clean one included
+  OnExit,
+};
+
+struct RestartOptions {
+  RestartPolicy policy = RestartPolicy::Never;
+  // Restarts in a row, a process that has run long enough starts counting from 0 again
+  uint32_t maxRestarts = 0;
+  // Delay of the first restart, doubled for every next one in a row
+  uint32_t backoffMs = 0;
+};
+
+struct ProcessExit {
+  pid_t pid;
+  // Exit status is known for processes the supervisor has started, only the parent of a process can read it
+  bool known;
+  // Exit code or -1 if the process was killed by a signal
+  int code;
+  // Signal that has killed the process or 0
+  int signal;
+  // Unix time in ms
+  double time;
+};
+
+class ProcessSupervisor;
+
+struct ExitWait {
+  uint32_t id;
+  std::chrono::steady_clock::time_point deadline;
+  Napi::Promise::Deferred deferred;
+  bool exited = false;
+  ProcessExit exit = {};
+  // A restart is scheduled after this exit
+  bool restarting = false;
+  ProcessSupervisor* supervisor = nullptr;
+};
+
+struct SupervisedProcess {
+  uint32_t id;
+  pid_t pid;
+  // -1 once the process has exited
+  int pidFd;
+  // Started by the supervisor, so it reaps the process and knows its exit status
+  bool child;
+  std::string path;
+  std::vector<std::string> args;
+  RestartOptions restart;
+  uint32_t restarts = 0;
+  uint32_t restartsInRow = 0;
+  std::chrono::steady_clock::time_point started;
+  // Pending restart, time_point::max() if there's none
+  std::chrono::steady_clock::time_point restartAt = std::chrono::steady_clock::time_point::max();
+  bool hasExited = false;
+  ProcessExit lastExit = {};
+  // Dropped once it exits, without restarting
+  bool released = false;
+};
+
+// Holds a pidfd of every launched or adopted process and waits for all of them on one epoll thread, so an exit
+// is seen right away instead of on the next poll. Processes it launches are reaped by it (not by libuv), which
+// gives the exact exit status, and restarted with backoff according to their policy.
+// Starts with the first process, stops in an env cleanup hook.
+class ProcessSupervisor {
+public:
+  ~ProcessSupervisor();
+
+  // Starts path with args in a new session, stdio goes to /dev/null. Returns the id. Throws Napi::Error
+  uint32_t launch(Napi::Env env, const std::string& path, const std::vector<std::string>& args,
+    const RestartOptions& restart, pid_t& pid);
+  // Watches a running process started by someone else, its exit status is not known. Throws Napi::Error
+  uint32_t adopt(Napi::Env env, pid_t pid);
+  // Takes ownership of wait, its promise is settled on the JS thread on the next exit of the process,
+  // right away if it has exited already, or with exited false on timeout
+  Napi::Promise waitForExit(Napi::Env env, ExitWait* wait);
+  // Stops supervising, a running child is still reaped when it exits. Returns false if there's no such id
+  bool release(uint32_t id);
+  // Copies of supervised processes, the last ones that have exited for good included
+  std::vector<SupervisedProcess> list();
+
+private:
+  static void stop(void* supervisor);
+  static void settle(Napi::Env env, Napi::Function, ExitWait* wait);
+  void start(Napi::Env env);
+  void wake();
+  void run();
+  // Called with mutex locked
+  uint32_t add(const SupervisedProcess& process);
+  void exited(SupervisedProcess& process, std::chrono::steady_clock::time_point now);
+  void relaunch(SupervisedProcess& process, std::chrono::steady_clock::time_point now);
+  // Settles waits of the process with its last exit
+  void settleWaits(const SupervisedProcess& process, bool restarting);
+  void finish(ExitWait* wait);
+  std::chrono::steady_clock::time_point nextDeadline() const;
+
+  std::mutex mutex;
+  std::map<uint32_t, SupervisedProcess> processes;
+  std::vector<ExitWait*> waits;
+  uint32_t nextId = 1;
+  int epollFd = -1;
+  // Wakes the thread up on new waits and on stop
+  int wakeFd = -1;
+  bool stopping = false;
+  std::thread thread;
+  Napi::ThreadSafeFunction completion;
+  // Waits not settled yet, completion is referenced only while there are any
+  size_t pendingWaits = 0;
+};
+
+Napi::Object processSupervisorInit(Napi::Env env, Napi::Object exports);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <napi.h>
+#include <sys/types.h>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Part of /proc/[pid] a process name is matched against
+enum class ProcessMatch {
+  // Executable name the kernel keeps for the process, up to 15 characters (like pkill)
+  Comm,
+  // Whole command line with arguments joined by spaces (like pgrep -f)
+  Cmdline,
+};
+
+struct ProcessKillResult {
+  // Exited after SIGTERM within the grace period
+  std::vector<pid_t> terminated;
+  // Got SIGKILL, either right away or after the grace period
+  std::vector<pid_t> killed;
+};
+
+// Open /proc directory, files of processes are opened relative to it
+class ProcDirectory {
+public:
+  // Throws NativeError
+  ProcDirectory();
+  ~ProcDirectory();
+  ProcDirectory(const ProcDirectory&) = delete;
+  ProcDirectory& operator=(const ProcDirectory&) = delete;
+
+  const int fd;
+};
+
+// Reads /proc/[pid]/file with a single pread into content and NUL terminates it, so at most size - 1 bytes are read.
+// Returns the length or -1 if the process is gone or the file is not readable
+ssize_t readProcFile(int procFd, pid_t pid, const char* file, char* content, size_t size);
+
+// Calls fn for every process in /proc until it returns false. procFd is an open /proc directory for openat.
+// Throws NativeError, safe to call off the JS thread
+void forEachProcess(const std::function<bool(int procFd, pid_t pid)>& fn);
+
+// Processes whose comm or cmdline contains name, the calling process is skipped. Throws NativeError
+std::vector<pid_t> findProcesses(const std::string& name, ProcessMatch match);
+
+// Sends SIGTERM and waits up to graceMs for the processes to exit, then sends SIGKILL to the rest.
+// graceMs 0 sends SIGKILL right away. Processes that are already gone are left out of the result.
+// Throws NativeError when a process can't be signalled
+ProcessKillResult killProcesses(const std::vector<pid_t>& pids, uint32_t graceMs);
+
+// ppid -> children index of every process. The first lookup scans /proc and reads stat of every process,
+// later ones list /proc and read stat only of processes started since, and of children of the ones that exited
+// because they were reparented. A pid reused between two lookups is caught by its start time when the lookup
+// reaches it. Safe to call from any thread
+class ProcessTree {
+public:
+  // pid followed by all of its descendants, with the index refreshed first. Throws NativeError
+  std::vector<pid_t> descendants(pid_t pid);
+
+private:
+  struct Node {
+    pid_t ppid;
+    // Clock ticks since boot, tells a process from a later one with the same pid
+    unsigned long long startTime;
+    // Refresh that has seen the process last
+    uint64_t seen;
+  };
+
+  void refresh();
+  void link(pid_t pid, pid_t ppid);
+  void unlink(pid_t pid, pid_t ppid);
+  bool relink(int procFd, pid_t pid);
+  void revalidate(int procFd, pid_t pid);
+
+  std::mutex mutex;
+  std::unordered_map<pid_t, Node> nodes;
+  std::unordered_map<pid_t, std::vector<pid_t>> children;
+  uint64_t generation = 0;
+};
+
+Napi::Object processTableInit(Napi::Env env, Napi::Object exports);
@@ -1,7 +1,41 @@
 #pragma once
 
 #include <napi.h>
+#include <sys/types.h>
+#include <cstdint>
+#include <string>
 
-std::string getProcessPath(pid_t pid, Napi::Env env);
+// Throws NativeError, safe to call off the JS thread
+std::string getProcessPath(pid_t pid);
+
+// Fields of /proc/[pid]/stat
+struct ProcessStat {
+  long long ppid;
+  long long threadCount;
+  // Clock ticks
+  unsigned long long utime;
+  unsigned long long stime;
+  // Clock ticks since boot, tells a process from a later one that got the same pid
+  unsigned long long startTime;
+};
+
+// /proc/[pid]/statm in bytes
+struct ProcessStatm {
+  uint64_t virtualBytes;
+  uint64_t residentBytes;
+  uint64_t sharedBytes;
+};
+
+// Readers of /proc/[pid] files, each one is a single pread into a stack buffer parsed in place.
+// procFd is an open /proc directory. They return false if the process is gone or the file is not readable
+bool readProcessStat(int procFd, pid_t pid, ProcessStat& stat);
+bool readProcessStatm(int procFd, pid_t pid, ProcessStatm& statm);
+// PSS and private memory from smaps_rollup, it's only readable by the owner of the process and walks its page tables
+bool readProcessRollup(int procFd, pid_t pid, uint64_t& proportionalBytes, uint64_t& privateBytes);
+// Bytes the process has read from and written to storage, /proc/[pid]/io is only readable by the owner
+bool readProcessIo(int procFd, pid_t pid, uint64_t& readBytes, uint64_t& writeBytes);
+
+// Unix time of boot in seconds. starttime counts from boot including suspend, same as CLOCK_BOOTTIME
+double bootTime();
 
 Napi::Object processInit(Napi::Env env, Napi::Object exports);
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <napi.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "./capture.h"
+#include "./damage.h"
+
+struct ScreenStreamOptions {
+  // Sends only damaged tiles, each one a separate JPEG, instead of whole frames
+  bool tiles = false;
+  int tileSize = 128;
+  int quality = 70;
+  // Shortest time between two frames, from maxFps
+  std::chrono::milliseconds minInterval{100};
+};
+
+// JPEG of a part of the stream area, in stream area coordinates
+struct StreamTile {
+  CaptureRect rect;
+  std::vector<uint8_t> data;
+};
+
+struct StreamFrame {
+  // Every tile of the area is included, a viewer can start from it
+  bool full = false;
+  std::vector<StreamTile> tiles;
+};
+
+// Stream opened by JS. JS asks for one frame at a time: the damage thread answers when something has changed,
+// then only the damaged tiles are captured on the native queue and encoded on the encode queue.
+// A screen that doesn't change costs nothing, a slow consumer simply asks less often.
+struct ScreenStream {
+  uint32_t id;
+  CaptureRect area;
+  ScreenStreamOptions options;
+  std::shared_ptr<DamageSubscription> subscription;
+  // Promise of the requested frame
+  std::optional<Napi::Promise::Deferred> pending;
+  std::chrono::steady_clock::time_point lastFrame;
+  // Frames mode only: damaged tiles are captured into it and the whole image is encoded.
+  // Used by one encoding at a time, JS asks for the next frame after the previous one is resolved
+  std::shared_ptr<std::vector<uint8_t>> screen;
+};
+
+// Streams of an addon instance, used on the JS thread only
+struct ScreenStreams {
+  uint32_t nextId = 1;
+  std::unordered_map<uint32_t, std::unique_ptr<ScreenStream>> streams;
+  // Delivers damage from the damage thread
+  Napi::ThreadSafeFunction damaged;
+  // Frames JS waits for, damaged is referenced only while there are any
+  size_t pendingFrames = 0;
+};
+
+Napi::Object screenStreamInit(Napi::Env env, Napi::Object exports);
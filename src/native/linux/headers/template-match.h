@@ -0,0 +1,40 @@
+#pragma once
+
+#include <napi.h>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "./image-decode.h"
+#include "./worker-pool.h"
+
+struct TemplateMatch {
+  // Top left corner in screen coordinates
+  int x;
+  int y;
+  uint32_t width;
+  uint32_t height;
+  // Normalized cross-correlation 0..1, 1 is an exact match
+  double score;
+};
+
+struct TemplateSearch {
+  GrayImage image;
+  // Lowest score of a returned match
+  double threshold = 0.9;
+  uint32_t maxResults = 1;
+};
+
+// Screen position of the last match of every template an instance has searched for, by template pixels hash.
+// The next search of the same template checks around it first
+struct TemplateHits {
+  std::mutex mutex;
+  std::unordered_map<uint64_t, std::pair<int, int>> positions;
+};
+
+// Finds search.image in screen, which starts at originX, originY in screen coordinates.
+// Best matches go first. Throws NativeError
+std::vector<TemplateMatch> findTemplate(const GrayImage& screen, int originX, int originY,
+  const TemplateSearch& search, TemplateHits& hits, WorkerPool& pool);
+
+Napi::Object templateMatchInit(Napi::Env env, Napi::Object exports);
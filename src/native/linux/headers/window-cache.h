@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <napi.h>
+#include "./window-info.h"
+
+// Immutable state of managed windows. A new snapshot is published after every batch of X events,
+// readers hold a shared_ptr to it and never wait for the event thread.
+struct WindowCacheSnapshot : std::enable_shared_from_this<WindowCacheSnapshot> {
+  std::unordered_map<xcb_window_t, WindowInfoData> windows;
+  // _NET_CLIENT_LIST order
+  std::vector<xcb_window_t> clients;
+  bool hasActiveWindow = false;
+  xcb_window_t activeWindow = XCB_NONE;
+  // WindowCache::localWrites read before the refresh this snapshot comes from was requested
+  uint64_t localWrites = 0;
+};
+
+// Latest snapshot, read without locks. libstdc++ implements atomic shared_ptr with a pool of mutexes, so the raw
+// pointer is published instead and guarded by hazard slots: a reader announces the snapshot it's about to take
+// a reference to, and the writer drops replaced snapshots only when no slot holds them.
+class SnapshotPublisher {
+public:
+  // Any thread. nullptr when nothing is published or more readers than slots run at once
+  std::shared_ptr<const WindowCacheSnapshot> load();
+  // One writer at a time: the event thread, then the cleanup hook after joining it
+  void publish(std::shared_ptr<const WindowCacheSnapshot> snapshot);
+
+private:
+  std::atomic<const WindowCacheSnapshot*> current{nullptr};
+  std::array<std::atomic<const WindowCacheSnapshot*>, 64> hazards{};
+  // Published snapshot and replaced ones a reader may still be taking a reference to, touched by the writer only
+  std::vector<std::shared_ptr<const WindowCacheSnapshot>> owned;
+};
+
+// Background tracking of one addon instance.
+// Event thread owns its own connection, so waiting for events never delays requests from JS thread
+struct WindowCache {
+  XcbWindowContext context;
+  std::thread thread;
+  // Wakes the event thread up on local writes and on stop
+  int wakeFd = -1;
+  std::atomic<bool> stopping{false};
+  SnapshotPublisher snapshots;
+  // Requests changing windows sent by this instance. Snapshots older than the last one are not returned,
+  // so a read right after a write never sees the state from before it
+  std::atomic<uint64_t> localWrites{0};
+  // Windows changed since the last refresh, the event thread re-reads them even if no event comes
+  std::mutex writtenMutex;
+  std::vector<xcb_window_t> writtenWindows;
+  // Bumped on RandR screen, CRTC and output changes and on _NET_WORKAREA or _NET_CURRENT_DESKTOP changes.
+  // Caches of monitor layout are valid while it stays the same and watchingScreen is set
+  std::atomic<uint64_t> screenGeneration{0};
+  std::atomic<bool> watchingScreen{false};
+};
+
+// Starts a background thread with its own XCB connection that tracks managed windows from X events.
+// Does nothing if the cache is already running. Failures are logged and the cache stays disabled.
+void startWindowCache(Napi::Env env);
+
+// Returns the latest snapshot of the calling thread's instance or nullptr when the cache isn't running (yet)
+// or hasn't caught up with a local write
+std::shared_ptr<const WindowCacheSnapshot> getWindowCacheSnapshot();
+
+// Called after requests changing window were flushed, reads go to the X server until the next snapshot
+void windowCacheLocalWrite(xcb_window_t window);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <sys/types.h>
+#include <xcb/xcb_ewmh.h>
+#include <xcb/res.h>
+
+// XCB connection along with atoms and extensions needed to query windows.
+// window.cc and the window cache thread each own one.
+struct XcbWindowContext {
+  xcb_connection_t* connection = nullptr;
+  // False when the connection is borrowed, e.g. from the instance display, and is closed by its owner
+  bool ownsConnection = true;
+  xcb_ewmh_connection_t ewmh;
+  xcb_window_t rootWindow = XCB_NONE;
+  xcb_atom_t netWmWindowOpacityAtom = XCB_NONE;
+  // X-Resource >= 1.2 can tell the pid of any local client, even if it doesn't set _NET_WM_PID
+  bool xresClientIdsSupported = false;
+};
+
+// Every request getWindowInfo needs. They are all written to the socket before the first reply is awaited,
+// so a lookup costs a single round-trip instead of one per property.
+struct WindowInfoCookies {
+  xcb_get_property_cookie_t pid;
+  xcb_get_geometry_cookie_t geometry;
+  xcb_translate_coordinates_cookie_t translate;
+  xcb_get_window_attributes_cookie_t attributes;
+  xcb_get_property_cookie_t state;
+  xcb_get_property_cookie_t netWmName;
+  xcb_get_property_cookie_t wmName;
+  xcb_get_property_cookie_t opacity;
+  xcb_query_tree_cookie_t tree;
+  xcb_res_query_client_ids_cookie_t clientPid;
+};
+
+struct WindowInfoData {
+  xcb_window_t wid;
+  pid_t pid;
+  int32_t x;
+  int32_t y;
+  uint32_t width;
+  uint32_t height;
+  std::string visibility;
+  std::string title;
+  double opacity;
+  xcb_window_t parent;
+};
+
+// Connects to the X server, or uses the shared connection if given, and initializes atoms.
+// Returns error message or empty string on success
+std::string connectXcbWindowContext(XcbWindowContext& ctx, xcb_connection_t* shared = nullptr);
+
+void disconnectXcbWindowContext(XcbWindowContext& ctx);
+
+// Appends X11 error details to the message, error is still owned by the caller
+std::string xcbErrorMessage(std::string errorMsg, xcb_generic_error_t* error);
+
+// Reads _NET_WM_PID out of a property reply, 0 if the window doesn't have one
+pid_t parseWindowPid(xcb_get_property_reply_t* reply);
+
+// Asks X-Resource for the pid of the client owning the resource, or of every connected client for XCB_NONE
+xcb_res_query_client_ids_cookie_t requestClientPids(const XcbWindowContext& ctx, uint32_t resource);
+
+// Maps client resource base (window id without resource_id_mask bits) to its pid.
+// Remote clients don't have a pid and are missing from the map.
+std::unordered_map<uint32_t, pid_t> collectClientPids(
+  const XcbWindowContext& ctx,
+  xcb_res_query_client_ids_cookie_t cookie
+);
+
+WindowInfoCookies requestWindowInfo(const XcbWindowContext& ctx, xcb_window_t window_id);
+
+// Drains every reply of the cookies, so nothing is left in XCB queue even if the window is gone.
+// Returns error message or empty string on success
+std::string collectWindowInfo(
+  const XcbWindowContext& ctx,
+  xcb_window_t window_id,
+  const WindowInfoCookies& cookies,
+  WindowInfoData& data
+);
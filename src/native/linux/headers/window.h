@@ -8,4 +8,8 @@ struct WindowInfo {
   pid_t pid;
 };
 
+// Connects the window context of the calling thread's instance on first use and starts its window cache.
+// JS thread only, throws Napi::Error when X is not available
+void ensure_xcb_initialized(Napi::Env env);
+
 Napi::Object windowInit(Napi::Env env, Napi::Object exports);
\ No newline at end of file
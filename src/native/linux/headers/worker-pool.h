@@ -0,0 +1,45 @@
+#pragma once
+
+#include <napi.h>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ParallelJob;
+
+// Threads that split CPU heavy work (e.g. image encoding) into independent parts.
+// Unlike NativeQueue it doesn't talk to JS: callers block in parallelFor on their own native thread.
+// Started from the JS thread, stopped in an env cleanup hook.
+class WorkerPool {
+public:
+  WorkerPool() = default;
+  ~WorkerPool();
+
+  // Starts the threads if they are not running yet. Must be called on the JS thread
+  void start(Napi::Env env);
+
+  // Calls fn(0) .. fn(count - 1) on the pool threads and the calling thread, returns once all calls have finished.
+  // Runs everything on the calling thread when the pool is not started or already stopped.
+  // Rethrows the first exception thrown by fn
+  void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+  // Number of threads parallelFor may run on, including the calling one
+  size_t concurrency() const;
+
+private:
+  static void stop(void* pool);
+  void run();
+  // Claims and runs parts of job until none are left. Called with mutex locked
+  void work(ParallelJob& job, std::unique_lock<std::mutex>& lock);
+
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<ParallelJob*> jobs;
+  bool stopping = false;
+};
@@ -0,0 +1,186 @@
+#include "./headers/image-decode.h"
+#include "./headers/native-queue.h"
+#include <zlib.h>
+#include <cstdio>
+#include <jpeglib.h>
+#include <csetjmp>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Templates are parts of the screen, anything larger than 4096x4096 is a mistake
+static const uint64_t MAX_DECODED_PIXELS = 4096ull * 4096;
+
+static uint8_t luma(uint8_t r, uint8_t g, uint8_t b) {
+  return static_cast<uint8_t>((r * 77 + g * 150 + b * 29 + 128) >> 8);
+}
+
+void bgraToGray(const uint8_t* src, uint8_t* dst, size_t pixels) {
+  // Plain loop over independent pixels, the compiler vectorizes it
+  for (size_t i = 0; i < pixels; i++) {
+    dst[i] = luma(src[i * 4 + 2], src[i * 4 + 1], src[i * 4]);
+  }
+}
+
+static uint32_t readBigEndian(const uint8_t* data) {
+  return static_cast<uint32_t>(data[0]) << 24 | data[1] << 16 | data[2] << 8 | data[3];
+}
+
+static void checkSize(uint32_t width, uint32_t height) {
+  if (width == 0 || height == 0 || static_cast<uint64_t>(width) * height > MAX_DECODED_PIXELS) {
+    throw NativeError("Image size " + std::to_string(width) + "x" + std::to_string(height) + " is not supported");
+  }
+}
+
+static uint8_t paeth(uint8_t left, uint8_t up, uint8_t upLeft) {
+  int estimate = left + up - upLeft;
+  int toLeft = abs(estimate - left);
+  int toUp = abs(estimate - up);
+  int toUpLeft = abs(estimate - upLeft);
+  if (toLeft <= toUp && toLeft <= toUpLeft) {
+    return left;
+  }
+  return toUp <= toUpLeft ? up : upLeft;
+}
+
+static GrayImage decodePng(const uint8_t* data, size_t size) {
+  uint32_t width = 0, height = 0;
+  uint8_t colorType = 0;
+  std::vector<uint8_t> palette;
+  std::vector<uint8_t> compressed;
+  size_t offset = 8;
+  while (offset + 12 <= size) {
+    uint32_t length = readBigEndian(data + offset);
+    const uint8_t* type = data + offset + 4;
+    const uint8_t* body = data + offset + 8;
+    if (length > size - offset - 12) {
+      throw NativeError("PNG chunk is truncated");
+    }
+    if (!memcmp(type, "IHDR", 4) && length >= 13) {
+      width = readBigEndian(body);
+      height = readBigEndian(body + 4);
+      colorType = body[9];
+      if (body[8] != 8 || body[12] != 0) {
+        throw NativeError("Only 8 bit not interlaced PNG is supported");
+      }
+    } else if (!memcmp(type, "PLTE", 4)) {
+      palette.assign(body, body + length);
+    } else if (!memcmp(type, "IDAT", 4)) {
+      compressed.insert(compressed.end(), body, body + length);
+    } else if (!memcmp(type, "IEND", 4)) {
+      break;
+    }
+    offset += 12 + length;
+  }
+  checkSize(width, height);
+
+  size_t channels;
+  switch (colorType) {
+    case 0: channels = 1; break;  // gray
+    case 2: channels = 3; break;  // RGB
+    case 3: channels = 1; break;  // palette
+    case 4: channels = 2; break;  // gray, alpha
+    case 6: channels = 4; break;  // RGBA
+    default: throw NativeError("PNG color type " + std::to_string(colorType) + " is not supported");
+  }
+  size_t rowSize = width * channels;
+  std::vector<uint8_t> raw((rowSize + 1) * height);
+  uLongf rawSize = static_cast<uLongf>(raw.size());
+  if (uncompress(raw.data(), &rawSize, compressed.data(), static_cast<uLong>(compressed.size())) != Z_OK ||
+    rawSize != raw.size()) {
+    throw NativeError("PNG data is corrupted");
+  }
+
+  GrayImage image;
+  image.width = width;
+  image.height = height;
+  image.pixels.resize(static_cast<size_t>(width) * height);
+  std::vector<uint8_t> previous(rowSize, 0);
+  for (uint32_t y = 0; y < height; y++) {
+    uint8_t filter = raw[y * (rowSize + 1)];
+    uint8_t* row = &raw[y * (rowSize + 1) + 1];
+    for (size_t i = 0; i < rowSize; i++) {
+      uint8_t left = i >= channels ? row[i - channels] : 0;
+      uint8_t upLeft = i >= channels ? previous[i - channels] : 0;
+      switch (filter) {
+        case 0: break;
+        case 1: row[i] += left; break;
+        case 2: row[i] += previous[i]; break;
+        case 3: row[i] += static_cast<uint8_t>((left + previous[i]) / 2); break;
+        case 4: row[i] += paeth(left, previous[i], upLeft); break;
+        default: throw NativeError("PNG filter " + std::to_string(filter) + " is not supported");
+      }
+    }
+    uint8_t* out = &image.pixels[static_cast<size_t>(y) * width];
+    for (uint32_t x = 0; x < width; x++) {
+      const uint8_t* px = row + x * channels;
+      if (colorType == 3) {
+        if (static_cast<size_t>(px[0]) * 3 + 2 >= palette.size()) {
+          throw NativeError("PNG palette index is out of range");
+        }
+        const uint8_t* color = &palette[px[0] * 3];
+        out[x] = luma(color[0], color[1], color[2]);
+      } else {
+        out[x] = channels >= 3 ? luma(px[0], px[1], px[2]) : px[0];
+      }
+    }
+    memcpy(previous.data(), row, rowSize);
+  }
+  return image;
+}
+
+struct JpegError {
+  jpeg_error_mgr manager;
+  jmp_buf jump;
+  char message[JMSG_LENGTH_MAX];
+};
+
+static void jpegErrorExit(j_common_ptr info) {
+  JpegError* error = reinterpret_cast<JpegError*>(info->err);
+  (*info->err->format_message)(info, error->message);
+  longjmp(error->jump, 1);
+}
+
+// libjpeg converts to luma itself, chroma isn't even upsampled
+static GrayImage decodeJpeg(const uint8_t* data, size_t size) {
+  jpeg_decompress_struct info;
+  JpegError error;
+  info.err = jpeg_std_error(&error.manager);
+  error.manager.error_exit = jpegErrorExit;
+  GrayImage image;
+  if (setjmp(error.jump)) {
+    jpeg_destroy_decompress(&info);
+    throw NativeError(std::string("Failed to decode JPEG: ") + error.message);
+  }
+  jpeg_create_decompress(&info);
+  jpeg_mem_src(&info, const_cast<unsigned char*>(data), static_cast<unsigned long>(size));
+  jpeg_read_header(&info, TRUE);
+  if (info.image_width == 0 || info.image_height == 0 ||
+    static_cast<uint64_t>(info.image_width) * info.image_height > MAX_DECODED_PIXELS) {
+    jpeg_destroy_decompress(&info);
+    checkSize(info.image_width, info.image_height);
+  }
+  info.out_color_space = JCS_GRAYSCALE;
+  jpeg_start_decompress(&info);
+  image.width = info.output_width;
+  image.height = info.output_height;
+  image.pixels.resize(static_cast<size_t>(image.width) * image.height);
+  while (info.output_scanline < info.output_height) {
+    JSAMPROW row = &image.pixels[static_cast<size_t>(info.output_scanline) * image.width];
+    jpeg_read_scanlines(&info, &row, 1);
+  }
+  jpeg_finish_decompress(&info);
+  jpeg_destroy_decompress(&info);
+  return image;
+}
+
+GrayImage decodeImageToGray(const uint8_t* data, size_t size) {
+  static const uint8_t pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  if (size >= 8 && !memcmp(data, pngSignature, 8)) {
+    return decodePng(data, size);
+  }
+  if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) {
+    return decodeJpeg(data, size);
+  }
+  throw NativeError("Image must be PNG or JPEG");
+}
@@ -0,0 +1,521 @@
+#include "./headers/image-encode.h"
+#include "./headers/native-queue.h"
+#include <zlib.h>
+#include <cstdio>
+#include <jpeglib.h>
+#include <csetjmp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Uncompressed bytes deflated by one PNG stripe. Every stripe starts with an empty dictionary,
+// smaller stripes parallelize better but compress worse
+static const size_t PNG_STRIPE_BYTES = 256 * 1024;
+
+// Output rows resized by one pool task
+static const uint32_t RESIZE_BAND_ROWS = 32;
+
+const char* imageFormatName(ImageFormat format) {
+  switch (format) {
+    case ImageFormat::Jpeg:
+      return "jpeg";
+    case ImageFormat::Qoi:
+      return "qoi";
+    default:
+      return "png";
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 4 pixels per shuffle. Every store writes 16 bytes of which 12 are valid,
+// so the loop stops 2 pixels early to not write past the end of dst
+__attribute__((target("ssse3")))
+static size_t bgraToRgbSsse3(const uint8_t* src, uint8_t* dst, size_t pixels) {
+  const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  size_t i = 0;
+  for (; i + 6 <= pixels; i += 4) {
+    __m128i bgra = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3), _mm_shuffle_epi8(bgra, shuffle));
+  }
+  return i;
+}
+#elif defined(__ARM_NEON)
+static size_t bgraToRgbNeon(const uint8_t* src, uint8_t* dst, size_t pixels) {
+  size_t i = 0;
+  for (; i + 16 <= pixels; i += 16) {
+    uint8x16x4_t bgra = vld4q_u8(src + i * 4);
+    uint8x16x3_t rgb = {{bgra.val[2], bgra.val[1], bgra.val[0]}};
+    vst3q_u8(dst + i * 3, rgb);
+  }
+  return i;
+}
+#endif
+
+void bgraToRgb(const uint8_t* src, uint8_t* dst, size_t pixels) {
+  size_t done = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  static const bool ssse3 = __builtin_cpu_supports("ssse3");
+  if (ssse3) {
+    done = bgraToRgbSsse3(src, dst, pixels);
+  }
+#elif defined(__ARM_NEON)
+  done = bgraToRgbNeon(src, dst, pixels);
+#endif
+  for (size_t i = done; i < pixels; i++) {
+    dst[i * 3] = src[i * 4 + 2];
+    dst[i * 3 + 1] = src[i * 4 + 1];
+    dst[i * 3 + 2] = src[i * 4];
+  }
+}
+
+// Splits rows 0..height into bands and resizes them on the pool
+template <typename ResizeRows>
+static void resizeBands(uint32_t height, WorkerPool& pool, ResizeRows resizeRows) {
+  size_t bands = (height + RESIZE_BAND_ROWS - 1) / RESIZE_BAND_ROWS;
+  pool.parallelFor(bands, [&](size_t band) {
+    uint32_t first = static_cast<uint32_t>(band) * RESIZE_BAND_ROWS;
+    resizeRows(first, std::min(first + RESIZE_BAND_ROWS, height));
+  });
+}
+
+// Averages all source pixels covered by every output pixel, used for downscaling 2x and more.
+// Rows are summed into a wide accumulator with plain loops over bytes, which the compiler vectorizes
+static void resizeBox(const RawImage& src, uint8_t* dst, uint32_t width, uint32_t height, WorkerPool& pool) {
+  std::vector<uint32_t> left(width + 1);
+  for (uint32_t x = 0; x <= width; x++) {
+    left[x] = static_cast<uint32_t>(static_cast<uint64_t>(x) * src.width / width);
+  }
+  resizeBands(height, pool, [&](uint32_t first, uint32_t last) {
+    std::vector<uint32_t> sums(static_cast<size_t>(src.width) * 4);
+    for (uint32_t y = first; y < last; y++) {
+      uint32_t top = static_cast<uint32_t>(static_cast<uint64_t>(y) * src.height / height);
+      uint32_t bottom = static_cast<uint32_t>(static_cast<uint64_t>(y + 1) * src.height / height);
+      std::fill(sums.begin(), sums.end(), 0);
+      for (uint32_t row = top; row < bottom; row++) {
+        const uint8_t* line = src.pixels + static_cast<size_t>(row) * src.stride;
+        uint32_t* sum = sums.data();
+        for (size_t i = 0; i < sums.size(); i++) {
+          sum[i] += line[i];
+        }
+      }
+      uint8_t* out = dst + static_cast<size_t>(y) * width * 4;
+      for (uint32_t x = 0; x < width; x++) {
+        uint32_t area = (left[x + 1] - left[x]) * (bottom - top);
+        uint32_t pixel[4] = {0, 0, 0, 0};
+        for (uint32_t sx = left[x]; sx < left[x + 1]; sx++) {
+          for (int c = 0; c < 4; c++) {
+            pixel[c] += sums[sx * 4 + c];
+          }
+        }
+        for (int c = 0; c < 4; c++) {
+          out[x * 4 + c] = static_cast<uint8_t>((pixel[c] + area / 2) / area);
+        }
+      }
+    }
+  });
+}
+
+// Maps output position to the two nearest source ones and the 8 bit weight of the second one
+static void bilinearTaps(uint32_t from, uint32_t to, std::vector<uint32_t>& taps, std::vector<uint16_t>& weights) {
+  taps.resize(to);
+  weights.resize(to);
+  for (uint32_t i = 0; i < to; i++) {
+    double center = std::max((i + 0.5) * from / to - 0.5, 0.0);
+    uint32_t tap = std::min(static_cast<uint32_t>(center), from - 1);
+    taps[i] = tap;
+    weights[i] = tap + 1 < from ? static_cast<uint16_t>((center - tap) * 256) : 0;
+  }
+}
+
+// Blends two source rows into a 16 bit one first, the loop over bytes is vectorized by the compiler,
+// then blends horizontal neighbours of that row
+static void resizeBilinear(const RawImage& src, uint8_t* dst, uint32_t width, uint32_t height, WorkerPool& pool) {
+  std::vector<uint32_t> columns, rows;
+  std::vector<uint16_t> columnWeights, rowWeights;
+  bilinearTaps(src.width, width, columns, columnWeights);
+  bilinearTaps(src.height, height, rows, rowWeights);
+  resizeBands(height, pool, [&](uint32_t first, uint32_t last) {
+    size_t rowBytes = static_cast<size_t>(src.width) * 4;
+    std::vector<uint16_t> blended(rowBytes);
+    for (uint32_t y = first; y < last; y++) {
+      const uint8_t* top = src.pixels + static_cast<size_t>(rows[y]) * src.stride;
+      const uint8_t* bottom = rowWeights[y] ? top + src.stride : top;
+      uint16_t bottomWeight = rowWeights[y];
+      uint16_t topWeight = 256 - bottomWeight;
+      uint16_t* line = blended.data();
+      for (size_t i = 0; i < rowBytes; i++) {
+        line[i] = static_cast<uint16_t>(top[i] * topWeight + bottom[i] * bottomWeight);
+      }
+      uint8_t* out = dst + static_cast<size_t>(y) * width * 4;
+      for (uint32_t x = 0; x < width; x++) {
+        const uint16_t* left = line + columns[x] * 4;
+        const uint16_t* right = columnWeights[x] ? left + 4 : left;
+        uint32_t rightWeight = columnWeights[x];
+        uint32_t leftWeight = 256 - rightWeight;
+        for (int c = 0; c < 4; c++) {
+          out[x * 4 + c] = static_cast<uint8_t>((left[c] * leftWeight + right[c] * rightWeight + 0x8000) >> 16);
+        }
+      }
+    }
+  });
+}
+
+static RawImage resizeImage(const RawImage& src, uint32_t width, uint32_t height, std::vector<uint8_t>& storage,
+  WorkerPool& pool) {
+  storage.resize(static_cast<size_t>(width) * height * 4);
+  if (src.width >= width * 2 && src.height >= height * 2) {
+    resizeBox(src, storage.data(), width, height, pool);
+  } else {
+    resizeBilinear(src, storage.data(), width, height, pool);
+  }
+  return {storage.data(), width, height, width * 4};
+}
+
+static void writeBigEndian(uint8_t* out, uint32_t value) {
+  out[0] = static_cast<uint8_t>(value >> 24);
+  out[1] = static_cast<uint8_t>(value >> 16);
+  out[2] = static_cast<uint8_t>(value >> 8);
+  out[3] = static_cast<uint8_t>(value);
+}
+
+static void appendPngChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t size) {
+  size_t offset = out.size();
+  out.resize(offset + 12 + size);
+  writeBigEndian(&out[offset], static_cast<uint32_t>(size));
+  memcpy(&out[offset + 4], type, 4);
+  if (size) {
+    memcpy(&out[offset + 8], data, size);
+  }
+  uLong crc = crc32(crc32(0, Z_NULL, 0), &out[offset + 4], static_cast<uInt>(size + 4));
+  writeBigEndian(&out[offset + 8 + size], static_cast<uint32_t>(crc));
+}
+
+static uint8_t paeth(uint8_t left, uint8_t up, uint8_t upLeft) {
+  int estimate = left + up - upLeft;
+  int toLeft = abs(estimate - left);
+  int toUp = abs(estimate - up);
+  int toUpLeft = abs(estimate - upLeft);
+  if (toLeft <= toUp && toLeft <= toUpLeft) {
+    return left;
+  }
+  return toUp <= toUpLeft ? up : upLeft;
+}
+
+// Filters row with Sub, Up or Paeth, whichever has the smallest sum of absolute values,
+// the heuristic recommended by the PNG spec. out is 1 filter byte followed by the filtered row
+static void filterPngRow(const uint8_t* row, const uint8_t* previous, size_t size, uint8_t* out,
+  std::vector<uint8_t>& best, std::vector<uint8_t>& trial) {
+  static const uint8_t filters[] = {1, 2, 4};  // Average rarely wins on screen content
+  best.resize(size);
+  trial.resize(size);
+  uint32_t bestSum = UINT32_MAX;
+  for (uint8_t filter : filters) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < size; i++) {
+      uint8_t left = i >= 3 ? row[i - 3] : 0;
+      uint8_t upLeft = i >= 3 ? previous[i - 3] : 0;
+      uint8_t predicted = filter == 1 ? left : filter == 2 ? previous[i] : paeth(left, previous[i], upLeft);
+      trial[i] = static_cast<uint8_t>(row[i] - predicted);
+      sum += static_cast<uint32_t>(abs(static_cast<int8_t>(trial[i])));
+    }
+    if (sum < bestSum) {
+      bestSum = sum;
+      best.swap(trial);
+      out[0] = filter;
+    }
+  }
+  memcpy(out + 1, best.data(), size);
+}
+
+struct PngStripe {
+  std::vector<uint8_t> deflated;
+  uLong adler = 0;
+  size_t rawSize = 0;
+};
+
+static void deflateInto(z_stream& stream, std::vector<uint8_t>& out, const uint8_t* data, size_t size, int flush) {
+  stream.next_in = const_cast<uint8_t*>(data);
+  stream.avail_in = static_cast<uInt>(size);
+  do {
+    size_t used = out.size() - stream.avail_out;
+    if (stream.avail_out == 0) {
+      out.resize(out.size() * 2);
+      stream.avail_out = static_cast<uInt>(out.size() - used);
+    }
+    stream.next_out = out.data() + used;
+    deflate(&stream, flush);
+  } while (stream.avail_out == 0);
+}
+
+// Deflates rows first..last into a raw deflate stream ended by a sync flush (or the final block for the last stripe),
+// so stripes compressed independently concatenate into one valid zlib stream
+static void deflatePngStripe(const RawImage& image, uint32_t first, uint32_t last, int level, PngStripe& stripe) {
+  size_t rowSize = static_cast<size_t>(image.width) * 3;
+  std::vector<uint8_t> previous(rowSize, 0);
+  std::vector<uint8_t> row(rowSize);
+  std::vector<uint8_t> filtered(rowSize + 1);
+  std::vector<uint8_t> best, trial;
+  if (first > 0) {
+    bgraToRgb(image.pixels + static_cast<size_t>(first - 1) * image.stride, previous.data(), image.width);
+  }
+
+  z_stream stream = {};
+  if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw NativeError("Failed to initialize PNG compression");
+  }
+  stripe.rawSize = (rowSize + 1) * (last - first);
+  stripe.deflated.resize(deflateBound(&stream, static_cast<uLong>(stripe.rawSize)) + 16);
+  stream.avail_out = static_cast<uInt>(stripe.deflated.size());
+  stripe.adler = adler32(0, Z_NULL, 0);
+  for (uint32_t y = first; y < last; y++) {
+    bgraToRgb(image.pixels + static_cast<size_t>(y) * image.stride, row.data(), image.width);
+    filterPngRow(row.data(), previous.data(), rowSize, filtered.data(), best, trial);
+    stripe.adler = adler32(stripe.adler, filtered.data(), static_cast<uInt>(filtered.size()));
+    int flush = y + 1 < last ? Z_NO_FLUSH : last == image.height ? Z_FINISH : Z_SYNC_FLUSH;
+    deflateInto(stream, stripe.deflated, filtered.data(), filtered.size(), flush);
+    row.swap(previous);
+  }
+  stripe.deflated.resize(stripe.deflated.size() - stream.avail_out);
+  deflateEnd(&stream);
+}
+
+// 8 bit RGB PNG, rows are filtered and deflated in parallel stripes
+static void encodePng(const RawImage& image, int level, WorkerPool& pool, std::vector<uint8_t>& out) {
+  size_t rowBytes = static_cast<size_t>(image.width) * 3 + 1;
+  uint32_t stripeRows = static_cast<uint32_t>(std::max<size_t>(1, PNG_STRIPE_BYTES / rowBytes));
+  size_t stripeCount = (image.height + stripeRows - 1) / stripeRows;
+  std::vector<PngStripe> stripes(stripeCount);
+  pool.parallelFor(stripeCount, [&](size_t i) {
+    uint32_t first = static_cast<uint32_t>(i) * stripeRows;
+    deflatePngStripe(image, first, std::min(first + stripeRows, image.height), level, stripes[i]);
+  });
+
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  size_t total = 0;
+  for (const PngStripe& stripe : stripes) {
+    total += stripe.deflated.size() + 12;
+  }
+  out.reserve(sizeof(signature) + 25 + 12 + 6 + total + 12);
+  out.assign(signature, signature + sizeof(signature));
+
+  uint8_t header[13];
+  writeBigEndian(header, image.width);
+  writeBigEndian(header + 4, image.height);
+  header[8] = 8;  // bit depth
+  header[9] = 2;  // RGB
+  header[10] = 0;  // deflate
+  header[11] = 0;  // adaptive filtering
+  header[12] = 0;  // no interlace
+  appendPngChunk(out, "IHDR", header, sizeof(header));
+
+  // zlib header with the level hint, IDAT chunks may split the stream anywhere
+  uint8_t zlibHeader[2] = {0x78, static_cast<uint8_t>(level <= 1 ? 0x01 : level <= 5 ? 0x5E : level == 6 ? 0x9C : 0xDA)};
+  appendPngChunk(out, "IDAT", zlibHeader, sizeof(zlibHeader));
+  uLong adler = adler32(0, Z_NULL, 0);
+  for (const PngStripe& stripe : stripes) {
+    appendPngChunk(out, "IDAT", stripe.deflated.data(), stripe.deflated.size());
+    adler = adler32_combine(adler, stripe.adler, static_cast<z_off_t>(stripe.rawSize));
+  }
+  uint8_t checksum[4];
+  writeBigEndian(checksum, static_cast<uint32_t>(adler));
+  appendPngChunk(out, "IDAT", checksum, sizeof(checksum));
+  appendPngChunk(out, "IEND", nullptr, 0);
+}
+
+// https://qoiformat.org/qoi-specification.pdf, RGB channels. The format is sequential, so it runs on one thread,
+// but it's an order of magnitude faster than PNG at a similar size on screen content
+static void encodeQoi(const RawImage& image, std::vector<uint8_t>& out) {
+  out.resize(14 + static_cast<size_t>(image.width) * image.height * 4 + 8);
+  uint8_t* p = out.data();
+  memcpy(p, "qoif", 4);
+  writeBigEndian(p + 4, image.width);
+  writeBigEndian(p + 8, image.height);
+  p[12] = 3;  // channels
+  p[13] = 0;  // sRGB with linear alpha
+  p += 14;
+
+  uint32_t index[64] = {};
+  uint8_t r = 0, g = 0, b = 0;
+  uint32_t previous = 0xFF000000u;
+  int run = 0;
+  for (uint32_t y = 0; y < image.height; y++) {
+    const uint8_t* px = image.pixels + static_cast<size_t>(y) * image.stride;
+    for (uint32_t x = 0; x < image.width; x++, px += 4) {
+      uint32_t current = 0xFF000000u | (static_cast<uint32_t>(px[2]) << 16) | (px[1] << 8) | px[0];
+      if (current == previous) {
+        if (++run == 62) {
+          *p++ = static_cast<uint8_t>(0xC0 | (run - 1));
+          run = 0;
+        }
+        continue;
+      }
+      if (run) {
+        *p++ = static_cast<uint8_t>(0xC0 | (run - 1));
+        run = 0;
+      }
+      uint8_t pr = px[2], pg = px[1], pb = px[0];
+      uint8_t hash = static_cast<uint8_t>((pr * 3 + pg * 5 + pb * 7 + 255 * 11) % 64);
+      if (index[hash] == current) {
+        *p++ = hash;
+      } else {
+        index[hash] = current;
+        int8_t dr = static_cast<int8_t>(pr - r);
+        int8_t dg = static_cast<int8_t>(pg - g);
+        int8_t db = static_cast<int8_t>(pb - b);
+        int8_t drdg = static_cast<int8_t>(dr - dg);
+        int8_t dbdg = static_cast<int8_t>(db - dg);
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+          *p++ = static_cast<uint8_t>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+        } else if (dg >= -32 && dg <= 31 && drdg >= -8 && drdg <= 7 && dbdg >= -8 && dbdg <= 7) {
+          *p++ = static_cast<uint8_t>(0x80 | (dg + 32));
+          *p++ = static_cast<uint8_t>((drdg + 8) << 4 | (dbdg + 8));
+        } else {
+          *p++ = 0xFE;
+          *p++ = pr;
+          *p++ = pg;
+          *p++ = pb;
+        }
+      }
+      previous = current;
+      r = pr;
+      g = pg;
+      b = pb;
+    }
+  }
+  if (run) {
+    *p++ = static_cast<uint8_t>(0xC0 | (run - 1));
+  }
+  static const uint8_t padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+  memcpy(p, padding, sizeof(padding));
+  p += sizeof(padding);
+  out.resize(p - out.data());
+}
+
+// libjpeg reports errors by calling error_exit, which must not return
+struct JpegError {
+  jpeg_error_mgr manager;
+  jmp_buf jump;
+  char message[JMSG_LENGTH_MAX];
+};
+
+static void jpegErrorExit(j_common_ptr info) {
+  JpegError* error = reinterpret_cast<JpegError*>(info->err);
+  (*info->err->format_message)(info, error->message);
+  longjmp(error->jump, 1);
+}
+
+// Compressed data goes straight into the output vector, growing it when libjpeg runs out of space
+struct JpegVectorDestination {
+  jpeg_destination_mgr manager;
+  std::vector<uint8_t>* out;
+};
+
+static void jpegInitDestination(j_compress_ptr info) {
+  JpegVectorDestination* destination = reinterpret_cast<JpegVectorDestination*>(info->dest);
+  destination->manager.next_output_byte = destination->out->data();
+  destination->manager.free_in_buffer = destination->out->size();
+}
+
+static boolean jpegEmptyOutputBuffer(j_compress_ptr info) {
+  JpegVectorDestination* destination = reinterpret_cast<JpegVectorDestination*>(info->dest);
+  size_t used = destination->out->size();
+  destination->out->resize(used * 2);
+  destination->manager.next_output_byte = destination->out->data() + used;
+  destination->manager.free_in_buffer = destination->out->size() - used;
+  return TRUE;
+}
+
+static void jpegTermDestination(j_compress_ptr info) {
+  JpegVectorDestination* destination = reinterpret_cast<JpegVectorDestination*>(info->dest);
+  destination->out->resize(destination->out->size() - destination->manager.free_in_buffer);
+}
+
+// libjpeg-turbo reads BGRX rows as they are and converts them to YCbCr with its own SIMD code,
+// plain libjpeg gets them packed into RGB first
+static void encodeJpeg(const RawImage& image, int quality, std::vector<uint8_t>& out) {
+  jpeg_compress_struct info;
+  JpegError error;
+  info.err = jpeg_std_error(&error.manager);
+  error.manager.error_exit = jpegErrorExit;
+  std::vector<uint8_t> rgbRow;
+  if (setjmp(error.jump)) {
+    jpeg_destroy_compress(&info);
+    throw NativeError(std::string("Failed to encode JPEG: ") + error.message);
+  }
+  jpeg_create_compress(&info);
+
+  out.resize(std::max<size_t>(static_cast<size_t>(image.width) * image.height / 4, 4096));
+  JpegVectorDestination destination;
+  destination.manager.init_destination = jpegInitDestination;
+  destination.manager.empty_output_buffer = jpegEmptyOutputBuffer;
+  destination.manager.term_destination = jpegTermDestination;
+  destination.out = &out;
+  info.dest = &destination.manager;
+
+  info.image_width = image.width;
+  info.image_height = image.height;
+#ifdef JCS_EXTENSIONS
+  info.input_components = 4;
+  info.in_color_space = JCS_EXT_BGRX;
+#else
+  info.input_components = 3;
+  info.in_color_space = JCS_RGB;
+  rgbRow.resize(static_cast<size_t>(image.width) * 3);
+#endif
+  jpeg_set_defaults(&info);
+  jpeg_set_quality(&info, quality, TRUE);
+  jpeg_start_compress(&info, TRUE);
+  while (info.next_scanline < info.image_height) {
+    const uint8_t* line = image.pixels + static_cast<size_t>(info.next_scanline) * image.stride;
+#ifdef JCS_EXTENSIONS
+    JSAMPROW row = const_cast<JSAMPROW>(line);
+#else
+    bgraToRgb(line, rgbRow.data(), image.width);
+    JSAMPROW row = rgbRow.data();
+#endif
+    jpeg_write_scanlines(&info, &row, 1);
+  }
+  jpeg_finish_compress(&info);
+  jpeg_destroy_compress(&info);
+}
+
+EncodedImage encodeImage(const RawImage& image, const ImageEncodeOptions& options, WorkerPool& pool) {
+  EncodedImage encoded;
+  encoded.format = options.format;
+  encoded.width = options.width;
+  encoded.height = options.height;
+  if (!encoded.width && !encoded.height) {
+    encoded.width = image.width;
+    encoded.height = image.height;
+  } else if (!encoded.height) {
+    encoded.height = static_cast<uint32_t>(std::max<uint64_t>(1, static_cast<uint64_t>(image.height) * encoded.width / image.width));
+  } else if (!encoded.width) {
+    encoded.width = static_cast<uint32_t>(std::max<uint64_t>(1, static_cast<uint64_t>(image.width) * encoded.height / image.height));
+  }
+
+  std::vector<uint8_t> resized;
+  RawImage source = image;
+  if (encoded.width != image.width || encoded.height != image.height) {
+    source = resizeImage(image, encoded.width, encoded.height, resized, pool);
+  }
+
+  switch (options.format) {
+    case ImageFormat::Png:
+      encodePng(source, options.compression, pool, encoded.data);
+      break;
+    case ImageFormat::Jpeg:
+      encodeJpeg(source, options.quality, encoded.data);
+      break;
+    case ImageFormat::Qoi:
+      encodeQoi(source, encoded.data);
+      break;
+  }
+  return encoded;
+}
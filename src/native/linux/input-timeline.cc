@@ -0,0 +1,284 @@
+#include "./headers/input-timeline.h"
+#include "./headers/keypress.h"
+#include "./headers/mouse.h"
+#include "./headers/native-queue.h"
+#include "./headers/addon-data.h"
+#include "./headers/validators.h"
+#include <X11/Xlib.h>
+#include <sys/prctl.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using TimelineClock = std::chrono::steady_clock;
+
+// Last part of every wait is spun instead of slept, timer wakeups are late by tens of microseconds
+static const std::chrono::microseconds SPIN_BEFORE_EVENT(200);
+// Same limits as the request schema, a timeline holds its queue until it ends
+static const int64_t MAX_OFFSET_US = 10LL * 60 * 1000 * 1000;
+static const uint32_t MAX_TIMELINE_EVENTS = 10000;
+
+struct TimelineEvent {
+  enum class Type { Key, Button, Move, Text };
+
+  Type type;
+  // Offset from the timeline start in microseconds
+  int64_t offsetUs;
+  // Position in the request, results are reported in the request order
+  size_t index;
+  KeySym keysym;
+  int button;
+  bool down;
+  int x;
+  int y;
+  std::string text;
+};
+
+struct TimelineResult {
+  // Actual offset of every event from the timeline start, -1 for events skipped after cancellation
+  std::vector<int64_t> actualUs;
+  std::vector<int64_t> requestedUs;
+  bool cancelled = false;
+};
+
+static TimelineEvent parseTimelineEvent(Napi::Env env, Napi::Object object, size_t index) {
+  TimelineEvent event{};
+  event.index = index;
+  Napi::Value offset = object.Get("offsetUs");
+  Napi::Value type = object.Get("type");
+  if (!offset.IsNumber() || offset.As<Napi::Number>().Int64Value() < 0) {
+    throw Napi::TypeError::New(env, "Event " + std::to_string(index) + ": offsetUs must be a non negative number");
+  }
+  if (offset.As<Napi::Number>().Int64Value() > MAX_OFFSET_US) {
+    throw Napi::RangeError::New(env, "Event " + std::to_string(index) + ": offsetUs must be at most 10 minutes");
+  }
+  if (!type.IsString()) {
+    throw Napi::TypeError::New(env, "Event " + std::to_string(index) + ": type must be a string");
+  }
+  event.offsetUs = offset.As<Napi::Number>().Int64Value();
+  std::string typeName = type.As<Napi::String>();
+
+  if (typeName == "key") {
+    Napi::Value key = object.Get("key");
+    if (!key.IsString() || !object.Get("down").IsBoolean()) {
+      throw Napi::TypeError::New(env, "Event " + std::to_string(index) + ": key event needs key and down");
+    }
+    std::string keyName = key.As<Napi::String>();
+    event.type = TimelineEvent::Type::Key;
+    event.keysym = assignKeyCode(keyName);
+    event.down = object.Get("down").As<Napi::Boolean>();
+    if (event.keysym == 0) {
+      throw Napi::Error::New(env, "Event " + std::to_string(index) + ": unknown key '" + keyName + "'");
+    }
+  } else if (typeName == "button") {
+    Napi::Value button = object.Get("button");
+    if (!button.IsString() || !object.Get("down").IsBoolean()) {
+      throw Napi::TypeError::New(env, "Event " + std::to_string(index) + ": button event needs button and down");
+    }
+    event.type = TimelineEvent::Type::Button;
+    event.button = mouseButtonFromName(button.As<Napi::String>());
+    event.down = object.Get("down").As<Napi::Boolean>();
+    if (event.button == 0) {
+      throw Napi::Error::New(env, "Event " + std::to_string(index) + ": button must be 'LEFT', 'RIGHT', or 'MIDDLE'");
+    }
+  } else if (typeName == "move") {
+    if (!object.Get("x").IsNumber() || !object.Get("y").IsNumber()) {
+      throw Napi::TypeError::New(env, "Event " + std::to_string(index) + ": move event needs x and y");
+    }
+    event.type = TimelineEvent::Type::Move;
+    event.x = object.Get("x").ToNumber().Int32Value();
+    event.y = object.Get("y").ToNumber().Int32Value();
+  } else if (typeName == "text") {
+    if (!object.Get("text").IsString()) {
+      throw Napi::TypeError::New(env, "Event " + std::to_string(index) + ": text event needs text");
+    }
+    event.type = TimelineEvent::Type::Text;
+    event.text = object.Get("text").As<Napi::String>().Utf8Value();
+  } else {
+    throw Napi::TypeError::New(env, "Event " + std::to_string(index) + ": unknown type '" + typeName + "'");
+  }
+  return event;
+}
+
+static void sendTimelineEvent(const TimelineEvent& event) {
+  switch (event.type) {
+  case TimelineEvent::Type::Key:
+    toggleKeyCode(event.keysym, event.down, 0);
+    break;
+  case TimelineEvent::Type::Button:
+    sendMouseButton(event.button, event.down);
+    break;
+  case TimelineEvent::Type::Move:
+    sendMouseMotion(event.x, event.y);
+    break;
+  case TimelineEvent::Type::Text:
+    typeText(event.text);
+    break;
+  }
+}
+
+static void cancelTimeline(TimelineControl& control) {
+  {
+    std::lock_guard<std::mutex> lock(control.mutex);
+    control.cancelled = true;
+  }
+  control.condition.notify_one();
+}
+
+// Cancels every queued and playing timeline, registered after the timeline queue hook so it runs before
+// the queue thread is joined
+static void stopTimelines(void* data) {
+  TimelineRegistry* registry = static_cast<TimelineRegistry*>(data);
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  registry->stopping = true;
+  for (auto& entry : registry->controls) {
+    cancelTimeline(*entry.second);
+  }
+}
+
+// Waits until deadline, false if the timeline was cancelled meanwhile
+static bool waitForEvent(TimelineControl& control, TimelineClock::time_point deadline) {
+  {
+    std::unique_lock<std::mutex> lock(control.mutex);
+    if (control.condition.wait_until(lock, deadline - SPIN_BEFORE_EVENT, [&] { return control.cancelled; })) {
+      return false;
+    }
+  }
+  while (TimelineClock::now() < deadline) {
+  }
+  std::lock_guard<std::mutex> lock(control.mutex);
+  return !control.cancelled;
+}
+
+static TimelineResult playTimeline(std::vector<TimelineEvent> events, TimelineControl& control) {
+  // Default 50us slack of this thread would be added to every sleep
+  prctl(PR_SET_TIMERSLACK, 1UL);
+
+  TimelineResult result;
+  result.actualUs.assign(events.size(), -1);
+  result.requestedUs.resize(events.size());
+  for (const TimelineEvent& event : events) {
+    result.requestedUs[event.index] = event.offsetUs;
+  }
+  std::stable_sort(events.begin(), events.end(), [](const TimelineEvent& a, const TimelineEvent& b) {
+    return a.offsetUs < b.offsetUs;
+  });
+
+  TimelineClock::time_point start = TimelineClock::now();
+  for (const TimelineEvent& event : events) {
+    if (!waitForEvent(control, start + std::chrono::microseconds(event.offsetUs))) {
+      result.cancelled = true;
+      break;
+    }
+    sendTimelineEvent(event);
+    result.actualUs[event.index] =
+      std::chrono::duration_cast<std::chrono::microseconds>(TimelineClock::now() - start).count();
+  }
+  return result;
+}
+
+static Napi::Value timelineResultToObject(Napi::Env env, const TimelineResult& result) {
+  Napi::Array events = Napi::Array::New(env, result.actualUs.size());
+  for (uint32_t i = 0; i < result.actualUs.size(); i++) {
+    Napi::Object event = Napi::Object::New(env);
+    event.Set("requestedUs", Napi::Number::New(env, static_cast<double>(result.requestedUs[i])));
+    if (result.actualUs[i] >= 0) {
+      event.Set("actualUs", Napi::Number::New(env, static_cast<double>(result.actualUs[i])));
+    }
+    events[i] = event;
+  }
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("cancelled", Napi::Boolean::New(env, result.cancelled));
+  obj.Set("events", events);
+  return obj;
+}
+
+// Replays events at their offsets from the start. Resolves with requested and actual offsets of every event.
+// Cancelled timelines resolve too, with actualUs missing on events that were not sent.
+Napi::Value playInputTimelineAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  GET_UINT_32(info, 0, timelineId, uint32_t);
+  ASSERT_ARRAY(info, 1);
+  Napi::Array items = info[1].As<Napi::Array>();
+  if (items.Length() > MAX_TIMELINE_EVENTS) {
+    throw Napi::RangeError::New(env, "At most " + std::to_string(MAX_TIMELINE_EVENTS) + " events can be played");
+  }
+  std::vector<TimelineEvent> events;
+  events.reserve(items.Length());
+  for (uint32_t i = 0; i < items.Length(); i++) {
+    Napi::Value item = items.Get(i);
+    if (!item.IsObject()) {
+      throw Napi::TypeError::New(env, "Argument 1 must be an array of objects");
+    }
+    events.push_back(parseTimelineEvent(env, item.As<Napi::Object>(), i));
+  }
+
+  // Timelines run one at a time on their own thread, so a long one doesn't hold nativeQueue calls
+  AddonData& data = addonData();
+  TimelineRegistry* registry = &data.timelines;
+  auto control = std::make_shared<TimelineControl>();
+  {
+    std::lock_guard<std::mutex> lock(registry->mutex);
+    if (!registry->controls.emplace(timelineId, control).second) {
+      throw Napi::Error::New(env, "Timeline " + std::to_string(timelineId) + " is already queued");
+    }
+    control->cancelled = registry->stopping;
+  }
+
+  Napi::Promise promise = runOnQueue<TimelineResult>(
+    data.timelineQueue, env,
+    [=]() {
+      TimelineResult result;
+      try {
+        result = playTimeline(events, *control);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(registry->mutex);
+        registry->controls.erase(timelineId);
+        throw;
+      }
+      std::lock_guard<std::mutex> lock(registry->mutex);
+      registry->controls.erase(timelineId);
+      return result;
+    },
+    timelineResultToObject
+  );
+  // Cleanup hooks run in reverse order, the queue registers its hook with the first timeline
+  if (!registry->cleanupHook) {
+    napi_add_env_cleanup_hook(env, stopTimelines, registry);
+    registry->cleanupHook = true;
+  }
+  return promise;
+}
+
+// Stops a queued or playing timeline, events already sent are not reverted. False if there's no such timeline
+Napi::Boolean cancelInputTimeline(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  GET_UINT_32(info, 0, timelineId, uint32_t);
+
+  TimelineRegistry& registry = addonData().timelines;
+  std::shared_ptr<TimelineControl> control;
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto it = registry.controls.find(timelineId);
+    if (it == registry.controls.end()) {
+      return Napi::Boolean::New(env, false);
+    }
+    control = it->second;
+  }
+  cancelTimeline(*control);
+  return Napi::Boolean::New(env, true);
+}
+
+Napi::Object inputTimelineInit(Napi::Env env, Napi::Object exports) {
+  exports.Set("playInputTimelineAsync", Napi::Function::New(env, playInputTimelineAsync));
+  exports.Set("cancelInputTimeline", Napi::Function::New(env, cancelInputTimeline));
+  return exports;
+}
@@ -1,13 +1,12 @@
 #include "./headers/keyboard-layout.h"
 
-#include <napi.h>
 #include <dbus/dbus.h>
 #include <X11/Xlib.h>
 #include <X11/XKBlib.h>
 #include <vector>
 #include <string>
 
-extern Display* xGetMainDisplay(Napi::Env env);
+#include "./headers/display.h"
 
 std::vector<KdeLayout> getKdeAvailableLayouts() {
   std::vector<KdeLayout> layouts;
@@ -135,8 +134,8 @@ bool switchToKdeLayout(uint32_t layoutIndex) {
   return success;
 }
 
-bool fallbackLayoutSwitch(Napi::Env env) {
-  Display* display = xGetMainDisplay(env);
+bool fallbackLayoutSwitch() {
+  Display* display = xGetMainDisplay();
   if (!display) {
     return false;
   }
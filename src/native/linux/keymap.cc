@@ -0,0 +1,366 @@
+#include "./headers/keymap.h"
+#include "./headers/logger.h"
+#include "./headers/addon-data.h"
+#include "./headers/keysym-unicode.h"
+#include <X11/XKBlib.h>
+#include <X11/keysym.h>
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+KeySym keysymForChar(char c) {
+  switch (c) {
+  case '\n':
+  case '\r':
+    return XK_Return;
+  case '\t':
+    return XK_Tab;
+  case '\b':
+    return XK_BackSpace;
+  }
+  // Printable ASCII keysyms are equal to their character codes
+  if (c >= 0x20 && c < 0x7f) {
+    return static_cast<KeySym>(c);
+  }
+  return NoSymbol;
+}
+
+static int countBits(unsigned int mask) {
+  return __builtin_popcount(mask);
+}
+
+// Modifiers that select level of the key type. Level 0 needs none, levels without a map entry can't be typed
+static bool levelModifiers(XkbKeyTypePtr type, int level, unsigned int& modifiers) {
+  if (level == 0) {
+    modifiers = 0;
+    return true;
+  }
+  bool found = false;
+  for (int i = 0; i < type->map_count; i++) {
+    const XkbKTMapEntryRec& entry = type->map[i];
+    if (entry.active && entry.level == level && (!found || countBits(entry.mods.mask) < countBits(modifiers))) {
+      modifiers = entry.mods.mask;
+      found = true;
+    }
+  }
+  return found;
+}
+
+static void addStroke(KeymapState& keymap, int group, KeySym keysym, KeyStroke stroke) {
+  auto it = keymap.strokes[group].find(keysym);
+  // Prefer keys that need fewer modifiers, e.g. digits from the main row over ones that need NumLock
+  if (it == keymap.strokes[group].end() || countBits(stroke.modifiers) < countBits(it->second.modifiers)) {
+    keymap.strokes[group][keysym] = stroke;
+  }
+}
+
+static void buildKeymap(KeymapState& keymap, Display* display) {
+  XkbDescPtr xkb = XkbGetMap(display, XkbKeyTypesMask | XkbKeySymsMask | XkbModifierMapMask, XkbUseCoreKbd);
+  if (!xkb) {
+    LOG("Failed to get XKB keyboard map");
+    return;
+  }
+
+  for (int group = 0; group < XkbNumKbdGroups; group++) {
+    keymap.strokes[group].clear();
+  }
+  for (KeyCode& keycode : keymap.modifierKeyCodes) {
+    keycode = 0;
+  }
+  for (int keycode = xkb->min_key_code; keycode <= xkb->max_key_code; keycode++) {
+    unsigned char realMods = xkb->map->modmap[keycode];
+    for (int bit = 0; bit < 8; bit++) {
+      if ((realMods & (1 << bit)) && keymap.modifierKeyCodes[bit] == 0) {
+        keymap.modifierKeyCodes[bit] = keycode;
+      }
+    }
+  }
+  // Lock modifiers toggle state instead of being held, so levels that need them are not typed with them
+  unsigned int usableModifiers = 0;
+  for (int bit = 0; bit < 8; bit++) {
+    if (keymap.modifierKeyCodes[bit] != 0) {
+      usableModifiers |= 1 << bit;
+    }
+  }
+  usableModifiers &= ~(LockMask | XkbKeysymToModifiers(display, XK_Num_Lock));
+
+  // Keys bound by keymapResolveBatch stay spare as long as they still have only the bound keysym
+  std::vector<SpareKey> previousSpareKeys;
+  previousSpareKeys.swap(keymap.spareKeys);
+  for (int keycode = xkb->min_key_code; keycode <= xkb->max_key_code; keycode++) {
+    int keyGroups = XkbKeyNumGroups(xkb, keycode);
+    if (keyGroups == 0) {
+      keymap.spareKeys.push_back({static_cast<KeyCode>(keycode), NoSymbol, 0});
+      continue;
+    }
+    for (const SpareKey& spare : previousSpareKeys) {
+      if (spare.keycode == keycode && keyGroups == 1 && XkbKeySymEntry(xkb, keycode, 0, 0) == spare.keysym) {
+        keymap.spareKeys.push_back(spare);
+      }
+    }
+  }
+
+  for (int keycode = xkb->min_key_code; keycode <= xkb->max_key_code; keycode++) {
+    int keyGroups = XkbKeyNumGroups(xkb, keycode);
+    if (keyGroups == 0) {
+      continue;
+    }
+    for (int group = 0; group < XkbNumKbdGroups; group++) {
+      // Keys with fewer groups wrap, same as the server does for out of range groups by default
+      int keyGroup = group % keyGroups;
+      XkbKeyTypePtr type = XkbKeyKeyType(xkb, keycode, keyGroup);
+      for (int level = 0; level < type->num_levels; level++) {
+        KeySym keysym = XkbKeySymEntry(xkb, keycode, level, keyGroup);
+        unsigned int modifiers;
+        if (keysym == NoSymbol || !levelModifiers(type, level, modifiers) || (modifiers & ~usableModifiers)) {
+          continue;
+        }
+        KeyStroke stroke = {static_cast<KeyCode>(keycode), modifiers};
+        addStroke(keymap, group, keysym, stroke);
+        // Text is looked up by keysymForCodepoint, most layouts use legacy keysyms (Cyrillic_a) instead
+        uint32_t codepoint = keysymToCodepoint(keysym);
+        KeySym textKeysym = codepoint != 0 ? keysymForCodepoint(codepoint) : NoSymbol;
+        if (textKeysym != NoSymbol && textKeysym != keysym) {
+          addStroke(keymap, group, textKeysym, stroke);
+        }
+      }
+    }
+  }
+  XkbFreeKeyboard(xkb, 0, True);
+
+  for (int group = 0; group < XkbNumKbdGroups; group++) {
+    for (int c = 0; c < 128; c++) {
+      KeySym keysym = keysymForChar(static_cast<char>(c));
+      auto it = keysym != NoSymbol ? keymap.strokes[group].find(keysym) : keymap.strokes[group].end();
+      keymap.charStrokes[group][c] = it != keymap.strokes[group].end() ? it->second : KeyStroke{0, 0};
+    }
+  }
+
+  XkbStateRec state;
+  if (XkbGetState(display, XkbUseCoreKbd, &state) == Success) {
+    keymap.activeGroup = state.group;
+  }
+  keymap.built = true;
+  LOG("Keymap built, %zu keysyms in group %d, %zu spare keycodes",
+      keymap.strokes[keymap.activeGroup].size(), keymap.activeGroup, keymap.spareKeys.size());
+}
+
+static void selectKeymapEvents(KeymapState& keymap, Display* display) {
+  int opcode, errorBase;
+  int major = XkbMajorVersion;
+  int minor = XkbMinorVersion;
+  if (!XkbQueryExtension(display, &opcode, &keymap.xkbEventBase, &errorBase, &major, &minor)) {
+    LOG("XKB extension is not available, keymap won't follow mapping changes");
+    return;
+  }
+  XkbSelectEvents(display, XkbUseCoreKbd,
+                  XkbNewKeyboardNotifyMask | XkbMapNotifyMask, XkbNewKeyboardNotifyMask | XkbMapNotifyMask);
+  XkbSelectEventDetails(display, XkbUseCoreKbd, XkbStateNotify, XkbGroupStateMask, XkbGroupStateMask);
+}
+
+static bool isSpareKeyCode(const KeymapState& keymap, int keycode) {
+  for (const SpareKey& spare : keymap.spareKeys) {
+    if (spare.keycode == keycode) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Whether all keycodes of a changed range are spare, changes made by keymapResolveBatch are already in the cache
+static bool isSpareRange(const KeymapState& keymap, int first, int count) {
+  for (int keycode = first; keycode < first + count; keycode++) {
+    if (!isSpareKeyCode(keymap, keycode)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void keymapSync(Display* display) {
+  KeymapState& keymap = addonData().keymap;
+  std::lock_guard<std::mutex> lock(keymap.mutex);
+  if (!keymap.eventsSelected) {
+    selectKeymapEvents(keymap, display);
+    keymap.eventsSelected = true;
+  }
+
+  bool rebuild = !keymap.built;
+  // Nothing else reads events of the main display, so all of them can be consumed here
+  while (XPending(display) > 0) {
+    XEvent event;
+    XNextEvent(display, &event);
+    if (event.type == MappingNotify) {
+      XRefreshKeyboardMapping(&event.xmapping);
+      if (event.xmapping.request != MappingKeyboard || !isSpareRange(keymap, event.xmapping.first_keycode, event.xmapping.count)) {
+        rebuild = true;
+      }
+    } else if (keymap.xkbEventBase && event.type == keymap.xkbEventBase) {
+      XkbEvent* xkbEvent = reinterpret_cast<XkbEvent*>(&event);
+      if (xkbEvent->any.xkb_type == XkbStateNotify) {
+        keymap.activeGroup = xkbEvent->state.group;
+      } else if (xkbEvent->any.xkb_type == XkbMapNotify) {
+        const XkbMapNotifyEvent& map = xkbEvent->map;
+        XkbRefreshKeyboardMapping(&xkbEvent->map);
+        if ((map.changed & (XkbKeyTypesMask | XkbModifierMapMask)) ||
+            ((map.changed & XkbKeySymsMask) && !isSpareRange(keymap, map.first_key_sym, map.num_key_syms))) {
+          rebuild = true;
+        }
+      } else if (xkbEvent->any.xkb_type == XkbNewKeyboardNotify) {
+        rebuild = true;
+      }
+    }
+  }
+  if (rebuild) {
+    buildKeymap(keymap, display);
+  }
+}
+
+bool keymapLookup(KeySym keysym, KeyStroke& stroke) {
+  KeymapState& keymap = addonData().keymap;
+  std::lock_guard<std::mutex> lock(keymap.mutex);
+  auto it = keymap.strokes[keymap.activeGroup].find(keysym);
+  if (it == keymap.strokes[keymap.activeGroup].end()) {
+    return false;
+  }
+  stroke = it->second;
+  return true;
+}
+
+KeyCode keymapModifierKeyCode(unsigned int modifier) {
+  KeymapState& keymap = addonData().keymap;
+  std::lock_guard<std::mutex> lock(keymap.mutex);
+  for (int bit = 0; bit < 8; bit++) {
+    if (modifier == (1u << bit)) {
+      return keymap.modifierKeyCodes[bit];
+    }
+  }
+  return 0;
+}
+
+KeySym keysymForCodepoint(uint32_t codepoint) {
+  if (codepoint < 0x80) {
+    return keysymForChar(static_cast<char>(codepoint));
+  }
+  // Latin-1 keysyms are equal to their code points, the rest have Unicode keysyms
+  if (codepoint >= 0xa0 && codepoint <= 0xff) {
+    return codepoint;
+  }
+  if (codepoint < 0x100 || codepoint > 0x10ffff) {
+    return NoSymbol;
+  }
+  return 0x01000000 | codepoint;
+}
+
+void keymapBeginBatch() {
+  KeymapState& keymap = addonData().keymap;
+  std::lock_guard<std::mutex> lock(keymap.mutex);
+  keymap.currentBatch++;
+}
+
+// Points the cached strokes of keysym to the spare, the server keymap is changed by sendSpareKeys
+static void bindSpareKey(KeymapState& keymap, SpareKey& spare, KeySym keysym) {
+  for (int group = 0; group < XkbNumKbdGroups; group++) {
+    auto it = keymap.strokes[group].find(spare.keysym);
+    if (spare.keysym != NoSymbol && it != keymap.strokes[group].end() && it->second.keycode == spare.keycode) {
+      keymap.strokes[group].erase(it);
+    }
+    keymap.strokes[group][keysym] = {spare.keycode, 0};
+  }
+  spare.keysym = keysym;
+}
+
+// Sends keysyms of the spares, one request per run of adjacent keycodes, so a batch costs a few
+// MappingNotify events instead of one per character
+static void sendSpareKeys(Display* display, std::vector<const SpareKey*> spares) {
+  std::sort(spares.begin(), spares.end(), [](const SpareKey* a, const SpareKey* b) { return a->keycode < b->keycode; });
+  std::vector<KeySym> keysyms;
+  for (size_t first = 0; first < spares.size();) {
+    size_t end = first + 1;
+    while (end < spares.size() && spares[end]->keycode == spares[end - 1]->keycode + 1) {
+      end++;
+    }
+    keysyms.clear();
+    for (size_t i = first; i < end; i++) {
+      // Same keysym on both levels, so Shift or CapsLock state doesn't change what the key types
+      keysyms.push_back(spares[i]->keysym);
+      keysyms.push_back(spares[i]->keysym);
+    }
+    XChangeKeyboardMapping(display, spares[first]->keycode, 2, keysyms.data(), static_cast<int>(end - first));
+    first = end;
+  }
+}
+
+size_t keymapResolveBatch(Display* display, const std::vector<KeySym>& keysyms, size_t first,
+  std::vector<KeyStroke>& strokes) {
+  KeymapState& keymap = addonData().keymap;
+  std::lock_guard<std::mutex> lock(keymap.mutex);
+  auto& groupStrokes = keymap.strokes[keymap.activeGroup];
+  std::vector<const SpareKey*> bound;
+  size_t index = first;
+  for (; index < keysyms.size(); index++) {
+    KeySym keysym = keysyms[index];
+    if (keysym < 0x80) {
+      KeyStroke stroke = keymap.charStrokes[keymap.activeGroup][keysym];
+      if (stroke.keycode != 0) {
+        strokes.push_back(stroke);
+        continue;
+      }
+    }
+    auto it = groupStrokes.find(keysym);
+    if (it != groupStrokes.end()) {
+      strokes.push_back(it->second);
+      for (SpareKey& spare : keymap.spareKeys) {
+        if (spare.keycode == it->second.keycode) {
+          spare.batch = keymap.currentBatch;
+        }
+      }
+      continue;
+    }
+
+    // Least recently used spare that the current batch doesn't need
+    SpareKey* victim = nullptr;
+    for (SpareKey& spare : keymap.spareKeys) {
+      if (spare.batch != keymap.currentBatch && (!victim || spare.batch < victim->batch)) {
+        victim = &spare;
+      }
+    }
+    if (!victim) {
+      break;
+    }
+    bindSpareKey(keymap, *victim, keysym);
+    victim->batch = keymap.currentBatch;
+    bound.push_back(victim);
+    strokes.push_back({victim->keycode, 0});
+  }
+  sendSpareKeys(display, std::move(bound));
+  return index - first;
+}
+
+// Unbinds the spares at env teardown, so typed characters don't stay in the keymap of the session.
+// Registered before any queue starts, so it runs after their threads are joined
+static void releaseSpareKeys(void* arg) {
+  AddonData* data = static_cast<AddonData*>(arg);
+  KeymapState& keymap = data->keymap;
+  std::lock_guard<std::mutex> lock(keymap.mutex);
+  if (data->display == nullptr) {
+    return;
+  }
+  std::vector<const SpareKey*> bound;
+  for (SpareKey& spare : keymap.spareKeys) {
+    if (spare.keysym != NoSymbol) {
+      spare.keysym = NoSymbol;
+      bound.push_back(&spare);
+    }
+  }
+  if (!bound.empty()) {
+    sendSpareKeys(data->display, std::move(bound));
+    XSync(data->display, False);
+  }
+}
+
+void keymapInit(Napi::Env env) {
+  napi_add_env_cleanup_hook(env, releaseSpareKeys, &addonData());
+}
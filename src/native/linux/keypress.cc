@@ -1,118 +1,192 @@
 #include <napi.h>
-#include <X11/extensions/XTest.h>
 #include <X11/Xlib.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/xtest.h>
 #include <X11/keysym.h>
 #include <cstring>
-#include <cctype>
+#include <cstdint>
+#include <unistd.h>
+#include <vector>
 #include "./headers/key-names.h"
 #include "./headers/display.h"
 #include "./headers/keypress.h"
 #include "./headers/keyboard-layout.h"
+#include "./headers/keymap.h"
 #include "./headers/validators.h"
+#include "./headers/native-queue.h"
 
-void toggleKeyCode(Napi::Env env, KeySym code, const bool down, unsigned int flags) {
-#define X_KEY_EVENT(display, key, is_press)                \
-  (XTestFakeKeyEvent(display, XKeysymToKeycode(display, key), is_press, CurrentTime), XFlush(display))
+// Fake key events sent between flushes. XCB buffers requests until a flush, so a whole string costs
+// a few socket writes instead of one per event. Chunks keep the server consuming events in order
+// while the rest are generated, instead of one huge write at the end.
+static const int KEY_EVENTS_PER_FLUSH = 256;
 
-  Display* display = xGetMainDisplay(env);
-  const Bool is_press = down ? True : False; /* Just to be safe. */
-  if (!down) {
-    X_KEY_EVENT(display, code, is_press);
+// Queues XTest key events on the display and flushes them in chunks, the rest is flushed on destruction.
+// Requests are unchecked, nothing waits for the server and errors go to the Xlib error handler.
+class KeyEventBatch {
+public:
+  explicit KeyEventBatch(Display* display) : connection(XGetXCBConnection(display)) {}
+
+  ~KeyEventBatch() {
+    flush();
   }
 
-  if (flags & Mod4Mask)
-    X_KEY_EVENT(display, XK_Super_L, is_press);
-  if (flags & Mod1Mask)
-    X_KEY_EVENT(display, XK_Alt_L, is_press);
-  if (flags & ControlMask)
-    X_KEY_EVENT(display, XK_Control_L, is_press);
-  if (flags & ShiftMask)
-    X_KEY_EVENT(display, XK_Shift_L, is_press);
+  void add(KeyCode code, bool down) {
+    xcb_test_fake_input(connection, down ? XCB_KEY_PRESS : XCB_KEY_RELEASE, code, XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+    if (++pending >= KEY_EVENTS_PER_FLUSH) {
+      flush();
+    }
+  }
 
-  if (down) {
-    X_KEY_EVENT(display, code, is_press);
+  void flush() {
+    if (pending > 0) {
+      xcb_flush(connection);
+      pending = 0;
+    }
   }
-}
 
-KeySym keyCodeForChar(const char c) {
-  KeySym code;
+private:
+  xcb_connection_t* connection;
+  int pending = 0;
+};
+
+// Keys held for modifier flags of keyTap/keyToggle, in the order they are pressed
+static const struct {
+  unsigned int flag;
+  KeySym keysym;
+} flagKeys[] = {
+  {Mod4Mask, XK_Super_L},
+  {Mod1Mask, XK_Alt_L},
+  {ControlMask, XK_Control_L},
+  {ShiftMask, XK_Shift_L},
+};
+
+struct ModifierKeys {
+  KeyCode codes[8];
+  int count = 0;
+};
+
+// Keys for flags plus keys for the modifiers that select the shift level of a stroke, e.g. Shift or AltGr
+static ModifierKeys modifierKeys(unsigned int flags, unsigned int levelModifiers) {
+  ModifierKeys keys;
+  for (const auto& flagKey : flagKeys) {
+    KeyStroke modifier;
+    if ((flags & flagKey.flag) && keymapLookup(flagKey.keysym, modifier)) {
+      keys.codes[keys.count++] = modifier.keycode;
+    }
+  }
+  unsigned int remaining = levelModifiers & ~flags;
+  for (unsigned int modifier = ShiftMask; modifier <= Mod5Mask && keys.count < 8; modifier <<= 1) {
+    KeyCode keycode = (remaining & modifier) ? keymapModifierKeyCode(modifier) : 0;
+    if (keycode != 0) {
+      keys.codes[keys.count++] = keycode;
+    }
+  }
+  return keys;
+}
 
-  char buf[2];
-  buf[0] = c;
-  buf[1] = '\0';
+void toggleKeyCode(KeySym code, const bool down, unsigned int flags) {
+  Display* display = xGetMainDisplay();
+  keymapSync(display);
 
-  code = XStringToKeysym(buf);
-  if (code == NoSymbol) {
-    auto it = xSpecialCharacterMap.find(c);
-    if (it != xSpecialCharacterMap.end()) {
-      code = it->second;
-    } else {
-      auto shiftIt = xShiftRequiredMap.find(c);
-      if (shiftIt != xShiftRequiredMap.end()) {
-        code = shiftIt->second;
-      }
-    }
+  KeyStroke stroke;
+  if (!keymapLookup(code, stroke)) {
+    throw NativeError("Key is not available in the current keyboard layout");
   }
+  ModifierKeys modifiers = modifierKeys(flags, stroke.modifiers);
 
-  return code;
+  KeyEventBatch batch(display);
+  if (!down) {
+    batch.add(stroke.keycode, false);
+  }
+  for (int i = 0; i < modifiers.count; i++) {
+    batch.add(modifiers.codes[i], down);
+  }
+  if (down) {
+    batch.add(stroke.keycode, true);
+  }
 }
 
-void toggleKey(Napi::Env env, char c, const bool down, unsigned int flags) {
-  KeySym keyCode = keyCodeForChar(c);
-  if (std::isupper(c) || xShiftRequiredMap.find(c) != xShiftRequiredMap.end()) {
-    flags |= ShiftMask;
+// Time given to clients to process typed events before spare keycodes they used are rebound
+static const useconds_t SPARE_KEYS_SETTLE_US = 20000;
+
+// Decodes UTF-8, invalid sequences are skipped
+static std::vector<uint32_t> decodeUtf8(const std::string& text) {
+  std::vector<uint32_t> codepoints;
+  codepoints.reserve(text.size());
+  size_t i = 0;
+  while (i < text.size()) {
+    unsigned char lead = text[i];
+    int length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xe ? 3 : (lead >> 3) == 0x1e ? 4 : 0;
+    if (length == 0 || i + length > text.size()) {
+      i++;
+      continue;
+    }
+    uint32_t codepoint = length == 1 ? lead : lead & (0x7f >> length);
+    bool valid = true;
+    for (int j = 1; j < length; j++) {
+      unsigned char next = text[i + j];
+      valid = valid && (next & 0xc0) == 0x80;
+      codepoint = (codepoint << 6) | (next & 0x3f);
+    }
+    i += valid ? length : 1;
+    if (valid) {
+      codepoints.push_back(codepoint);
+    }
   }
-  toggleKeyCode(env, keyCode, down, flags);
+  return codepoints;
 }
 
-void typeString(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
+static void tapStroke(KeyEventBatch& batch, const KeyStroke& stroke) {
+  ModifierKeys modifiers = modifierKeys(0, stroke.modifiers);
+  for (int i = 0; i < modifiers.count; i++) {
+    batch.add(modifiers.codes[i], true);
+  }
 
-  GET_STRING(info, 0, strstd);
-
-  const char* str = strstd.c_str();
-  Display* display = xGetMainDisplay(env);
-  while (*str) {
-    KeySym ks;
-    bool needShift = false;
-
-    // First check our special character map
-    auto it = xSpecialCharacterMap.find(*str);
-    if (it != xSpecialCharacterMap.end()) {
-      ks = it->second;
-    } else {
-      // Then check shift-required map
-      auto shiftIt = xShiftRequiredMap.find(*str);
-      if (shiftIt != xShiftRequiredMap.end()) {
-        ks = shiftIt->second;
-        needShift = true;
-      } else {
-        // Finally try normal character conversion
-        char buf[2] = {*str, 0};
-        ks = XStringToKeysym(buf);
-      }
+  batch.add(stroke.keycode, true);
+  batch.add(stroke.keycode, false);
+
+  for (int i = modifiers.count - 1; i >= 0; i--) {
+    batch.add(modifiers.codes[i], false);
+  }
+}
+
+// Types any Unicode text. Characters of the current layout use their keys, the rest are bound to
+// spare keycodes. Text is split into batches that need at most as many keysyms as there are spares,
+// so the keymap changes once per batch instead of once per character.
+void typeText(const std::string& text) {
+  std::vector<KeySym> keysyms;
+  for (uint32_t codepoint : decodeUtf8(text)) {
+    KeySym keysym = keysymForCodepoint(codepoint);
+    if (keysym != NoSymbol) {
+      keysyms.push_back(keysym);
     }
+  }
 
-    if (ks != NoSymbol) {
-      KeyCode kc = XKeysymToKeycode(display, ks);
-      if (kc != 0) {
-        if (needShift || std::isupper(*str)) {
-          XTestFakeKeyEvent(display, XKeysymToKeycode(display, XK_Shift_L), True, CurrentTime);
-          XFlush(display);
-        }
-
-        XTestFakeKeyEvent(display, kc, True, CurrentTime);
-        XFlush(display);
-        XTestFakeKeyEvent(display, kc, False, CurrentTime);
-        XFlush(display);
-
-        if (needShift || std::isupper(*str)) {
-          XTestFakeKeyEvent(display, XKeysymToKeycode(display, XK_Shift_L), False, CurrentTime);
-          XFlush(display);
-        }
-      }
+  Display* display = xGetMainDisplay();
+  keymapSync(display);
+  keymapBeginBatch();
+
+  KeyEventBatch batch(display);
+  std::vector<KeyStroke> strokes;
+  strokes.reserve(keysyms.size());
+  size_t resolved = 0;
+  while (resolved < keysyms.size()) {
+    // Every call starts a batch, nothing resolved means there are no spares at all
+    size_t count = keymapResolveBatch(display, keysyms, resolved, strokes);
+    if (count == 0) {
+      throw NativeError("No spare keycodes to type unicode characters");
+    }
+    for (size_t i = resolved; i < resolved + count; i++) {
+      tapStroke(batch, strokes[i]);
+    }
+    resolved += count;
+    if (resolved < keysyms.size()) {
+      // All spares are taken by this batch, clients have to process it before they are rebound
+      batch.flush();
+      XSync(display, False);
+      usleep(SPARE_KEYS_SETTLE_US);
+      keymapBeginBatch();
     }
-    str++;
   }
 }
 
@@ -155,7 +229,7 @@ unsigned int getAllFlags(napi_env env, napi_value value) {
 
 unsigned int assignKeyCode(std::string& keyName) {
   if (keyName.length() == 1) {
-    return keyCodeForChar(keyName[0]);
+    return keysymForChar(keyName[0]);
   }
   KeyNames* kn = keyNames;
   while (kn->name) {
@@ -167,14 +241,37 @@ unsigned int assignKeyCode(std::string& keyName) {
   return 0;
 }
 
+void typeString(const Napi::CallbackInfo& info) {
+  GET_STRING(info, 0, str);
+  callNative(info.Env(), [&] { typeText(str); });
+}
+
+Napi::Value typeStringAsync(const Napi::CallbackInfo& info) {
+  GET_STRING(info, 0, str);
+  return runOnNativeQueue(info.Env(), [=] { typeText(str); });
+}
+
+static void tapKey(unsigned int key, unsigned int flags) {
+  toggleKeyCode(key, true, flags);
+  toggleKeyCode(key, false, flags);
+}
+
 void keyTap(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
   GET_STRING(info, 0, keyName);
   ASSERT_ARRAY(info, 1);
   unsigned int flags = getAllFlags(env, info[1]);
   unsigned int key = assignKeyCode(keyName);
-  toggleKeyCode(env, key, true, flags);
-  toggleKeyCode(env, key, false, flags);
+  callNative(env, [=] { tapKey(key, flags); });
+}
+
+Napi::Value keyTapAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_STRING(info, 0, keyName);
+  ASSERT_ARRAY(info, 1);
+  unsigned int flags = getAllFlags(env, info[1]);
+  unsigned int key = assignKeyCode(keyName);
+  return runOnNativeQueue(env, [=] { tapKey(key, flags); });
 }
 
 void keyToggle(const Napi::CallbackInfo& info) {
@@ -188,15 +285,25 @@ void keyToggle(const Napi::CallbackInfo& info) {
 
   unsigned int key = assignKeyCode(keyName);
 
-  toggleKeyCode(env, key, down, flags);
+  callNative(env, [=] { toggleKeyCode(key, down, flags); });
 }
 
-
-void setKeyboardLayout(const Napi::CallbackInfo& info) {
+Napi::Value keyToggleAsync(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
-  GET_STRING(info, 0, layoutId);
+  GET_STRING(info, 0, keyName);
+  ASSERT_ARRAY(info, 1);
+  GET_BOOL(info, 2, down);
+
+  unsigned int flags = getAllFlags(env, info[1]);
+
+  unsigned int key = assignKeyCode(keyName);
+
+  return runOnNativeQueue(env, [=] { toggleKeyCode(key, down, flags); });
+}
 
+
+static void switchKeyboardLayout(const std::string& layoutId) {
   // Try KDE's DBus interface first - query available layouts and validate
   std::vector<KdeLayout> availableLayouts = getKdeAvailableLayouts();
 
@@ -218,7 +325,7 @@ void setKeyboardLayout(const Napi::CallbackInfo& info) {
         if (i < availableLayouts.size() - 1) availableList += ", ";
       }
 
-      throw Napi::Error::New(env, "Layout '" + layoutId + "' not found. Available layouts: " + availableList);
+      throw NativeError("Layout '" + layoutId + "' not found. Available layouts: " + availableList);
     }
 
     // Layout is available, try to switch to it by index
@@ -226,16 +333,27 @@ void setKeyboardLayout(const Napi::CallbackInfo& info) {
       return;
     }
 
-    throw Napi::Error::New(env, "Failed to switch to layout '" + layoutId + "' via KDE DBus");
+    throw NativeError("Failed to switch to layout '" + layoutId + "' via KDE DBus");
   }
 
   // Fallback to direct XKB group switching (works on non-KDE systems or when DBus is unavailable)
-  if (fallbackLayoutSwitch(env)) {
+  if (fallbackLayoutSwitch()) {
     return;
   }
 
   // If both methods fail, throw error
-  throw Napi::Error::New(env, "Failed to switch keyboard layout. KDE service not available and XKB fallback failed.");
+  throw NativeError("Failed to switch keyboard layout. KDE service not available and XKB fallback failed.");
+}
+
+void setKeyboardLayout(const Napi::CallbackInfo& info) {
+  GET_STRING(info, 0, layoutId);
+  callNative(info.Env(), [&] { switchKeyboardLayout(layoutId); });
+}
+
+// DBus calls block up to a second each, the main reason to prefer this variant
+Napi::Value setKeyboardLayoutAsync(const Napi::CallbackInfo& info) {
+  GET_STRING(info, 0, layoutId);
+  return runOnNativeQueue(info.Env(), [=] { switchKeyboardLayout(layoutId); });
 }
 
 
@@ -244,5 +362,9 @@ Napi::Object keyboardInit(Napi::Env env, Napi::Object exports) {
   exports.Set("keyToggle", Napi::Function::New(env, keyToggle));
   exports.Set("typeString", Napi::Function::New(env, typeString));
   exports.Set("setKeyboardLayout", Napi::Function::New(env, setKeyboardLayout));
+  exports.Set("keyTapAsync", Napi::Function::New(env, keyTapAsync));
+  exports.Set("keyToggleAsync", Napi::Function::New(env, keyToggleAsync));
+  exports.Set("typeStringAsync", Napi::Function::New(env, typeStringAsync));
+  exports.Set("setKeyboardLayoutAsync", Napi::Function::New(env, setKeyboardLayoutAsync));
   return exports;
 }
\ No newline at end of file
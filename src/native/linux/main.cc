@@ -1,16 +1,40 @@
 #include <napi.h>
+#include "./headers/addon-data.h"
+#include "./headers/display.h"
 #include "./headers/window.h"
 #include "./headers/keypress.h"
 #include "./headers/mouse.h"
 #include "./headers/monitor.h"
 #include "./headers/process.h"
+#include "./headers/process-table.h"
+#include "./headers/process-sampler.h"
+#include "./headers/process-supervisor.h"
+#include "./headers/input-timeline.h"
+#include "./headers/capture.h"
+#include "./headers/pixel.h"
+#include "./headers/template-match.h"
+#include "./headers/damage.h"
+#include "./headers/screen-stream.h"
+#include "./headers/frame-socket.h"
 
 Napi::Object init(Napi::Env env, Napi::Object exports) {
+  addonDataInit(env);
+  displayInit();
   windowInit(env, exports);
   keyboardInit(env, exports);
   mouseInit(env, exports);
   monitorInit(env, exports);
   processInit(env, exports);
+  processTableInit(env, exports);
+  processSamplerInit(env, exports);
+  processSupervisorInit(env, exports);
+  inputTimelineInit(env, exports);
+  captureInit(env, exports);
+  pixelInit(env, exports);
+  templateMatchInit(env, exports);
+  damageInit(env, exports);
+  screenStreamInit(env, exports);
+  frameSocketInit(env, exports);
 
   return exports;
 }
@@ -1,39 +1,307 @@
 #include <napi.h>
 #include "./headers/monitor.h"
-#include <X11/Xlib.h>
+#include <xcb/randr.h>
+#include <xcb/xcb_ewmh.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
 
+#include "headers/addon-data.h"
 #include "headers/display.h"
+#include "headers/native-queue.h"
+#include "headers/validators.h"
+#include "headers/window.h"
+#include "headers/window-info.h"
 
-// Minimal Linux monitor implementation providing API parity with win32
-// This basic version reports a single primary monitor using the default screen.
-// getMonitorScaleFactor returns 1.0 as a conservative default (no per-monitor scaling).
+// Monitors are active RandR CRTCs. X11 has no per-monitor scaling, scale is derived from the physical DPI
+// of the first output of the CRTC, relative to 96 DPI and rounded to quarters.
 
+template <typename T>
+using XcbReply = std::unique_ptr<T, decltype(&free)>;
 
-static Napi::Object getMonitorInfo(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
+static const double BASE_DPI = 96.0;
+// Outputs report bogus sizes like 16x9 mm when EDID only has an aspect ratio, such ones get scale 1
+static const uint32_t MIN_PHYSICAL_SIZE_MM = 50;
+
+static double outputScale(const MonitorRect& bounds, const xcb_randr_get_output_info_reply_t* output) {
+  if (!output || output->mm_width < MIN_PHYSICAL_SIZE_MM || output->mm_height < MIN_PHYSICAL_SIZE_MM) {
+    return 1;
+  }
+  // Diagonals don't depend on rotation, mm sizes are reported for the unrotated output
+  double pixels = std::hypot(bounds.width, bounds.height);
+  double inches = std::hypot(output->mm_width, output->mm_height) / 25.4;
+  return std::max(1.0, std::round(pixels / inches / BASE_DPI * 4) / 4);
+}
+
+static MonitorRect intersect(const MonitorRect& a, const MonitorRect& b) {
+  int left = std::max(a.x, b.x);
+  int top = std::max(a.y, b.y);
+  int right = std::min(a.x + a.width, b.x + b.width);
+  int bottom = std::min(a.y + a.height, b.y + b.height);
+  if (right <= left || bottom <= top) {
+    return {0, 0, 0, 0};
+  }
+  return {left, top, right - left, bottom - top};
+}
+
+// _NET_WORKAREA of the current desktop, whole root when the window manager doesn't set it
+static MonitorRect queryWorkArea(XcbWindowContext& context, const MonitorRect& root) {
+  xcb_get_property_cookie_t desktopCookie = xcb_ewmh_get_current_desktop(&context.ewmh, 0);
+  xcb_get_property_cookie_t workAreaCookie = xcb_ewmh_get_workarea(&context.ewmh, 0);
+
+  uint32_t desktop = 0;
+  if (!xcb_ewmh_get_current_desktop_reply(&context.ewmh, desktopCookie, &desktop, nullptr)) {
+    desktop = 0;
+  }
+  xcb_ewmh_get_workarea_reply_t workArea;
+  if (!xcb_ewmh_get_workarea_reply(&context.ewmh, workAreaCookie, &workArea, nullptr)) {
+    return root;
+  }
+  MonitorRect result = root;
+  if (workArea.workarea_len > 0) {
+    const xcb_ewmh_geometry_t& area = workArea.workarea[std::min(desktop, workArea.workarea_len - 1)];
+    result = {static_cast<int>(area.x), static_cast<int>(area.y),
+              static_cast<int>(area.width), static_cast<int>(area.height)};
+  }
+  xcb_ewmh_get_workarea_reply_wipe(&workArea);
+  return result;
+}
+
+// Reads CRTCs, their first outputs, primary output and the work area. Requests of every step are pipelined,
+// so the whole layout costs three round-trips
+static std::vector<MonitorInfoData> readMonitors(XcbWindowContext& context) {
+  xcb_connection_t* connection = context.connection;
+  xcb_screen_t* screen = xcb_setup_roots_iterator(xcb_get_setup(connection)).data;
+  MonitorRect root = {0, 0, screen->width_in_pixels, screen->height_in_pixels};
+
+  const xcb_query_extension_reply_t* randr = xcb_get_extension_data(connection, &xcb_randr_id);
+  if (!randr || !randr->present) {
+    // Single screen without RandR, e.g. some VNC servers
+    return {{context.rootWindow, root, queryWorkArea(context, root), 1, true}};
+  }
+
+  xcb_randr_get_output_primary_cookie_t primaryCookie = xcb_randr_get_output_primary(connection, context.rootWindow);
+  XcbReply<xcb_randr_get_screen_resources_current_reply_t> resources(
+    xcb_randr_get_screen_resources_current_reply(
+      connection, xcb_randr_get_screen_resources_current(connection, context.rootWindow), nullptr), free);
+  XcbReply<xcb_randr_get_output_primary_reply_t> primary(
+    xcb_randr_get_output_primary_reply(connection, primaryCookie, nullptr), free);
+  if (!resources) {
+    throw NativeError("Failed to get RandR screen resources");
+  }
+
+  xcb_randr_crtc_t* crtcs = xcb_randr_get_screen_resources_current_crtcs(resources.get());
+  int crtcCount = xcb_randr_get_screen_resources_current_crtcs_length(resources.get());
+  std::vector<xcb_randr_get_crtc_info_cookie_t> crtcCookies;
+  crtcCookies.reserve(crtcCount);
+  for (int i = 0; i < crtcCount; i++) {
+    crtcCookies.push_back(xcb_randr_get_crtc_info(connection, crtcs[i], resources->config_timestamp));
+  }
+
+  std::vector<MonitorInfoData> monitors;
+  std::vector<xcb_randr_get_output_info_cookie_t> outputCookies;
+  for (int i = 0; i < crtcCount; i++) {
+    XcbReply<xcb_randr_get_crtc_info_reply_t> crtc(
+      xcb_randr_get_crtc_info_reply(connection, crtcCookies[i], nullptr), free);
+    // Disabled CRTCs have no mode and no outputs
+    if (!crtc || crtc->mode == XCB_NONE || crtc->num_outputs == 0) {
+      continue;
+    }
+    xcb_randr_output_t* outputs = xcb_randr_get_crtc_info_outputs(crtc.get());
+    bool isPrimary = false;
+    for (int j = 0; primary && j < xcb_randr_get_crtc_info_outputs_length(crtc.get()); j++) {
+      isPrimary = isPrimary || outputs[j] == primary->output;
+    }
+    MonitorRect bounds = {crtc->x, crtc->y, crtc->width, crtc->height};
+    monitors.push_back({crtcs[i], bounds, bounds, 1, isPrimary});
+    outputCookies.push_back(xcb_randr_get_output_info(connection, outputs[0], resources->config_timestamp));
+  }
 
-  Display* display = xGetMainDisplay(env);
+  MonitorRect workArea = queryWorkArea(context, root);
+  for (size_t i = 0; i < monitors.size(); i++) {
+    XcbReply<xcb_randr_get_output_info_reply_t> output(
+      xcb_randr_get_output_info_reply(connection, outputCookies[i], nullptr), free);
+    monitors[i].scale = outputScale(monitors[i].bounds, output.get());
+    MonitorRect area = intersect(monitors[i].bounds, workArea);
+    monitors[i].workArea = area.width > 0 ? area : monitors[i].bounds;
+  }
 
-  int screen = DefaultScreen(display);
-  int width = DisplayWidth(display, screen);
-  int height = DisplayHeight(display, screen);
+  // Without a primary output the server treats the first CRTC as primary
+  bool hasPrimary = std::any_of(monitors.begin(), monitors.end(), [](const MonitorInfoData& m) { return m.isPrimary; });
+  if (!hasPrimary && !monitors.empty()) {
+    monitors[0].isPrimary = true;
+  }
+  return monitors;
+}
+
+static std::vector<MonitorInfoData> queryMonitors() {
+  AddonData& data = addonData();
+  WindowCache& windowCache = data.windowCache;
+  MonitorCache& cache = data.monitors;
+  // Read before the query, a change during it invalidates the result for the next call
+  uint64_t generation = windowCache.screenGeneration;
+  bool watching = windowCache.watchingScreen;
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (watching && cache.valid && cache.generation == generation) {
+      return cache.monitors;
+    }
+  }
+  std::vector<MonitorInfoData> monitors = readMonitors(data.windowContext);
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.monitors = monitors;
+  cache.generation = generation;
+  cache.valid = watching;
+  return monitors;
+}
+
+static std::vector<uint32_t> queryMonitorIds() {
+  std::vector<uint32_t> ids;
+  for (const MonitorInfoData& monitor : queryMonitors()) {
+    ids.push_back(monitor.id);
+  }
+  return ids;
+}
+
+MonitorInfoData queryMonitorInfo(uint32_t id) {
+  for (const MonitorInfoData& monitor : queryMonitors()) {
+    if (monitor.id == id) {
+      return monitor;
+    }
+  }
+  throw NativeError("Monitor " + std::to_string(id) + " not found");
+}
 
-  Napi::Object bounds = Napi::Object::New(env);
-  bounds.Set("x", 0);
-  bounds.Set("y", 0);
-  bounds.Set("width", width);
-  bounds.Set("height", height);
+static MonitorRect queryWindowRect(xcb_window_t window) {
+  std::shared_ptr<const WindowCacheSnapshot> snapshot = getWindowCacheSnapshot();
+  if (snapshot) {
+    auto it = snapshot->windows.find(window);
+    if (it != snapshot->windows.end()) {
+      const WindowInfoData& info = it->second;
+      return {info.x, info.y, static_cast<int>(info.width), static_cast<int>(info.height)};
+    }
+  }
 
+  XcbWindowContext& context = addonData().windowContext;
+  xcb_get_geometry_cookie_t geometryCookie = xcb_get_geometry(context.connection, window);
+  xcb_translate_coordinates_cookie_t translateCookie =
+    xcb_translate_coordinates(context.connection, window, context.rootWindow, 0, 0);
+  xcb_generic_error_t* error = nullptr;
+  XcbReply<xcb_get_geometry_reply_t> geometry(xcb_get_geometry_reply(context.connection, geometryCookie, &error), free);
+  if (!geometry) {
+    xcb_discard_reply(context.connection, translateCookie.sequence);
+    std::string errorMsg = xcbErrorMessage("Failed to get window geometry", error);
+    free(error);
+    throw NativeError(errorMsg);
+  }
+  XcbReply<xcb_translate_coordinates_reply_t> translate(
+    xcb_translate_coordinates_reply(context.connection, translateCookie, &error), free);
+  if (!translate) {
+    std::string errorMsg = xcbErrorMessage("Failed to translate window coordinates", error);
+    free(error);
+    throw NativeError(errorMsg);
+  }
+  return {translate->dst_x, translate->dst_y, geometry->width, geometry->height};
+}
+
+// Monitor with the largest part of the window, the primary one when the window is off screen
+static uint32_t queryMonitorFromWindow(xcb_window_t window) {
+  MonitorRect rect = queryWindowRect(window);
+  std::vector<MonitorInfoData> monitors = queryMonitors();
+  if (monitors.empty()) {
+    throw NativeError("No active monitors");
+  }
+  const MonitorInfoData* best = nullptr;
+  int64_t bestArea = 0;
+  for (const MonitorInfoData& monitor : monitors) {
+    MonitorRect area = intersect(rect, monitor.bounds);
+    int64_t size = static_cast<int64_t>(area.width) * area.height;
+    if (size > bestArea || (!best && monitor.isPrimary)) {
+      best = &monitor;
+      bestArea = std::max(bestArea, size);
+    }
+  }
+  return (best ? *best : monitors[0]).id;
+}
+
+static Napi::Object rectToObject(Napi::Env env, const MonitorRect& rect) {
   Napi::Object obj = Napi::Object::New(env);
-  obj.Set("bounds", bounds);
-  obj.Set("workArea", bounds); // No EWMH work area support in this minimal version
-  obj.Set("isPrimary", true);
-  obj.Set("scale", 1);
+  obj.Set("x", rect.x);
+  obj.Set("y", rect.y);
+  obj.Set("width", rect.width);
+  obj.Set("height", rect.height);
+  return obj;
+}
+
+static Napi::Value monitorInfoToObject(Napi::Env env, const MonitorInfoData& data) {
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("bounds", rectToObject(env, data.bounds));
+  obj.Set("workArea", rectToObject(env, data.workArea));
+  obj.Set("isPrimary", data.isPrimary);
+  obj.Set("scale", data.scale);
 
   return obj;
 }
 
+static Napi::Value monitorIdsToArray(Napi::Env env, const std::vector<uint32_t>& ids) {
+  Napi::Array result = Napi::Array::New(env, ids.size());
+  for (uint32_t i = 0; i < ids.size(); i++) {
+    result[i] = Napi::Number::New(env, ids[i]);
+  }
+  return result;
+}
+
+static Napi::Value monitorIdToNumber(Napi::Env env, uint32_t id) {
+  return Napi::Number::New(env, id);
+}
+
+static Napi::Value getMonitors(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  ensure_xcb_initialized(env);
+  return monitorIdsToArray(env, callNative(env, queryMonitorIds));
+}
+
+static Napi::Value getMonitorsAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  ensure_xcb_initialized(env);
+  return runOnNativeQueue<std::vector<uint32_t>>(env, queryMonitorIds, monitorIdsToArray);
+}
+
+static Napi::Value getMonitorInfo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  ensure_xcb_initialized(env);
+  GET_UINT_32(info, 0, monitorId, uint32_t);
+  return monitorInfoToObject(env, callNative(env, [=] { return queryMonitorInfo(monitorId); }));
+}
+
+static Napi::Value getMonitorInfoAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  ensure_xcb_initialized(env);
+  GET_UINT_32(info, 0, monitorId, uint32_t);
+  return runOnNativeQueue<MonitorInfoData>(env, [=] { return queryMonitorInfo(monitorId); }, monitorInfoToObject);
+}
+
+static Napi::Value getMonitorFromWindow(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  ensure_xcb_initialized(env);
+  GET_INT_64(info, 0, windowId, xcb_window_t);
+  return monitorIdToNumber(env, callNative(env, [=] { return queryMonitorFromWindow(windowId); }));
+}
+
+static Napi::Value getMonitorFromWindowAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  ensure_xcb_initialized(env);
+  GET_INT_64(info, 0, windowId, xcb_window_t);
+  return runOnNativeQueue<uint32_t>(env, [=] { return queryMonitorFromWindow(windowId); }, monitorIdToNumber);
+}
+
 Napi::Object monitorInit(Napi::Env env, Napi::Object exports) {
+  exports.Set(Napi::String::New(env, "getMonitors"), Napi::Function::New(env, getMonitors));
   exports.Set(Napi::String::New(env, "getMonitorInfo"), Napi::Function::New(env, getMonitorInfo));
+  exports.Set(Napi::String::New(env, "getMonitorFromWindow"), Napi::Function::New(env, getMonitorFromWindow));
+  exports.Set(Napi::String::New(env, "getMonitorsAsync"), Napi::Function::New(env, getMonitorsAsync));
+  exports.Set(Napi::String::New(env, "getMonitorInfoAsync"), Napi::Function::New(env, getMonitorInfoAsync));
+  exports.Set(Napi::String::New(env, "getMonitorFromWindowAsync"), Napi::Function::New(env, getMonitorFromWindowAsync));
   return exports;
-}
\ No newline at end of file
+}
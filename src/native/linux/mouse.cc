@@ -1,74 +1,245 @@
 #include "./headers/display.h"
 #include "./headers/mouse.h"
+#include "./headers/native-queue.h"
+#include "./headers/addon-data.h"
 #include <napi.h>
-#include <X11/extensions/XTest.h>
+#include <xcb/xtest.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <utility>
 
 #include "headers/validators.h"
 
 
-Napi::Object getMousePosition(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
-  int x, y; /* This is all we care about. Seriously. */
-  Window garb1, garb2; /* Why you can't specify NULL as a parameter */
-  int garbX, garbY; /* is beyond me. */
-  unsigned int moreGarbage;
-
-  Display* display = xGetMainDisplay(env);
-  XQueryPointer(display, XDefaultRootWindow(display), &garb1, &garb2, &x, &y, &garbX, &garbY, &moreGarbage);
+static std::pair<int, int> queryMousePosition() {
+  Display* display = xGetMainDisplay();
+  xcb_connection_t* connection = xGetMainConnection();
+  xcb_window_t root = XDefaultRootWindow(display);
+  xcb_query_pointer_reply_t* reply = xcb_query_pointer_reply(connection, xcb_query_pointer(connection, root), nullptr);
+  if (!reply) {
+    throw NativeError("Failed to query pointer");
+  }
+  std::pair<int, int> position{reply->root_x, reply->root_y};
+  free(reply);
+  return position;
+}
 
+static Napi::Value mousePositionToObject(Napi::Env env, const std::pair<int, int>& position) {
   Napi::Object obj = Napi::Object::New(env);
-  obj.Set("x", Napi::Number::New(env, x));
-  obj.Set("y", Napi::Number::New(env, y));
+  obj.Set("x", Napi::Number::New(env, position.first));
+  obj.Set("y", Napi::Number::New(env, position.second));
   return obj;
 }
 
-void setMouseButtonToState(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
-
-  GET_STRING(info, 0, button);
-  GET_BOOL(info, 1, isDown);
-
-  int buttonInt;
+int mouseButtonFromName(const std::string& button) {
   if (button == "LEFT") {
-    buttonInt = 1;
+    return 1;
   } else if (button == "RIGHT") {
-    buttonInt = 2;
+    return 2;
   } else if (button == "MIDDLE") {
-    buttonInt = 3;
-  } else {
-    throw Napi::Error::New(env, "Invalid button name. Must be 'LEFT', 'RIGHT', or 'MIDDLE'");
+    return 3;
   }
-  Display* display = xGetMainDisplay(env);
+  return 0;
+}
 
-  if (!XTestFakeButtonEvent(display, buttonInt, isDown ? True : False, CurrentTime)) {
-    throw Napi::Error::New(env, "Failed to send XTestFakeMotionEvent");
+static int parseMouseButton(const Napi::CallbackInfo& info) {
+  GET_STRING(info, 0, button);
+  int buttonInt = mouseButtonFromName(button);
+  if (buttonInt == 0) {
+    throw Napi::Error::New(info.Env(), "Invalid button name. Must be 'LEFT', 'RIGHT', or 'MIDDLE'");
   }
-  if (!XFlush(display)) {
-    throw Napi::Error::New(env, "Failed to XFlush");
+  return buttonInt;
+}
+
+// XTest input is unchecked and only flushed, errors are reported by the Xlib error handler
+void sendMouseButton(int button, bool isDown) {
+  xcb_connection_t* connection = xGetMainConnection();
+  xcb_test_fake_input(connection, isDown ? XCB_BUTTON_PRESS : XCB_BUTTON_RELEASE, button,
+                      XCB_CURRENT_TIME, XCB_NONE, 0, 0, 0);
+  if (xcb_flush(connection) <= 0) {
+    throw NativeError("Failed to flush XTest button event");
   }
 }
 
-void setMousePosition(const Napi::CallbackInfo& info) {
+// Root None moves the pointer on the screen it is currently on
+void sendMouseMotion(int x, int y) {
+  xcb_connection_t* connection = xGetMainConnection();
+  xcb_test_fake_input(connection, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME, XCB_NONE, x, y, 0);
+  if (xcb_flush(connection) <= 0) {
+    throw NativeError("Failed to flush XTest motion event");
+  }
+}
+
+Napi::Value getMousePosition(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  return mousePositionToObject(env, callNative(env, queryMousePosition));
+}
+
+Napi::Value getMousePositionAsync(const Napi::CallbackInfo& info) {
+  return runOnNativeQueue<std::pair<int, int>>(info.Env(), queryMousePosition, mousePositionToObject);
+}
+
+void setMouseButtonToState(const Napi::CallbackInfo& info) {
+  int button = parseMouseButton(info);
+  GET_BOOL(info, 1, isDown);
+  callNative(info.Env(), [=] { sendMouseButton(button, isDown); });
+}
+
+Napi::Value setMouseButtonToStateAsync(const Napi::CallbackInfo& info) {
+  int button = parseMouseButton(info);
+  GET_BOOL(info, 1, isDown);
+  return runOnNativeQueue(info.Env(), [=] { sendMouseButton(button, isDown); });
+}
+
+void setMousePosition(const Napi::CallbackInfo& info) {
+  GET_OBJECT(info, 0, bounds);
+  int x = bounds.Get("x").ToNumber().Int32Value();
+  int y = bounds.Get("y").ToNumber().Int32Value();
+  callNative(info.Env(), [=] { sendMouseMotion(x, y); });
+}
 
+Napi::Value setMousePositionAsync(const Napi::CallbackInfo& info) {
   GET_OBJECT(info, 0, bounds);
   int x = bounds.Get("x").ToNumber().Int32Value();
   int y = bounds.Get("y").ToNumber().Int32Value();
+  return runOnNativeQueue(info.Env(), [=] { sendMouseMotion(x, y); });
+}
 
-  Display* display = xGetMainDisplay(env);
-  int screen = -1;
-  if (!XTestFakeMotionEvent(display, screen, x, y, CurrentTime)) {
-    throw Napi::Error::New(env, "Failed to send XTestFakeMotionEvent");
+struct HumanMotion {
+  int x;
+  int y;
+  int destinationRandomX;
+  int destinationRandomY;
+  // Base delay between points in milliseconds, actual one varies between 80% and 120% of it
+  double delayBetweenIterations;
+  int pixelsPerIteration;
+  double curveIntensity;
+  double curveIntensityDeviation;
+};
+
+static double getOptionalNumber(const Napi::Object& object, const char* key, double defaultValue) {
+  Napi::Value value = object.Get(key);
+  if (value.IsUndefined()) {
+    return defaultValue;
+  }
+  if (!value.IsNumber()) {
+    throw Napi::TypeError::New(object.Env(), std::string("Object property '") + key + "' must be a number");
   }
-  if (!XFlush(display)) {
-    throw Napi::Error::New(env, "Failed to XFlush");
+  return value.As<Napi::Number>().DoubleValue();
+}
+
+static HumanMotion parseHumanMotion(const Napi::CallbackInfo& info) {
+  GET_OBJECT(info, 0, params);
+  ASSERT_OBJECT_NUMBER(info, 0, x);
+  ASSERT_OBJECT_NUMBER(info, 0, y);
+
+  HumanMotion motion;
+  motion.x = params.Get("x").ToNumber().Int32Value();
+  motion.y = params.Get("y").ToNumber().Int32Value();
+  motion.destinationRandomX = static_cast<int>(getOptionalNumber(params, "destinationRandomX", 0));
+  motion.destinationRandomY = static_cast<int>(getOptionalNumber(params, "destinationRandomY", 0));
+  motion.delayBetweenIterations = getOptionalNumber(params, "delayBetweenIterations", 5);
+  motion.pixelsPerIteration = static_cast<int>(getOptionalNumber(params, "pixelsPerIteration", 50));
+  motion.curveIntensity = getOptionalNumber(params, "curveIntensity", 0.3);
+  motion.curveIntensityDeviation = getOptionalNumber(params, "curveIntensityDeviation", 0.2);
+  if (motion.pixelsPerIteration <= 0 || motion.delayBetweenIterations < 0) {
+    throw Napi::Error::New(info.Env(), "pixelsPerIteration and delayBetweenIterations must be positive");
   }
+  return motion;
+}
+
+static double quadBezier(double p0, double p1, double p2, double t) {
+  double mt = 1 - t;
+  return mt * mt * p0 + 2 * mt * t * p1 + t * t * p2;
+}
+
+// Robert Penner's ease-in-out cubic, slower at start/end and faster in the middle
+static double easeInOut(double t) {
+  return t < 0.5 ? 4 * t * t * t : 1 - std::pow(-2 * t + 2, 3) / 2;
+}
+
+static void addMilliseconds(timespec& time, double ms) {
+  long long nanoseconds = time.tv_nsec + static_cast<long long>(ms * 1e6);
+  time.tv_sec += nanoseconds / 1000000000;
+  time.tv_nsec = nanoseconds % 1000000000;
+}
+
+// Sleeps until an absolute CLOCK_MONOTONIC deadline, so time spent sending events doesn't add up over the path
+static void sleepUntil(const timespec& deadline) {
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+  }
+}
+
+// Moves mouse along a quadratic Bézier curve with eased progress, same path MouseService used to generate in JS
+static void runHumanMotion(const HumanMotion& motion) {
+  std::mt19937 random(std::random_device{}());
+  std::uniform_real_distribution<double> symmetric(-1.0, 1.0);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+  std::pair<int, int> start = queryMousePosition();
+  double x1 = start.first;
+  double y1 = start.second;
+  int x2 = motion.x + static_cast<int>(std::round(symmetric(random) * motion.destinationRandomX));
+  int y2 = motion.y + static_cast<int>(std::round(symmetric(random) * motion.destinationRandomY));
+
+  double dx = x2 - x1;
+  double dy = y2 - y1;
+  double distance = std::hypot(dx, dy);
+  int steps = std::max(3, static_cast<int>(std::round(distance / motion.pixelsPerIteration)));
+
+  double baseCurveIntensity = std::min(1.0, std::max(0.1, motion.curveIntensity));
+  double curveDeviation = motion.curveIntensityDeviation * baseCurveIntensity;
+  double curveIntensity = std::min(1.0, std::max(0.1, baseCurveIntensity + symmetric(random) * curveDeviation));
+
+  double angle = std::atan2(dy, dx);
+  // Alternate curve direction based on position for more natural movement
+  int curveDirection = (start.first + start.second) % 2 ? 1 : -1;
+  double offsetAngle = angle + curveDirection * M_PI / 4;
+
+  // Checked between steps, a step sleeps at most 1.2 * delayBetweenIterations
+  const QueueStop& stop = currentQueueStop();
+  timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  for (int i = 1; i < steps; i++) {
+    // Control point wobbles a bit on every step to mimic hand tremor
+    double offsetScale = (0.1 + curveIntensity * 0.4) * (0.9 + 0.2 * unit(random));
+    double cx = x1 + dx * 0.5 + std::cos(offsetAngle) * distance * offsetScale;
+    double cy = y1 + dy * 0.5 + std::sin(offsetAngle) * distance * offsetScale;
+    double t = easeInOut(static_cast<double>(i) / steps);
+
+    sendMouseMotion(
+      static_cast<int>(std::round(quadBezier(x1, cx, x2, t))),
+      static_cast<int>(std::round(quadBezier(y1, cy, y2, t)))
+    );
+    addMilliseconds(deadline, motion.delayBetweenIterations * (0.8 + 0.4 * unit(random)));
+    sleepUntil(deadline);
+    if (stop.requested()) {
+      return;
+    }
+  }
+
+  // Ensure we hit the target exactly
+  sendMouseMotion(x2, y2);
+}
+
+Napi::Value mouseMoveHumanAsync(const Napi::CallbackInfo& info) {
+  HumanMotion motion = parseHumanMotion(info);
+  // Human-like moves last for seconds, they have their own thread so clicks and keys on nativeQueue don't wait
+  return runOnQueue(addonData().motionQueue, info.Env(), [=] { runHumanMotion(motion); });
 }
 
 Napi::Object mouseInit(Napi::Env env, Napi::Object exports) {
   exports.Set(Napi::String::New(env, "setMousePosition"), Napi::Function::New(env, setMousePosition));
   exports.Set(Napi::String::New(env, "setMouseButtonToState"), Napi::Function::New(env, setMouseButtonToState));
   exports.Set(Napi::String::New(env, "getMousePosition"), Napi::Function::New(env, getMousePosition));
+  exports.Set(Napi::String::New(env, "setMousePositionAsync"), Napi::Function::New(env, setMousePositionAsync));
+  exports.Set(Napi::String::New(env, "setMouseButtonToStateAsync"), Napi::Function::New(env, setMouseButtonToStateAsync));
+  exports.Set(Napi::String::New(env, "getMousePositionAsync"), Napi::Function::New(env, getMousePositionAsync));
+  exports.Set(Napi::String::New(env, "mouseMoveHumanAsync"), Napi::Function::New(env, mouseMoveHumanAsync));
   return exports;
-}
\ No newline at end of file
+}
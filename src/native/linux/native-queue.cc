@@ -0,0 +1,137 @@
+#include "./headers/native-queue.h"
+#include "./headers/addon-data.h"
+#include "./headers/logger.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cstdint>
+
+struct NativeTask {
+  NativeQueue* queue;
+  std::function<void()> execute;
+  std::function<Napi::Value(Napi::Env)> resolve;
+  Napi::Promise::Deferred deferred;
+  bool failed = false;
+  std::string error;
+};
+
+static thread_local QueueStop* threadQueueStop = nullptr;
+
+NativeQueue& nativeQueue() {
+  return addonData().queue;
+}
+
+QueueStop::QueueStop() : eventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {}
+
+QueueStop::~QueueStop() {
+  if (eventFd >= 0) {
+    close(eventFd);
+  }
+}
+
+void QueueStop::request() {
+  stopped.store(true, std::memory_order_release);
+  if (eventFd >= 0) {
+    uint64_t one = 1;
+    (void)!write(eventFd, &one, sizeof(one));
+  }
+}
+
+QueueStop& currentQueueStop() {
+  static QueueStop never;
+  return threadQueueStop != nullptr ? *threadQueueStop : never;
+}
+
+NativeQueue::~NativeQueue() {
+  // Env cleanup hook joins the thread before the instance is deleted, it can't be joined safely at process exit
+  if (thread.joinable()) {
+    thread.detach();
+  }
+}
+
+void NativeQueue::settle(Napi::Env env, Napi::Function, NativeTask* task) {
+  if (env != nullptr) {
+    if (task->failed) {
+      task->deferred.Reject(Napi::Error::New(env, task->error).Value());
+    } else {
+      try {
+        task->deferred.Resolve(task->resolve(env));
+      } catch (const Napi::Error& e) {
+        task->deferred.Reject(e.Value());
+      }
+    }
+    if (--task->queue->pendingTasks == 0) {
+      task->queue->completion.Unref(env);
+    }
+  }
+  delete task;
+}
+
+void NativeQueue::run(AddonData* data) {
+  bindAddonData(data);
+  threadQueueStop = &stopToken;
+  while (true) {
+    NativeTask* task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+      if (stopping) {
+        return;
+      }
+      task = tasks.front();
+      tasks.pop_front();
+    }
+    try {
+      task->execute();
+    } catch (const std::exception& e) {
+      task->failed = true;
+      task->error = e.what();
+    }
+    if (completion.BlockingCall(task, settle) != napi_ok) {
+      delete task;
+    }
+  }
+}
+
+void NativeQueue::stop(void* data) {
+  NativeQueue* queue = static_cast<NativeQueue*>(data);
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->stopping = true;
+  }
+  queue->condition.notify_one();
+  queue->stopToken.request();
+  if (queue->thread.joinable()) {
+    queue->thread.join();
+  }
+  for (NativeTask* task : queue->tasks) {
+    delete task;
+  }
+  queue->tasks.clear();
+  queue->completion.Release();
+}
+
+Napi::Promise NativeQueue::enqueue(
+  Napi::Env env,
+  std::function<void()> execute,
+  std::function<Napi::Value(Napi::Env)> resolve
+) {
+  if (!thread.joinable()) {
+    completion = Napi::ThreadSafeFunction::New(
+      env, Napi::Function::New(env, [](const Napi::CallbackInfo&) {}), name, 0, 1);
+    completion.Unref(env);
+    thread = std::thread(&NativeQueue::run, this, currentAddonData());
+    napi_add_env_cleanup_hook(env, stop, this);
+  }
+
+  NativeTask* task = new NativeTask{this, std::move(execute), std::move(resolve), Napi::Promise::Deferred::New(env)};
+  Napi::Promise promise = task->deferred.Promise();
+  if (pendingTasks++ == 0) {
+    completion.Ref(env);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(task);
+  }
+  condition.notify_one();
+  return promise;
+}
@@ -0,0 +1,334 @@
+#include "./headers/pixel.h"
+#include "./headers/addon-data.h"
+#include "./headers/display.h"
+#include "./headers/native-queue.h"
+#include "./headers/validators.h"
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+
+// Points in a bounding box up to this area are read with one capture, sparse ones with a request per point
+static const int64_t MAX_POINTS_BOX_AREA = 256 * 256;
+
+// Largest region polled by waitForPixel, it's meant for a button or an indicator, not for the whole screen
+static const int64_t MAX_WAIT_REGION_AREA = 1024 * 1024;
+
+struct PixelPoint {
+  int x;
+  int y;
+};
+
+template <typename T>
+using XcbReply = std::unique_ptr<T, decltype(&free)>;
+
+static PixelColor pixelAt(const uint8_t* bgra) {
+  return {bgra[2], bgra[1], bgra[0]};
+}
+
+static std::vector<PixelColor> queryPixels(const std::vector<PixelPoint>& points) {
+  xcb_connection_t* connection = xGetMainConnection();
+  const xcb_screen_t* screen = xcb_setup_roots_iterator(xcb_get_setup(connection)).data;
+  int left = INT32_MAX, top = INT32_MAX, right = INT32_MIN, bottom = INT32_MIN;
+  for (const PixelPoint& point : points) {
+    if (point.x < 0 || point.y < 0 || point.x >= screen->width_in_pixels || point.y >= screen->height_in_pixels) {
+      throw NativeError("Point " + std::to_string(point.x) + "," + std::to_string(point.y) + " is outside of the screen");
+    }
+    left = std::min(left, point.x);
+    top = std::min(top, point.y);
+    right = std::max(right, point.x + 1);
+    bottom = std::max(bottom, point.y + 1);
+  }
+
+  std::vector<PixelColor> colors;
+  colors.reserve(points.size());
+  if (points.empty()) {
+    return colors;
+  }
+  if (static_cast<int64_t>(right - left) * (bottom - top) <= MAX_POINTS_BOX_AREA) {
+    CaptureTarget target;
+    target.type = CaptureTarget::Type::Rect;
+    target.rect = {left, top, right - left, bottom - top};
+    CaptureFrame frame = captureScreen(target);
+    for (const PixelPoint& point : points) {
+      colors.push_back(pixelAt(frame.data() + (point.y - top) * frame.stride + (point.x - left) * 4));
+    }
+    return colors;
+  }
+
+  // Requests are pipelined, all of them are sent before waiting for the first reply
+  std::vector<xcb_get_image_cookie_t> cookies;
+  cookies.reserve(points.size());
+  for (const PixelPoint& point : points) {
+    cookies.push_back(xcb_get_image(connection, XCB_IMAGE_FORMAT_Z_PIXMAP, screen->root, point.x, point.y, 1, 1, ~0u));
+  }
+  std::string errorMsg;
+  for (xcb_get_image_cookie_t cookie : cookies) {
+    xcb_generic_error_t* error = nullptr;
+    XcbReply<xcb_get_image_reply_t> reply(xcb_get_image_reply(connection, cookie, &error), free);
+    if (!reply || xcb_get_image_data_length(reply.get()) < 4) {
+      if (errorMsg.empty()) {
+        errorMsg = xcbErrorMessage("Failed to read pixel", error);
+      }
+      free(error);
+      colors.push_back({0, 0, 0});
+      continue;
+    }
+    colors.push_back(pixelAt(xcb_get_image_data(reply.get())));
+  }
+  // Replies of all cookies are read first, so none is left behind on the connection
+  if (!errorMsg.empty()) {
+    throw NativeError(errorMsg);
+  }
+  return colors;
+}
+
+// Scans the wait region for the first pixel within tolerance of the wanted color
+static void pollPixelWait(PixelWait& wait) {
+  CaptureTarget target;
+  target.type = CaptureTarget::Type::Rect;
+  target.rect = wait.region;
+  CaptureFrame frame = captureScreen(target);
+  const uint8_t* pixels = frame.data();
+  for (int y = 0; y < frame.rect.height; y++) {
+    const uint8_t* row = pixels + static_cast<size_t>(y) * frame.stride;
+    for (int x = 0; x < frame.rect.width; x++) {
+      const uint8_t* px = row + x * 4;
+      if (abs(px[2] - wait.color.r) <= wait.tolerance && abs(px[1] - wait.color.g) <= wait.tolerance &&
+        abs(px[0] - wait.color.b) <= wait.tolerance) {
+        wait.matched = true;
+        wait.x = frame.rect.x + x;
+        wait.y = frame.rect.y + y;
+        wait.found = pixelAt(px);
+        return;
+      }
+    }
+  }
+}
+
+PixelWatcher::~PixelWatcher() {
+  // Same as NativeQueue, the cleanup hook joins the thread before the instance is deleted
+  if (thread.joinable()) {
+    thread.detach();
+  }
+}
+
+void PixelWatcher::settle(Napi::Env env, Napi::Function, PixelWait* wait) {
+  std::unique_ptr<PixelWait> owned(wait);
+  if (env == nullptr) {
+    return;
+  }
+  if (wait->failed) {
+    wait->deferred.Reject(Napi::Error::New(env, wait->error).Value());
+  } else {
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("matched", wait->matched);
+    if (wait->matched) {
+      Napi::Object color = Napi::Object::New(env);
+      color.Set("r", wait->found.r);
+      color.Set("g", wait->found.g);
+      color.Set("b", wait->found.b);
+      result.Set("x", wait->x);
+      result.Set("y", wait->y);
+      result.Set("color", color);
+    }
+    result.Set("elapsedMs", std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - wait->started).count());
+    wait->deferred.Resolve(result);
+  }
+  if (--wait->watcher->pendingWaits == 0) {
+    wait->watcher->completion.Unref(env);
+  }
+}
+
+void PixelWatcher::finish(PixelWait* wait) {
+  if (completion.BlockingCall(wait, settle) != napi_ok) {
+    delete wait;
+  }
+}
+
+void PixelWatcher::run(AddonData* data) {
+  bindAddonData(data);
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping) {
+    if (waits.empty()) {
+      condition.wait(lock);
+      continue;
+    }
+    PixelWait* wait = *std::min_element(waits.begin(), waits.end(), [](PixelWait* a, PixelWait* b) {
+      return a->nextPoll < b->nextPoll;
+    });
+    if (condition.wait_until(lock, wait->nextPoll) != std::cv_status::timeout || stopping) {
+      // New wait or stop, pick the next poll again
+      continue;
+    }
+    // watch() may have grown the vector while the lock was released, iterators taken before are invalid
+    waits.erase(std::find(waits.begin(), waits.end(), wait));
+    lock.unlock();
+    try {
+      pollPixelWait(*wait);
+    } catch (const std::exception& e) {
+      wait->failed = true;
+      wait->error = e.what();
+    }
+    auto now = std::chrono::steady_clock::now();
+    lock.lock();
+    if (wait->failed || wait->matched || now >= wait->deadline) {
+      lock.unlock();
+      finish(wait);
+      lock.lock();
+    } else {
+      wait->nextPoll = std::min(now + wait->interval, wait->deadline);
+      waits.push_back(wait);
+    }
+  }
+}
+
+void PixelWatcher::stop(void* data) {
+  PixelWatcher* watcher = static_cast<PixelWatcher*>(data);
+  {
+    std::lock_guard<std::mutex> lock(watcher->mutex);
+    watcher->stopping = true;
+  }
+  watcher->condition.notify_one();
+  if (watcher->thread.joinable()) {
+    watcher->thread.join();
+  }
+  for (PixelWait* wait : watcher->waits) {
+    delete wait;
+  }
+  watcher->waits.clear();
+  watcher->completion.Release();
+}
+
+Napi::Promise PixelWatcher::watch(Napi::Env env, PixelWait* wait) {
+  if (!thread.joinable()) {
+    completion = Napi::ThreadSafeFunction::New(
+      env, Napi::Function::New(env, [](const Napi::CallbackInfo&) {}), "pixelWatcher", 0, 1);
+    completion.Unref(env);
+    thread = std::thread(&PixelWatcher::run, this, currentAddonData());
+    napi_add_env_cleanup_hook(env, stop, this);
+  }
+  wait->watcher = this;
+  Napi::Promise promise = wait->deferred.Promise();
+  if (pendingWaits++ == 0) {
+    completion.Ref(env);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    waits.push_back(wait);
+  }
+  condition.notify_one();
+  return promise;
+}
+
+static Napi::Object colorToObject(Napi::Env env, const PixelColor& color) {
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("r", color.r);
+  obj.Set("g", color.g);
+  obj.Set("b", color.b);
+  return obj;
+}
+
+static PixelPoint parsePoint(Napi::Env env, Napi::Value value) {
+  if (!value.IsObject()) {
+    throw Napi::TypeError::New(env, "Point must be an object");
+  }
+  Napi::Object point = value.As<Napi::Object>();
+  if (!point.Get("x").IsNumber() || !point.Get("y").IsNumber()) {
+    throw Napi::TypeError::New(env, "Point must have numeric x and y");
+  }
+  return {point.Get("x").ToNumber().Int32Value(), point.Get("y").ToNumber().Int32Value()};
+}
+
+// Resolves with {r, g, b} of the screen pixel
+static Napi::Value getPixelAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_INT_32(info, 0, x, int);
+  GET_INT_32(info, 1, y, int);
+  return runOnNativeQueue<std::vector<PixelColor>>(env, [=] { return queryPixels({{x, y}}); },
+    [](Napi::Env env, std::vector<PixelColor>& colors) -> Napi::Value { return colorToObject(env, colors[0]); });
+}
+
+// Resolves with [{r, g, b}] in the order of points
+static Napi::Value getPixelsAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  ASSERT_ARRAY(info, 0);
+  Napi::Array array = info[0].As<Napi::Array>();
+  std::vector<PixelPoint> points;
+  points.reserve(array.Length());
+  for (uint32_t i = 0; i < array.Length(); i++) {
+    points.push_back(parsePoint(env, array.Get(i)));
+  }
+  return runOnNativeQueue<std::vector<PixelColor>>(env, [points] { return queryPixels(points); },
+    [](Napi::Env env, std::vector<PixelColor>& colors) -> Napi::Value {
+      Napi::Array result = Napi::Array::New(env, colors.size());
+      for (size_t i = 0; i < colors.size(); i++) {
+        result.Set(i, colorToObject(env, colors[i]));
+      }
+      return result;
+    });
+}
+
+// waitForPixelAsync({region: {x, y, width, height}, color: {r, g, b}, tolerance, timeoutMs, intervalMs})
+// resolves with {matched, x, y, color, elapsedMs} once a pixel of the region is within tolerance of color
+// on every channel, or with {matched: false, elapsedMs} after timeoutMs
+static Napi::Value waitForPixelAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_OBJECT(info, 0, request);
+  Napi::Value region = request.Get("region");
+  Napi::Value color = request.Get("color");
+  if (!region.IsObject() || !color.IsObject()) {
+    throw Napi::TypeError::New(env, "region and color must be objects");
+  }
+  Napi::Object regionObj = region.As<Napi::Object>();
+  Napi::Object colorObj = color.As<Napi::Object>();
+  for (const char* key : {"x", "y", "width", "height"}) {
+    if (!regionObj.Get(key).IsNumber()) {
+      throw Napi::TypeError::New(env, std::string("region.") + key + " must be a number");
+    }
+  }
+  for (const char* key : {"r", "g", "b"}) {
+    if (!colorObj.Get(key).IsNumber()) {
+      throw Napi::TypeError::New(env, std::string("color.") + key + " must be a number");
+    }
+  }
+  for (const char* key : {"tolerance", "timeoutMs", "intervalMs"}) {
+    if (!request.Get(key).IsNumber()) {
+      throw Napi::TypeError::New(env, std::string(key) + " must be a number");
+    }
+  }
+
+  std::unique_ptr<PixelWait> wait(new PixelWait{
+    {
+      regionObj.Get("x").ToNumber().Int32Value(),
+      regionObj.Get("y").ToNumber().Int32Value(),
+      regionObj.Get("width").ToNumber().Int32Value(),
+      regionObj.Get("height").ToNumber().Int32Value(),
+    },
+    {
+      static_cast<uint8_t>(std::clamp(colorObj.Get("r").ToNumber().Int32Value(), 0, 255)),
+      static_cast<uint8_t>(std::clamp(colorObj.Get("g").ToNumber().Int32Value(), 0, 255)),
+      static_cast<uint8_t>(std::clamp(colorObj.Get("b").ToNumber().Int32Value(), 0, 255)),
+    },
+    static_cast<uint8_t>(std::clamp(request.Get("tolerance").ToNumber().Int32Value(), 0, 255)),
+    std::chrono::milliseconds(std::max<int64_t>(1, request.Get("intervalMs").ToNumber().Int64Value())),
+    {}, {}, {},
+    Napi::Promise::Deferred::New(env),
+  });
+  if (wait->region.width <= 0 || wait->region.height <= 0 ||
+    static_cast<int64_t>(wait->region.width) * wait->region.height > MAX_WAIT_REGION_AREA) {
+    throw Napi::RangeError::New(env, "region must be non empty and at most " +
+      std::to_string(MAX_WAIT_REGION_AREA) + " pixels");
+  }
+  wait->started = std::chrono::steady_clock::now();
+  wait->deadline = wait->started + std::chrono::milliseconds(std::max<int64_t>(0, request.Get("timeoutMs").ToNumber().Int64Value()));
+  wait->nextPoll = wait->started;
+  return addonData().pixelWatcher.watch(env, wait.release());
+}
+
+Napi::Object pixelInit(Napi::Env env, Napi::Object exports) {
+  exports.Set("getPixelAsync", Napi::Function::New(env, getPixelAsync));
+  exports.Set("getPixelsAsync", Napi::Function::New(env, getPixelsAsync));
+  exports.Set("waitForPixelAsync", Napi::Function::New(env, waitForPixelAsync));
+  return exports;
+}
@@ -0,0 +1,272 @@
+#include "./headers/process-sampler.h"
+#include "./headers/addon-data.h"
+#include "./headers/logger.h"
+#include "./headers/native-queue.h"
+#include "./headers/process.h"
+#include "./headers/process-table.h"
+#include "./headers/validators.h"
+#include <algorithm>
+#include <chrono>
+#include <unistd.h>
+
+static const size_t MAX_SAMPLED_PIDS = 10000;
+static const int32_t MAX_HISTORY_SIZE = 3600;
+
+struct ProcessReading {
+  pid_t pid;
+  ProcessStat stat;
+  ProcessStatm statm;
+  uint64_t proportionalBytes;
+  uint64_t readBytes;
+  uint64_t writeBytes;
+  bool io;
+};
+
+static double steadyMs() {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double unixMs() {
+  return std::chrono::duration<double, std::milli>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+ProcessSampler::~ProcessSampler() {
+  // Same as NativeQueue, the cleanup hook joins the thread before the instance is deleted
+  if (thread.joinable()) {
+    thread.detach();
+  }
+}
+
+void ProcessSampler::start(Napi::Env env, const ProcessSamplerOptions& samplerOptions) {
+  close();
+  options = samplerOptions;
+  stopping = false;
+  thread = std::thread(&ProcessSampler::run, this);
+  if (!cleanupHook) {
+    napi_add_env_cleanup_hook(env, stop, this);
+    cleanupHook = true;
+  }
+}
+
+void ProcessSampler::close() {
+  if (!running()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  condition.notify_all();
+  thread.join();
+  tracks.clear();
+}
+
+void ProcessSampler::stop(void* sampler) {
+  static_cast<ProcessSampler*>(sampler)->close();
+}
+
+void ProcessSampler::run() {
+  std::chrono::milliseconds interval(options.intervalMs);
+  auto next = std::chrono::steady_clock::now();
+  for (uint64_t sweep = 1;; ++sweep) {
+    try {
+      sample(sweep);
+    } catch (const NativeError& e) {
+      LOG("Process sampler failed: %s", e.what());
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    // A sweep slower than the interval skips ticks instead of running back to back
+    auto now = std::chrono::steady_clock::now();
+    do {
+      next += interval;
+    } while (next <= now);
+    if (condition.wait_until(lock, next, [this] { return stopping; })) {
+      return;
+    }
+  }
+}
+
+void ProcessSampler::sample(uint64_t sweep) {
+  // /proc is read without the mutex, readers only wait for the rings to be updated
+  ProcDirectory proc;
+  std::vector<pid_t> pids;
+  if (options.pids.empty()) {
+    forEachProcess([&pids](int, pid_t pid) {
+      pids.push_back(pid);
+      return true;
+    });
+  } else {
+    pids = options.pids;
+  }
+  std::vector<ProcessReading> readings;
+  readings.reserve(pids.size());
+  for (pid_t pid : pids) {
+    ProcessReading reading = {pid};
+    if (!readProcessStat(proc.fd, pid, reading.stat)) {
+      continue;
+    }
+    readProcessStatm(proc.fd, pid, reading.statm);
+    uint64_t privateBytes;
+    if (!options.proportional || !readProcessRollup(proc.fd, pid, reading.proportionalBytes, privateBytes)) {
+      reading.proportionalBytes = reading.statm.residentBytes;
+    }
+    reading.io = readProcessIo(proc.fd, pid, reading.readBytes, reading.writeBytes);
+    readings.push_back(reading);
+  }
+  double time = steadyMs();
+  double now = unixMs();
+  double ticksPerMs = static_cast<double>(sysconf(_SC_CLK_TCK)) / 1000;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const ProcessReading& reading : readings) {
+    unsigned long long cpuTicks = reading.stat.utime + reading.stat.stime;
+    auto it = tracks.find(reading.pid);
+    if (it == tracks.end() || it->second.startTime != reading.stat.startTime) {
+      // CPU usage needs two readings, the first sample comes with the next sweep
+      tracks[reading.pid] = {reading.stat.startTime, cpuTicks, time,
+        std::vector<ProcessSample>(options.historySize), 0, 0, sweep};
+      continue;
+    }
+    Track& track = it->second;
+    double elapsed = time - track.time;
+    ProcessSample& sample = track.ring[track.next];
+    sample.time = now;
+    sample.cpu = elapsed > 0 ? static_cast<double>(cpuTicks - track.cpuTicks) / ticksPerMs / elapsed * 100 : 0;
+    sample.residentBytes = reading.statm.residentBytes;
+    sample.proportionalBytes = reading.proportionalBytes;
+    sample.readBytes = reading.io ? reading.readBytes : 0;
+    sample.writeBytes = reading.io ? reading.writeBytes : 0;
+    sample.io = reading.io;
+    sample.threadCount = static_cast<uint32_t>(reading.stat.threadCount);
+    track.next = (track.next + 1) % track.ring.size();
+    track.count = std::min(track.count + 1, track.ring.size());
+    track.cpuTicks = cpuTicks;
+    track.time = time;
+    track.sweep = sweep;
+  }
+  for (auto it = tracks.begin(); it != tracks.end();) {
+    it = it->second.sweep == sweep ? std::next(it) : tracks.erase(it);
+  }
+}
+
+std::vector<ProcessHistory> ProcessSampler::history(const std::vector<pid_t>& pids, size_t limit) {
+  std::vector<ProcessHistory> result;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto add = [&result, limit](pid_t pid, const Track& track) {
+    size_t count = std::min(track.count, limit);
+    if (count == 0) {
+      return;
+    }
+    ProcessHistory history = {pid};
+    history.samples.reserve(count);
+    size_t size = track.ring.size();
+    for (size_t i = (track.next + size - count) % size; history.samples.size() < count; i = (i + 1) % size) {
+      history.samples.push_back(track.ring[i]);
+    }
+    result.push_back(std::move(history));
+  };
+  if (pids.empty()) {
+    result.reserve(tracks.size());
+    for (const auto& entry : tracks) {
+      add(entry.first, entry.second);
+    }
+  } else {
+    for (pid_t pid : pids) {
+      auto it = tracks.find(pid);
+      if (it != tracks.end()) {
+        add(pid, it->second);
+      }
+    }
+  }
+  return result;
+}
+
+static std::vector<pid_t> getPidsOption(Napi::Env env, Napi::Value value) {
+  std::vector<pid_t> pids;
+  if (value.IsUndefined()) {
+    return pids;
+  }
+  if (!value.IsArray()) {
+    throw Napi::TypeError::New(env, "pids must be an array");
+  }
+  Napi::Array array = value.As<Napi::Array>();
+  if (array.Length() > MAX_SAMPLED_PIDS) {
+    throw Napi::RangeError::New(env, "At most " + std::to_string(MAX_SAMPLED_PIDS) + " pids can be sampled");
+  }
+  for (uint32_t i = 0; i < array.Length(); ++i) {
+    Napi::Value pid = array.Get(i);
+    if (!pid.IsNumber() || pid.As<Napi::Number>().Int32Value() <= 0) {
+      throw Napi::TypeError::New(env, "pids must be positive numbers");
+    }
+    pids.push_back(static_cast<pid_t>(pid.As<Napi::Number>().Int32Value()));
+  }
+  return pids;
+}
+
+static Napi::Object sampleToObject(Napi::Env env, const ProcessSample& sample) {
+  Napi::Object object = Napi::Object::New(env);
+  object.Set("time", Napi::Number::New(env, sample.time));
+  object.Set("cpu", Napi::Number::New(env, sample.cpu));
+  object.Set("residentBytes", Napi::Number::New(env, static_cast<double>(sample.residentBytes)));
+  object.Set("proportionalBytes", Napi::Number::New(env, static_cast<double>(sample.proportionalBytes)));
+  object.Set("threadCount", Napi::Number::New(env, sample.threadCount));
+  if (sample.io) {
+    object.Set("readBytes", Napi::Number::New(env, static_cast<double>(sample.readBytes)));
+    object.Set("writeBytes", Napi::Number::New(env, static_cast<double>(sample.writeBytes)));
+  }
+  return object;
+}
+
+// startProcessSampler({pids?, intervalMs, historySize, proportional}), restarts the sampler if it's running
+static Napi::Value startProcessSampler(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_OBJECT(info, 0, object);
+  ProcessSamplerOptions options;
+  options.pids = getPidsOption(env, object.Get("pids"));
+  options.intervalMs = static_cast<uint32_t>(getIntOption(env, object, "intervalMs", 100, 60000, 1000));
+  options.historySize = static_cast<uint32_t>(getIntOption(env, object, "historySize", 1, MAX_HISTORY_SIZE, 60));
+  Napi::Value proportional = object.Get("proportional");
+  options.proportional = proportional.IsBoolean() && proportional.As<Napi::Boolean>().Value();
+  addonData().processSampler.start(env, options);
+  return env.Undefined();
+}
+
+static Napi::Value stopProcessSampler(const Napi::CallbackInfo& info) {
+  addonData().processSampler.close();
+  return info.Env().Undefined();
+}
+
+// getProcessSamples(pids?, limit?) returns [{pid, samples}], samples oldest first
+static Napi::Value getProcessSamples(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::vector<pid_t> pids = getPidsOption(env, info[0]);
+  size_t limit = MAX_HISTORY_SIZE;
+  if (info.Length() > 1 && !info[1].IsUndefined()) {
+    GET_UINT_32(info, 1, requested, uint32_t);
+    limit = requested;
+  }
+  ProcessSampler& sampler = addonData().processSampler;
+  if (!sampler.running()) {
+    throw Napi::Error::New(env, "Process sampler is not running");
+  }
+  std::vector<ProcessHistory> histories = sampler.history(pids, limit);
+  Napi::Array result = Napi::Array::New(env, histories.size());
+  for (size_t i = 0; i < histories.size(); ++i) {
+    Napi::Object history = Napi::Object::New(env);
+    history.Set("pid", Napi::Number::New(env, histories[i].pid));
+    Napi::Array samples = Napi::Array::New(env, histories[i].samples.size());
+    for (size_t j = 0; j < histories[i].samples.size(); ++j) {
+      samples.Set(static_cast<uint32_t>(j), sampleToObject(env, histories[i].samples[j]));
+    }
+    history.Set("samples", samples);
+    result.Set(static_cast<uint32_t>(i), history);
+  }
+  return result;
+}
+
+Napi::Object processSamplerInit(Napi::Env env, Napi::Object exports) {
+  exports.Set("startProcessSampler", Napi::Function::New(env, startProcessSampler));
+  exports.Set("stopProcessSampler", Napi::Function::New(env, stopProcessSampler));
+  exports.Set("getProcessSamples", Napi::Function::New(env, getProcessSamples));
+  return exports;
+}
@@ -0,0 +1,600 @@
+#include "./headers/process-supervisor.h"
+#include "./headers/addon-data.h"
+#include "./headers/logger.h"
+#include "./headers/validators.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// A process that has run this long is healthy again, its next crash is restarted after backoffMs
+static const std::chrono::milliseconds STABLE_RUN(60000);
+static const uint32_t MAX_BACKOFF_MS = 60000;
+static const uint32_t MAX_RESTARTS = 1000;
+static const int32_t MAX_WAIT_MS = 24 * 60 * 60 * 1000;
+// Processes that have exited for good are kept for their exit status until there are more than this many
+static const size_t MAX_EXITED = 256;
+// epoll data of the wake eventfd, process ids start from 1
+static const uint64_t WAKE_EVENT = 0;
+
+static double unixMs() {
+  return std::chrono::duration<double, std::milli>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static int openPidFd(pid_t pid) {
+#ifdef SYS_pidfd_open
+  return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+// Same as child_process.spawn with detached and ignored stdio: own session, /dev/null stdio, default signal
+// handlers (node ignores SIGPIPE) and PATH lookup. Returns 0 or errno, exec errors like ENOENT included
+static int spawnProcess(const std::string& path, const std::vector<std::string>& args, pid_t& pid) {
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  for (int fd = 0; fd < 3; ++fd) {
+    posix_spawn_file_actions_addopen(&actions, fd, "/dev/null", fd == 0 ? O_RDONLY : O_WRONLY, 0);
+  }
+  posix_spawnattr_t attributes;
+  posix_spawnattr_init(&attributes);
+  sigset_t defaults;
+  sigfillset(&defaults);
+  sigdelset(&defaults, SIGKILL);
+  sigdelset(&defaults, SIGSTOP);
+  posix_spawnattr_setsigdefault(&attributes, &defaults);
+  sigset_t mask;
+  sigemptyset(&mask);
+  posix_spawnattr_setsigmask(&attributes, &mask);
+  short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+#ifdef POSIX_SPAWN_SETSID
+  flags |= POSIX_SPAWN_SETSID;
+#else
+  flags |= POSIX_SPAWN_SETPGROUP;
+#endif
+  posix_spawnattr_setflags(&attributes, flags);
+  std::vector<char*> argv;
+  argv.reserve(args.size() + 2);
+  argv.push_back(const_cast<char*>(path.c_str()));
+  for (const std::string& arg : args) {
+    argv.push_back(const_cast<char*>(arg.c_str()));
+  }
+  argv.push_back(nullptr);
+  int error = posix_spawnp(&pid, path.c_str(), &actions, &attributes, argv.data(), environ);
+  posix_spawnattr_destroy(&attributes);
+  posix_spawn_file_actions_destroy(&actions);
+  return error;
+}
+
+// Spawns and opens a pidfd of the child, a child without a pidfd is killed and reaped. Returns 0 or errno
+static int spawnWatched(const std::string& path, const std::vector<std::string>& args, pid_t& pid, int& pidFd) {
+  int error = spawnProcess(path, args, pid);
+  if (error != 0) {
+    return error;
+  }
+  // The child is not reaped until the supervisor waits for it, so the pid can't be reused in between
+  pidFd = openPidFd(pid);
+  if (pidFd < 0) {
+    error = errno;
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+  }
+  return error;
+}
+
+ProcessSupervisor::~ProcessSupervisor() {
+  // Same as NativeQueue, the cleanup hook joins the thread before the instance is deleted
+  if (thread.joinable()) {
+    thread.detach();
+  }
+}
+
+static Napi::Object exitToObject(Napi::Env env, const ProcessExit& exit) {
+  Napi::Object object = Napi::Object::New(env);
+  object.Set("pid", exit.pid);
+  if (exit.known) {
+    object.Set("code", exit.signal == 0 ? Napi::Number::New(env, exit.code) : env.Null());
+    object.Set("signal", exit.signal != 0 ? Napi::Number::New(env, exit.signal) : env.Null());
+  }
+  object.Set("time", exit.time);
+  return object;
+}
+
+static Napi::Object waitToObject(Napi::Env env, const ExitWait& wait) {
+  if (!wait.exited) {
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("exited", false);
+    return result;
+  }
+  Napi::Object result = exitToObject(env, wait.exit);
+  result.Set("exited", true);
+  result.Set("restarting", wait.restarting);
+  return result;
+}
+
+void ProcessSupervisor::settle(Napi::Env env, Napi::Function, ExitWait* wait) {
+  std::unique_ptr<ExitWait> owned(wait);
+  if (env == nullptr) {
+    return;
+  }
+  wait->deferred.Resolve(waitToObject(env, *wait));
+  if (--wait->supervisor->pendingWaits == 0) {
+    wait->supervisor->completion.Unref(env);
+  }
+}
+
+void ProcessSupervisor::finish(ExitWait* wait) {
+  if (completion.BlockingCall(wait, settle) != napi_ok) {
+    delete wait;
+  }
+}
+
+void ProcessSupervisor::start(Napi::Env env) {
+  if (thread.joinable()) {
+    return;
+  }
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd < 0) {
+    throw Napi::Error::New(env, std::string("Failed to create process supervisor epoll: ") + strerror(errno));
+  }
+  wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = WAKE_EVENT;
+  if (wakeFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) < 0) {
+    if (wakeFd >= 0) {
+      close(wakeFd);
+      wakeFd = -1;
+    }
+    close(epollFd);
+    epollFd = -1;
+    throw Napi::Error::New(env, "Failed to create process supervisor eventfd");
+  }
+  completion = Napi::ThreadSafeFunction::New(
+    env, Napi::Function::New(env, [](const Napi::CallbackInfo&) {}), "processSupervisor", 0, 1);
+  completion.Unref(env);
+  thread = std::thread(&ProcessSupervisor::run, this);
+  napi_add_env_cleanup_hook(env, stop, this);
+}
+
+void ProcessSupervisor::stop(void* data) {
+  ProcessSupervisor* supervisor = static_cast<ProcessSupervisor*>(data);
+  {
+    std::lock_guard<std::mutex> lock(supervisor->mutex);
+    supervisor->stopping = true;
+  }
+  supervisor->wake();
+  if (supervisor->thread.joinable()) {
+    supervisor->thread.join();
+  }
+  for (ExitWait* wait : supervisor->waits) {
+    delete wait;
+  }
+  supervisor->waits.clear();
+  // Children are left running, they are in their own session and outlive the server like detached ones
+  for (auto& entry : supervisor->processes) {
+    if (entry.second.pidFd >= 0) {
+      close(entry.second.pidFd);
+    }
+  }
+  supervisor->processes.clear();
+  close(supervisor->wakeFd);
+  supervisor->wakeFd = -1;
+  close(supervisor->epollFd);
+  supervisor->epollFd = -1;
+  supervisor->completion.Release();
+}
+
+void ProcessSupervisor::wake() {
+  if (wakeFd < 0) {
+    return;
+  }
+  uint64_t value = 1;
+  if (write(wakeFd, &value, sizeof(value)) < 0) {
+    LOG("Failed to wake process supervisor up");
+  }
+}
+
+uint32_t ProcessSupervisor::add(const SupervisedProcess& process) {
+  uint32_t id = nextId++;
+  epoll_event event = {};
+  // A pidfd becomes readable once its process has exited, right away if it's gone already
+  event.events = EPOLLIN;
+  event.data.u64 = id;
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, process.pidFd, &event) < 0) {
+    throw NativeError(std::string("Failed to watch process ") + std::to_string(process.pid) + ": " + strerror(errno));
+  }
+  processes.emplace(id, process).first->second.id = id;
+  return id;
+}
+
+uint32_t ProcessSupervisor::launch(Napi::Env env, const std::string& path, const std::vector<std::string>& args,
+  const RestartOptions& restart, pid_t& pid) {
+  start(env);
+  SupervisedProcess process = {};
+  int error = spawnWatched(path, args, process.pid, process.pidFd);
+  if (error != 0) {
+    throw Napi::Error::New(env, "Failed to launch " + path + ": " + strerror(error));
+  }
+  process.child = true;
+  process.path = path;
+  process.args = args;
+  process.restart = restart;
+  process.started = std::chrono::steady_clock::now();
+  process.restartAt = std::chrono::steady_clock::time_point::max();
+  pid = process.pid;
+  std::lock_guard<std::mutex> lock(mutex);
+  try {
+    return add(process);
+  } catch (const NativeError& e) {
+    close(process.pidFd);
+    kill(process.pid, SIGKILL);
+    waitpid(process.pid, nullptr, 0);
+    throw Napi::Error::New(env, e.what());
+  }
+}
+
+uint32_t ProcessSupervisor::adopt(Napi::Env env, pid_t pid) {
+  if (pid == getpid()) {
+    throw Napi::Error::New(env, "Server process can't be supervised");
+  }
+  start(env);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& entry : processes) {
+      if (entry.second.pid == pid && entry.second.pidFd >= 0) {
+        return entry.first;
+      }
+    }
+  }
+  SupervisedProcess process = {};
+  process.pid = pid;
+  process.pidFd = openPidFd(pid);
+  if (process.pidFd < 0) {
+    throw Napi::Error::New(env, errno == ESRCH
+      ? "Process " + std::to_string(pid) + " not found"
+      : "Failed to open pidfd of process " + std::to_string(pid) + ": " + strerror(errno));
+  }
+  process.started = std::chrono::steady_clock::now();
+  process.restartAt = std::chrono::steady_clock::time_point::max();
+  std::lock_guard<std::mutex> lock(mutex);
+  try {
+    return add(process);
+  } catch (const NativeError& e) {
+    close(process.pidFd);
+    throw Napi::Error::New(env, e.what());
+  }
+}
+
+Napi::Promise ProcessSupervisor::waitForExit(Napi::Env env, ExitWait* wait) {
+  std::unique_ptr<ExitWait> owned(wait);
+  wait->supervisor = this;
+  Napi::Promise promise = wait->deferred.Promise();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = processes.find(wait->id);
+    if (it == processes.end()) {
+      throw Napi::Error::New(env, "Process " + std::to_string(wait->id) + " is not supervised");
+    }
+    const SupervisedProcess& process = it->second;
+    if (process.pidFd < 0 && process.restartAt == std::chrono::steady_clock::time_point::max()) {
+      // Exited for good, nothing left to wait for
+      wait->exited = true;
+      wait->exit = process.lastExit;
+      wait->deferred.Resolve(waitToObject(env, *wait));
+      return promise;
+    }
+  }
+  if (pendingWaits++ == 0) {
+    completion.Ref(env);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    waits.push_back(owned.release());
+  }
+  wake();
+  return promise;
+}
+
+bool ProcessSupervisor::release(uint32_t id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = processes.find(id);
+    if (it == processes.end()) {
+      return false;
+    }
+    it->second.released = true;
+    it->second.restartAt = std::chrono::steady_clock::time_point::max();
+  }
+  wake();
+  return true;
+}
+
+std::vector<SupervisedProcess> ProcessSupervisor::list() {
+  std::vector<SupervisedProcess> result;
+  std::lock_guard<std::mutex> lock(mutex);
+  result.reserve(processes.size());
+  for (const auto& entry : processes) {
+    if (!entry.second.released) {
+      result.push_back(entry.second);
+    }
+  }
+  return result;
+}
+
+void ProcessSupervisor::exited(SupervisedProcess& process, std::chrono::steady_clock::time_point now) {
+  ProcessExit exit = {process.pid, false, -1, 0, unixMs()};
+  if (process.child) {
+    // The pid stays a zombie until it's reaped here, libuv only waits for children it has spawned itself
+    siginfo_t info = {};
+    if (waitid(P_PID, static_cast<id_t>(process.pid), &info, WEXITED | WNOHANG) == 0 && info.si_pid == process.pid) {
+      exit.known = true;
+      if (info.si_code == CLD_EXITED) {
+        exit.code = info.si_status;
+      } else {
+        exit.signal = info.si_status;
+      }
+    }
+  }
+  // Closing the pidfd removes it from the epoll set
+  close(process.pidFd);
+  process.pidFd = -1;
+  process.hasExited = true;
+  process.lastExit = exit;
+  bool failed = !exit.known || exit.code != 0 || exit.signal != 0;
+  bool restart = process.child && !process.released && (process.restart.policy == RestartPolicy::OnExit ||
+    (process.restart.policy == RestartPolicy::OnFailure && failed));
+  if (restart) {
+    if (now - process.started >= STABLE_RUN) {
+      process.restartsInRow = 0;
+    }
+    if (process.restartsInRow < process.restart.maxRestarts) {
+      uint64_t delay = static_cast<uint64_t>(process.restart.backoffMs) << std::min<uint32_t>(process.restartsInRow, 16);
+      process.restartAt = now + std::chrono::milliseconds(std::min<uint64_t>(delay, MAX_BACKOFF_MS));
+    } else {
+      LOG("Process %s has exited %u times in a row, not restarting it", process.path.c_str(), process.restartsInRow);
+    }
+  }
+  settleWaits(process, process.restartAt != std::chrono::steady_clock::time_point::max());
+}
+
+void ProcessSupervisor::settleWaits(const SupervisedProcess& process, bool restarting) {
+  for (auto it = waits.begin(); it != waits.end();) {
+    if ((*it)->id != process.id) {
+      ++it;
+      continue;
+    }
+    (*it)->exited = true;
+    (*it)->exit = process.lastExit;
+    (*it)->restarting = restarting;
+    finish(*it);
+    it = waits.erase(it);
+  }
+}
+
+void ProcessSupervisor::relaunch(SupervisedProcess& process, std::chrono::steady_clock::time_point now) {
+  process.restartAt = std::chrono::steady_clock::time_point::max();
+  process.restartsInRow++;
+  process.restarts++;
+  int error = spawnWatched(process.path, process.args, process.pid, process.pidFd);
+  if (error != 0) {
+    LOG("Failed to restart %s: %s", process.path.c_str(), strerror(error));
+    process.pidFd = -1;
+    // Gone for good, waits made during the backoff would otherwise only time out as if it was running
+    settleWaits(process, false);
+    return;
+  }
+  epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = process.id;
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, process.pidFd, &event) < 0) {
+    LOG("Failed to watch restarted %s: %s", process.path.c_str(), strerror(errno));
+  }
+  process.started = now;
+}
+
+std::chrono::steady_clock::time_point ProcessSupervisor::nextDeadline() const {
+  auto deadline = std::chrono::steady_clock::time_point::max();
+  for (const ExitWait* wait : waits) {
+    deadline = std::min(deadline, wait->deadline);
+  }
+  for (const auto& entry : processes) {
+    deadline = std::min(deadline, entry.second.restartAt);
+  }
+  return deadline;
+}
+
+void ProcessSupervisor::run() {
+  epoll_event events[32];
+  for (;;) {
+    int timeout = -1;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (stopping) {
+        return;
+      }
+      auto deadline = nextDeadline();
+      if (deadline != std::chrono::steady_clock::time_point::max()) {
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        timeout = static_cast<int>(std::clamp<int64_t>(left.count(), 0, MAX_WAIT_MS));
+      }
+    }
+    int count = epoll_wait(epollFd, events, 32, timeout);
+    if (count < 0 && errno != EINTR) {
+      LOG("Process supervisor epoll failed: %s", strerror(errno));
+      return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping) {
+      return;
+    }
+    for (int i = 0; i < count; ++i) {
+      if (events[i].data.u64 == WAKE_EVENT) {
+        uint64_t value;
+        while (read(wakeFd, &value, sizeof(value)) > 0) {
+        }
+        continue;
+      }
+      auto it = processes.find(static_cast<uint32_t>(events[i].data.u64));
+      if (it != processes.end() && it->second.pidFd >= 0) {
+        exited(it->second, now);
+      }
+    }
+    for (auto& entry : processes) {
+      if (entry.second.restartAt <= now) {
+        relaunch(entry.second, now);
+      }
+    }
+    for (auto it = waits.begin(); it != waits.end();) {
+      auto process = processes.find((*it)->id);
+      // Released processes that are not running won't exit again
+      bool gone = process == processes.end() || (process->second.released && process->second.pidFd < 0);
+      if (!gone && (*it)->deadline > now) {
+        ++it;
+        continue;
+      }
+      finish(*it);
+      it = waits.erase(it);
+    }
+    size_t exitedCount = 0;
+    for (const auto& entry : processes) {
+      exitedCount += entry.second.pidFd < 0 && entry.second.restartAt == std::chrono::steady_clock::time_point::max();
+    }
+    // Ids grow, so the oldest exits are dropped first
+    for (auto it = processes.begin(); it != processes.end();) {
+      const SupervisedProcess& process = it->second;
+      bool done = process.pidFd < 0 && process.restartAt == std::chrono::steady_clock::time_point::max();
+      if (done && (process.released || exitedCount > MAX_EXITED)) {
+        exitedCount--;
+        it = processes.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+static RestartOptions getRestartOptions(Napi::Env env, Napi::Value value) {
+  RestartOptions restart;
+  if (value.IsUndefined() || value.IsNull()) {
+    return restart;
+  }
+  if (!value.IsObject()) {
+    throw Napi::TypeError::New(env, "restart must be an object");
+  }
+  Napi::Object object = value.As<Napi::Object>();
+  Napi::Value policy = object.Get("policy");
+  std::string name = policy.IsString() ? policy.As<Napi::String>().Utf8Value() : "";
+  if (name == "never") {
+    restart.policy = RestartPolicy::Never;
+  } else if (name == "on-failure") {
+    restart.policy = RestartPolicy::OnFailure;
+  } else if (name == "always") {
+    restart.policy = RestartPolicy::OnExit;
+  } else {
+    throw Napi::TypeError::New(env, "restart.policy must be 'never', 'on-failure' or 'always'");
+  }
+  restart.maxRestarts = static_cast<uint32_t>(getIntOption(env, object, "maxRestarts", 0, MAX_RESTARTS, 5));
+  restart.backoffMs = static_cast<uint32_t>(getIntOption(env, object, "backoffMs", 0, MAX_BACKOFF_MS, 1000));
+  return restart;
+}
+
+static Napi::Object launchedToObject(Napi::Env env, uint32_t id, pid_t pid) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("id", id);
+  result.Set("pid", pid);
+  return result;
+}
+
+// launchSupervisedProcess(path, args, restart?: {policy, maxRestarts, backoffMs}) returns {id, pid}
+static Napi::Value launchSupervisedProcess(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_STRING_UTF8(info, 0, path);
+  ASSERT_ARRAY(info, 1);
+  Napi::Array array = info[1].As<Napi::Array>();
+  std::vector<std::string> args;
+  args.reserve(array.Length());
+  for (uint32_t i = 0; i < array.Length(); ++i) {
+    Napi::Value arg = array.Get(i);
+    if (!arg.IsString()) {
+      throw Napi::TypeError::New(env, "args must be strings");
+    }
+    args.push_back(arg.As<Napi::String>().Utf8Value());
+  }
+  RestartOptions restart = getRestartOptions(env, info[2]);
+  pid_t pid;
+  uint32_t id = addonData().processSupervisor.launch(env, path, args, restart, pid);
+  return launchedToObject(env, id, pid);
+}
+
+// superviseProcess(pid) returns {id, pid}, the id of an already supervised pid is reused
+static Napi::Value superviseProcess(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_UINT_32(info, 0, pid, pid_t);
+  if (pid <= 0) {
+    throw Napi::RangeError::New(env, "pid must be positive");
+  }
+  return launchedToObject(env, addonData().processSupervisor.adopt(env, pid), pid);
+}
+
+// waitForSupervisedExitAsync(id, timeoutMs) resolves {exited, pid?, code?, signal?, time?, restarting?}
+static Napi::Value waitForSupervisedExitAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_UINT_32(info, 0, id, uint32_t);
+  GET_UINT_32(info, 1, timeoutMs, uint32_t);
+  std::unique_ptr<ExitWait> wait(new ExitWait{id,
+    std::chrono::steady_clock::now() + std::chrono::milliseconds(std::min<uint32_t>(timeoutMs, MAX_WAIT_MS)),
+    Napi::Promise::Deferred::New(env)});
+  return addonData().processSupervisor.waitForExit(env, wait.release());
+}
+
+// getSupervisedProcesses() returns [{id, pid, path?, running, restarts, restartPending, lastExit?}]
+static Napi::Value getSupervisedProcesses(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::vector<SupervisedProcess> processes = addonData().processSupervisor.list();
+  Napi::Array result = Napi::Array::New(env, processes.size());
+  for (size_t i = 0; i < processes.size(); ++i) {
+    const SupervisedProcess& process = processes[i];
+    Napi::Object object = Napi::Object::New(env);
+    object.Set("id", process.id);
+    object.Set("pid", process.pid);
+    if (process.child) {
+      object.Set("path", process.path);
+    }
+    object.Set("running", process.pidFd >= 0);
+    object.Set("restarts", process.restarts);
+    object.Set("restartPending", process.restartAt != std::chrono::steady_clock::time_point::max());
+    if (process.hasExited) {
+      object.Set("lastExit", exitToObject(env, process.lastExit));
+    }
+    result.Set(static_cast<uint32_t>(i), object);
+  }
+  return result;
+}
+
+// releaseSupervisedProcess(id) returns false if the id is not supervised
+static Napi::Value releaseSupervisedProcess(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_UINT_32(info, 0, id, uint32_t);
+  return Napi::Boolean::New(env, addonData().processSupervisor.release(id));
+}
+
+Napi::Object processSupervisorInit(Napi::Env env, Napi::Object exports) {
+  exports.Set("launchSupervisedProcess", Napi::Function::New(env, launchSupervisedProcess));
+  exports.Set("superviseProcess", Napi::Function::New(env, superviseProcess));
+  exports.Set("waitForSupervisedExitAsync", Napi::Function::New(env, waitForSupervisedExitAsync));
+  exports.Set("getSupervisedProcesses", Napi::Function::New(env, getSupervisedProcesses));
+  exports.Set("releaseSupervisedProcess", Napi::Function::New(env, releaseSupervisedProcess));
+  return exports;
+}
@@ -0,0 +1,468 @@
+#include "./headers/process-table.h"
+#include "./headers/addon-data.h"
+#include "./headers/native-queue.h"
+#include "./headers/process.h"
+#include "./headers/validators.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <unordered_set>
+
+// Longer command lines are matched by their beginning only
+static const size_t MAX_MATCHED_CONTENT = 4096;
+static const uint32_t MAX_GRACE_MS = 60000;
+// How often /proc is checked for processes that can't be waited on with a pidfd
+static const int EXIT_POLL_MS = 10;
+
+struct KillTarget {
+  pid_t pid;
+  // -1 on kernels without pidfd_open (before 5.3), then pid is signalled and polled through /proc
+  int pidFd;
+  bool signalled;
+  bool exited;
+};
+
+static std::string errnoMessage(const std::string& message) {
+  return message + ": " + strerror(errno);
+}
+
+ProcDirectory::ProcDirectory() : fd(open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC)) {
+  if (fd < 0) {
+    throw NativeError(errnoMessage("Failed to open /proc"));
+  }
+}
+
+ProcDirectory::~ProcDirectory() {
+  close(fd);
+}
+
+// Pid of a /proc entry, 0 for entries that are not processes
+static pid_t parsePid(const char* name) {
+  pid_t pid = 0;
+  for (const char* c = name; *c; ++c) {
+    if (*c < '0' || *c > '9' || pid > 99999999) {
+      return 0;
+    }
+    pid = pid * 10 + (*c - '0');
+  }
+  return pid;
+}
+
+void forEachProcess(const std::function<bool(int procFd, pid_t pid)>& fn) {
+  ProcDirectory proc;
+  // Records are read straight from the kernel, readdir would allocate a DIR stream for every scan
+  alignas(struct dirent64) char buffer[32768];
+  while (true) {
+    long length = syscall(SYS_getdents64, proc.fd, buffer, sizeof(buffer));
+    if (length < 0) {
+      throw NativeError(errnoMessage("Failed to read /proc"));
+    }
+    if (length == 0) {
+      return;
+    }
+    for (long offset = 0; offset < length;) {
+      const struct dirent64* entry = reinterpret_cast<const struct dirent64*>(buffer + offset);
+      offset += entry->d_reclen;
+      pid_t pid = parsePid(entry->d_name);
+      if (pid > 0 && !fn(proc.fd, pid)) {
+        return;
+      }
+    }
+  }
+}
+
+ssize_t readProcFile(int procFd, pid_t pid, const char* file, char* content, size_t size) {
+  char path[64];
+  snprintf(path, sizeof(path), "%d/%s", pid, file);
+  int fd = openat(procFd, path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  // Files of /proc are generated whole on read, one call returns everything that fits
+  ssize_t length;
+  do {
+    length = pread(fd, content, size - 1, 0);
+  } while (length < 0 && errno == EINTR);
+  close(fd);
+  if (length >= 0) {
+    content[length] = '\0';
+  }
+  return length;
+}
+
+std::vector<pid_t> findProcesses(const std::string& name, ProcessMatch match) {
+  std::vector<pid_t> pids;
+  if (name.empty()) {
+    return pids;
+  }
+  pid_t self = getpid();
+  const char* file = match == ProcessMatch::Comm ? "comm" : "cmdline";
+  char content[MAX_MATCHED_CONTENT];
+  forEachProcess([&](int procFd, pid_t pid) {
+    if (pid == self) {
+      return true;
+    }
+    // Kernel threads have an empty cmdline
+    ssize_t length = readProcFile(procFd, pid, file, content, sizeof(content));
+    if (length <= 0) {
+      return true;
+    }
+    if (match == ProcessMatch::Comm) {
+      if (content[length - 1] == '\n') {
+        --length;
+      }
+    } else {
+      // Arguments are separated with NUL, pgrep -f joins them with spaces
+      std::replace(content, content + length, '\0', ' ');
+    }
+    if (memmem(content, length, name.data(), name.size()) != nullptr) {
+      pids.push_back(pid);
+    }
+    return true;
+  });
+  return pids;
+}
+
+void ProcessTree::link(pid_t pid, pid_t ppid) {
+  children[ppid].push_back(pid);
+}
+
+void ProcessTree::unlink(pid_t pid, pid_t ppid) {
+  auto it = children.find(ppid);
+  if (it == children.end()) {
+    return;
+  }
+  std::vector<pid_t>& siblings = it->second;
+  siblings.erase(std::remove(siblings.begin(), siblings.end(), pid), siblings.end());
+  if (siblings.empty()) {
+    children.erase(it);
+  }
+}
+
+void ProcessTree::refresh() {
+  ++generation;
+  std::vector<pid_t> reread;
+  forEachProcess([this, &reread](int, pid_t pid) {
+    auto it = nodes.find(pid);
+    if (it == nodes.end()) {
+      reread.push_back(pid);
+    } else {
+      it->second.seen = generation;
+    }
+    return true;
+  });
+
+  // Children of exited processes now belong to init or a subreaper
+  for (auto it = nodes.begin(); it != nodes.end();) {
+    if (it->second.seen == generation) {
+      ++it;
+      continue;
+    }
+    auto orphans = children.find(it->first);
+    if (orphans != children.end()) {
+      reread.insert(reread.end(), orphans->second.begin(), orphans->second.end());
+    }
+    unlink(it->first, it->second.ppid);
+    it = nodes.erase(it);
+  }
+
+  ProcDirectory proc;
+  for (pid_t pid : reread) {
+    // Exited since the scan, its children are picked up by the next refresh
+    relink(proc.fd, pid);
+  }
+}
+
+// Replaces the node of pid with one read from its stat now. False if the process is gone
+bool ProcessTree::relink(int procFd, pid_t pid) {
+  auto it = nodes.find(pid);
+  if (it != nodes.end()) {
+    unlink(pid, it->second.ppid);
+    nodes.erase(it);
+  }
+  ProcessStat stat;
+  if (!readProcessStat(procFd, pid, stat)) {
+    return false;
+  }
+  pid_t ppid = static_cast<pid_t>(stat.ppid);
+  nodes[pid] = {ppid, stat.startTime, generation};
+  link(pid, ppid);
+  return true;
+}
+
+// Refresh only sees that a pid is still listed. When it now belongs to another process, the children linked
+// to the previous one were reparented and are relinked too, ones the new process has started stay under it
+void ProcessTree::revalidate(int procFd, pid_t pid) {
+  auto it = nodes.find(pid);
+  if (it == nodes.end()) {
+    return;
+  }
+  ProcessStat stat;
+  if (readProcessStat(procFd, pid, stat) && stat.startTime == it->second.startTime) {
+    return;
+  }
+  auto linked = children.find(pid);
+  if (linked != children.end()) {
+    std::vector<pid_t> previous = linked->second;
+    for (pid_t child : previous) {
+      relink(procFd, child);
+    }
+  }
+  relink(procFd, pid);
+}
+
+std::vector<pid_t> ProcessTree::descendants(pid_t pid) {
+  std::lock_guard<std::mutex> lock(mutex);
+  refresh();
+  // Stat is read again only for processes in the result, so the cost follows its size
+  ProcDirectory proc;
+  revalidate(proc.fd, pid);
+  std::vector<pid_t> result = {pid};
+  std::unordered_set<pid_t> visited = {pid};
+  std::vector<pid_t> linked;
+  for (size_t i = 0; i < result.size(); ++i) {
+    auto it = children.find(result[i]);
+    if (it == children.end()) {
+      continue;
+    }
+    // Revalidation relinks, so the list can't be walked in place
+    linked = it->second;
+    for (pid_t child : linked) {
+      if (!visited.insert(child).second) {
+        continue;
+      }
+      revalidate(proc.fd, child);
+      auto node = nodes.find(child);
+      if (node != nodes.end() && node->second.ppid == result[i]) {
+        result.push_back(child);
+      }
+    }
+  }
+  return result;
+}
+
+static int openPidFd(pid_t pid) {
+#ifdef SYS_pidfd_open
+  return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+// Signals through the pidfd when there's one, so a pid reused after the process has exited is never hit
+static bool sendSignal(const KillTarget& target, int signal) {
+#ifdef SYS_pidfd_send_signal
+  if (target.pidFd >= 0) {
+    return syscall(SYS_pidfd_send_signal, target.pidFd, signal, nullptr, 0) == 0;
+  }
+#endif
+  return kill(target.pid, signal) == 0;
+}
+
+// Zombies count as exited, only their parent can do anything with them
+static bool processExited(pid_t pid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return true;
+  }
+  char stat[512];
+  ssize_t length = read(fd, stat, sizeof(stat) - 1);
+  close(fd);
+  if (length <= 0) {
+    return true;
+  }
+  stat[length] = '\0';
+  // comm may contain spaces and parentheses, state follows the last ')'
+  const char* state = strrchr(stat, ')');
+  return state != nullptr && state[1] == ' ' && (state[2] == 'Z' || state[2] == 'X');
+}
+
+// Returns once every signalled target has exited, timeoutMs has passed or the process queue is stopping
+static void waitForExit(std::vector<KillTarget>& targets, uint32_t timeoutMs) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+  QueueStop& stop = currentQueueStop();
+  std::vector<pollfd> fds;
+  std::vector<KillTarget*> polled;
+  while (!stop.requested()) {
+    fds.clear();
+    polled.clear();
+    // First one is the stop token, not a target
+    fds.push_back({stop.fd(), POLLIN, 0});
+    bool withoutPidFd = false;
+    for (KillTarget& target : targets) {
+      if (!target.signalled || target.exited) {
+        continue;
+      }
+      if (target.pidFd >= 0) {
+        fds.push_back({target.pidFd, POLLIN, 0});
+        polled.push_back(&target);
+      } else if (processExited(target.pid)) {
+        target.exited = true;
+      } else {
+        withoutPidFd = true;
+      }
+    }
+    if (polled.empty() && !withoutPidFd) {
+      return;
+    }
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline - std::chrono::steady_clock::now()).count();
+    if (remaining <= 0) {
+      return;
+    }
+    int timeout = withoutPidFd ? std::min<int>(static_cast<int>(remaining), EXIT_POLL_MS) : static_cast<int>(remaining);
+    // A pidfd becomes readable once its process has exited
+    if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR) {
+      throw NativeError(errnoMessage("Failed to wait for processes"));
+    }
+    for (size_t i = 0; i < polled.size(); ++i) {
+      if (fds[i + 1].revents != 0) {
+        polled[i]->exited = true;
+      }
+    }
+  }
+}
+
+ProcessKillResult killProcesses(const std::vector<pid_t>& pids, uint32_t graceMs) {
+  std::vector<KillTarget> targets;
+  targets.reserve(pids.size());
+  for (pid_t pid : pids) {
+    int pidFd = openPidFd(pid);
+    if (pidFd < 0 && errno == ESRCH) {
+      continue;
+    }
+    targets.push_back({pid, pidFd, false, false});
+  }
+
+  std::string error;
+  auto signalTarget = [&error](KillTarget& target, int signal) {
+    if (sendSignal(target, signal)) {
+      return true;
+    }
+    if (errno != ESRCH && error.empty()) {
+      error = errnoMessage("Failed to signal process " + std::to_string(target.pid));
+    }
+    return false;
+  };
+
+  ProcessKillResult result;
+  try {
+    for (KillTarget& target : targets) {
+      target.signalled = signalTarget(target, graceMs > 0 ? SIGTERM : SIGKILL);
+      if (target.signalled && graceMs == 0) {
+        result.killed.push_back(target.pid);
+      }
+    }
+    if (graceMs > 0) {
+      waitForExit(targets, graceMs);
+      for (KillTarget& target : targets) {
+        if (!target.signalled) {
+          continue;
+        }
+        // Exited between the end of the wait and SIGKILL
+        if (target.exited || !signalTarget(target, SIGKILL)) {
+          result.terminated.push_back(target.pid);
+        } else {
+          result.killed.push_back(target.pid);
+        }
+      }
+    }
+  } catch (...) {
+    for (const KillTarget& target : targets) {
+      if (target.pidFd >= 0) {
+        close(target.pidFd);
+      }
+    }
+    throw;
+  }
+  for (const KillTarget& target : targets) {
+    if (target.pidFd >= 0) {
+      close(target.pidFd);
+    }
+  }
+  if (!error.empty()) {
+    throw NativeError(error);
+  }
+  return result;
+}
+
+static ProcessMatch getProcessMatch(Napi::Env env, Napi::Value value) {
+  std::string match = value.IsString() ? value.As<Napi::String>().Utf8Value() : "";
+  if (match == "comm") {
+    return ProcessMatch::Comm;
+  }
+  if (match == "cmdline") {
+    return ProcessMatch::Cmdline;
+  }
+  throw Napi::TypeError::New(env, "Match must be 'comm' or 'cmdline'");
+}
+
+static Napi::Array pidsToArray(Napi::Env env, const std::vector<pid_t>& pids) {
+  Napi::Array array = Napi::Array::New(env, pids.size());
+  for (size_t i = 0; i < pids.size(); ++i) {
+    array.Set(static_cast<uint32_t>(i), Napi::Number::New(env, pids[i]));
+  }
+  return array;
+}
+
+static Napi::Value killResultToObject(Napi::Env env, const ProcessKillResult& result) {
+  Napi::Object object = Napi::Object::New(env);
+  object.Set("terminated", pidsToArray(env, result.terminated));
+  object.Set("killed", pidsToArray(env, result.killed));
+  return object;
+}
+
+static Napi::Value findProcessesAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_STRING_UTF8(info, 0, name);
+  ProcessMatch match = getProcessMatch(env, info[1]);
+
+  return runOnQueue<std::vector<pid_t>>(addonData().processQueue, env, [=] { return findProcesses(name, match); },
+    [](Napi::Env env, const std::vector<pid_t>& pids) -> Napi::Value { return pidsToArray(env, pids); });
+}
+
+static Napi::Value killProcessesAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_OBJECT(info, 0, target);
+  GET_UINT_32(info, 1, graceMs, uint32_t);
+  if (graceMs > MAX_GRACE_MS) {
+    throw Napi::RangeError::New(env, "Grace period must be at most " + std::to_string(MAX_GRACE_MS) + " ms");
+  }
+
+  Napi::Value pid = target.Get("pid");
+  Napi::Value name = target.Get("name");
+  std::function<ProcessKillResult()> execute;
+  if (pid.IsNumber()) {
+    std::vector<pid_t> pids = {static_cast<pid_t>(pid.As<Napi::Number>().Int32Value())};
+    if (pids[0] <= 0) {
+      throw Napi::RangeError::New(env, "Pid must be positive");
+    }
+    execute = [=] { return killProcesses(pids, graceMs); };
+  } else if (name.IsString()) {
+    std::string processName = name.As<Napi::String>().Utf8Value();
+    ProcessMatch match = getProcessMatch(env, target.Get("match"));
+    // Scan and signals in one task, so nothing else on the queue runs in between
+    execute = [=] { return killProcesses(findProcesses(processName, match), graceMs); };
+  } else {
+    throw Napi::TypeError::New(env, "Target must have a pid or a name");
+  }
+
+  return runOnQueue<ProcessKillResult>(addonData().processQueue, env, execute, killResultToObject);
+}
+
+Napi::Object processTableInit(Napi::Env env, Napi::Object exports) {
+  exports.Set(Napi::String::New(env, "findProcessesAsync"), Napi::Function::New(env, findProcessesAsync));
+  exports.Set(Napi::String::New(env, "killProcessesAsync"), Napi::Function::New(env, killProcessesAsync));
+  return exports;
+}
@@ -4,16 +4,19 @@
 #include <sys/wait.h>
 #include <vector>
 #include <string>
+#include <cstdlib>
 #include <cstring>
-#include <fstream>
-#include <sstream>
+#include <ctime>
 #include "./headers/process.h"
+#include "./headers/process-table.h"
+#include "./headers/addon-data.h"
 #include "./headers/validators.h"
+#include "./headers/native-queue.h"
 
 
-std::string getProcessPath(pid_t pid, Napi::Env env) {
+std::string getProcessPath(pid_t pid) {
   if (pid <= 0) {
-    throw Napi::Error::New(env, "Invalid pid");
+    throw NativeError("Invalid pid");
   }
 
   char path[1024];
@@ -22,7 +25,7 @@ std::string getProcessPath(pid_t pid, Napi::Env env) {
 
   ssize_t len = readlink(proc_path, path, sizeof(path) - 1);
   if (len == -1) {
-    throw Napi::Error::New(env, "Failed to get process path");
+    throw NativeError("Failed to get process path");
   }
   path[len] = '\0';
   return std::string(path);
@@ -35,102 +38,249 @@ static Napi::Boolean isProcessElevated(const Napi::CallbackInfo& info) {
   return Napi::Boolean::New(env, getuid() == 0);
 }
 
-static Napi::Object getProcessInfo(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
+// Large enough for status of any process
+static const size_t STATUS_FILE_SIZE = 8192;
+// stat, statm and smaps_rollup are much smaller
+static const size_t PROC_FILE_SIZE = 2048;
+static const size_t MAX_PROCESSES = 10000;
 
-  GET_UINT_32(info, 0, pid, pid_t);
+struct ProcessInfoData {
+  pid_t pid;
+  std::string path;
+  ProcessStat stat;
+  uint64_t residentBytes;
+  uint64_t peakResidentBytes;
+  uint64_t privateBytes;
+  uint64_t proportionalBytes;
+  uint64_t virtualBytes;
+};
+
+// Skips count space separated fields
+static const char* skipFields(const char* it, int count) {
+  for (int i = 0; i < count && it; ++i) {
+    it = strchr(it, ' ');
+    if (it) {
+      ++it;
+    }
+  }
+  return it;
+}
+
+// Value of a "Name:   123" line or fallback if there's no such line
+static uint64_t findValue(const char* content, const char* name, uint64_t fallback) {
+  const char* line = strstr(content, name);
+  // Names are matched at the beginning of a line only, so Pss doesn't match SwapPss
+  while (line && line != content && line[-1] != '\n') {
+    line = strstr(line + 1, name);
+  }
+  return line ? strtoull(line + strlen(name), nullptr, 10) : fallback;
+}
+
+// Value of a "Name:   123 kB" line in bytes
+static uint64_t findKbValue(const char* content, const char* name, uint64_t fallback) {
+  uint64_t kb = findValue(content, name, UINT64_MAX);
+  return kb == UINT64_MAX ? fallback : kb * 1024;
+}
+
+bool readProcessStat(int procFd, pid_t pid, ProcessStat& stat) {
+  char content[PROC_FILE_SIZE];
+  if (readProcFile(procFd, pid, "stat", content, sizeof(content)) <= 0) {
+    return false;
+  }
+  // comm may contain spaces and parentheses, the fields after it start with the last ')'
+  const char* it = strrchr(content, ')');
+  // ") S ppid", ppid is field 4, utime and stime 14 and 15, num_threads 20, starttime 22
+  it = skipFields(it, 2);
+  if (!it) {
+    return false;
+  }
+  char* end;
+  stat = ProcessStat();
+  stat.ppid = strtoll(it, &end, 10);
+  it = skipFields(end + 1, 9);
+  stat.utime = it ? strtoull(it, &end, 10) : 0;
+  stat.stime = it ? strtoull(end, &end, 10) : 0;
+  it = it ? skipFields(end + 1, 4) : nullptr;
+  stat.threadCount = it ? strtoll(it, &end, 10) : 0;
+  it = it ? skipFields(end + 1, 1) : nullptr;
+  stat.startTime = it ? strtoull(it, nullptr, 10) : 0;
+  return true;
+}
 
+bool readProcessStatm(int procFd, pid_t pid, ProcessStatm& statm) {
+  char content[PROC_FILE_SIZE];
+  if (readProcFile(procFd, pid, "statm", content, sizeof(content)) <= 0) {
+    return false;
+  }
+  static const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+  char* end;
+  // size resident shared ..., in pages
+  statm.virtualBytes = strtoull(content, &end, 10) * pageSize;
+  statm.residentBytes = strtoull(end, &end, 10) * pageSize;
+  statm.sharedBytes = strtoull(end, nullptr, 10) * pageSize;
+  return true;
+}
+
+bool readProcessRollup(int procFd, pid_t pid, uint64_t& proportionalBytes, uint64_t& privateBytes) {
+  char content[PROC_FILE_SIZE];
+  if (readProcFile(procFd, pid, "smaps_rollup", content, sizeof(content)) <= 0) {
+    return false;
+  }
+  proportionalBytes = findKbValue(content, "Pss:", 0);
+  privateBytes = findKbValue(content, "Private_Clean:", 0) + findKbValue(content, "Private_Dirty:", 0);
+  return true;
+}
+
+bool readProcessIo(int procFd, pid_t pid, uint64_t& readBytes, uint64_t& writeBytes) {
+  char content[PROC_FILE_SIZE];
+  if (readProcFile(procFd, pid, "io", content, sizeof(content)) <= 0) {
+    return false;
+  }
+  readBytes = findValue(content, "read_bytes:", 0);
+  writeBytes = findValue(content, "write_bytes:", 0);
+  return true;
+}
+
+// Parses stat, statm, status and smaps_rollup of pid where they were read, nothing is allocated but the path.
+// smaps_rollup is only readable by the owner of the process, then memory is estimated from statm
+static ProcessInfoData readProcessInfo(int procFd, pid_t pid) {
   if (pid <= 0) {
-    throw Napi::Error::New(env, "Invalid pid");
+    throw NativeError("Invalid pid");
+  }
+  ProcessInfoData data{pid};
+  if (!readProcessStat(procFd, pid, data.stat)) {
+    throw NativeError("Failed to open process stat file");
   }
 
-  Napi::Object result = Napi::Object::New(env);
+  ProcessStatm statm = {};
+  readProcessStatm(procFd, pid, statm);
+  data.residentBytes = statm.residentBytes;
+  data.virtualBytes = statm.virtualBytes;
+  data.peakResidentBytes = statm.residentBytes;
+  char content[STATUS_FILE_SIZE];
+  if (readProcFile(procFd, pid, "status", content, sizeof(content)) > 0) {
+    data.peakResidentBytes = findKbValue(content, "VmHWM:", statm.residentBytes);
+  }
+  if (!readProcessRollup(procFd, pid, data.proportionalBytes, data.privateBytes)) {
+    data.proportionalBytes = statm.residentBytes;
+    data.privateBytes = statm.residentBytes > statm.sharedBytes ? statm.residentBytes - statm.sharedBytes : 0;
+  }
+
+  data.path = getProcessPath(pid);
+  return data;
+}
 
-  // Get process path
-  std::string path = getProcessPath(pid, env);
-  result.Set("path", Napi::String::New(env, path));
-
-  // Get basic info from /proc/[pid]/stat
-  char stat_path[1024];
-  snprintf(stat_path, sizeof(stat_path), "/proc/%d/stat", pid);
-
-  std::ifstream stat_file(stat_path);
-  if (!stat_file.is_open()) {
-    throw Napi::Error::New(env, "Failed to open process stat file");
-  }
-
-  std::string stat_line;
-  std::getline(stat_file, stat_line);
-  std::istringstream stat_stream(stat_line);
-
-  std::string token;
-  // Skip first token (comm)
-  stat_stream >> token;
-
-  // Parse stat fields
-  char state;
-  long ppid;
-  stat_stream >> state >> ppid;
-
-  // Skip to utime, stime, cutime, cstime (fields 14-17)
-  for (int i = 4; i < 14; ++i) stat_stream >> token;
-
-  unsigned long utime, stime, cutime, cstime;
-  stat_stream >> utime >> stime >> cutime >> cstime;
-
-  // Get memory info from /proc/[pid]/status
-  char status_path[1024];
-  snprintf(status_path, sizeof(status_path), "/proc/%d/status", pid);
-
-  std::ifstream status_file(status_path);
-  unsigned long memoryUsage = 0;
-  int threadCount = 0;
-
-  if (status_file.is_open()) {
-    std::string line;
-    while (std::getline(status_file, line)) {
-      if (line.substr(0, 6) == "VmRSS:") {
-        std::istringstream iss(line);
-        std::string label;
-        iss >> label >> memoryUsage; // in KB
-      } else if (line.substr(0, 8) == "Threads:") {
-        std::istringstream iss(line);
-        std::string label;
-        iss >> label >> threadCount;
-      }
+static ProcessInfoData readProcessInfo(pid_t pid) {
+  ProcDirectory proc;
+  return readProcessInfo(proc.fd, pid);
+}
+
+// Processes that are gone or not readable are skipped
+static std::vector<ProcessInfoData> readProcessesInfo(const std::vector<pid_t>& pids) {
+  ProcDirectory proc;
+  std::vector<ProcessInfoData> result;
+  result.reserve(pids.size());
+  for (pid_t pid : pids) {
+    try {
+      result.push_back(readProcessInfo(proc.fd, pid));
+    } catch (const NativeError&) {
     }
   }
+  return result;
+}
+
+double bootTime() {
+  struct timespec now, sinceBoot;
+  clock_gettime(CLOCK_REALTIME, &now);
+  clock_gettime(CLOCK_BOOTTIME, &sinceBoot);
+  return static_cast<double>(now.tv_sec - sinceBoot.tv_sec) + (now.tv_nsec - sinceBoot.tv_nsec) / 1e9;
+}
+
+static Napi::Value processInfoToObject(Napi::Env env, const ProcessInfoData& data) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("path", Napi::String::New(env, data.path));
 
   // Set result properties
-  result.Set("pid", Napi::Number::New(env, pid));
-  result.Set("parentPid", Napi::Number::New(env, ppid));
-  result.Set("threadCount", Napi::Number::New(env, threadCount));
+  result.Set("pid", Napi::Number::New(env, data.pid));
+  result.Set("parentPid", Napi::Number::New(env, static_cast<double>(data.stat.ppid)));
+  result.Set("threadCount", Napi::Number::New(env, static_cast<double>(data.stat.threadCount)));
 
-  // Memory object
   Napi::Object memory = Napi::Object::New(env);
-  memory.Set("workingSetSize", Napi::Number::New(env, static_cast<double>(memoryUsage * 1024))); // Convert KB to bytes
-  memory.Set("peakWorkingSetSize", Napi::Number::New(env, static_cast<double>(memoryUsage * 1024)));
-  memory.Set("privateUsage", Napi::Number::New(env, static_cast<double>(memoryUsage * 1024)));
-  memory.Set("pageFileUsage", Napi::Number::New(env, static_cast<double>(memoryUsage * 1024)));
-  // Use RSS as approximation
+  memory.Set("workingSetSize", Napi::Number::New(env, static_cast<double>(data.residentBytes)));
+  memory.Set("peakWorkingSetSize", Napi::Number::New(env, static_cast<double>(data.peakResidentBytes)));
+  memory.Set("privateUsage", Napi::Number::New(env, static_cast<double>(data.privateBytes)));
+  memory.Set("pageFileUsage", Napi::Number::New(env, static_cast<double>(data.virtualBytes)));
+  memory.Set("proportionalSetSize", Napi::Number::New(env, static_cast<double>(data.proportionalBytes)));
   result.Set("memory", memory);
 
   // Times object (convert clock ticks to milliseconds)
-  long clockTicksPerSec = sysconf(_SC_CLK_TCK);
+  double clockTicksPerSec = static_cast<double>(sysconf(_SC_CLK_TCK));
+  // Same as on Windows: 100 nanosecond intervals since 1601-01-01
+  double startedAt = bootTime() + data.stat.startTime / clockTicksPerSec;
   Napi::Object times = Napi::Object::New(env);
-  times.Set("creationTime", Napi::Number::New(env, 0.0)); // Not easily available
-  times.Set("kernelTime", Napi::Number::New(env, static_cast<double>(stime * 1000 / clockTicksPerSec)));
-  times.Set("userTime", Napi::Number::New(env, static_cast<double>(utime * 1000 / clockTicksPerSec)));
+  times.Set("creationTime", Napi::Number::New(env, (startedAt + 11644473600.0) * 1e7));
+  times.Set("kernelTime", Napi::Number::New(env, static_cast<double>(data.stat.stime) * 1000 / clockTicksPerSec));
+  times.Set("userTime", Napi::Number::New(env, static_cast<double>(data.stat.utime) * 1000 / clockTicksPerSec));
   result.Set("times", times);
 
   // Check if process is elevated (same as current process)
-  result.Set("isElevated", isProcessElevated(info));
+  result.Set("isElevated", Napi::Boolean::New(env, getuid() == 0));
 
   return result;
 }
 
+static Napi::Value processesInfoToArray(Napi::Env env, const std::vector<ProcessInfoData>& processes) {
+  Napi::Array array = Napi::Array::New(env, processes.size());
+  for (size_t i = 0; i < processes.size(); ++i) {
+    array.Set(static_cast<uint32_t>(i), processInfoToObject(env, processes[i]));
+  }
+  return array;
+}
+
+static std::vector<pid_t> parsePids(const Napi::CallbackInfo& info) {
+  ASSERT_ARRAY(info, 0);
+  Napi::Array array = info[0].As<Napi::Array>();
+  if (array.Length() > MAX_PROCESSES) {
+    throw Napi::RangeError::New(info.Env(), "At most " + std::to_string(MAX_PROCESSES) + " pids can be read at once");
+  }
+  std::vector<pid_t> pids;
+  pids.reserve(array.Length());
+  for (uint32_t i = 0; i < array.Length(); ++i) {
+    Napi::Value pid = array.Get(i);
+    if (!pid.IsNumber()) {
+      throw Napi::TypeError::New(info.Env(), "Pids must be numbers");
+    }
+    pids.push_back(static_cast<pid_t>(pid.As<Napi::Number>().Int32Value()));
+  }
+  return pids;
+}
+
+static Napi::Value getProcessInfo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  GET_UINT_32(info, 0, pid, pid_t);
+
+  return processInfoToObject(env, callNative(env, [=] { return readProcessInfo(pid); }));
+}
+
+static Napi::Value getProcessInfoAsync(const Napi::CallbackInfo& info) {
+  GET_UINT_32(info, 0, pid, pid_t);
+
+  return runOnQueue<ProcessInfoData>(addonData().processQueue, info.Env(), [=] { return readProcessInfo(pid); },
+    processInfoToObject);
+}
+
+static Napi::Value getProcessesInfoAsync(const Napi::CallbackInfo& info) {
+  std::vector<pid_t> pids = parsePids(info);
+
+  return runOnQueue<std::vector<ProcessInfoData>>(addonData().processQueue, info.Env(),
+    [pids] { return readProcessesInfo(pids); }, processesInfoToArray);
+}
+
 Napi::Object processInit(Napi::Env env, Napi::Object exports) {
   exports.Set(Napi::String::New(env, "isProcessElevated"), Napi::Function::New(env, isProcessElevated));
   exports.Set(Napi::String::New(env, "getProcessInfo"), Napi::Function::New(env, getProcessInfo));
+  exports.Set(Napi::String::New(env, "getProcessInfoAsync"), Napi::Function::New(env, getProcessInfoAsync));
+  exports.Set(Napi::String::New(env, "getProcessesInfoAsync"), Napi::Function::New(env, getProcessesInfoAsync));
   return exports;
 }
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include "./headers/screen-stream.h"
+#include "./headers/addon-data.h"
+#include "./headers/image-encode.h"
+#include "./headers/native-queue.h"
+#include "./headers/validators.h"
+#include <algorithm>
+#include <cstring>
+
+static const int MIN_TILE_SIZE = 16;
+static const int MAX_TILE_SIZE = 1024;
+static const int MAX_FPS = 60;
+
+// Damage handed from the damage thread to the JS thread
+struct StreamDamage {
+  uint32_t id;
+  DamageTiles tiles;
+};
+
+// Damaged tiles of every row merged into runs, in stream area coordinates
+static std::vector<CaptureRect> damagedRects(const DamageTiles& tiles) {
+  std::vector<CaptureRect> rects;
+  for (int row = 0; row < tiles.rows; row++) {
+    const uint8_t* flags = tiles.dirty.data() + static_cast<size_t>(row) * tiles.columns;
+    int column = 0;
+    while (column < tiles.columns) {
+      if (!flags[column]) {
+        column++;
+        continue;
+      }
+      int first = column;
+      while (column < tiles.columns && flags[column]) {
+        column++;
+      }
+      int x = first * tiles.tileSize;
+      int y = row * tiles.tileSize;
+      rects.push_back({x, y, std::min(column * tiles.tileSize, tiles.area.width) - x,
+        std::min(y + tiles.tileSize, tiles.area.height) - y});
+    }
+  }
+  return rects;
+}
+
+static CaptureRect boundingRect(const std::vector<CaptureRect>& rects) {
+  int left = INT32_MAX, top = INT32_MAX, right = INT32_MIN, bottom = INT32_MIN;
+  for (const CaptureRect& rect : rects) {
+    left = std::min(left, rect.x);
+    top = std::min(top, rect.y);
+    right = std::max(right, rect.x + rect.width);
+    bottom = std::max(bottom, rect.y + rect.height);
+  }
+  return {left, top, right - left, bottom - top};
+}
+
+// frame holds the bounding box of rects, screen is the last frame in frames mode and nullptr in tiles mode
+static StreamFrame encodeStreamFrame(CaptureFrame& frame, const CaptureRect& area, const CaptureRect& bounds,
+  const std::vector<CaptureRect>& rects, bool full, const ScreenStreamOptions& options, std::vector<uint8_t>* screen,
+  WorkerPool& pool) {
+  if (frame.rect.x != area.x + bounds.x || frame.rect.y != area.y + bounds.y ||
+    frame.rect.width != bounds.width || frame.rect.height != bounds.height) {
+    throw NativeError("Stream area is not on the screen anymore, the stream must be reopened");
+  }
+  ImageEncodeOptions encodeOptions;
+  encodeOptions.format = ImageFormat::Jpeg;
+  encodeOptions.quality = options.quality;
+  StreamFrame result;
+  result.full = full;
+
+  if (screen) {
+    uint32_t screenStride = static_cast<uint32_t>(area.width) * 4;
+    for (int y = 0; y < bounds.height; y++) {
+      memcpy(screen->data() + static_cast<size_t>(bounds.y + y) * screenStride + static_cast<size_t>(bounds.x) * 4,
+        frame.data() + static_cast<size_t>(y) * frame.stride, static_cast<size_t>(bounds.width) * 4);
+    }
+    RawImage image = {screen->data(), static_cast<uint32_t>(area.width), static_cast<uint32_t>(area.height), screenStride};
+    result.tiles.push_back({{0, 0, area.width, area.height}, encodeImage(image, encodeOptions, pool).data});
+    return result;
+  }
+
+  result.tiles.resize(rects.size());
+  pool.parallelFor(rects.size(), [&](size_t i) {
+    const CaptureRect& rect = rects[i];
+    RawImage image = {
+      frame.data() + static_cast<size_t>(rect.y - bounds.y) * frame.stride + static_cast<size_t>(rect.x - bounds.x) * 4,
+      static_cast<uint32_t>(rect.width),
+      static_cast<uint32_t>(rect.height),
+      frame.stride,
+    };
+    result.tiles[i] = {rect, encodeImage(image, encodeOptions, pool).data};
+  });
+  return result;
+}
+
+// Tile bytes are handed to JS without a copy, every vector lives until its Buffer is garbage collected
+static Napi::Value streamFrameToObject(Napi::Env env, StreamFrame& frame) {
+  Napi::Array tiles = Napi::Array::New(env, frame.tiles.size());
+  for (size_t i = 0; i < frame.tiles.size(); i++) {
+    StreamTile& tile = frame.tiles[i];
+    std::vector<uint8_t>* bytes = new std::vector<uint8_t>(std::move(tile.data));
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("x", tile.rect.x);
+    obj.Set("y", tile.rect.y);
+    obj.Set("width", tile.rect.width);
+    obj.Set("height", tile.rect.height);
+    obj.Set("data", Napi::Buffer<uint8_t>::New(
+      env, bytes->data(), bytes->size(), [](Napi::Env, uint8_t*, std::vector<uint8_t>* hint) { delete hint; }, bytes));
+    tiles.Set(i, obj);
+  }
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("full", frame.full);
+  result.Set("tiles", tiles);
+  return result;
+}
+
+static void deliverDamage(Napi::Env env, Napi::Function, StreamDamage* damage) {
+  std::unique_ptr<StreamDamage> owned(damage);
+  if (env == nullptr) {
+    return;
+  }
+  AddonData& data = addonData();
+  ScreenStreams& registry = data.screenStreams;
+  auto it = registry.streams.find(damage->id);
+  // Closed meanwhile
+  if (it == registry.streams.end() || !it->second->pending) {
+    return;
+  }
+  ScreenStream& stream = *it->second;
+  Napi::Promise::Deferred deferred = *stream.pending;
+  stream.pending.reset();
+  stream.lastFrame = std::chrono::steady_clock::now();
+  if (--registry.pendingFrames == 0) {
+    registry.damaged.Unref(env);
+  }
+
+  auto rects = std::make_shared<std::vector<CaptureRect>>(damagedRects(damage->tiles));
+  bool full = std::all_of(damage->tiles.dirty.begin(), damage->tiles.dirty.end(), [](uint8_t flag) { return flag; });
+  CaptureRect area = stream.area;
+  CaptureRect bounds = boundingRect(*rects);
+  CaptureTarget target;
+  target.type = CaptureTarget::Type::Rect;
+  target.rect = {area.x + bounds.x, area.y + bounds.y, bounds.width, bounds.height};
+  ScreenStreamOptions options = stream.options;
+  std::shared_ptr<std::vector<uint8_t>> screen = stream.screen;
+  // Same chain as captureImageAsync: the capture promise adopts the encoding one
+  deferred.Resolve(runOnNativeQueue<CaptureFrame>(env, [target] { return captureScreen(target); },
+    [=](Napi::Env env, CaptureFrame& captured) -> Napi::Value {
+      std::shared_ptr<CaptureFrame> frame = std::make_shared<CaptureFrame>(std::move(captured));
+      AddonData& data = addonData();
+      WorkerPool* pool = &data.encodeWorkers;
+      return runOnQueue<StreamFrame>(data.encodeQueue, env, [=] {
+        StreamFrame encoded = encodeStreamFrame(*frame, area, bounds, *rects, full, options, screen.get(), *pool);
+        *frame = CaptureFrame();
+        return encoded;
+      }, streamFrameToObject);
+    }));
+}
+
+static void closeScreenStreams(void* arg) {
+  AddonData* data = static_cast<AddonData*>(arg);
+  for (auto& entry : data->screenStreams.streams) {
+    data->damageWatcher.unsubscribe(entry.second->subscription);
+  }
+  data->screenStreams.streams.clear();
+  data->screenStreams.damaged.Release();
+}
+
+// openScreenStream(target?, {tiles, tileSize, quality, maxFps}) returns {id, x, y, width, height} of a stream of
+// the target area clipped to the screen. Frames are requested with nextScreenFrameAsync and the stream must be closed with closeScreenStream
+static Napi::Value openScreenStream(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  CaptureTarget target = parseCaptureTarget(info, 0);
+  GET_OBJECT(info, 1, object);
+  ScreenStreamOptions options;
+  options.tiles = object.Get("tiles").ToBoolean();
+  options.tileSize = getIntOption(env, object, "tileSize", MIN_TILE_SIZE, MAX_TILE_SIZE, options.tileSize);
+  options.quality = getIntOption(env, object, "quality", 1, 100, options.quality);
+  options.minInterval = std::chrono::milliseconds(1000 / getIntOption(env, object, "maxFps", 1, MAX_FPS, 10));
+  CaptureRect area = callNative(env, [&] { return resolveCaptureTarget(target); });
+
+  AddonData& data = addonData();
+  ScreenStreams& registry = data.screenStreams;
+  if (static_cast<napi_threadsafe_function>(registry.damaged) == nullptr) {
+    registry.damaged = Napi::ThreadSafeFunction::New(
+      env, Napi::Function::New(env, [](const Napi::CallbackInfo&) {}), "screenStreamDamage", 0, 1);
+    registry.damaged.Unref(env);
+    napi_add_env_cleanup_hook(env, closeScreenStreams, &data);
+  }
+  data.encodeWorkers.start(env);
+
+  std::unique_ptr<ScreenStream> stream(new ScreenStream());
+  uint32_t id = registry.nextId++;
+  stream->id = id;
+  stream->area = area;
+  stream->options = options;
+  ScreenStreams* streams = &registry;
+  stream->subscription = std::make_shared<DamageSubscription>(area, options.tileSize, [streams, id](DamageTiles&& tiles) {
+    StreamDamage* damage = new StreamDamage{id, std::move(tiles)};
+    if (streams->damaged.NonBlockingCall(damage, deliverDamage) != napi_ok) {
+      delete damage;
+    }
+  });
+  if (!options.tiles) {
+    stream->screen = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(area.width) * area.height * 4);
+  }
+  data.damageWatcher.subscribe(env, stream->subscription);
+  registry.streams.emplace(id, std::move(stream));
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("id", id);
+  result.Set("x", area.x);
+  result.Set("y", area.y);
+  result.Set("width", area.width);
+  result.Set("height", area.height);
+  return result;
+}
+
+// nextScreenFrameAsync(id, full) resolves with {full, tiles: [{x, y, width, height, data: JPEG Buffer}]} once the
+// stream area has changed since the previous frame, but not sooner than 1 / maxFps after it. Tiles are in stream area
+// coordinates, frames mode always sends one tile of the whole area. full asks for every tile, e.g. for a new viewer
+static Napi::Value nextScreenFrameAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_UINT_32(info, 0, id, uint32_t);
+  GET_BOOL(info, 1, full);
+  AddonData& data = addonData();
+  ScreenStreams& registry = data.screenStreams;
+  auto it = registry.streams.find(id);
+  if (it == registry.streams.end()) {
+    throw Napi::Error::New(env, "Screen stream " + std::to_string(id) + " is not open");
+  }
+  ScreenStream& stream = *it->second;
+  if (stream.pending) {
+    throw Napi::Error::New(env, "Previous frame of screen stream " + std::to_string(id) + " is not resolved yet");
+  }
+  // Last frame of frames mode is empty until the whole area is captured once
+  if (stream.screen && stream.lastFrame == std::chrono::steady_clock::time_point()) {
+    full = true;
+  }
+  stream.pending = Napi::Promise::Deferred::New(env);
+  if (registry.pendingFrames++ == 0) {
+    registry.damaged.Ref(env);
+  }
+  data.damageWatcher.request(stream.subscription, full, stream.lastFrame + stream.options.minInterval);
+  return stream.pending->Promise();
+}
+
+// closeScreenStream(id) stops damage tracking of the stream, its pending frame is rejected
+static Napi::Value closeScreenStream(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_UINT_32(info, 0, id, uint32_t);
+  AddonData& data = addonData();
+  ScreenStreams& registry = data.screenStreams;
+  auto it = registry.streams.find(id);
+  if (it == registry.streams.end()) {
+    return env.Undefined();
+  }
+  ScreenStream& stream = *it->second;
+  data.damageWatcher.unsubscribe(stream.subscription);
+  if (stream.pending) {
+    stream.pending->Reject(Napi::Error::New(env, "Screen stream " + std::to_string(id) + " is closed").Value());
+    if (--registry.pendingFrames == 0) {
+      registry.damaged.Unref(env);
+    }
+  }
+  registry.streams.erase(it);
+  return env.Undefined();
+}
+
+Napi::Object screenStreamInit(Napi::Env env, Napi::Object exports) {
+  exports.Set("openScreenStream", Napi::Function::New(env, openScreenStream));
+  exports.Set("nextScreenFrameAsync", Napi::Function::New(env, nextScreenFrameAsync));
+  exports.Set("closeScreenStream", Napi::Function::New(env, closeScreenStream));
+  return exports;
+}
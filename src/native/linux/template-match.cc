@@ -0,0 +1,389 @@
+#include "./headers/template-match.h"
+#include "./headers/addon-data.h"
+#include "./headers/capture.h"
+#include "./headers/native-queue.h"
+#include "./headers/validators.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Template side at the coarsest pyramid level, smaller ones match everything
+static const uint32_t MIN_PYRAMID_SIDE = 8;
+static const size_t MAX_PYRAMID_LEVELS = 4;
+// Rows of positions searched by one pool task at the coarsest level
+static const uint32_t SEARCH_BAND_ROWS = 4;
+// Positions checked around a coarse candidate on every finer level, and around the last hit
+static const int REFINE_RADIUS = 2;
+static const int LAST_HIT_RADIUS = 4;
+
+struct Candidate {
+  int x;
+  int y;
+  uint32_t sad;
+};
+
+// FNV-1a of the template size and pixels
+static uint64_t templateKey(const GrayImage& image) {
+  uint64_t hash = 1469598103934665603ull;
+  auto mix = [&hash](uint8_t byte) {
+    hash ^= byte;
+    hash *= 1099511628211ull;
+  };
+  for (int i = 0; i < 4; i++) {
+    mix(static_cast<uint8_t>(image.width >> (i * 8)));
+    mix(static_cast<uint8_t>(image.height >> (i * 8)));
+  }
+  for (uint8_t pixel : image.pixels) {
+    mix(pixel);
+  }
+  return hash;
+}
+
+static GrayImage halveImage(const GrayImage& src) {
+  GrayImage dst;
+  dst.width = src.width / 2;
+  dst.height = src.height / 2;
+  dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height);
+  for (uint32_t y = 0; y < dst.height; y++) {
+    const uint8_t* top = &src.pixels[static_cast<size_t>(y) * 2 * src.width];
+    const uint8_t* bottom = top + src.width;
+    uint8_t* out = &dst.pixels[static_cast<size_t>(y) * dst.width];
+    for (uint32_t x = 0; x < dst.width; x++) {
+      out[x] = static_cast<uint8_t>((top[x * 2] + top[x * 2 + 1] + bottom[x * 2] + bottom[x * 2 + 1] + 2) >> 2);
+    }
+  }
+  return dst;
+}
+
+// Sum of absolute differences of the template placed at x, y.
+// Stops as soon as a row pushes the sum over limit, the result is then only known to be larger than it
+static uint32_t sumOfDifferences(const GrayImage& screen, const GrayImage& tmpl, int x, int y, uint32_t limit) {
+  uint32_t sum = 0;
+  for (uint32_t row = 0; row < tmpl.height; row++) {
+    const uint8_t* s = &screen.pixels[static_cast<size_t>(y + row) * screen.width + x];
+    const uint8_t* t = &tmpl.pixels[static_cast<size_t>(row) * tmpl.width];
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= tmpl.width; i += 16) {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(t + i));
+      acc = _mm_add_epi64(acc, _mm_sad_epu8(a, b));
+    }
+    sum += static_cast<uint32_t>(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+#endif
+    for (; i < tmpl.width; i++) {
+      sum += static_cast<uint32_t>(abs(s[i] - t[i]));
+    }
+    if (sum > limit) {
+      return sum;
+    }
+  }
+  return sum;
+}
+
+// Zero mean normalized cross-correlation, robust to brightness and contrast changes.
+// Flat templates have no variance to correlate with, they are scored by their mean difference instead
+static double matchScore(const GrayImage& screen, const GrayImage& tmpl, int x, int y) {
+  double n = static_cast<double>(tmpl.width) * tmpl.height;
+  uint64_t sumS = 0, sumT = 0, sumSS = 0, sumTT = 0, sumST = 0, sad = 0;
+  for (uint32_t row = 0; row < tmpl.height; row++) {
+    const uint8_t* s = &screen.pixels[static_cast<size_t>(y + row) * screen.width + x];
+    const uint8_t* t = &tmpl.pixels[static_cast<size_t>(row) * tmpl.width];
+    uint32_t rowS = 0, rowT = 0, rowSS = 0, rowTT = 0, rowST = 0, rowSad = 0;
+    for (uint32_t i = 0; i < tmpl.width; i++) {
+      rowS += s[i];
+      rowT += t[i];
+      rowSS += s[i] * s[i];
+      rowTT += t[i] * t[i];
+      rowST += s[i] * t[i];
+      rowSad += static_cast<uint32_t>(abs(s[i] - t[i]));
+    }
+    sumS += rowS;
+    sumT += rowT;
+    sumSS += rowSS;
+    sumTT += rowTT;
+    sumST += rowST;
+    sad += rowSad;
+  }
+  double varianceT = n * sumTT - static_cast<double>(sumT) * sumT;
+  double varianceS = n * sumSS - static_cast<double>(sumS) * sumS;
+  if (varianceT < n) {
+    return 1.0 - sad / (255.0 * n);
+  }
+  if (varianceS < n) {
+    return 0;
+  }
+  double ncc = (n * sumST - static_cast<double>(sumS) * sumT) / std::sqrt(varianceT * varianceS);
+  return std::max(0.0, std::min(1.0, ncc));
+}
+
+// Position with the smallest difference within radius of x, y
+static Candidate refine(const GrayImage& screen, const GrayImage& tmpl, int x, int y, int radius) {
+  int maxX = static_cast<int>(screen.width - tmpl.width);
+  int maxY = static_cast<int>(screen.height - tmpl.height);
+  Candidate best = {std::min(std::max(x, 0), maxX), std::min(std::max(y, 0), maxY), UINT32_MAX};
+  for (int cy = std::max(y - radius, 0); cy <= std::min(y + radius, maxY); cy++) {
+    for (int cx = std::max(x - radius, 0); cx <= std::min(x + radius, maxX); cx++) {
+      uint32_t sad = sumOfDifferences(screen, tmpl, cx, cy, best.sad);
+      if (sad < best.sad) {
+        best = {cx, cy, sad};
+      }
+    }
+  }
+  return best;
+}
+
+// Keeps the best candidates that are at least half a template apart
+static std::vector<Candidate> suppressNeighbours(std::vector<Candidate> candidates, uint32_t width, uint32_t height,
+  size_t limit) {
+  std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.sad < b.sad; });
+  std::vector<Candidate> kept;
+  for (const Candidate& candidate : candidates) {
+    bool overlaps = std::any_of(kept.begin(), kept.end(), [&](const Candidate& other) {
+      return static_cast<uint32_t>(abs(other.x - candidate.x)) * 2 < width &&
+        static_cast<uint32_t>(abs(other.y - candidate.y)) * 2 < height;
+    });
+    if (!overlaps) {
+      kept.push_back(candidate);
+      if (kept.size() == limit) {
+        break;
+      }
+    }
+  }
+  return kept;
+}
+
+// Exhaustive search of the coarsest level. Bands of rows are claimed by the pool threads as they get free,
+// so a thread that got an expensive band doesn't hold the others. Every band keeps its own best candidates
+// and skips positions as soon as they get worse than all of them
+static std::vector<Candidate> searchCoarse(const GrayImage& screen, const GrayImage& tmpl, size_t keep,
+  WorkerPool& pool) {
+  uint32_t rows = screen.height - tmpl.height + 1;
+  int maxX = static_cast<int>(screen.width - tmpl.width);
+  size_t bands = (rows + SEARCH_BAND_ROWS - 1) / SEARCH_BAND_ROWS;
+  std::vector<std::vector<Candidate>> found(bands);
+  pool.parallelFor(bands, [&](size_t band) {
+    std::vector<Candidate>& best = found[band];
+    uint32_t first = static_cast<uint32_t>(band) * SEARCH_BAND_ROWS;
+    uint32_t last = std::min(first + SEARCH_BAND_ROWS, rows);
+    for (uint32_t y = first; y < last; y++) {
+      for (int x = 0; x <= maxX; x++) {
+        uint32_t limit = best.size() == keep ? best.back().sad : UINT32_MAX;
+        uint32_t sad = sumOfDifferences(screen, tmpl, x, static_cast<int>(y), limit);
+        if (sad >= limit) {
+          continue;
+        }
+        Candidate candidate = {x, static_cast<int>(y), sad};
+        auto position = std::upper_bound(best.begin(), best.end(), candidate,
+          [](const Candidate& a, const Candidate& b) { return a.sad < b.sad; });
+        best.insert(position, candidate);
+        if (best.size() > keep) {
+          best.pop_back();
+        }
+      }
+    }
+  });
+  std::vector<Candidate> all;
+  for (const std::vector<Candidate>& band : found) {
+    all.insert(all.end(), band.begin(), band.end());
+  }
+  return all;
+}
+
+std::vector<TemplateMatch> findTemplate(const GrayImage& screen, int originX, int originY,
+  const TemplateSearch& search, TemplateHits& hits, WorkerPool& pool) {
+  const GrayImage& tmpl = search.image;
+  if (tmpl.width > screen.width || tmpl.height > screen.height) {
+    throw NativeError("Template is larger than the search region");
+  }
+  uint64_t key = templateKey(tmpl);
+  auto remember = [&](const std::vector<TemplateMatch>& matches) {
+    if (!matches.empty()) {
+      std::lock_guard<std::mutex> lock(hits.mutex);
+      hits.positions[key] = {matches[0].x, matches[0].y};
+    }
+    return matches;
+  };
+
+  // UI elements tend to stay where they were, a single check near the last hit avoids the whole search
+  if (search.maxResults == 1) {
+    std::pair<int, int> last = {0, 0};
+    bool known;
+    {
+      std::lock_guard<std::mutex> lock(hits.mutex);
+      auto it = hits.positions.find(key);
+      known = it != hits.positions.end();
+      if (known) {
+        last = it->second;
+      }
+    }
+    int lastX = last.first - originX;
+    int lastY = last.second - originY;
+    if (known && lastX >= 0 && lastY >= 0 && static_cast<uint32_t>(lastX) + tmpl.width <= screen.width &&
+      static_cast<uint32_t>(lastY) + tmpl.height <= screen.height) {
+      Candidate near = refine(screen, tmpl, lastX, lastY, LAST_HIT_RADIUS);
+      double score = matchScore(screen, tmpl, near.x, near.y);
+      if (score >= search.threshold) {
+        return remember({{near.x + originX, near.y + originY, tmpl.width, tmpl.height, score}});
+      }
+    }
+  }
+
+  std::vector<GrayImage> screens;
+  std::vector<GrayImage> templates;
+  const GrayImage* levelScreen = &screen;
+  const GrayImage* levelTemplate = &tmpl;
+  while (screens.size() + 1 < MAX_PYRAMID_LEVELS &&
+    levelTemplate->width / 2 >= MIN_PYRAMID_SIDE && levelTemplate->height / 2 >= MIN_PYRAMID_SIDE) {
+    screens.push_back(halveImage(*levelScreen));
+    templates.push_back(halveImage(*levelTemplate));
+    levelScreen = &screens.back();
+    levelTemplate = &templates.back();
+  }
+
+  // Coarse levels blur small differences, so more candidates are kept than asked for
+  size_t keep = std::max<size_t>(search.maxResults * 4, 16);
+  std::vector<Candidate> candidates = suppressNeighbours(
+    searchCoarse(*levelScreen, *levelTemplate, keep, pool), levelTemplate->width, levelTemplate->height, keep);
+
+  std::vector<TemplateMatch> matches(candidates.size());
+  pool.parallelFor(candidates.size(), [&](size_t i) {
+    Candidate candidate = candidates[i];
+    for (size_t level = screens.size(); level-- > 0;) {
+      const GrayImage& finerScreen = level == 0 ? screen : screens[level - 1];
+      const GrayImage& finerTemplate = level == 0 ? tmpl : templates[level - 1];
+      candidate = refine(finerScreen, finerTemplate, candidate.x * 2, candidate.y * 2, REFINE_RADIUS);
+    }
+    matches[i] = {candidate.x, candidate.y, tmpl.width, tmpl.height, matchScore(screen, tmpl, candidate.x, candidate.y)};
+  });
+
+  std::sort(matches.begin(), matches.end(), [](const TemplateMatch& a, const TemplateMatch& b) {
+    return a.score > b.score;
+  });
+  std::vector<TemplateMatch> result;
+  for (const TemplateMatch& match : matches) {
+    if (match.score < search.threshold || result.size() == search.maxResults) {
+      break;
+    }
+    // Different coarse candidates may refine to the same spot
+    bool duplicate = std::any_of(result.begin(), result.end(), [&](const TemplateMatch& other) {
+      return static_cast<uint32_t>(abs(other.x - originX - match.x)) * 2 < tmpl.width &&
+        static_cast<uint32_t>(abs(other.y - originY - match.y)) * 2 < tmpl.height;
+    });
+    if (!duplicate) {
+      result.push_back({match.x + originX, match.y + originY, match.width, match.height, match.score});
+    }
+  }
+  return remember(result);
+}
+
+// Luma of the captured frame, converted in bands on the pool
+static GrayImage frameToGray(CaptureFrame& frame, WorkerPool& pool) {
+  GrayImage gray;
+  gray.width = static_cast<uint32_t>(frame.rect.width);
+  gray.height = static_cast<uint32_t>(frame.rect.height);
+  gray.pixels.resize(static_cast<size_t>(gray.width) * gray.height);
+  const uint8_t* pixels = frame.data();
+  size_t bands = (gray.height + 63) / 64;
+  pool.parallelFor(bands, [&](size_t band) {
+    for (uint32_t y = static_cast<uint32_t>(band) * 64; y < std::min<uint32_t>((band + 1) * 64, gray.height); y++) {
+      bgraToGray(pixels + static_cast<size_t>(y) * frame.stride, &gray.pixels[static_cast<size_t>(y) * gray.width],
+        gray.width);
+    }
+  });
+  return gray;
+}
+
+static Napi::Value matchesToArray(Napi::Env env, std::vector<TemplateMatch>& matches) {
+  Napi::Array result = Napi::Array::New(env, matches.size());
+  for (size_t i = 0; i < matches.size(); i++) {
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("x", matches[i].x);
+    obj.Set("y", matches[i].y);
+    obj.Set("width", matches[i].width);
+    obj.Set("height", matches[i].height);
+    obj.Set("score", matches[i].score);
+    result.Set(i, obj);
+  }
+  return result;
+}
+
+// findTemplateAsync(image: Buffer, {region?, threshold, maxResults}) resolves with [{x, y, width, height, score}],
+// best first. image is a PNG or JPEG file, region is {monitor} or {x, y, width, height} like in captureScreenAsync
+static Napi::Value findTemplateAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsBuffer()) {
+    throw Napi::TypeError::New(env, "Argument 0 must be a Buffer");
+  }
+  GET_OBJECT(info, 1, options);
+  Napi::Buffer<uint8_t> buffer = info[0].As<Napi::Buffer<uint8_t>>();
+  // Copied, the Buffer may be collected while the search runs
+  auto file = std::make_shared<std::vector<uint8_t>>(buffer.Data(), buffer.Data() + buffer.Length());
+
+  CaptureTarget target;
+  Napi::Value region = options.Get("region");
+  if (!region.IsUndefined() && !region.IsNull()) {
+    if (!region.IsObject()) {
+      throw Napi::TypeError::New(env, "region must be an object");
+    }
+    Napi::Object regionObj = region.As<Napi::Object>();
+    if (regionObj.Get("monitor").IsNumber()) {
+      target.type = CaptureTarget::Type::Monitor;
+      target.monitor = regionObj.Get("monitor").ToNumber().Uint32Value();
+    } else {
+      for (const char* key : {"x", "y", "width", "height"}) {
+        if (!regionObj.Get(key).IsNumber()) {
+          throw Napi::TypeError::New(env, std::string("region.") + key + " must be a number");
+        }
+      }
+      target.type = CaptureTarget::Type::Rect;
+      target.rect = {
+        regionObj.Get("x").ToNumber().Int32Value(),
+        regionObj.Get("y").ToNumber().Int32Value(),
+        regionObj.Get("width").ToNumber().Int32Value(),
+        regionObj.Get("height").ToNumber().Int32Value(),
+      };
+    }
+  }
+  if (!options.Get("threshold").IsNumber() || !options.Get("maxResults").IsNumber()) {
+    throw Napi::TypeError::New(env, "threshold and maxResults must be numbers");
+  }
+  double threshold = options.Get("threshold").ToNumber().DoubleValue();
+  uint32_t maxResults = options.Get("maxResults").ToNumber().Uint32Value();
+  if (threshold < 0 || threshold > 1 || maxResults == 0) {
+    throw Napi::RangeError::New(env, "threshold must be in range 0..1 and maxResults must be positive");
+  }
+
+  addonData().encodeWorkers.start(env);
+  return runOnNativeQueue<CaptureFrame>(env, [=] { return captureScreen(target); },
+    [file, threshold, maxResults](Napi::Env env, CaptureFrame& captured) -> Napi::Value {
+      // Matching doesn't use X, like encoding it runs off the native queue
+      std::shared_ptr<CaptureFrame> frame = std::make_shared<CaptureFrame>(std::move(captured));
+      AddonData& data = addonData();
+      WorkerPool* pool = &data.encodeWorkers;
+      TemplateHits* hits = &data.templateHits;
+      return runOnQueue<std::vector<TemplateMatch>>(data.matchQueue, env, [=] {
+        TemplateSearch search;
+        search.image = decodeImageToGray(file->data(), file->size());
+        search.threshold = threshold;
+        search.maxResults = maxResults;
+        int originX = frame->rect.x;
+        int originY = frame->rect.y;
+        GrayImage screen = frameToGray(*frame, *pool);
+        // Segment goes back to the pool before the search
+        *frame = CaptureFrame();
+        return findTemplate(screen, originX, originY, search, *hits, *pool);
+      }, matchesToArray);
+    });
+}
+
+Napi::Object templateMatchInit(Napi::Env env, Napi::Object exports) {
+  exports.Set("findTemplateAsync", Napi::Function::New(env, findTemplateAsync));
+  return exports;
+}
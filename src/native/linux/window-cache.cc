@@ -0,0 +1,383 @@
+#include "./headers/window-cache.h"
+#include "./headers/logger.h"
+#include "./headers/addon-data.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <thread>
+#include <unordered_set>
+#include <xcb/randr.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+static const uint32_t rootEventMask = XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_PROPERTY_CHANGE;
+static const uint32_t clientEventMask = XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_PROPERTY_CHANGE;
+
+// Changes collected from events which require a refresh from the X server
+struct PendingChanges {
+  bool clientList = true;
+  bool activeWindow = true;
+  std::unordered_set<xcb_window_t> windows;
+
+  bool empty() const {
+    return !clientList && !activeWindow && windows.empty();
+  }
+};
+
+// Tracked windows with an index of the WM frames holding them, the event thread owns it
+struct CacheState {
+  WindowCacheSnapshot snapshot;
+  // Frame (parent) -> client, clients that are not reparented are left out
+  std::unordered_multimap<xcb_window_t, xcb_window_t> frames;
+  xcb_window_t rootWindow = XCB_NONE;
+
+  void set(xcb_window_t window, const WindowInfoData& data) {
+    erase(window);
+    snapshot.windows[window] = data;
+    if (data.parent != XCB_NONE && data.parent != rootWindow) {
+      frames.emplace(data.parent, window);
+    }
+  }
+
+  void erase(xcb_window_t window) {
+    auto it = snapshot.windows.find(window);
+    if (it == snapshot.windows.end()) {
+      return;
+    }
+    auto range = frames.equal_range(it->second.parent);
+    for (auto frame = range.first; frame != range.second; ++frame) {
+      if (frame->second == window) {
+        frames.erase(frame);
+        break;
+      }
+    }
+    snapshot.windows.erase(it);
+  }
+
+  void clear() {
+    snapshot.windows.clear();
+    snapshot.clients.clear();
+    frames.clear();
+  }
+};
+
+// Marks the window as changed. Events on a WM frame change the position or state of the client it holds
+static void markWindowChanged(const CacheState& state, PendingChanges& pending, xcb_window_t window) {
+  if (state.snapshot.windows.find(window) != state.snapshot.windows.end()) {
+    pending.windows.insert(window);
+  }
+  auto range = state.frames.equal_range(window);
+  for (auto it = range.first; it != range.second; ++it) {
+    pending.windows.insert(it->second);
+  }
+}
+
+static void handleEvent(
+  WindowCache& cache, CacheState& state, PendingChanges& pending, xcb_generic_event_t* event
+) {
+  const XcbWindowContext& cacheContext = cache.context;
+  switch (event->response_type & ~0x80) {
+  case XCB_PROPERTY_NOTIFY: {
+    auto* e = reinterpret_cast<xcb_property_notify_event_t*>(event);
+    if (e->window == cacheContext.rootWindow) {
+      if (e->atom == cacheContext.ewmh._NET_CLIENT_LIST) {
+        pending.clientList = true;
+      } else if (e->atom == cacheContext.ewmh._NET_ACTIVE_WINDOW) {
+        pending.activeWindow = true;
+      } else if (e->atom == cacheContext.ewmh._NET_WORKAREA || e->atom == cacheContext.ewmh._NET_CURRENT_DESKTOP) {
+        cache.screenGeneration++;
+      }
+    } else {
+      markWindowChanged(state, pending, e->window);
+    }
+    break;
+  }
+  case XCB_CONFIGURE_NOTIFY:
+    markWindowChanged(state, pending, reinterpret_cast<xcb_configure_notify_event_t*>(event)->window);
+    break;
+  case XCB_MAP_NOTIFY:
+    markWindowChanged(state, pending, reinterpret_cast<xcb_map_notify_event_t*>(event)->window);
+    break;
+  case XCB_UNMAP_NOTIFY:
+    markWindowChanged(state, pending, reinterpret_cast<xcb_unmap_notify_event_t*>(event)->window);
+    break;
+  case XCB_REPARENT_NOTIFY:
+    markWindowChanged(state, pending, reinterpret_cast<xcb_reparent_notify_event_t*>(event)->window);
+    break;
+  case XCB_DESTROY_NOTIFY: {
+    xcb_window_t window = reinterpret_cast<xcb_destroy_notify_event_t*>(event)->window;
+    state.erase(window);
+    pending.windows.erase(window);
+    break;
+  }
+  default:
+    // Errors of requests for windows that were destroyed meanwhile, nothing to do
+    break;
+  }
+}
+
+// Re-reads everything that was marked as changed. Requests are pipelined,
+// so a refresh costs one round-trip, or two when new clients have appeared.
+static void refresh(XcbWindowContext& cacheContext, CacheState& state, PendingChanges& pending) {
+  xcb_connection_t* connection = cacheContext.connection;
+  xcb_get_property_cookie_t clientListCookie;
+  xcb_get_property_cookie_t activeWindowCookie;
+  if (pending.clientList) {
+    clientListCookie = xcb_ewmh_get_client_list(&cacheContext.ewmh, 0);
+  }
+  if (pending.activeWindow) {
+    activeWindowCookie = xcb_ewmh_get_active_window(&cacheContext.ewmh, 0);
+  }
+
+  if (pending.clientList) {
+    xcb_ewmh_get_windows_reply_t clients;
+    xcb_generic_error_t* error = nullptr;
+    if (xcb_ewmh_get_client_list_reply(&cacheContext.ewmh, clientListCookie, &clients, &error)) {
+      std::unordered_set<xcb_window_t> alive(clients.windows, clients.windows + clients.windows_len);
+      std::vector<xcb_window_t> gone;
+      for (const auto& entry : state.snapshot.windows) {
+        if (!alive.count(entry.first)) {
+          gone.push_back(entry.first);
+        }
+      }
+      for (xcb_window_t window : gone) {
+        state.erase(window);
+      }
+      for (xcb_window_t window : alive) {
+        if (state.snapshot.windows.find(window) == state.snapshot.windows.end()) {
+          xcb_change_window_attributes(connection, window, XCB_CW_EVENT_MASK, &clientEventMask);
+          pending.windows.insert(window);
+        }
+      }
+      state.snapshot.clients.assign(clients.windows, clients.windows + clients.windows_len);
+      xcb_ewmh_get_windows_reply_wipe(&clients);
+    } else {
+      free(error);
+      state.clear();
+    }
+  }
+  if (pending.activeWindow) {
+    xcb_generic_error_t* error = nullptr;
+    state.snapshot.hasActiveWindow = xcb_ewmh_get_active_window_reply(
+      &cacheContext.ewmh, activeWindowCookie, &state.snapshot.activeWindow, &error);
+    free(error);
+  }
+
+  std::vector<xcb_window_t> windows(pending.windows.begin(), pending.windows.end());
+  std::vector<WindowInfoCookies> cookies;
+  cookies.reserve(windows.size());
+  for (xcb_window_t window : windows) {
+    cookies.push_back(requestWindowInfo(cacheContext, window));
+  }
+  for (size_t i = 0; i < windows.size(); i++) {
+    WindowInfoData data;
+    if (collectWindowInfo(cacheContext, windows[i], cookies[i], data).empty()) {
+      state.set(windows[i], data);
+    } else {
+      state.erase(windows[i]);
+    }
+  }
+
+  pending.clientList = false;
+  pending.activeWindow = false;
+  pending.windows.clear();
+}
+
+// Subscribes to monitor layout changes, returns first RandR event code or 0 if RandR is not available
+static uint8_t selectScreenEvents(const XcbWindowContext& cacheContext) {
+  xcb_connection_t* connection = cacheContext.connection;
+  const xcb_query_extension_reply_t* randr = xcb_get_extension_data(connection, &xcb_randr_id);
+  if (!randr || !randr->present) {
+    LOG("RandR is not available, monitors are queried on every call");
+    return 0;
+  }
+  // Server treats clients that didn't announce their version as RandR 1.0 ones
+  free(xcb_randr_query_version_reply(connection, xcb_randr_query_version(connection, 1, 5), nullptr));
+  xcb_randr_select_input(connection, cacheContext.rootWindow,
+                         XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE | XCB_RANDR_NOTIFY_MASK_CRTC_CHANGE |
+                         XCB_RANDR_NOTIFY_MASK_OUTPUT_CHANGE);
+  return randr->first_event;
+}
+
+std::shared_ptr<const WindowCacheSnapshot> SnapshotPublisher::load() {
+  const WindowCacheSnapshot* snapshot = current.load();
+  if (!snapshot) {
+    return nullptr;
+  }
+  for (auto& slot : hazards) {
+    const WindowCacheSnapshot* expected = nullptr;
+    if (!slot.compare_exchange_strong(expected, snapshot)) {
+      continue;
+    }
+    // Snapshot may have been replaced and dropped before the slot was set, it's safe to use once it's still current
+    while (true) {
+      const WindowCacheSnapshot* latest = current.load();
+      if (latest == snapshot) {
+        break;
+      }
+      if (!latest) {
+        slot.store(nullptr);
+        return nullptr;
+      }
+      slot.store(latest);
+      snapshot = latest;
+    }
+    std::shared_ptr<const WindowCacheSnapshot> result = snapshot->shared_from_this();
+    slot.store(nullptr);
+    return result;
+  }
+  // All slots are taken, callers query the X server instead of waiting
+  return nullptr;
+}
+
+void SnapshotPublisher::publish(std::shared_ptr<const WindowCacheSnapshot> snapshot) {
+  const WindowCacheSnapshot* published = snapshot.get();
+  if (snapshot) {
+    owned.push_back(std::move(snapshot));
+  }
+  current.store(published);
+  // Readers that already hold a shared_ptr keep their snapshot alive themselves
+  owned.erase(std::remove_if(owned.begin(), owned.end(), [this, published](const auto& candidate) {
+    if (candidate.get() == published) {
+      return false;
+    }
+    for (const auto& slot : hazards) {
+      if (slot.load() == candidate.get()) {
+        return false;
+      }
+    }
+    return true;
+  }), owned.end());
+}
+
+static void runWindowCache(WindowCache* cache) {
+  xcb_connection_t* connection = cache->context.connection;
+  CacheState state;
+  state.rootWindow = cache->context.rootWindow;
+  PendingChanges pending;
+
+  xcb_change_window_attributes(connection, cache->context.rootWindow, XCB_CW_EVENT_MASK, &rootEventMask);
+  uint8_t randrEventBase = selectScreenEvents(cache->context);
+  cache->watchingScreen = randrEventBase != 0;
+
+  struct pollfd fds[2];
+  fds[0].fd = xcb_get_file_descriptor(connection);
+  fds[0].events = POLLIN;
+  fds[1].fd = cache->wakeFd;
+  fds[1].events = POLLIN;
+
+  while (true) {
+    // poll_for_event also returns events that were read from the socket while waiting for replies
+    xcb_generic_event_t* event;
+    while ((event = xcb_poll_for_event(connection))) {
+      uint8_t type = event->response_type & ~0x80;
+      if (randrEventBase && (type == randrEventBase + XCB_RANDR_SCREEN_CHANGE_NOTIFY ||
+                             type == randrEventBase + XCB_RANDR_NOTIFY)) {
+        cache->screenGeneration++;
+      }
+      handleEvent(*cache, state, pending, event);
+      free(event);
+    }
+    if (xcb_connection_has_error(connection)) {
+      LOG("Window cache lost X connection, falling back to direct queries");
+      cache->snapshots.publish(nullptr);
+      break;
+    }
+    if (!pending.empty()) {
+      // Loaded before the requests are sent, so the snapshot can only look older than it is
+      state.snapshot.localWrites = cache->localWrites;
+      refresh(cache->context, state, pending);
+      cache->snapshots.publish(std::make_shared<WindowCacheSnapshot>(state.snapshot));
+      continue;
+    }
+    xcb_flush(connection);
+    if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+      break;
+    }
+    if (fds[1].revents & POLLIN) {
+      uint64_t value;
+      if (read(cache->wakeFd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        break;
+      }
+      if (cache->stopping) {
+        break;
+      }
+      std::vector<xcb_window_t> written;
+      {
+        std::lock_guard<std::mutex> lock(cache->writtenMutex);
+        written.swap(cache->writtenWindows);
+      }
+      for (xcb_window_t window : written) {
+        // Windows that are not tracked yet are picked up with the client list
+        markWindowChanged(state, pending, window);
+      }
+      // A write may change the active window or not change anything, a new snapshot is published either way
+      pending.activeWindow = true;
+    }
+  }
+  cache->watchingScreen = false;
+}
+
+static void stopWindowCache(void* data) {
+  WindowCache* cache = static_cast<WindowCache*>(data);
+  if (!cache->thread.joinable()) {
+    return;
+  }
+  cache->stopping = true;
+  uint64_t value = 1;
+  if (write(cache->wakeFd, &value, sizeof(value)) < 0) {
+    LOG("Failed to stop window cache thread");
+  }
+  cache->thread.join();
+  cache->snapshots.publish(nullptr);
+  close(cache->wakeFd);
+  cache->wakeFd = -1;
+  disconnectXcbWindowContext(cache->context);
+}
+
+void startWindowCache(Napi::Env env) {
+  WindowCache& cache = addonData().windowCache;
+  if (cache.thread.joinable()) {
+    return;
+  }
+  std::string errorMsg = connectXcbWindowContext(cache.context);
+  if (!errorMsg.empty()) {
+    LOG("Window cache is disabled: %s", errorMsg.c_str());
+    return;
+  }
+  cache.stopping = false;
+  cache.wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (cache.wakeFd < 0) {
+    LOG("Window cache is disabled: eventfd failed");
+    disconnectXcbWindowContext(cache.context);
+    return;
+  }
+  cache.thread = std::thread(runWindowCache, &cache);
+  napi_add_env_cleanup_hook(env, stopWindowCache, &cache);
+}
+
+std::shared_ptr<const WindowCacheSnapshot> getWindowCacheSnapshot() {
+  WindowCache& cache = addonData().windowCache;
+  std::shared_ptr<const WindowCacheSnapshot> snapshot = cache.snapshots.load();
+  if (snapshot && snapshot->localWrites < cache.localWrites) {
+    return nullptr;
+  }
+  return snapshot;
+}
+
+void windowCacheLocalWrite(xcb_window_t window) {
+  WindowCache& cache = addonData().windowCache;
+  if (cache.wakeFd < 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(cache.writtenMutex);
+    cache.writtenWindows.push_back(window);
+  }
+  cache.localWrites++;
+  uint64_t value = 1;
+  if (write(cache.wakeFd, &value, sizeof(value)) < 0) {
+    LOG("Failed to wake window cache thread up");
+  }
+}
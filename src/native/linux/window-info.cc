@@ -0,0 +1,323 @@
+#include "./headers/window-info.h"
+#include "./headers/logger.h"
+#include <cstring>
+#include <memory>
+
+static void releaseConnection(XcbWindowContext& ctx) {
+  if (ctx.ownsConnection) {
+    xcb_disconnect(ctx.connection);
+  }
+  ctx.connection = nullptr;
+}
+
+std::string connectXcbWindowContext(XcbWindowContext& ctx, xcb_connection_t* shared) {
+  int screenNum;
+  ctx.ownsConnection = shared == nullptr;
+  ctx.connection = shared ? shared : xcb_connect(nullptr, &screenNum);
+
+  if (int error = xcb_connection_has_error(ctx.connection)) {
+    std::string errorMsg;
+    switch (error) {
+    case XCB_CONN_ERROR:
+      errorMsg = "Connection error: socket, pipe, or stream error";
+      break;
+    case XCB_CONN_CLOSED_EXT_NOTSUPPORTED:
+      errorMsg = "Connection closed: required extension not supported";
+      break;
+    case XCB_CONN_CLOSED_MEM_INSUFFICIENT:
+      errorMsg = "Connection closed: insufficient memory";
+      break;
+    case XCB_CONN_CLOSED_REQ_LEN_EXCEED:
+      errorMsg = "Connection closed: request length exceeded server limit";
+      break;
+    case XCB_CONN_CLOSED_PARSE_ERR:
+      errorMsg = "Connection closed: error parsing display string";
+      break;
+    case XCB_CONN_CLOSED_INVALID_SCREEN:
+      errorMsg = "Connection closed: no matching screen found on X server";
+      break;
+    default:
+      errorMsg = "Unknown connection error";
+    }
+    releaseConnection(ctx);
+    return "Failed to connect to X server: " + errorMsg;
+  }
+
+  xcb_screen_t* screen = xcb_setup_roots_iterator(xcb_get_setup(ctx.connection)).data;
+  ctx.rootWindow = screen->root;
+
+  xcb_generic_error_t* ewmh_error = nullptr;
+  if (xcb_ewmh_init_atoms_replies(&ctx.ewmh, xcb_ewmh_init_atoms(ctx.connection, &ctx.ewmh), &ewmh_error) == 0) {
+    std::string errorMsg = "Failed to initialize EWMH atoms";
+    if (ewmh_error) {
+      errorMsg += ": X11 error code " + std::to_string(ewmh_error->error_code);
+      errorMsg += " (sequence: " + std::to_string(ewmh_error->sequence) + ")";
+      free(ewmh_error);
+    }
+    releaseConnection(ctx);
+    return errorMsg;
+  }
+
+  // Initialize _NET_WM_WINDOW_OPACITY atom
+  xcb_intern_atom_cookie_t opacityCookie = xcb_intern_atom(ctx.connection, 0, strlen("_NET_WM_WINDOW_OPACITY"),
+                                                           "_NET_WM_WINDOW_OPACITY");
+  xcb_generic_error_t* opacityError = nullptr;
+  xcb_intern_atom_reply_t* opacityReply = xcb_intern_atom_reply(ctx.connection, opacityCookie, &opacityError);
+  if (!opacityReply) {
+    std::string errorMsg = "Failed to get _NET_WM_WINDOW_OPACITY atom reply";
+    if (opacityError) {
+      errorMsg += ": X11 error code " + std::to_string(opacityError->error_code);
+      errorMsg += " (sequence: " + std::to_string(opacityError->sequence) + ")";
+      free(opacityError);
+    }
+    ctx.netWmWindowOpacityAtom = XCB_NONE;
+  } else {
+    ctx.netWmWindowOpacityAtom = opacityReply->atom;
+    free(opacityReply);
+  }
+
+  const xcb_query_extension_reply_t* xresExtension = xcb_get_extension_data(ctx.connection, &xcb_res_id);
+  if (xresExtension && xresExtension->present) {
+    xcb_res_query_version_reply_t* versionReply = xcb_res_query_version_reply(
+      ctx.connection, xcb_res_query_version(ctx.connection, 1, 2), nullptr);
+    if (versionReply) {
+      ctx.xresClientIdsSupported = versionReply->server_major > 1 ||
+        (versionReply->server_major == 1 && versionReply->server_minor >= 2);
+      free(versionReply);
+    }
+  }
+  if (!ctx.xresClientIdsSupported) {
+    LOG("X-Resource 1.2 is not available, window pids are read from _NET_WM_PID");
+  }
+
+  return "";
+}
+
+void disconnectXcbWindowContext(XcbWindowContext& ctx) {
+  if (!ctx.connection) {
+    return;
+  }
+  xcb_ewmh_connection_wipe(&ctx.ewmh);
+  releaseConnection(ctx);
+}
+
+std::string xcbErrorMessage(std::string errorMsg, xcb_generic_error_t* error) {
+  if (error) {
+    errorMsg += ": X11 error code " + std::to_string(error->error_code);
+    errorMsg += " (sequence: " + std::to_string(error->sequence) + ")";
+  }
+  return errorMsg;
+}
+
+pid_t parseWindowPid(xcb_get_property_reply_t* reply) {
+  if (reply->type == XCB_ATOM_CARDINAL && reply->format == 32 && reply->length == 1) {
+    return *(pid_t*)xcb_get_property_value(reply);
+  }
+  return 0;
+}
+
+xcb_res_query_client_ids_cookie_t requestClientPids(const XcbWindowContext& ctx, uint32_t resource) {
+  xcb_res_client_id_spec_t spec;
+  spec.client = resource;
+  spec.mask = XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID;
+  return xcb_res_query_client_ids(ctx.connection, 1, &spec);
+}
+
+std::unordered_map<uint32_t, pid_t> collectClientPids(
+  const XcbWindowContext& ctx,
+  xcb_res_query_client_ids_cookie_t cookie
+) {
+  std::unordered_map<uint32_t, pid_t> pids;
+  xcb_generic_error_t* error = nullptr;
+  xcb_res_query_client_ids_reply_t* reply = xcb_res_query_client_ids_reply(ctx.connection, cookie, &error);
+  if (!reply) {
+    free(error);
+    return pids;
+  }
+  xcb_res_client_id_value_iterator_t it = xcb_res_query_client_ids_ids_iterator(reply);
+  for (; it.rem; xcb_res_client_id_value_next(&it)) {
+    if ((it.data->spec.mask & XCB_RES_CLIENT_ID_MASK_LOCAL_CLIENT_PID) &&
+      xcb_res_client_id_value_value_length(it.data) == 1) {
+      pids[it.data->spec.client] = static_cast<pid_t>(*xcb_res_client_id_value_value(it.data));
+    }
+  }
+  free(reply);
+  return pids;
+}
+
+// Replies are owned by XCB callers and have to be released with free()
+template <typename T>
+using XcbReply = std::unique_ptr<T, decltype(&free)>;
+
+WindowInfoCookies requestWindowInfo(const XcbWindowContext& ctx, xcb_window_t window_id) {
+  WindowInfoCookies cookies;
+  cookies.pid = xcb_get_property(ctx.connection, 0, window_id, ctx.ewmh._NET_WM_PID, XCB_ATOM_CARDINAL, 0, 1);
+  cookies.geometry = xcb_get_geometry(ctx.connection, window_id);
+  // Window's absolute position (accounting for window decorations)
+  cookies.translate = xcb_translate_coordinates(ctx.connection, window_id, ctx.rootWindow, 0, 0);
+  cookies.attributes = xcb_get_window_attributes(ctx.connection, window_id);
+  cookies.state = xcb_get_property(ctx.connection, 0, window_id, ctx.ewmh._NET_WM_STATE, XCB_ATOM_ATOM, 0, 1024);
+  // WM_NAME is only used when _NET_WM_NAME is missing, but requesting it upfront is cheaper than a second round-trip
+  cookies.netWmName = xcb_get_property(ctx.connection, 0, window_id, ctx.ewmh._NET_WM_NAME, ctx.ewmh.UTF8_STRING, 0, 1024);
+  cookies.wmName = xcb_get_property(ctx.connection, 0, window_id, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 0, 1024);
+  if (ctx.netWmWindowOpacityAtom != XCB_NONE) {
+    cookies.opacity = xcb_get_property(ctx.connection, 0, window_id, ctx.netWmWindowOpacityAtom, XCB_ATOM_CARDINAL, 0, 1);
+  }
+  cookies.tree = xcb_query_tree(ctx.connection, window_id);
+  if (ctx.xresClientIdsSupported) {
+    cookies.clientPid = requestClientPids(ctx, window_id);
+  }
+  return cookies;
+}
+
+// Returns an error message if _NET_WM_STATE is malformed, empty string otherwise
+static std::string parseWindowVisibility(
+  const XcbWindowContext& ctx,
+  xcb_get_window_attributes_reply_t* attrReply,
+  xcb_get_property_reply_t* stateReply,
+  std::string& visibility
+) {
+  visibility = attrReply->map_state != XCB_MAP_STATE_VIEWABLE ? "hide" : "show";
+
+  // If property doesn't exist, it's not minimized or maximized
+  if (stateReply->type == XCB_NONE) {
+    return "";
+  } else if (stateReply->type != XCB_ATOM_ATOM) {
+    return "_NET_WM_STATE property type is not ATOM";
+  } else if (stateReply->format != 32) {
+    return "_NET_WM_STATE property format is not 32";
+  }
+
+  xcb_atom_t* atoms = (xcb_atom_t*)xcb_get_property_value(stateReply);
+  int atomCount = stateReply->value_len;
+
+  bool isHidden = false;
+  bool isMaximized = false;
+
+  for (int i = 0; i < atomCount; i++) {
+    if (atoms[i] == ctx.ewmh._NET_WM_STATE_HIDDEN) {
+      isHidden = true;
+    }
+    if (atoms[i] == ctx.ewmh._NET_WM_STATE_MAXIMIZED_VERT ||
+      atoms[i] == ctx.ewmh._NET_WM_STATE_MAXIMIZED_HORZ) {
+      isMaximized = true;
+    }
+  }
+
+  if (isHidden) {
+    visibility = "minimize";
+  } else if (isMaximized) {
+    visibility = "maximize";
+  }
+  return "";
+}
+
+static std::string parseWindowTitle(xcb_get_property_reply_t* reply) {
+  if (reply && reply->type != XCB_NONE && reply->format == 8) {
+    int length = xcb_get_property_value_length(reply);
+    if (length > 0) {
+      return std::string((char*)xcb_get_property_value(reply), length);
+    }
+  }
+  return "";
+}
+
+static double parseWindowOpacity(xcb_get_property_reply_t* reply) {
+  if (reply && reply->type == XCB_ATOM_CARDINAL && reply->format == 32 && reply->length == 1) {
+    uint32_t opacityValue = *(uint32_t*)xcb_get_property_value(reply);
+    return static_cast<double>(opacityValue) / 4294967295.0;
+  }
+  return 1.0; // Default opacity, also used when opacity is not supported
+}
+
+std::string collectWindowInfo(
+  const XcbWindowContext& ctx,
+  xcb_window_t window_id,
+  const WindowInfoCookies& cookies,
+  WindowInfoData& data
+) {
+  xcb_generic_error_t* pidError = nullptr;
+  XcbReply<xcb_get_property_reply_t> pidReply(
+    xcb_get_property_reply(ctx.connection, cookies.pid, &pidError), free);
+  xcb_generic_error_t* geomError = nullptr;
+  XcbReply<xcb_get_geometry_reply_t> geomReply(
+    xcb_get_geometry_reply(ctx.connection, cookies.geometry, &geomError), free);
+  xcb_generic_error_t* transError = nullptr;
+  XcbReply<xcb_translate_coordinates_reply_t> transReply(
+    xcb_translate_coordinates_reply(ctx.connection, cookies.translate, &transError), free);
+  xcb_generic_error_t* attrError = nullptr;
+  XcbReply<xcb_get_window_attributes_reply_t> attrReply(
+    xcb_get_window_attributes_reply(ctx.connection, cookies.attributes, &attrError), free);
+  xcb_generic_error_t* stateError = nullptr;
+  XcbReply<xcb_get_property_reply_t> stateReply(
+    xcb_get_property_reply(ctx.connection, cookies.state, &stateError), free);
+  // Title, opacity and X-Resource pid are not critical, their errors are ignored
+  xcb_generic_error_t* netWmNameError = nullptr;
+  XcbReply<xcb_get_property_reply_t> netWmNameReply(
+    xcb_get_property_reply(ctx.connection, cookies.netWmName, &netWmNameError), free);
+  xcb_generic_error_t* wmNameError = nullptr;
+  XcbReply<xcb_get_property_reply_t> wmNameReply(
+    xcb_get_property_reply(ctx.connection, cookies.wmName, &wmNameError), free);
+  xcb_generic_error_t* opacityError = nullptr;
+  XcbReply<xcb_get_property_reply_t> opacityReply(nullptr, free);
+  if (ctx.netWmWindowOpacityAtom != XCB_NONE) {
+    opacityReply.reset(xcb_get_property_reply(ctx.connection, cookies.opacity, &opacityError));
+  }
+  pid_t clientPid = 0;
+  if (ctx.xresClientIdsSupported) {
+    std::unordered_map<uint32_t, pid_t> clientPids = collectClientPids(ctx, cookies.clientPid);
+    if (!clientPids.empty()) {
+      clientPid = clientPids.begin()->second;
+    }
+  }
+  xcb_generic_error_t* treeError = nullptr;
+  XcbReply<xcb_query_tree_reply_t> treeReply(
+    xcb_query_tree_reply(ctx.connection, cookies.tree, &treeError), free);
+
+  std::string errorMsg;
+  if (!pidReply) {
+    errorMsg = xcbErrorMessage("Failed to get _NET_WM_PID property reply", pidError);
+  } else if (!geomReply) {
+    errorMsg = xcbErrorMessage("Failed to get window geometry", geomError);
+  } else if (!transReply) {
+    errorMsg = xcbErrorMessage("Failed to translate window coordinates", transError);
+  } else if (!attrReply) {
+    errorMsg = xcbErrorMessage("Failed to get window attributes", attrError);
+  } else if (!stateReply) {
+    errorMsg = xcbErrorMessage("Failed to get _NET_WM_STATE property reply", stateError);
+  } else if (!treeReply) {
+    errorMsg = xcbErrorMessage("Failed to get window tree", treeError);
+  }
+  for (xcb_generic_error_t* error : {pidError, geomError, transError, attrError, stateError, netWmNameError,
+    wmNameError, opacityError, treeError}) {
+    free(error);
+  }
+  if (!errorMsg.empty()) {
+    return errorMsg;
+  }
+
+  data.wid = window_id;
+  // X server knows which local process owns the window, _NET_WM_PID is set by the client and holds a pid of its
+  // own namespace in sandboxes. Same precedence as getWindowsByProcessId, so both report the same pid
+  data.pid = clientPid;
+  if (data.pid == 0) {
+    // Remote clients or no X-Resource extension
+    data.pid = parseWindowPid(pidReply.get());
+  }
+  data.x = transReply->dst_x;
+  data.y = transReply->dst_y;
+  data.width = geomReply->width;
+  data.height = geomReply->height;
+  std::string stateErrorMsg = parseWindowVisibility(ctx, attrReply.get(), stateReply.get(), data.visibility);
+  if (!stateErrorMsg.empty()) {
+    return stateErrorMsg;
+  }
+  // Fallback to WM_NAME if _NET_WM_NAME is not available
+  data.title = parseWindowTitle(netWmNameReply.get());
+  if (data.title.empty()) {
+    data.title = parseWindowTitle(wmNameReply.get());
+  }
+  data.opacity = parseWindowOpacity(opacityReply.get());
+  data.parent = treeReply->parent;
+  return "";
+}
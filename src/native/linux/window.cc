@@ -1,139 +1,74 @@
 #include <napi.h>
 #include <unistd.h>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <xcb/xcb_ewmh.h>
 #include "./headers/window.h"
+#include "./headers/window-info.h"
+#include "./headers/window-cache.h"
 #include "./headers/logger.h"
 #include "./headers/process.h"
 #include "./headers/validators.h"
+#include "./headers/native-queue.h"
+#include "./headers/addon-data.h"
 #include <X11/Xlib.h>
 #include <X11/Xatom.h>
 
 #include "headers/display.h"
 
-// Global XCB connection
-static xcb_connection_t* connection = nullptr;
-static xcb_ewmh_connection_t ewmh;
-static xcb_window_t rootWindow;
-static xcb_atom_t netWmWindowOpacityAtom;
-
 
 // Initialize XCB if not already initialized
 void ensure_xcb_initialized(Napi::Env env) {
-  if (connection) {
+  XcbWindowContext& context = addonData().windowContext;
+  if (context.connection) {
     return;
   }
-  int screenNum;
-  connection = xcb_connect(nullptr, &screenNum);
-
-  if (int error = xcb_connection_has_error(connection)) {
-    std::string errorMsg;
-    switch (error) {
-    case XCB_CONN_ERROR:
-      errorMsg = "Connection error: socket, pipe, or stream error";
-      break;
-    case XCB_CONN_CLOSED_EXT_NOTSUPPORTED:
-      errorMsg = "Connection closed: required extension not supported";
-      break;
-    case XCB_CONN_CLOSED_MEM_INSUFFICIENT:
-      errorMsg = "Connection closed: insufficient memory";
-      break;
-    case XCB_CONN_CLOSED_REQ_LEN_EXCEED:
-      errorMsg = "Connection closed: request length exceeded server limit";
-      break;
-    case XCB_CONN_CLOSED_PARSE_ERR:
-      errorMsg = "Connection closed: error parsing display string";
-      break;
-    case XCB_CONN_CLOSED_INVALID_SCREEN:
-      errorMsg = "Connection closed: no matching screen found on X server";
-      break;
-    default:
-      errorMsg = "Unknown connection error";
-    }
-    xcb_disconnect(connection);
-    connection = nullptr;
-    throw Napi::Error::New(env, "Failed to connect to X server: " + errorMsg);
-  }
-
-  xcb_screen_t* screen = xcb_setup_roots_iterator(xcb_get_setup(connection)).data;
-  rootWindow = screen->root;
-
-  xcb_generic_error_t* ewmh_error = nullptr;
-  if (xcb_ewmh_init_atoms_replies(&ewmh, xcb_ewmh_init_atoms(connection, &ewmh), &ewmh_error) == 0) {
-    std::string errorMsg = "Failed to initialize EWMH atoms";
-    if (ewmh_error) {
-      errorMsg += ": X11 error code " + std::to_string(ewmh_error->error_code);
-      errorMsg += " (sequence: " + std::to_string(ewmh_error->sequence) + ")";
-      free(ewmh_error);
-    }
-    xcb_disconnect(connection);
-    connection = nullptr;
+  xcb_connection_t* connection = callNative(env, xGetMainConnection);
+  std::string errorMsg = connectXcbWindowContext(context, connection);
+  if (!errorMsg.empty()) {
     throw Napi::Error::New(env, errorMsg);
   }
 
-  // Initialize _NET_WM_WINDOW_OPACITY atom
-  xcb_intern_atom_cookie_t opacityCookie = xcb_intern_atom(connection, 0, strlen("_NET_WM_WINDOW_OPACITY"),
-                                                           "_NET_WM_WINDOW_OPACITY");
-  xcb_generic_error_t* opacityError = nullptr;
-  xcb_intern_atom_reply_t* opacityReply = xcb_intern_atom_reply(connection, opacityCookie, &opacityError);
-  if (!opacityReply) {
-    std::string errorMsg = "Failed to get _NET_WM_WINDOW_OPACITY atom reply";
-    if (opacityError) {
-      errorMsg += ": X11 error code " + std::to_string(opacityError->error_code);
-      errorMsg += " (sequence: " + std::to_string(opacityError->sequence) + ")";
-      free(opacityError);
-    }
-    netWmWindowOpacityAtom = XCB_NONE;
-  } else {
-    netWmWindowOpacityAtom = opacityReply->atom;
-    free(opacityReply);
-  }
-
   LOG("XCB initialized successfully");
+  startWindowCache(env);
 }
 
+// Sends _NET_WM_STATE and similar requests to the window manager
+static void sendRootClientMessage(const xcb_client_message_event_t& event) {
+  XcbWindowContext& context = addonData().windowContext;
+  xcb_send_event(context.connection, 0, context.rootWindow,
+                 XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT,
+                 (const char*)&event);
+}
 
-// Get PID for a window
-pid_t getWindowPid(xcb_window_t window, Napi::Env env) {
-  xcb_get_property_cookie_t cookie = xcb_get_property(
-    connection,
-    0,
-    window,
-    ewmh._NET_WM_PID,
-    XCB_ATOM_CARDINAL,
-    0,
-    1
-  );
-
-  xcb_generic_error_t* error = nullptr;
-  xcb_get_property_reply_t* reply = xcb_get_property_reply(connection, cookie, &error);
-  if (!reply) {
-    std::string errorMsg = "Failed to get _NET_WM_PID property reply";
-    if (error) {
+// Appends the reason of a failed EWMH property read to errorMsg and frees the error
+static std::string ewmhErrorMessage(std::string errorMsg, xcb_generic_error_t* error) {
+  if (error) {
+    switch (error->error_code) {
+    case XCB_WINDOW: // 3
+      errorMsg += ": Invalid window";
+      break;
+    case XCB_VALUE: // 2
+      errorMsg += ": Invalid value";
+      break;
+    case XCB_ACCESS: // 10
+      errorMsg += ": Access denied";
+      break;
+    default:
       errorMsg += ": X11 error code " + std::to_string(error->error_code);
-      errorMsg += " (sequence: " + std::to_string(error->sequence) + ")";
-      free(error);
     }
-    throw Napi::Error::New(env, errorMsg);
-  };
-
-  pid_t pid = 0;
-  if (reply->type == XCB_ATOM_CARDINAL && reply->format == 32 && reply->length == 1) {
-    pid = *(pid_t*)xcb_get_property_value(reply);
-    free(reply);
+    errorMsg += " (sequence: " + std::to_string(error->sequence) + ")";
+    free(error);
   } else {
-    free(reply);
-    return 0; // TODO this is an error :(
-    // throw Napi::Error::New(env, "Failed to get PID from XCB reply");
+    errorMsg += ": No EWMH support or window manager not compliant";
   }
-  return pid;
+  return errorMsg;
 }
 
-void setWindowActive(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
-  GET_INT_64(info, 0, window_id, xcb_window_t);
-
-  ensure_xcb_initialized(env);
-
+static void activateWindow(xcb_window_t window_id) {
+  XcbWindowContext& context = addonData().windowContext;
   // Send _NET_ACTIVE_WINDOW message
   xcb_client_message_event_t event;
   memset(&event, 0, sizeof(event));
@@ -141,367 +76,396 @@ void setWindowActive(const Napi::CallbackInfo& info) {
   event.response_type = XCB_CLIENT_MESSAGE;
   event.format = 32;
   event.window = window_id;
-  event.type = ewmh._NET_ACTIVE_WINDOW;
+  event.type = context.ewmh._NET_ACTIVE_WINDOW;
   event.data.data32[0] = 2; // Source indication: 2 = pager
   event.data.data32[1] = XCB_CURRENT_TIME;
   event.data.data32[2] = XCB_NONE;
 
-  xcb_send_event(connection, 0, rootWindow,
-                 XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT,
-                 (const char*)&event);
+  sendRootClientMessage(event);
 
   // Also use traditional method as fallback
   uint32_t values[] = {XCB_STACK_MODE_ABOVE};
-  xcb_configure_window(connection, window_id, XCB_CONFIG_WINDOW_STACK_MODE, values);
-  xcb_set_input_focus(connection, XCB_INPUT_FOCUS_POINTER_ROOT, window_id, XCB_CURRENT_TIME);
-  xcb_flush(connection);
+  xcb_configure_window(context.connection, window_id, XCB_CONFIG_WINDOW_STACK_MODE, values);
+  xcb_set_input_focus(context.connection, XCB_INPUT_FOCUS_POINTER_ROOT, window_id, XCB_CURRENT_TIME);
+  xcb_flush(context.connection);
+  windowCacheLocalWrite(window_id);
+}
+
+void setWindowActive(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  GET_INT_64(info, 0, window_id, xcb_window_t);
+
+  ensure_xcb_initialized(env);
+  activateWindow(window_id);
 }
 
-Napi::Number getWindowActiveId(const Napi::CallbackInfo& info) {
+Napi::Value setWindowActiveAsync(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  GET_INT_64(info, 0, window_id, xcb_window_t);
+
   ensure_xcb_initialized(env);
-  xcb_get_property_cookie_t cookie = xcb_ewmh_get_active_window(&ewmh, 0);
+  return runOnNativeQueue(env, [=] { activateWindow(window_id); });
+}
+
+static xcb_window_t queryActiveWindow() {
+  XcbWindowContext& context = addonData().windowContext;
+  std::shared_ptr<const WindowCacheSnapshot> snapshot = getWindowCacheSnapshot();
+  if (snapshot && snapshot->hasActiveWindow) {
+    return snapshot->activeWindow;
+  }
+  xcb_get_property_cookie_t cookie = xcb_ewmh_get_active_window(&context.ewmh, 0);
   xcb_window_t activeWindow = 0;
 
   xcb_generic_error_t* error = nullptr;
-  if (!xcb_ewmh_get_active_window_reply(&ewmh, cookie, &activeWindow, &error)) {
-    std::string errorMsg = "Failed to get active window";
-
-    if (error) {
-      switch (error->error_code) {
-      case XCB_WINDOW: // 3
-        errorMsg += ": Invalid window";
-        break;
-      case XCB_VALUE: // 2
-        errorMsg += ": Invalid value";
-        break;
-      case XCB_ACCESS: // 10
-        errorMsg += ": Access denied";
-        break;
-      default:
-        errorMsg += ": X11 error code " + std::to_string(error->error_code);
-      }
-      errorMsg += " (sequence: " + std::to_string(error->sequence) + ")";
-      free(error);
-    } else {
-      errorMsg += ": No EWMH support or window manager not compliant";
-    }
-
-    throw Napi::Error::New(env, errorMsg);
+  if (!xcb_ewmh_get_active_window_reply(&context.ewmh, cookie, &activeWindow, &error)) {
+    throw NativeError(ewmhErrorMessage("Failed to get active window", error));
   }
+  return activeWindow;
+}
 
-  return Napi::Number::New(env, static_cast<int64_t>(activeWindow));
+static Napi::Value windowIdToNumber(Napi::Env env, xcb_window_t window) {
+  return Napi::Number::New(env, static_cast<int64_t>(window));
 }
 
+Napi::Value getWindowActiveId(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  ensure_xcb_initialized(env);
+  return windowIdToNumber(env, callNative(env, queryActiveWindow));
+}
 
-std::string getWindowVisiblity(Napi::Env env, xcb_window_t window_id) {
-  // Get window visibility state
-  std::string visibility = "show"; // default
+Napi::Value getWindowActiveIdAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  ensure_xcb_initialized(env);
+  return runOnNativeQueue<xcb_window_t>(env, queryActiveWindow, windowIdToNumber);
+}
 
-  // Check if window is mapped (visible)
-  xcb_get_window_attributes_cookie_t attrCookie = xcb_get_window_attributes(connection, window_id);
-  xcb_generic_error_t* attrError = nullptr;
-  xcb_get_window_attributes_reply_t* attrReply = xcb_get_window_attributes_reply(connection, attrCookie, &attrError);
 
-  if (attrReply) {
-    if (attrReply->map_state != XCB_MAP_STATE_VIEWABLE) {
-      visibility = "hide";
-    }
-    free(attrReply);
-  } else {
-    std::string errorMsg = "Failed to get window attributes";
-    if (attrError) {
-      errorMsg += ": X11 error code " + std::to_string(attrError->error_code);
-      errorMsg += " (sequence: " + std::to_string(attrError->sequence) + ")";
-      free(attrError);
-    }
-    throw Napi::Error::New(env, errorMsg);
-  }
+struct WindowInfoWithPath {
+  WindowInfoData data;
+  std::string path;
+};
 
-  // Check for minimized state
-  xcb_get_property_cookie_t stateCookie = xcb_get_property(
-    connection, 0, window_id, ewmh._NET_WM_STATE, XCB_ATOM_ATOM, 0, 1024);
-  xcb_generic_error_t* stateError = nullptr;
-  xcb_get_property_reply_t* stateReply = xcb_get_property_reply(connection, stateCookie, &stateError);
-
-  if (!stateReply) {
-    std::string errorMsg = "Failed to get _NET_WM_STATE property reply";
-    if (stateError) {
-      errorMsg += ": X11 error code " + std::to_string(stateError->error_code);
-      errorMsg += " (sequence: " + std::to_string(stateError->sequence) + ")";
-      free(stateError);
-    }
-    throw Napi::Error::New(env, errorMsg);
+static Napi::Object windowInfoToObject(Napi::Env env, const WindowInfoData& data, const std::string& path) {
+  Napi::Object result = Napi::Object::New(env);
+  if (data.pid != 0) {
+    result.Set("path", Napi::String::New(env, path));
+    result.Set("pid", Napi::Number::New(env, data.pid));
   }
 
-  // If property doesn't exist, it's not minimized or maximized
-  if (stateReply->type == XCB_NONE) {
-    free(stateReply);
-    return visibility; // Return early with default visibility
-  } else if (stateReply->type != XCB_ATOM && stateReply->type != 4) { // 4 is XA_ATOM
-    free(stateReply);
-    throw Napi::Error::New(env, "_NET_WM_STATE property type is not ATOM");
-  } else if (stateReply->format != 32) {
-    free(stateReply);
-    throw Napi::Error::New(env, "_NET_WM_STATE property format is not 32");
-  } else {
-    xcb_atom_t* atoms = (xcb_atom_t*)xcb_get_property_value(stateReply);
-    int atomCount = stateReply->value_len;
-
-    bool isHidden = false;
-    bool isMaximized = false;
+  Napi::Object bounds = Napi::Object::New(env);
+  bounds.Set("x", Napi::Number::New(env, data.x));
+  bounds.Set("y", Napi::Number::New(env, data.y));
+  bounds.Set("width", Napi::Number::New(env, data.width));
+  bounds.Set("height", Napi::Number::New(env, data.height));
 
-    for (int i = 0; i < atomCount; i++) {
-      if (atoms[i] == ewmh._NET_WM_STATE_HIDDEN) {
-        isHidden = true;
-      }
-      if (atoms[i] == ewmh._NET_WM_STATE_MAXIMIZED_VERT ||
-        atoms[i] == ewmh._NET_WM_STATE_MAXIMIZED_HORZ) {
-        isMaximized = true;
-      }
-    }
+  result.Set("wid", Napi::Number::New(env, static_cast<int64_t>(data.wid)));
+  result.Set("bounds", bounds);
+  result.Set("visibility", Napi::String::New(env, data.visibility));
+  result.Set("title", Napi::String::New(env, data.title));
+  result.Set("opacity", Napi::Number::New(env, data.opacity));
+  result.Set("parentWid", Napi::Number::New(env, static_cast<int64_t>(data.parent)));
+  return result;
+}
 
-    if (isHidden) {
-      visibility = "minimize";
-    } else if (isMaximized) {
-      visibility = "maximize";
-    }
+static Napi::Value windowInfoWithPathToObject(Napi::Env env, const WindowInfoWithPath& window) {
+  return windowInfoToObject(env, window.data, window.path);
+}
 
-    free(stateReply);
+static Napi::Value windowsInfoToArray(Napi::Env env, const std::vector<WindowInfoWithPath>& windows) {
+  Napi::Array result = Napi::Array::New(env, windows.size());
+  for (uint32_t i = 0; i < windows.size(); i++) {
+    result[i] = windowInfoWithPathToObject(env, windows[i]);
   }
-  return visibility;
+  return result;
 }
 
-
-Napi::Object getWindowBounds(Napi::Env env, xcb_window_t window_id) {
-  xcb_get_geometry_cookie_t geomCookie = xcb_get_geometry(connection, window_id);
-  xcb_generic_error_t* geomError = nullptr;
-  xcb_get_geometry_reply_t* geomReply = xcb_get_geometry_reply(connection, geomCookie, &geomError);
-
-  if (!geomReply) {
-    std::string errorMsg = "Failed to get window geometry";
-    if (geomError) {
-      errorMsg += ": X11 error code " + std::to_string(geomError->error_code);
-      errorMsg += " (sequence: " + std::to_string(geomError->sequence) + ")";
-      free(geomError);
+static WindowInfoWithPath queryWindowInfo(xcb_window_t window_id) {
+  XcbWindowContext& context = addonData().windowContext;
+  WindowInfoWithPath result;
+  std::shared_ptr<const WindowCacheSnapshot> snapshot = getWindowCacheSnapshot();
+  const WindowInfoData* cached = nullptr;
+  if (snapshot) {
+    auto it = snapshot->windows.find(window_id);
+    if (it != snapshot->windows.end()) {
+      cached = &it->second;
     }
-    throw Napi::Error::New(env, errorMsg);
   }
-
-  // Get window's absolute position (accounting for window decorations)
-  xcb_translate_coordinates_cookie_t transCookie = xcb_translate_coordinates(
-    connection, window_id, rootWindow, 0, 0);
-  xcb_generic_error_t* transError = nullptr;
-  xcb_translate_coordinates_reply_t* transReply =
-    xcb_translate_coordinates_reply(connection, transCookie, &transError);
-
-  if (!transReply) {
-    std::string errorMsg = "Failed to translate window coordinates";
-    if (transError) {
-      errorMsg += ": X11 error code " + std::to_string(transError->error_code);
-      errorMsg += " (sequence: " + std::to_string(transError->sequence) + ")";
-      free(transError);
+  if (cached) {
+    result.data = *cached;
+  } else {
+    // Windows that are not managed by WM are not tracked by the cache
+    WindowInfoCookies cookies = requestWindowInfo(context, window_id);
+    std::string errorMsg = collectWindowInfo(context, window_id, cookies, result.data);
+    if (!errorMsg.empty()) {
+      throw NativeError(errorMsg);
     }
-    free(geomReply);
-    throw Napi::Error::New(env, errorMsg);
   }
+  if (result.data.pid != 0) {
+    result.path = getProcessPath(result.data.pid);
+  }
+  return result;
+}
 
-  Napi::Object bounds = Napi::Object::New(env);
-  bounds.Set("x", Napi::Number::New(env, transReply->dst_x));
-  bounds.Set("y", Napi::Number::New(env, transReply->dst_y));
-  bounds.Set("width", Napi::Number::New(env, geomReply->width));
-  bounds.Set("height", Napi::Number::New(env, geomReply->height));
+Napi::Value getWindowInfo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
 
-  free(geomReply);
-  free(transReply);
+  GET_UINT_32(info, 0, window_id, xcb_window_t);
 
-  return bounds;
+  ensure_xcb_initialized(env);
+  return windowInfoWithPathToObject(env, callNative(env, [=] { return queryWindowInfo(window_id); }));
 }
 
-std::string getWindowTitle(Napi::Env env, xcb_window_t window_id) {
-  xcb_get_property_cookie_t cookie = xcb_get_property(
-    connection, 0, window_id, ewmh._NET_WM_NAME, XCB_ATOM_STRING, 0, 1024);
-  xcb_generic_error_t* error = nullptr;
-  xcb_get_property_reply_t* reply = xcb_get_property_reply(connection, cookie, &error);
-
-  std::string title = "";
-  if (reply && reply->type != XCB_NONE && reply->format == 8 && reply->length > 0) {
-    title = std::string((char*)xcb_get_property_value(reply), reply->length);
-  }
+Napi::Value getWindowInfoAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
 
-  if (reply) free(reply);
+  GET_UINT_32(info, 0, window_id, xcb_window_t);
 
-  // Fallback to WM_NAME if _NET_WM_NAME is not available
-  if (title.empty()) {
-    cookie = xcb_get_property(connection, 0, window_id, XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 0, 1024);
-    xcb_generic_error_t* fallback_error = nullptr;
-    reply = xcb_get_property_reply(connection, cookie, &fallback_error);
+  ensure_xcb_initialized(env);
+  return runOnNativeQueue<WindowInfoWithPath>(
+    env, [=] { return queryWindowInfo(window_id); }, windowInfoWithPathToObject);
+}
 
-    if (!reply) {
-      std::string errorMsg = "Failed to get WM_NAME property reply";
-      if (fallback_error) {
-        errorMsg += ": X11 error code " + std::to_string(fallback_error->error_code);
-        errorMsg += " (sequence: " + std::to_string(fallback_error->sequence) + ")";
-        free(fallback_error);
+// Gets info of many windows at once. Windows missing in the cache are requested pipelined over the connection,
+// so the whole batch costs at most a single round-trip. Windows that are gone or fail are skipped.
+static std::vector<WindowInfoWithPath> queryWindowsInfo(const std::vector<xcb_window_t>& windowIds) {
+  XcbWindowContext& context = addonData().windowContext;
+  size_t length = windowIds.size();
+  std::shared_ptr<const WindowCacheSnapshot> snapshot = getWindowCacheSnapshot();
+  std::vector<WindowInfoData> windows(length);
+  std::vector<bool> cached(length, false);
+  std::vector<WindowInfoCookies> cookies(length);
+  for (size_t i = 0; i < length; i++) {
+    if (snapshot) {
+      auto it = snapshot->windows.find(windowIds[i]);
+      if (it != snapshot->windows.end()) {
+        windows[i] = it->second;
+        cached[i] = true;
+        continue;
       }
-      // Don't throw here, just return empty title since it's a fallback
-    } else if (reply->type != XCB_NONE && reply->format == 8 && reply->length > 0) {
-      title = std::string((char*)xcb_get_property_value(reply), reply->length);
     }
-
-    if (reply) free(reply);
-  } else if (error) {
-    // Free error from first attempt if we got a reply
-    free(error);
+    cookies[i] = requestWindowInfo(context, windowIds[i]);
   }
 
-  return title;
-}
-
-double getWindowOpacity(Napi::Env env, xcb_window_t window_id) {
-  if (netWmWindowOpacityAtom == XCB_NONE) {
-    return 1.0; // Opacity not supported
+  std::vector<bool> found(cached);
+  for (size_t i = 0; i < length; i++) {
+    // Skip windows that cause errors, rest of replies still have to be drained
+    if (!cached[i]) {
+      found[i] = collectWindowInfo(context, windowIds[i], cookies[i], windows[i]).empty();
+    }
   }
 
-  xcb_get_property_cookie_t cookie = xcb_get_property(
-    connection, 0, window_id, netWmWindowOpacityAtom, XCB_ATOM_CARDINAL, 0, 1);
-  xcb_generic_error_t* error = nullptr;
-  xcb_get_property_reply_t* reply = xcb_get_property_reply(connection, cookie, &error);
-
-  double opacity = 1.0; // Default opacity
-  if (reply && reply->type == XCB_ATOM_CARDINAL && reply->format == 32 && reply->length == 1) {
-    uint32_t opacityValue = *(uint32_t*)xcb_get_property_value(reply);
-    opacity = static_cast<double>(opacityValue) / 4294967295.0;
-  } else if (!reply) {
-    std::string errorMsg = "Failed to get _NET_WM_WINDOW_OPACITY property reply";
-    if (error) {
-      errorMsg += ": X11 error code " + std::to_string(error->error_code);
-      errorMsg += " (sequence: " + std::to_string(error->sequence) + ")";
-      free(error);
+  // Windows of the same process share the executable path
+  std::unordered_map<pid_t, std::string> paths;
+  std::vector<WindowInfoWithPath> result;
+  result.reserve(length);
+  for (size_t i = 0; i < length; i++) {
+    if (!found[i]) {
+      continue;
+    }
+    const WindowInfoData& data = windows[i];
+    try {
+      if (data.pid != 0 && paths.find(data.pid) == paths.end()) {
+        paths[data.pid] = getProcessPath(data.pid);
+      }
+      result.push_back({data, data.pid != 0 ? paths[data.pid] : ""});
+    } catch (const NativeError&) {
+      continue;
     }
-    // Don't throw here, just return default opacity since it's not critical
   }
-
-  if (reply) free(reply);
-  return opacity;
+  return result;
 }
 
-xcb_window_t getParentWindow(Napi::Env env, xcb_window_t window_id) {
-  xcb_query_tree_cookie_t cookie = xcb_query_tree(connection, window_id);
-  xcb_generic_error_t* error = nullptr;
-  xcb_query_tree_reply_t* reply = xcb_query_tree_reply(connection, cookie, &error);
-
-  xcb_window_t parent = 0;
-  if (reply) {
-    parent = reply->parent;
-    free(reply);
-  } else {
-    std::string errorMsg = "Failed to get window tree";
-    if (error) {
-      errorMsg += ": X11 error code " + std::to_string(error->error_code);
-      errorMsg += " (sequence: " + std::to_string(error->sequence) + ")";
-      free(error);
+static std::vector<xcb_window_t> parseWindowIds(const Napi::CallbackInfo& info) {
+  ASSERT_ARRAY(info, 0);
+  Napi::Array wids = info[0].As<Napi::Array>();
+  uint32_t length = wids.Length();
+  std::vector<xcb_window_t> windowIds(length);
+  for (uint32_t i = 0; i < length; i++) {
+    Napi::Value wid = wids.Get(i);
+    if (!wid.IsNumber()) {
+      throw Napi::TypeError::New(info.Env(), "Argument 0 must be an array of numbers");
     }
-    throw Napi::Error::New(env, errorMsg);
+    windowIds[i] = wid.As<Napi::Number>().Uint32Value();
   }
-
-  return parent;
+  return windowIds;
 }
 
-Napi::Object getWindowInfo(const Napi::CallbackInfo& info) {
+Napi::Value getWindowsInfo(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
+  std::vector<xcb_window_t> windowIds = parseWindowIds(info);
 
-  GET_UINT_32(info, 0, window_id, xcb_window_t);
+  ensure_xcb_initialized(env);
+  return windowsInfoToArray(env, queryWindowsInfo(windowIds));
+}
+
+Napi::Value getWindowsInfoAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  std::vector<xcb_window_t> windowIds = parseWindowIds(info);
 
   ensure_xcb_initialized(env);
+  return runOnNativeQueue<std::vector<WindowInfoWithPath>>(
+    env, [windowIds] { return queryWindowsInfo(windowIds); }, windowsInfoToArray);
+}
 
-  pid_t pid = getWindowPid(window_id, env);
-  Napi::Object result = Napi::Object::New(env);
-  if (pid != 0) {
-    std::string path = getProcessPath(pid, env);
-    result.Set("path", Napi::String::New(env, path));
-    result.Set("pid", Napi::Number::New(env, pid));
+// Owner pids of windows, 0 for windows that fail. clientPids are X-Resource pids of all clients, windows which owner
+// X-Resource doesn't know (remote clients, no extension) fall back to _NET_WM_PID. All of those property reads are
+// sent at once, so they cost one round-trip
+static std::vector<pid_t> collectWindowPids(
+  XcbWindowContext& context,
+  const std::unordered_map<uint32_t, pid_t>& clientPids,
+  const std::vector<xcb_window_t>& windows
+) {
+  uint32_t resourceMask = xcb_get_setup(context.connection)->resource_id_mask;
+  std::vector<pid_t> windowPids(windows.size(), 0);
+  std::vector<xcb_get_property_cookie_t> pidCookies(windows.size());
+  std::vector<bool> fromProperty(windows.size(), false);
+  for (size_t i = 0; i < windows.size(); i++) {
+    auto it = clientPids.find(windows[i] & ~resourceMask);
+    if (it != clientPids.end()) {
+      windowPids[i] = it->second;
+    } else {
+      pidCookies[i] = xcb_get_property(
+        context.connection, 0, windows[i], context.ewmh._NET_WM_PID, XCB_ATOM_CARDINAL, 0, 1);
+      fromProperty[i] = true;
+    }
+  }
+  for (size_t i = 0; i < windows.size(); i++) {
+    if (!fromProperty[i]) {
+      continue;
+    }
+    xcb_generic_error_t* pidError = nullptr;
+    xcb_get_property_reply_t* reply = xcb_get_property_reply(context.connection, pidCookies[i], &pidError);
+    if (reply) {
+      windowPids[i] = parseWindowPid(reply);
+      free(reply);
+    } else {
+      // Skip windows that cause errors
+      free(pidError);
+    }
   }
+  return windowPids;
+}
 
-  Napi::Object bounds = getWindowBounds(env, window_id);
-  std::string visibility = getWindowVisiblity(env, window_id);
-  std::string title = getWindowTitle(env, window_id);
-  double opacity = getWindowOpacity(env, window_id);
-  xcb_window_t parentWid = getParentWindow(env, window_id);
+// Get all window handles owned by any of the processes
+static std::vector<xcb_window_t> queryWindowsByProcesses(const std::unordered_set<pid_t>& pids) {
+  XcbWindowContext& context = addonData().windowContext;
+  std::vector<xcb_window_t> result;
+
+  std::shared_ptr<const WindowCacheSnapshot> snapshot = getWindowCacheSnapshot();
+  if (snapshot) {
+    // Clients the cache failed to read are looked up directly
+    std::vector<xcb_window_t> missing;
+    for (xcb_window_t window : snapshot->clients) {
+      auto it = snapshot->windows.find(window);
+      if (it == snapshot->windows.end()) {
+        missing.push_back(window);
+      } else if (pids.count(it->second.pid)) {
+        result.push_back(window);
+      }
+    }
+    if (!missing.empty()) {
+      std::unordered_map<uint32_t, pid_t> clientPids;
+      if (context.xresClientIdsSupported) {
+        clientPids = collectClientPids(context, requestClientPids(context, XCB_NONE));
+      }
+      std::vector<pid_t> missingPids = collectWindowPids(context, clientPids, missing);
+      for (size_t i = 0; i < missing.size(); i++) {
+        if (pids.count(missingPids[i])) {
+          result.push_back(missing[i]);
+        }
+      }
+    }
+    return result;
+  }
 
+  xcb_ewmh_get_windows_reply_t clients;
+  // Client list and pids of all clients are requested together, so both cost one round-trip
+  xcb_get_property_cookie_t cookie = xcb_ewmh_get_client_list(&context.ewmh, 0);
+  xcb_res_query_client_ids_cookie_t clientIdsCookie;
+  if (context.xresClientIdsSupported) {
+    clientIdsCookie = requestClientPids(context, XCB_NONE);
+  }
 
-  result.Set("wid", Napi::Number::New(env, static_cast<int64_t>(window_id)));
-  result.Set("bounds", bounds);
-  result.Set("visibility", Napi::String::New(env, visibility));
-  result.Set("title", Napi::String::New(env, title));
-  result.Set("opacity", Napi::Number::New(env, opacity));
-  result.Set("parentWid", Napi::Number::New(env, static_cast<int64_t>(parentWid)));
+  xcb_generic_error_t* error = nullptr;
+  if (!xcb_ewmh_get_client_list_reply(&context.ewmh, cookie, &clients, &error)) {
+    if (context.xresClientIdsSupported) {
+      xcb_discard_reply(context.connection, clientIdsCookie.sequence);
+    }
+    throw NativeError(ewmhErrorMessage("Failed to get client list", error));
+  }
+
+  std::unordered_map<uint32_t, pid_t> clientPids;
+  if (context.xresClientIdsSupported) {
+    clientPids = collectClientPids(context, clientIdsCookie);
+  }
+  std::vector<xcb_window_t> windows(clients.windows, clients.windows + clients.windows_len);
+  xcb_ewmh_get_windows_reply_wipe(&clients);
 
+  std::vector<pid_t> windowPids = collectWindowPids(context, clientPids, windows);
+  for (size_t i = 0; i < windows.size(); i++) {
+    if (pids.count(windowPids[i])) {
+      result.push_back(windows[i]);
+    }
+  }
   return result;
 }
 
+static std::vector<xcb_window_t> queryWindowsByProcessId(pid_t targetPid) {
+  return queryWindowsByProcesses({targetPid});
+}
+
+// Windows of pid and of all its descendants, launchers and Electron apps draw in child processes
+static std::vector<xcb_window_t> queryWindowsByProcessTree(pid_t pid) {
+  std::vector<pid_t> tree = addonData().processTree.descendants(pid);
+  return queryWindowsByProcesses(std::unordered_set<pid_t>(tree.begin(), tree.end()));
+}
+
+static Napi::Value windowIdsToArray(Napi::Env env, const std::vector<xcb_window_t>& windows) {
+  Napi::Array result = Napi::Array::New(env, windows.size());
+  for (uint32_t i = 0; i < windows.size(); i++) {
+    result[i] = windowIdToNumber(env, windows[i]);
+  }
+  return result;
+}
 
-// Get all window handles for a specified process ID
-Napi::Array getWindowsByProcessId(const Napi::CallbackInfo& info) {
+Napi::Value getWindowsByProcessId(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
   GET_UINT_32(info, 0, targetPid, pid_t);
-  Napi::Array result = Napi::Array::New(env);
 
   ensure_xcb_initialized(env);
-  xcb_ewmh_get_windows_reply_t clients;
-  xcb_get_property_cookie_t cookie = xcb_ewmh_get_client_list(&ewmh, 0);
-
-  xcb_generic_error_t* error = nullptr;
-  if (!xcb_ewmh_get_client_list_reply(&ewmh, cookie, &clients, &error)) {
-    std::string errorMsg = "Failed to get client list";
-
-    if (error) {
-      switch (error->error_code) {
-      case XCB_WINDOW: // 3
-        errorMsg += ": Invalid window";
-        break;
-      case XCB_VALUE: // 2
-        errorMsg += ": Invalid value";
-        break;
-      case XCB_ACCESS: // 10
-        errorMsg += ": Access denied";
-        break;
-      default:
-        errorMsg += ": X11 error code " + std::to_string(error->error_code);
-      }
-      errorMsg += " (sequence: " + std::to_string(error->sequence) + ")";
-      free(error);
-    } else {
-      errorMsg += ": No EWMH support or window manager not compliant";
-    }
+  return windowIdsToArray(env, callNative(env, [=] { return queryWindowsByProcessId(targetPid); }));
+}
 
-    throw Napi::Error::New(env, errorMsg);
-  }
+Napi::Value getWindowsByProcessIdAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
 
-  size_t count = 0;
-  for (unsigned int i = 0; i < clients.windows_len; i++) {
-    try {
-      pid_t windowPid = getWindowPid(clients.windows[i], env);
-      if (windowPid == targetPid) {
-        result[count++] = Napi::Number::New(env, static_cast<int64_t>(clients.windows[i]));
-      }
-    }
-    catch (const Napi::Error&) {
-      // Skip windows that cause errors
-      continue;
-    }
-  }
+  GET_UINT_32(info, 0, targetPid, pid_t);
 
-  xcb_ewmh_get_windows_reply_wipe(&clients);
-  return result;
+  ensure_xcb_initialized(env);
+  return runOnNativeQueue<std::vector<xcb_window_t>>(
+    env, [=] { return queryWindowsByProcessId(targetPid); }, windowIdsToArray);
 }
 
-void setWindowBounds(const Napi::CallbackInfo& info) {
+Napi::Value getWindowsByProcessTreeAsync(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
+  GET_UINT_32(info, 0, pid, pid_t);
+
   ensure_xcb_initialized(env);
+  return runOnNativeQueue<std::vector<xcb_window_t>>(
+    env, [=] { return queryWindowsByProcessTree(pid); }, windowIdsToArray);
+}
+
+struct WindowBounds {
+  xcb_window_t window;
+  int x;
+  int y;
+  int width;
+  int height;
+};
 
+static WindowBounds parseWindowBounds(const Napi::CallbackInfo& info) {
   GET_INT_64(info, 0, window_id, xcb_window_t);
   GET_OBJECT(info, 1, bounds);
   ASSERT_OBJECT_NUMBER(info, 1, x);
@@ -515,34 +479,48 @@ void setWindowBounds(const Napi::CallbackInfo& info) {
   int height = bounds.Get("height").ToNumber().Int32Value();
 
   if (width <= 0 || height <= 0) {
-    throw Napi::Error::New(env, "Invalid window dimensions");
+    throw Napi::Error::New(info.Env(), "Invalid window dimensions");
   }
+  return {window_id, x, y, width, height};
+}
 
-  uint32_t values[] = {(uint32_t)x, (uint32_t)y, (uint32_t)width, (uint32_t)height};
+static void applyWindowBounds(const WindowBounds& bounds) {
+  XcbWindowContext& context = addonData().windowContext;
+  uint32_t values[] = {(uint32_t)bounds.x, (uint32_t)bounds.y, (uint32_t)bounds.width, (uint32_t)bounds.height};
   xcb_configure_window(
-    connection, window_id,
+    context.connection, bounds.window,
     XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
     values
   );
-  xcb_flush(connection);
+  xcb_flush(context.connection);
+  windowCacheLocalWrite(bounds.window);
 }
 
+void setWindowBounds(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
 
-// Show a window
-void setWindowState(const Napi::CallbackInfo& info) {
-  Napi::Env env{info.Env()};
+  ensure_xcb_initialized(env);
+  applyWindowBounds(parseWindowBounds(info));
+}
+
+Napi::Value setWindowBoundsAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
 
   ensure_xcb_initialized(env);
+  WindowBounds bounds = parseWindowBounds(info);
+  return runOnNativeQueue(env, [=] { applyWindowBounds(bounds); });
+}
 
-  GET_INT_64(info, 0, window_id, xcb_window_t);
-  GET_STRING(info, 1, type);
 
+// Show a window
+static void applyWindowState(xcb_window_t window_id, const std::string& type) {
+  XcbWindowContext& context = addonData().windowContext;
   if (type == "show") {
     // Map the window (make it visible)
-    xcb_map_window(connection, window_id);
+    xcb_map_window(context.connection, window_id);
   } else if (type == "hide") {
     // Unmap the window (make it invisible)
-    xcb_unmap_window(connection, window_id);
+    xcb_unmap_window(context.connection, window_id);
   } else if (type == "minimize") {
     // Send _NET_WM_STATE_HIDDEN message to minimize
     xcb_client_message_event_t event;
@@ -550,15 +528,13 @@ void setWindowState(const Napi::CallbackInfo& info) {
     event.response_type = XCB_CLIENT_MESSAGE;
     event.format = 32;
     event.window = window_id;
-    event.type = ewmh._NET_WM_STATE;
+    event.type = context.ewmh._NET_WM_STATE;
     event.data.data32[0] = 1; // _NET_WM_STATE_ADD
-    event.data.data32[1] = ewmh._NET_WM_STATE_HIDDEN;
+    event.data.data32[1] = context.ewmh._NET_WM_STATE_HIDDEN;
     event.data.data32[2] = XCB_NONE;
     event.data.data32[3] = 0;
 
-    xcb_send_event(connection, 0, rootWindow,
-                   XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT,
-                   (const char*)&event);
+    sendRootClientMessage(event);
   } else if (type == "restore") {
     // Remove hidden state and map window
     xcb_client_message_event_t event;
@@ -566,16 +542,14 @@ void setWindowState(const Napi::CallbackInfo& info) {
     event.response_type = XCB_CLIENT_MESSAGE;
     event.format = 32;
     event.window = window_id;
-    event.type = ewmh._NET_WM_STATE;
+    event.type = context.ewmh._NET_WM_STATE;
     event.data.data32[0] = 0; // _NET_WM_STATE_REMOVE
-    event.data.data32[1] = ewmh._NET_WM_STATE_HIDDEN;
+    event.data.data32[1] = context.ewmh._NET_WM_STATE_HIDDEN;
     event.data.data32[2] = XCB_NONE;
     event.data.data32[3] = 0;
 
-    xcb_send_event(connection, 0, rootWindow,
-                   XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT,
-                   (const char*)&event);
-    xcb_map_window(connection, window_id);
+    sendRootClientMessage(event);
+    xcb_map_window(context.connection, window_id);
   } else if (type == "maximize") {
     // Send _NET_WM_STATE_MAXIMIZED_VERT and _NET_WM_STATE_MAXIMIZED_HORZ
     xcb_client_message_event_t event;
@@ -583,51 +557,93 @@ void setWindowState(const Napi::CallbackInfo& info) {
     event.response_type = XCB_CLIENT_MESSAGE;
     event.format = 32;
     event.window = window_id;
-    event.type = ewmh._NET_WM_STATE;
+    event.type = context.ewmh._NET_WM_STATE;
     event.data.data32[0] = 1; // _NET_WM_STATE_ADD
-    event.data.data32[1] = ewmh._NET_WM_STATE_MAXIMIZED_VERT;
-    event.data.data32[2] = ewmh._NET_WM_STATE_MAXIMIZED_HORZ;
+    event.data.data32[1] = context.ewmh._NET_WM_STATE_MAXIMIZED_VERT;
+    event.data.data32[2] = context.ewmh._NET_WM_STATE_MAXIMIZED_HORZ;
     event.data.data32[3] = 0;
 
-    xcb_send_event(connection, 0, rootWindow,
-                   XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT,
-                   (const char*)&event);
+    sendRootClientMessage(event);
   } else {
-    throw Napi::Error::New(env, "Invalid window show type");
+    throw NativeError("Invalid window show type");
   }
 
-  xcb_flush(connection);
+  xcb_flush(context.connection);
+  windowCacheLocalWrite(window_id);
 }
 
-void setWindowOpacity(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
+void setWindowState(const Napi::CallbackInfo& info) {
+  Napi::Env env{info.Env()};
 
   ensure_xcb_initialized(env);
 
   GET_INT_64(info, 0, window_id, xcb_window_t);
+  GET_STRING(info, 1, type);
+
+  callNative(env, [&] { applyWindowState(window_id, type); });
+}
+
+Napi::Value setWindowStateAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env{info.Env()};
+
+  ensure_xcb_initialized(env);
+
+  GET_INT_64(info, 0, window_id, xcb_window_t);
+  GET_STRING(info, 1, type);
+
+  return runOnNativeQueue(env, [=] { applyWindowState(window_id, type); });
+}
+
+static double parseWindowOpacity(const Napi::CallbackInfo& info) {
+  XcbWindowContext& context = addonData().windowContext;
   GET_DOUBLE(info, 1, opacity);
 
   if (opacity < 0.0 || opacity > 1.0) {
-    throw Napi::Error::New(env, "Opacity must be between 0.0 and 1.0");
+    throw Napi::Error::New(info.Env(), "Opacity must be between 0.0 and 1.0");
   }
 
-  if (netWmWindowOpacityAtom == XCB_NONE) {
-    throw Napi::Error::New(env, "Window opacity not supported");
+  if (context.netWmWindowOpacityAtom == XCB_NONE) {
+    throw Napi::Error::New(info.Env(), "Window opacity not supported");
   }
+  return opacity;
+}
 
+static void applyWindowOpacity(xcb_window_t window_id, double opacity) {
+  XcbWindowContext& context = addonData().windowContext;
   // Convert opacity to 32-bit integer (0-4294967295)
   uint32_t opacityValue = static_cast<uint32_t>(opacity * 4294967295.0);
 
-  xcb_change_property(connection, XCB_PROP_MODE_REPLACE, window_id,
-                      netWmWindowOpacityAtom, XCB_ATOM_CARDINAL, 32, 1, &opacityValue);
-  xcb_flush(connection);
+  xcb_change_property(context.connection, XCB_PROP_MODE_REPLACE, window_id,
+                      context.netWmWindowOpacityAtom, XCB_ATOM_CARDINAL, 32, 1, &opacityValue);
+  xcb_flush(context.connection);
+  windowCacheLocalWrite(window_id);
+}
+
+void setWindowOpacity(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  ensure_xcb_initialized(env);
+
+  GET_INT_64(info, 0, window_id, xcb_window_t);
+  double opacity = parseWindowOpacity(info);
+  applyWindowOpacity(window_id, opacity);
+}
+
+Napi::Value setWindowOpacityAsync(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  ensure_xcb_initialized(env);
+
+  GET_INT_64(info, 0, window_id, xcb_window_t);
+  double opacity = parseWindowOpacity(info);
+  return runOnNativeQueue(env, [=] { applyWindowOpacity(window_id, opacity); });
 }
 ; // Global variable
 // Add to your native module
 Napi::Value createTestWindow(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
-  Display* test_display = xGetMainDisplay(env);
+  Display* test_display = callNative(env, [] { return xGetMainDisplay(); });
 
   Window window = XCreateSimpleWindow(
     test_display,
@@ -649,10 +665,21 @@ Napi::Object windowInit(Napi::Env env, Napi::Object exports) {
   exports.Set("getWindowsByProcessId", Napi::Function::New(env, getWindowsByProcessId));
   exports.Set("setWindowState", Napi::Function::New(env, setWindowState));
   exports.Set("getWindowInfo", Napi::Function::New(env, getWindowInfo));
+  exports.Set("getWindowsInfo", Napi::Function::New(env, getWindowsInfo));
   exports.Set("setWindowBounds", Napi::Function::New(env, setWindowBounds));
 
   exports.Set("setWindowOpacity", Napi::Function::New(env, setWindowOpacity));
   exports.Set("createTestWindow", Napi::Function::New(env, createTestWindow));
+
+  exports.Set("setWindowActiveAsync", Napi::Function::New(env, setWindowActiveAsync));
+  exports.Set("getWindowActiveIdAsync", Napi::Function::New(env, getWindowActiveIdAsync));
+  exports.Set("getWindowsByProcessIdAsync", Napi::Function::New(env, getWindowsByProcessIdAsync));
+  exports.Set("getWindowsByProcessTreeAsync", Napi::Function::New(env, getWindowsByProcessTreeAsync));
+  exports.Set("setWindowStateAsync", Napi::Function::New(env, setWindowStateAsync));
+  exports.Set("getWindowInfoAsync", Napi::Function::New(env, getWindowInfoAsync));
+  exports.Set("getWindowsInfoAsync", Napi::Function::New(env, getWindowsInfoAsync));
+  exports.Set("setWindowBoundsAsync", Napi::Function::New(env, setWindowBoundsAsync));
+  exports.Set("setWindowOpacityAsync", Napi::Function::New(env, setWindowOpacityAsync));
   return exports;
 }
 
@@ -0,0 +1,109 @@
+#include "./headers/worker-pool.h"
+#include <algorithm>
+
+// Encoding is memory bound, more threads than this only compete for the bandwidth
+static const size_t MAX_WORKERS = 7;
+
+struct ParallelJob {
+  const std::function<void(size_t)>& fn;
+  size_t count;
+  size_t next = 0;
+  size_t finished = 0;
+  // Listed in jobs for the pool threads to pick up
+  bool queued = false;
+  std::exception_ptr error;
+  std::condition_variable done;
+};
+
+WorkerPool::~WorkerPool() {
+  // Same as NativeQueue, the cleanup hook joins the threads before the instance is deleted
+  for (std::thread& thread : threads) {
+    if (thread.joinable()) {
+      thread.detach();
+    }
+  }
+}
+
+void WorkerPool::start(Napi::Env env) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!threads.empty() || stopping) {
+    return;
+  }
+  size_t hardware = std::thread::hardware_concurrency();
+  size_t count = std::min(hardware > 1 ? hardware - 1 : 1, MAX_WORKERS);
+  for (size_t i = 0; i < count; i++) {
+    threads.emplace_back(&WorkerPool::run, this);
+  }
+  napi_add_env_cleanup_hook(env, stop, this);
+}
+
+size_t WorkerPool::concurrency() const {
+  return threads.size() + 1;
+}
+
+void WorkerPool::work(ParallelJob& job, std::unique_lock<std::mutex>& lock) {
+  while (job.next < job.count) {
+    size_t index = job.next++;
+    if (job.next == job.count && job.queued) {
+      jobs.erase(std::find(jobs.begin(), jobs.end(), &job));
+    }
+    lock.unlock();
+    std::exception_ptr error;
+    try {
+      job.fn(index);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    lock.lock();
+    if (error && !job.error) {
+      job.error = error;
+    }
+    if (++job.finished == job.count) {
+      job.done.notify_all();
+    }
+  }
+}
+
+void WorkerPool::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    condition.wait(lock, [this] { return stopping || !jobs.empty(); });
+    if (stopping) {
+      return;
+    }
+    work(*jobs.front(), lock);
+  }
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+  if (count == 0) {
+    return;
+  }
+  ParallelJob job{fn, count};
+  std::unique_lock<std::mutex> lock(mutex);
+  if (count > 1 && !threads.empty() && !stopping) {
+    job.queued = true;
+    jobs.push_back(&job);
+    condition.notify_all();
+  }
+  work(job, lock);
+  job.done.wait(lock, [&job] { return job.finished == job.count; });
+  lock.unlock();
+  if (job.error) {
+    std::rethrow_exception(job.error);
+  }
+}
+
+void WorkerPool::stop(void* data) {
+  WorkerPool* pool = static_cast<WorkerPool*>(data);
+  {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->stopping = true;
+  }
+  pool->condition.notify_all();
+  for (std::thread& thread : pool->threads) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
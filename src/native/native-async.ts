@@ -0,0 +1,47 @@
+import type {INativeModule} from '@/native/native-model';
+
+/**
+ * Native methods that have a Promise returning `${name}Async` variant
+ */
+const asyncVariants = [
+  'setWindowActive',
+  'getWindowActiveId',
+  'getWindowsByProcessId',
+  'setWindowState',
+  'getWindowInfo',
+  'getWindowsInfo',
+  'setWindowBounds',
+  'setWindowOpacity',
+  'getMonitors',
+  'getMonitorFromWindow',
+  'getMonitorInfo',
+  'getProcessInfo',
+  'typeString',
+  'keyTap',
+  'keyToggle',
+  'setKeyboardLayout',
+  'setMouseButtonToState',
+  'setMousePosition',
+  'getMousePosition',
+] as const;
+
+type AsyncVariantName = `${typeof asyncVariants[number]}Async`;
+
+type SyncNativeModule = Omit<INativeModule, AsyncVariantName> & Partial<Pick<INativeModule, AsyncVariantName>>;
+
+/**
+ * Adds async variants that the addon doesn't export by wrapping the sync ones.
+ * Sync method is looked up on every call, so it can be replaced later (e.g. by jest mocks)
+ */
+export function withAsyncFallbacks<T extends SyncNativeModule>(native: T): T & INativeModule {
+  // eslint-disable-next-line @typescript-eslint/no-explicit-any
+  const module = native as any;
+  for (const name of asyncVariants) {
+    const asyncName: AsyncVariantName = `${name}Async`;
+    if (!module[asyncName] && module[name]) {
+      // eslint-disable-next-line @typescript-eslint/no-unsafe-return, @typescript-eslint/no-unsafe-call
+      module[asyncName] = async(...args: unknown[]): Promise<unknown> => module[name](...args);
+    }
+  }
+  return module as T & INativeModule;
+}
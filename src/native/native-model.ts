@@ -12,11 +12,198 @@ interface MousePosition {
  y: number;
 }
 
+interface HumanMouseMove extends MousePosition {
+  destinationRandomX?: number;
+  destinationRandomY?: number;
+  delayBetweenIterations?: number;
+  pixelsPerIteration?: number;
+  curveIntensity?: number;
+  curveIntensityDeviation?: number;
+}
+
+interface InputTimelineEventBase {
+  /**
+   * Offset from the timeline start in microseconds
+   */
+  offsetUs: number;
+}
+
+interface InputTimelineKeyEvent extends InputTimelineEventBase {
+  type: 'key';
+  key: string;
+  down: boolean;
+}
+
+interface InputTimelineButtonEvent extends InputTimelineEventBase {
+  type: 'button';
+  button: MouseButton;
+  down: boolean;
+}
+
+interface InputTimelineMoveEvent extends InputTimelineEventBase, MousePosition {
+  type: 'move';
+}
+
+interface InputTimelineTextEvent extends InputTimelineEventBase {
+  type: 'text';
+  text: string;
+}
+
+type InputTimelineEvent = InputTimelineKeyEvent | InputTimelineButtonEvent | InputTimelineMoveEvent | InputTimelineTextEvent;
+
+interface InputTimelineResult {
+  cancelled: boolean;
+  /**
+   * Same order as in the request. actualUs is absent for events skipped because of cancellation
+   */
+  events: {requestedUs: number; actualUs?: number}[];
+}
+
+interface CaptureMonitorTarget {
+  monitor: number;
+}
+
+interface CaptureRectTarget {
+  x: number;
+  y: number;
+  width: number;
+  height: number;
+}
+
+type CaptureTarget = CaptureMonitorTarget | CaptureRectTarget;
+
+interface CaptureFrame extends CaptureRectTarget {
+  // Bytes between the starts of two rows
+  stride: number;
+  format: 'bgra';
+  data: Buffer;
+}
+
+interface PixelColor {
+  r: number;
+  g: number;
+  b: number;
+}
+
+interface PixelWaitRequest {
+  region: CaptureRectTarget;
+  color: PixelColor;
+  // Largest difference of a channel that still matches
+  tolerance: number;
+  timeoutMs: number;
+  intervalMs: number;
+}
+
+interface PixelWaitResult {
+  matched: boolean;
+  // First matching pixel of the region, scanned row by row
+  x?: number;
+  y?: number;
+  color?: PixelColor;
+  elapsedMs: number;
+}
+
+interface IdleWaitRequest {
+  // Either a window or an area of the screen
+  wid?: number;
+  region?: CaptureRectTarget;
+  // How long nothing must be drawn
+  quietMs: number;
+  timeoutMs: number;
+}
+
+interface IdleWaitResult {
+  idle: boolean;
+  elapsedMs: number;
+  // Damage notifications received while waiting, several draws in a row are reported once
+  damageEvents: number;
+}
+
+interface ScreenStreamOptions {
+  // Send only changed tiles instead of whole frames
+  tiles: boolean;
+  tileSize?: number;
+  // JPEG quality 1..100, 70 by default
+  quality?: number;
+  // Frames are sent only when the screen changes, but not more often than this
+  maxFps?: number;
+}
+
+interface ScreenStreamInfo extends CaptureRectTarget {
+  id: number;
+}
+
+interface StreamTile extends CaptureRectTarget {
+  // JPEG, position is relative to the stream area
+  data: Buffer;
+}
+
+interface StreamFrame {
+  // Every tile of the stream area is included
+  full: boolean;
+  tiles: StreamTile[];
+}
+
+interface FrameSocketOptions {
+  // File name of the socket in the runtime directory of the server ($XDG_RUNTIME_DIR/http-remote-pc-control),
+  // a stale socket there is replaced
+  name: string;
+  // Frames that can be held by clients at the same time
+  slots: number;
+}
+
+interface FrameSocketInfo {
+  // Absolute path of the socket
+  path: string;
+  slots: number;
+  // Bytes of a slot, it fits a whole screen
+  slotSize: number;
+}
+
+interface TemplateMatch {
+  // Top left corner in screen coordinates
+  x: number;
+  y: number;
+  width: number;
+  height: number;
+  // Normalized cross-correlation 0..1, 1 is an exact match
+  score: number;
+}
+
+interface TemplateSearchOptions {
+  // Whole screen when omitted
+  region?: CaptureTarget;
+  threshold: number;
+  maxResults: number;
+}
+
+type ImageFormat = 'png' | 'jpeg' | 'qoi';
+
+interface ImageEncodeOptions {
+  format: ImageFormat;
+  // JPEG quality 1..100, 80 by default
+  quality?: number;
+  // PNG zlib level 0..9, 6 by default
+  compression?: number;
+  // Output size, the other side keeps the aspect ratio when only one is set
+  width?: number;
+  height?: number;
+}
+
+interface EncodedImage {
+  width: number;
+  height: number;
+  format: ImageFormat;
+  data: Buffer;
+}
+
 interface ProcessMemory {
   workingSetSize: number;
   peakWorkingSetSize: number;
   privateUsage: number;
   pageFileUsage: number;
+  // Resident memory with shared pages divided between the processes that map them. Only available on Linux
+  proportionalSetSize?: number;
 }
 interface ProcessCpuTimes {
   creationTime: number;
@@ -34,6 +221,86 @@ interface ProcessInfo {
   times: ProcessCpuTimes;
 }
 
+// comm is the executable name the kernel keeps (15 characters), cmdline is the command line with arguments
+type ProcessMatch = 'comm' | 'cmdline';
+
+type ProcessKillTarget = {pid: number} | {name: string; match: ProcessMatch};
+
+interface ProcessKillResult {
+  // Exited after SIGTERM within the grace period
+  terminated: number[];
+  // Got SIGKILL
+  killed: number[];
+}
+
+type RestartPolicy = 'never' | 'on-failure' | 'always';
+
+interface ProcessRestartOptions {
+  // on-failure restarts after a non zero exit code or a signal
+  policy: RestartPolicy;
+  // Restarts in a row, a process that has run for a minute starts counting from 0 again
+  maxRestarts?: number;
+  // Delay of the first restart, doubled for every next one in a row up to a minute
+  backoffMs?: number;
+}
+
+interface SupervisedProcessHandle {
+  // Stays the same across restarts, unlike pid
+  id: number;
+  pid: number;
+}
+
+interface SupervisedProcessExit {
+  pid: number;
+  // Only known for processes launched by the supervisor, code is null when a signal has killed the process
+  code?: number | null;
+  signal?: number | null;
+  // Unix time in ms
+  time: number;
+}
+
+type SupervisedExitWait = {exited: false} | (SupervisedProcessExit & {exited: true; restarting: boolean});
+
+interface SupervisedProcess {
+  id: number;
+  pid: number;
+  // Only for processes launched by the supervisor
+  path?: string;
+  running: boolean;
+  restarts: number;
+  restartPending: boolean;
+  lastExit?: SupervisedProcessExit;
+}
+
+interface ProcessSamplerOptions {
+  // Every process when omitted
+  pids?: number[];
+  intervalMs: number;
+  // Samples kept per process
+  historySize: number;
+  // Reads PSS from smaps_rollup, which costs far more than the rest of a sample
+  proportional: boolean;
+}
+
+interface ProcessSample {
+  // Unix time in ms
+  time: number;
+  // Percent of one core since the previous sample
+  cpu: number;
+  residentBytes: number;
+  proportionalBytes: number;
+  threadCount: number;
+  // Only when /proc/<pid>/io is readable
+  readBytes?: number;
+  writeBytes?: number;
+}
+
+interface ProcessHistory {
+  pid: number;
+  // Oldest first
+  samples: ProcessSample[];
+}
+
 interface WindowInfo {
   wid: number;
   pid?: number;
@@ -85,6 +352,11 @@ interface WindowNativeModule {
    * Returns list of windows ID that this process has
    */
   getWindowsByProcessId(pid: number): number[];
+  /**
+   * Windows of the process and of all its descendants, matched against a process tree index that is refreshed
+   * incrementally on every call. Only available on Linux
+   */
+  getWindowsByProcessTreeAsync?(pid: number): Promise<number[]>;
   /**
    * minimizes/maximizes/shows/hides window
    */
@@ -93,6 +365,11 @@ interface WindowNativeModule {
    * Gets all available information for this window (its process id, title, etc)
    */
   getWindowInfo(handle: number): WindowInfo;
+  /**
+   * Gets information of multiple windows in a single call. Windows that fail are skipped.
+   * Only available on Linux, where requests are pipelined over a single X connection
+   */
+  getWindowsInfo?(handles: number[]): WindowInfo[];
   /**
    * Moves and resizes windows to specified value
    */
@@ -112,11 +389,24 @@ interface WindowNativeModule {
    */
   createTestWindow(): number;
 
+  /**
+   * Promise variants of the methods above. Native code runs on a separate thread, so the event loop is not blocked
+   * by X server round-trips. Platforms without native variants get them from withAsyncFallbacks
+   */
+  setWindowActiveAsync(handle: number): Promise<void>;
+  getWindowActiveIdAsync(): Promise<number>;
+  getWindowsByProcessIdAsync(pid: number): Promise<number[]>;
+  setWindowStateAsync(handle: number, visibility: WindowAction): Promise<void>;
+  getWindowInfoAsync(handle: number): Promise<WindowInfo>;
+  getWindowsInfoAsync?(handles: number[]): Promise<WindowInfo[]>;
+  setWindowBoundsAsync(handle: number, bounds: WindowBounds): Promise<void>;
+  setWindowOpacityAsync(handle: number, opacity: number): Promise<void>;
+
 }
 
 interface MonitorNativeModule {
   /**
-   * Returns all monitors id (actually connected displays)
+   * Returns all monitors id (actually connected displays). On Linux ids are RandR CRTCs
    */
   getMonitors?(): number[];
   /**
@@ -128,6 +418,13 @@ interface MonitorNativeModule {
    * Returns minimal information about monitor by its id
    */
   getMonitorInfo(monitor: number): MonitorInfo;
+
+  /**
+   * Promise variants of the methods above, run off the event loop
+   */
+  getMonitorsAsync?(): Promise<number[]>;
+  getMonitorFromWindowAsync?(handle: number): Promise<number>;
+  getMonitorInfoAsync(monitor: number): Promise<MonitorInfo>;
 }
 
 interface ProcessNativeModule {
@@ -142,12 +439,80 @@ interface ProcessNativeModule {
    * Gets detailed information about a process
    */
   getProcessInfo(pid: number): ProcessInfo;
+
+  /**
+   * Promise variant of getProcessInfo, runs off the event loop
+   */
+  getProcessInfoAsync(pid: number): Promise<ProcessInfo>;
+
+  /**
+   * Information about many processes in one call, processes that are gone or not readable are skipped.
+   * Only available on Linux
+   */
+  getProcessesInfoAsync?(pids: number[]): Promise<ProcessInfo[]>;
+}
+
+interface ProcessTableNativeModule {
+  /**
+   * Pids of processes whose comm or cmdline contains name, read from /proc without spawning pgrep. Only available on Linux
+   */
+  findProcessesAsync?(name: string, match: ProcessMatch): Promise<number[]>;
+
+  /**
+   * Sends SIGTERM and SIGKILL to processes that haven't exited after graceMs, graceMs 0 sends SIGKILL right away.
+   * Processes that are not found are left out of the result. Only available on Linux
+   */
+  killProcessesAsync?(target: ProcessKillTarget, graceMs: number): Promise<ProcessKillResult>;
+}
+
+interface ProcessSamplerNativeModule {
+  /**
+   * Samples CPU, memory, IO and threads of the processes every interval on a native thread and keeps the last
+   * historySize samples of each one. Restarts the sampler if it's running. Only available on Linux
+   */
+  startProcessSampler?(options: ProcessSamplerOptions): void;
+
+  /**
+   * Stops sampling and drops the history
+   */
+  stopProcessSampler?(): void;
+
+  /**
+   * Last limit samples of the pids or of every sampled process, throws if the sampler is not running
+   */
+  getProcessSamples?(pids?: number[], limit?: number): ProcessHistory[];
+}
+
+interface ProcessSupervisorNativeModule {
+  /**
+   * Launches a detached process with ignored stdio and waits for its pidfd on a native epoll thread, restarting it
+   * according to restart. Throws if the executable can't be started. Only available on Linux
+   */
+  launchSupervisedProcess?(path: string, args: string[], restart?: ProcessRestartOptions): SupervisedProcessHandle;
+
+  /**
+   * Watches a running process launched by someone else, its exit code is not known. Reuses the id of a supervised pid
+   */
+  superviseProcess?(pid: number): SupervisedProcessHandle;
+
+  /**
+   * Resolves on the next exit of the process, right away if it has exited for good, or with exited false on timeout
+   */
+  waitForSupervisedExitAsync?(id: number, timeoutMs: number): Promise<SupervisedExitWait>;
+
+  getSupervisedProcesses?(): SupervisedProcess[];
+
+  /**
+   * Stops supervising and cancels restarts, returns false if the id is not supervised
+   */
+  releaseSupervisedProcess?(id: number): boolean;
 }
 
 interface KeyboardNativeModule {
   /**
    * Check whether keyboard layout is properly set and capslock is disabled
-   * and types text as fast as possible
+   * and types text as fast as possible.
+   * On Linux any unicode text can be typed, characters missing in the layout are bound to spare keycodes
    */
   typeString(text: string): void;
   /**
@@ -162,6 +527,14 @@ interface KeyboardNativeModule {
    * Switches keyboard layout to specified one. Note that there are limited set of supported layouts
    */
   setKeyboardLayout(layout: string): void;
+
+  /**
+   * Promise variants of the methods above. Events from all of them are sent in the order of calls
+   */
+  typeStringAsync(text: string): Promise<void>;
+  keyTapAsync(key: string, modifiers: string[]): Promise<void>;
+  keyToggleAsync(key: string, modifiers: string[], down: boolean): Promise<void>;
+  setKeyboardLayoutAsync(layout: string): Promise<void>;
 }
 
 interface MouseNativeModule {
@@ -179,14 +552,128 @@ interface MouseNativeModule {
    * Returns X,Y coordinates of the mouse
    */
   getMousePosition(): MousePosition;
+
+  /**
+   * Promise variants of the methods above, run off the event loop in the order of calls
+   */
+  setMouseButtonToStateAsync(button: MouseButton, isDown: boolean): Promise<void>;
+  setMousePositionAsync(pos: MousePosition): Promise<void>;
+  getMousePositionAsync(): Promise<MousePosition>;
+
+  /**
+   * Moves mouse along a human-like curve generated and paced natively on a separate thread.
+   * Resolves when the pointer reaches the destination. Only available on Linux
+   */
+  mouseMoveHumanAsync?(move: HumanMouseMove): Promise<void>;
+}
+
+interface InputNativeModule {
+  /**
+   * Replays events at their offsets on a dedicated thread. Resolves with requested vs actual offset of every event.
+   * id must not be used by another queued or playing timeline. Only available on Linux
+   */
+  playInputTimelineAsync?(id: number, events: InputTimelineEvent[]): Promise<InputTimelineResult>;
+
+  /**
+   * Stops the timeline, its promise resolves with cancelled = true. Returns false if there's no such timeline
+   */
+  cancelInputTimeline?(id: number): boolean;
+}
+
+interface CaptureNativeModule {
+  /**
+   * Captures the whole screen when target is omitted, a monitor or a rectangle clipped to the screen.
+   * data shares memory with the X server until it's garbage collected, so don't hold it longer than needed.
+   * Only available on Linux
+   */
+  captureScreenAsync?(target?: CaptureTarget): Promise<CaptureFrame>;
+
+  /**
+   * Captures like captureScreenAsync, then resizes and encodes the image on native threads. Only available on Linux
+   */
+  captureImageAsync?(target: CaptureTarget | undefined, options: ImageEncodeOptions): Promise<EncodedImage>;
+}
+
+interface PixelNativeModule {
+  /**
+   * Color of a screen pixel. Only available on Linux
+   */
+  getPixelAsync?(x: number, y: number): Promise<PixelColor>;
+
+  /**
+   * Colors of screen pixels in the order of points, nearby points are read with a single capture. Only available on Linux
+   */
+  getPixelsAsync?(points: MousePosition[]): Promise<PixelColor[]>;
+
+  /**
+   * Polls the region on a native thread until one of its pixels matches the color or timeout passes. Only available on Linux
+   */
+  waitForPixelAsync?(request: PixelWaitRequest): Promise<PixelWaitResult>;
+}
+
+interface TemplateMatchNativeModule {
+  /**
+   * Finds a PNG or JPEG image on the screen, best matches first. The last match of every template is remembered
+   * and checked first on the next search of the same template. Only available on Linux
+   */
+  findTemplateAsync?(image: Buffer, options: TemplateSearchOptions): Promise<TemplateMatch[]>;
+}
+
+interface DamageNativeModule {
+  /**
+   * Resolves once nothing was drawn to the window or the screen region for quietMs, using XDamage events
+   * instead of comparing screenshots. Only available on Linux
+   */
+  waitForIdleAsync?(request: IdleWaitRequest): Promise<IdleWaitResult>;
+}
+
+interface ScreenStreamNativeModule {
+  /**
+   * Starts tracking damage of the area, frames are pulled with nextScreenFrameAsync. Only available on Linux
+   */
+  openScreenStream?(target: CaptureTarget | undefined, options: ScreenStreamOptions): ScreenStreamInfo;
+
+  /**
+   * Resolves once the area has changed since the previous frame, with only the changed part captured and encoded.
+   * full requests the whole area. Only one frame of a stream can be pending
+   */
+  nextScreenFrameAsync?(id: number, full: boolean): Promise<StreamFrame>;
+
+  /**
+   * Stops the stream, its pending frame is rejected
+   */
+  closeScreenStream?(id: number): void;
+}
+
+interface FrameSocketNativeModule {
+  /**
+   * Shares captures with local processes: clients of the Unix socket get a memfd ring the X server captures into,
+   * nothing is encoded or copied. Only available on Linux
+   */
+  startFrameSocket?(options: FrameSocketOptions): FrameSocketInfo;
+
+  /**
+   * Disconnects clients and removes the socket
+   */
+  stopFrameSocket?(): void;
 }
 
 interface INativeModule extends
   WindowNativeModule,
   MonitorNativeModule, 
   ProcessNativeModule, 
+  ProcessTableNativeModule,
+  ProcessSamplerNativeModule,
+  ProcessSupervisorNativeModule,
   KeyboardNativeModule, 
-  MouseNativeModule 
+  MouseNativeModule,
+  InputNativeModule,
+  CaptureNativeModule,
+  PixelNativeModule,
+  TemplateMatchNativeModule,
+  DamageNativeModule,
+  ScreenStreamNativeModule,
+  FrameSocketNativeModule
 {
   // Path to the native module
   path: string;
@@ -202,8 +689,51 @@ export type {
   WindowNativeModule,
   MonitorNativeModule,
   ProcessNativeModule,
+  ProcessTableNativeModule,
+  ProcessMatch,
+  ProcessKillTarget,
+  ProcessKillResult,
+  ProcessSamplerNativeModule,
+  ProcessSamplerOptions,
+  ProcessSample,
+  ProcessHistory,
+  ProcessSupervisorNativeModule,
+  RestartPolicy,
+  ProcessRestartOptions,
+  SupervisedProcessHandle,
+  SupervisedProcessExit,
+  SupervisedExitWait,
+  SupervisedProcess,
   KeyboardNativeModule,
   MouseNativeModule,
+  HumanMouseMove,
+  InputNativeModule,
+  InputTimelineEvent,
+  InputTimelineResult,
+  CaptureNativeModule,
+  CaptureTarget,
+  CaptureFrame,
+  ImageFormat,
+  ImageEncodeOptions,
+  EncodedImage,
+  PixelNativeModule,
+  PixelColor,
+  PixelWaitRequest,
+  PixelWaitResult,
+  TemplateMatchNativeModule,
+  TemplateMatch,
+  TemplateSearchOptions,
+  DamageNativeModule,
+  IdleWaitRequest,
+  IdleWaitResult,
+  ScreenStreamNativeModule,
+  ScreenStreamOptions,
+  ScreenStreamInfo,
+  StreamTile,
+  StreamFrame,
+  FrameSocketNativeModule,
+  FrameSocketOptions,
+  FrameSocketInfo,
 };
 
 export {WindowAction, Native, MouseButton};
@@ -1,5 +1,6 @@
 import {Global, Inject, Logger, Module, type OnModuleInit} from '@nestjs/common';
 import {INativeModule, Native} from '@/native/native-model';
+import {withAsyncFallbacks} from '@/native/native-async';
 import clc from 'cli-color';
 import os from 'os';
 import {getAsset, isSea} from 'node:sea';
@@ -21,12 +22,12 @@ import {writeFile, mkdtemp} from 'node:fs/promises';
           await writeFile(pathOnDisk, Buffer.from(getAsset('native')));
           const requireFromHere = createRequire(__filename);
           // eslint-disable-next-line
-          return requireFromHere(pathOnDisk) as INativeModule;
+          return withAsyncFallbacks(requireFromHere(pathOnDisk) as INativeModule);
         }
         // eslint-disable-next-line
         const bindings = require('bindings') as any;
         // eslint-disable-next-line
-        return bindings('native') as INativeModule;
+        return withAsyncFallbacks(bindings('native') as INativeModule);
       },
     },
   ],
@@ -1,4 +1,5 @@
 import {
+  Inject,
   Injectable,
   Logger,
   RequestTimeoutException,
@@ -7,17 +8,56 @@ import {
 } from '@nestjs/common';
 import {spawn} from 'child_process';
 import {LaunchExeRequest} from '@/process/process-dto';
+import {Native, ProcessSupervisorNativeModule, SupervisedProcessHandle} from '@/native/native-model';
 
 @Injectable()
 export class LauncherService {
   constructor(
-    private readonly logger: Logger
+    private readonly logger: Logger,
+    @Inject(Native)
+    private readonly native: ProcessSupervisorNativeModule,
   ) {
   }
 
   async launchExe(data: LaunchExeRequest): Promise<number> {
+    this.logger.log(`Launching: \u001b[35m${data.path} ${data.arguments!.join(' ')}`);
+    if (this.native.launchSupervisedProcess) {
+      return this.launchSupervised(data);
+    }
+    return this.launchDetached(data);
+  }
+
+  // The native supervisor waits on a pidfd of the process, so its exit is seen as it happens with the exact status
+  private async launchSupervised(data: LaunchExeRequest): Promise<number> {
+    let launched: SupervisedProcessHandle;
+    try {
+      launched = this.native.launchSupervisedProcess!(data.path, data.arguments!, data.restart);
+    } catch (e) {
+      this.logger.error(`Failed to launch process: ${(e as Error).message}`);
+      throw new ServiceUnavailableException(`Failed to start process: ${(e as Error).message}`);
+    }
+    const result = await this.native.waitForSupervisedExitAsync!(launched.id, data.waitTimeout!);
+    if (!result.exited) {
+      if (data.waitTillFinish) {
+        throw new RequestTimeoutException(`Process ${launched.pid} is still running after awaiting ${data.waitTimeout}ms`);
+      }
+      this.logger.debug(`Process started successfully: ${data.path}`);
+      return launched.pid;
+    }
+    if (!result.restarting) {
+      this.native.releaseSupervisedProcess!(launched.id);
+    }
+    if (result.code === 0) {
+      return launched.pid;
+    }
+    if (result.signal) {
+      throw new UnprocessableEntityException(`Process killed by signal ${result.signal}`);
+    }
+    throw new UnprocessableEntityException(`Process exit with code ${result.code}`);
+  }
+
+  private async launchDetached(data: LaunchExeRequest): Promise<number> {
     return new Promise((resolve, reject) => {
-      this.logger.log(`Launching: \u001b[35m${data.path} ${data.arguments!.join(' ')}`);
       try {
         const process = spawn(data.path, data.arguments!, {
           detached: true, // Run independently from parent process
@@ -6,7 +6,7 @@ import {LauncherService} from '@/process/launcher-service';
 import {LaunchExeRequest} from '@/process/process-dto';
 
 @Injectable()
-export class ExecuteLinuxDarwinService implements IExecuteService {
+export class ExecuteDarwinService implements IExecuteService {
   constructor(
     private readonly logger: Logger,
     private readonly launcher: LauncherService
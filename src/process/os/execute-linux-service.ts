@@ -0,0 +1,53 @@
+import {BadRequestException, Injectable, InternalServerErrorException, Logger} from '@nestjs/common';
+import {IExecuteService} from '@/process/process-model';
+import {LauncherService} from '@/process/launcher-service';
+import {LaunchExeRequest} from '@/process/process-dto';
+import {ProcessKillResult, ProcessKillTarget, ProcessTableNativeModule} from '@/native/native-model';
+
+/**
+ * Finds and kills processes through the native /proc scanner instead of spawning pgrep/pkill
+ */
+@Injectable()
+export class ExecuteLinuxService implements IExecuteService {
+  constructor(
+    private readonly logger: Logger,
+    private readonly launcher: LauncherService,
+    private readonly native: ProcessTableNativeModule,
+  ) {
+  }
+
+  async launchExe(data: LaunchExeRequest): Promise<number> {
+    return this.launcher.launchExe(data);
+  }
+
+  async killExeByName(name: string, graceMs = 0): Promise<void> {
+    this.logger.log(`Kill ${name}`);
+    // Same as pkill, matches the executable name
+    await this.kill({name, match: 'comm'}, graceMs, `"${name}"`);
+  }
+
+  async findPidByName(name: string): Promise<number[]> {
+    // Same as pgrep -f, matches the whole command line
+    const pids = await this.native.findProcessesAsync!(name, 'cmdline');
+    this.logger.debug(`Process "${name}" returned`, pids);
+    return pids;
+  }
+
+  async killExeByPid(pid: number, graceMs = 0): Promise<void> {
+    this.logger.log(`Kill ${pid}`);
+    await this.kill({pid}, graceMs, `"${pid}"`);
+  }
+
+  private async kill(target: ProcessKillTarget, graceMs: number, description: string): Promise<void> {
+    let result: ProcessKillResult;
+    try {
+      result = await this.native.killProcessesAsync!(target, graceMs);
+    } catch (e) {
+      throw new InternalServerErrorException(e);
+    }
+    if (result.terminated.length === 0 && result.killed.length === 0) {
+      throw new BadRequestException(`Unable to kill ${description} since it's not found`);
+    }
+    this.logger.debug(`Process ${description} killed successfully:`, result);
+  }
+}
@@ -4,8 +4,18 @@ import {ProcessService} from '@/process/process-service';
 import {
   CreateProcessResponseDto,
   ExecutableNameRequestDto,
+  GetProcessesInfoRequestDto,
+  KillExeByNameRequestDto,
+  KillProcessRequestDto,
   LaunchExeRequestDto,
+  ProcessHistoryResponseDto,
+  ProcessInfoResponseDto,
   ProcessResponseDto,
+  ProcessSamplesQueryDto,
+  StartSamplerRequestDto,
+  SuperviseProcessRequestDto,
+  SuperviseProcessResponseDto,
+  SupervisedProcessResponseDto,
 } from '@/process/process-dto';
 import {ExecuteService, IExecuteService} from '@/process/process-model';
 
@@ -19,13 +29,63 @@ export class ProcessController {
   ) {
   }
 
+  @Post('sampler')
+  @ApiOperation({summary: 'Starts sampling CPU, memory, IO and threads of processes in the background, replaces the running sampler'})
+  @HttpCode(204)
+  startSampler(@Body() body: StartSamplerRequestDto): void {
+    this.processService.startSampler(body);
+  }
+
+  @Delete('sampler')
+  @ApiOperation({summary: 'Stops sampling and drops the history'})
+  @HttpCode(204)
+  stopSampler(): void {
+    this.processService.stopSampler();
+  }
+
+  @Get('samples')
+  @ApiResponse({type: ProcessHistoryResponseDto, isArray: true})
+  @ApiOperation({summary: 'Returns recent samples of the sampled processes in one call'})
+  getSamples(@Query() query: ProcessSamplesQueryDto): ProcessHistoryResponseDto[] {
+    return this.processService.getSamples(query);
+  }
+
+  @Get('supervised')
+  @ApiResponse({type: SupervisedProcessResponseDto, isArray: true})
+  @ApiOperation({summary: 'Lists processes watched by the supervisor: launched ones, adopted ones and recently exited ones'})
+  getSupervised(): SupervisedProcessResponseDto[] {
+    return this.processService.getSupervised();
+  }
+
+  @Post('supervised')
+  @ApiResponse({type: SuperviseProcessResponseDto})
+  @ApiOperation({summary: 'Watches a running process, its exit shows up in the supervised list. Returns its supervisor id'})
+  supervise(@Body() body: SuperviseProcessRequestDto): SuperviseProcessResponseDto {
+    return this.processService.supervise(body);
+  }
+
+  @Delete('supervised/:id')
+  @ApiOperation({summary: 'Stops supervising a process and cancels its restarts, the process keeps running'})
+  @HttpCode(204)
+  releaseSupervised(@Param('id', ParseIntPipe) id: number): void {
+    this.processService.releaseSupervised(id);
+  }
+
   @Get(':pid')
   @ApiOperation({summary: 'Gets process information along with windows attached to it'})
   @ApiResponse({type: ProcessResponseDto})
-  getProcessInfo(@Param('pid', ParseIntPipe) id: number): ProcessResponseDto {
+  async getProcessInfo(@Param('pid', ParseIntPipe) id: number): Promise<ProcessResponseDto> {
     return this.processService.getProcessInfo(id);
   }
 
+  @Post('by-pids')
+  @ApiResponse({type: ProcessInfoResponseDto, isArray: true})
+  @ApiOperation({summary: 'Gets information about multiple processes in one call. Processes that are not found are skipped'})
+  @HttpCode(200)
+  async getProcessesInfo(@Body() body: GetProcessesInfoRequestDto): Promise<ProcessInfoResponseDto[]> {
+    return this.processService.getProcessesInfo(body);
+  }
+
   @Post()
   @ApiOperation({summary: 'Launches an application'})
   @ApiResponse({type: CreateProcessResponseDto})
@@ -36,8 +96,8 @@ export class ProcessController {
   @Delete()
   @ApiOperation({summary: 'Kill process by name'})
   @HttpCode(204)
-  async killExeByName(@Query() query: ExecutableNameRequestDto): Promise<void> {
-    await this.executionService.killExeByName(query.name);
+  async killExeByName(@Query() query: KillExeByNameRequestDto): Promise<void> {
+    await this.executionService.killExeByName(query.name, query.graceMs);
   }
 
   @Get()
@@ -50,7 +110,7 @@ export class ProcessController {
   @Delete(':pid')
   @ApiOperation({summary: 'Kill process by PID'})
   @HttpCode(204)
-  async killExeByPid(@Param('pid', ParseIntPipe) pid: number): Promise<void> {
-    await this.executionService.killExeByPid(pid);
+  async killExeByPid(@Param('pid', ParseIntPipe) pid: number, @Query() query: KillProcessRequestDto): Promise<void> {
+    await this.executionService.killExeByPid(pid, query.graceMs);
   }
 }
@@ -7,6 +7,8 @@ const memorySchema = z.object({
   peakWorkingSetSize: z.number().describe('Maximum Amount of physical Ram the process has ever used'),
   privateUsage: z.number().describe('Memory that is private to this process (not shareable with other processes). E.g. heap/stacks'),
   pageFileUsage: z.number().describe('Total virtual memory used by the process (including paged to disk)'),
+  proportionalSetSize: z.number().optional()
+    .describe('Resident memory where pages shared with other processes are divided between them, in Bytes. Only on Linux'),
 }).describe('Process information');
 
 const timesSchema = z.object({
@@ -28,12 +30,58 @@ const processSchema = z.object({
   wids: z.array(z.number()).describe('List of all windows id of the process'),
 }).describe('Process information');
 
+const processInfoSchema = processSchema.omit({wids: true}).describe('Process information without its windows');
+
+const getProcessesInfoRequestSchema = z.object({
+  pids: z.array(z.number().int().positive()).min(1).max(1000).describe('List of process ids to get information about'),
+}).strict();
+
+const startSamplerRequestSchema = z.object({
+  pids: z.array(z.number().int().positive()).min(1).max(10000).optional()
+    .describe('Processes to sample. Every process when omitted, processes started later are picked up on the next sample'),
+  intervalMs: z.number().int().min(100).max(60000).default(1000).describe('Time between samples in milliseconds'),
+  historySize: z.number().int().min(1).max(3600).default(60).describe('Number of last samples kept per process'),
+  proportional: z.boolean().default(false)
+    .describe('Samples PSS (shared memory divided between processes). Reading it walks page tables, so it is much slower'),
+}).strict();
+
+const processSamplesQuerySchema = z.object({
+  pids: z.string().regex(/^\d+(,\d+)*$/u).optional()
+    .transform((pids) => pids?.split(',').map((pid) => parseInt(pid, 10)))
+    .describe('Comma separated process ids, every sampled process when omitted'),
+  limit: z.coerce.number().int().min(1).max(3600).optional().describe('Number of last samples per process'),
+});
+
+const processSampleSchema = z.object({
+  time: z.number().describe('Unix time of the sample in milliseconds'),
+  cpu: z.number().describe('CPU usage since the previous sample in percent of one core, may exceed 100 on several cores'),
+  residentBytes: z.number().describe('Memory resident in RAM in Bytes'),
+  proportionalBytes: z.number().describe('PSS in Bytes if proportional sampling is on and readable, resident memory otherwise'),
+  threadCount: z.number().describe('Number of threads'),
+  readBytes: z.number().optional().describe('Bytes read from storage since the process has started. Only for processes of the same user'),
+  writeBytes: z.number().optional().describe('Bytes written to storage since the process has started. Only for processes of the same user'),
+});
+
+const processHistorySchema = z.object({
+  // eslint-disable-next-line sonarjs/no-duplicate-string
+  pid: z.number().describe('Process ID'),
+  samples: z.array(processSampleSchema).describe('Samples, oldest first'),
+}).describe('Recent samples of a process');
 
 const createProcessResponseSchema = z.object({
   // eslint-disable-next-line sonarjs/no-duplicate-string
   pid: z.number().describe('Process ID'),
 }).describe('Information about created process');
 
+const restartPolicySchema = z.object({
+  policy: z.enum(['never', 'on-failure', 'always'])
+    .describe('When to restart the process after it exits. on-failure restarts after a non zero exit code or a signal'),
+  maxRestarts: z.number().int().min(0).max(1000).default(5)
+    .describe('Restarts in a row before giving up. A process that has run for a minute starts counting from 0 again'),
+  backoffMs: z.number().int().min(0).max(60000).default(1000)
+    .describe('Delay before the first restart in miliseconds, doubled for every next restart in a row up to a minute'),
+}).describe('Restart policy of a supervised process');
+
 const launchExeRequestSchema = z.object({
   path: z.string().describe('Path to executable'),
   arguments: z.array(z.string()).default([]).optional().describe('Command line arguments'),
@@ -44,33 +92,110 @@ const launchExeRequestSchema = z.object({
       'If waitTillFinish = false awaits this timeout before getting process id. ' +
       'If waitTillFinish = true awaits maximum of this timeout to allow process to finish. ' +
       'If process failed to finish before it, throws error.'),
+  restart: restartPolicySchema.optional()
+    .describe('Restarts the process when it exits. Only supported on Linux, where launched processes are supervised'),
 });
 
+const supervisedProcessExitSchema = z.object({
+  pid: z.number().describe('Process ID of the exited run'),
+  code: z.number().nullable().optional().describe('Exit code, null if a signal has killed the process. Only known for launched processes'),
+  signal: z.number().nullable().optional().describe('Signal that has killed the process. Only known for launched processes'),
+  time: z.number().describe('Unix time in ms'),
+});
+
+const supervisedProcessSchema = z.object({
+  id: z.number().describe('Supervisor ID, stays the same across restarts'),
+  pid: z.number().describe('Process ID of the current or the last run'),
+  path: z.string().optional().describe('Executable path, only for launched processes'),
+  running: z.boolean().describe('Whether the process is running'),
+  restarts: z.number().describe('Number of restarts'),
+  restartPending: z.boolean().describe('Whether a restart is scheduled after a backoff'),
+  lastExit: supervisedProcessExitSchema.optional().describe('Last exit of the process'),
+}).describe('Process watched by the supervisor');
+
+const superviseProcessRequestSchema = z.object({
+  pid: z.number().int().positive().describe('Process ID of a running process'),
+});
+
+const superviseProcessResponseSchema = supervisedProcessSchema.pick({id: true, pid: true})
+  .describe('Supervisor ID of the process');
+
 const executableNameSchema = z.object({
   name: z.string().regex(/^[a-zA-Z0-9._ -]+$/u).describe('Process name. Allows only specific symbols due to security reasons'),
 });
 
+const killProcessSchema = z.object({
+  graceMs: z.coerce.number().int().min(0).max(60000).default(0)
+    .describe('Sends SIGTERM and waits this long in milliseconds for the process to exit before killing it. ' +
+      '0 kills right away. Only supported on Linux, other platforms always kill right away'),
+});
+
+const killExeByNameSchema = executableNameSchema.merge(killProcessSchema);
+
 
 class LaunchExeRequestDto extends createZodDto(launchExeRequestSchema) {}
 class ExecutableNameRequestDto extends createZodDto(executableNameSchema) {}
+class KillProcessRequestDto extends createZodDto(killProcessSchema) {}
+class KillExeByNameRequestDto extends createZodDto(killExeByNameSchema) {}
 class CreateProcessResponseDto extends createZodDto(createProcessResponseSchema) {}
 class ProcessResponseDto extends createZodDto(processSchema) {}
+class ProcessInfoResponseDto extends createZodDto(processInfoSchema) {}
+class GetProcessesInfoRequestDto extends createZodDto(getProcessesInfoRequestSchema) {}
+class StartSamplerRequestDto extends createZodDto(startSamplerRequestSchema) {}
+class ProcessSamplesQueryDto extends createZodDto(processSamplesQuerySchema) {}
+class ProcessHistoryResponseDto extends createZodDto(processHistorySchema) {}
+class SupervisedProcessResponseDto extends createZodDto(supervisedProcessSchema) {}
+class SuperviseProcessRequestDto extends createZodDto(superviseProcessRequestSchema) {}
+class SuperviseProcessResponseDto extends createZodDto(superviseProcessResponseSchema) {}
 
 type LaunchExeRequest = z.infer<typeof launchExeRequestSchema>;
 type ProcessResponse = z.infer<typeof processSchema>;
+type ProcessInfoResponse = z.infer<typeof processInfoSchema>;
+type GetProcessesInfoRequest = z.infer<typeof getProcessesInfoRequestSchema>;
+type StartSamplerRequest = z.infer<typeof startSamplerRequestSchema>;
+type ProcessSamplesQuery = z.infer<typeof processSamplesQuerySchema>;
+type ProcessHistoryResponse = z.infer<typeof processHistorySchema>;
 type CreateProcessResponse = z.infer<typeof createProcessResponseSchema>;
+type SupervisedProcessResponse = z.infer<typeof supervisedProcessSchema>;
+type SuperviseProcessRequest = z.infer<typeof superviseProcessRequestSchema>;
+type SuperviseProcessResponse = z.infer<typeof superviseProcessResponseSchema>;
 
 export {
   launchExeRequestSchema,
   executableNameSchema,
+  killProcessSchema,
+  killExeByNameSchema,
+  getProcessesInfoRequestSchema,
+  startSamplerRequestSchema,
+  processSamplesQuerySchema,
+  restartPolicySchema,
+  superviseProcessRequestSchema,
   LaunchExeRequestDto,
   CreateProcessResponseDto,
   ExecutableNameRequestDto,
+  KillProcessRequestDto,
+  KillExeByNameRequestDto,
   ProcessResponseDto,
+  ProcessInfoResponseDto,
+  GetProcessesInfoRequestDto,
+  StartSamplerRequestDto,
+  ProcessSamplesQueryDto,
+  ProcessHistoryResponseDto,
+  SupervisedProcessResponseDto,
+  SuperviseProcessRequestDto,
+  SuperviseProcessResponseDto,
 };
 
 export type {
   ProcessResponse,
+  ProcessInfoResponse,
+  GetProcessesInfoRequest,
+  StartSamplerRequest,
+  ProcessSamplesQuery,
+  ProcessHistoryResponse,
   CreateProcessResponse,
+  SupervisedProcessResponse,
+  SuperviseProcessRequest,
+  SuperviseProcessResponse,
   LaunchExeRequest,
 };
@@ -3,9 +3,12 @@ import type {LaunchExeRequest} from '@/process/process-dto';
 export interface IExecuteService {
   launchExe(data: LaunchExeRequest): Promise<number>;
 
-  killExeByName(name: string): Promise<void>;
+  /**
+   * graceMs gives processes time to exit after SIGTERM before they are killed, only Linux supports it
+   */
+  killExeByName(name: string, graceMs?: number): Promise<void>;
 
-  killExeByPid(pid: number): Promise<void>;
+  killExeByPid(pid: number, graceMs?: number): Promise<void>;
 
   findPidByName(name: string): Promise<number[]>;
 }
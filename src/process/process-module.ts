@@ -5,7 +5,9 @@ import os from 'os';
 import {LauncherService} from '@/process/launcher-service';
 import {ExecuteService, IExecuteService} from '@/process/process-model';
 import {ExecuteWin32Service} from '@/process/os/execute-win32-service';
-import {ExecuteLinuxDarwinService} from '@/process/os/execute-linux-darwin-service';
+import {ExecuteDarwinService} from '@/process/os/execute-darwin-service';
+import {ExecuteLinuxService} from '@/process/os/execute-linux-service';
+import {Native, ProcessTableNativeModule} from '@/native/native-model';
 
 @Module({
   controllers: [ProcessController],
@@ -13,13 +15,15 @@ import {ExecuteLinuxDarwinService} from '@/process/os/execute-linux-darwin-servi
     LauncherService,
     {
       provide: ExecuteService,
-      inject: [Logger, LauncherService],
-      useFactory: (logger: Logger, launcher: LauncherService): IExecuteService => {
+      inject: [Logger, LauncherService, Native],
+      useFactory: (logger: Logger, launcher: LauncherService, native: ProcessTableNativeModule): IExecuteService => {
         const platform = os.platform();
         if (platform === 'win32') {
           return new ExecuteWin32Service(logger, launcher);
-        } else if (platform === 'linux' || platform === 'darwin') {
-          return new ExecuteLinuxDarwinService(logger, launcher);
+        } else if (platform === 'linux') {
+          return new ExecuteLinuxService(logger, launcher, native);
+        } else if (platform === 'darwin') {
+          return new ExecuteDarwinService(logger, launcher);
         }
         throw new NotImplementedException(`Unsupported platform: ${platform}`);
       },
@@ -1,8 +1,26 @@
 import {Inject, Injectable, Logger} from '@nestjs/common';
-import {Native, ProcessNativeModule, WindowNativeModule} from '@/native/native-model';
+import {
+  Native,
+  ProcessNativeModule,
+  ProcessSamplerNativeModule,
+  ProcessSupervisorNativeModule,
+  WindowNativeModule,
+} from '@/native/native-model';
 import {Safe400} from '@/utils/decorators';
 import {OS_INJECT} from '@/global/global-model';
-import {CreateProcessResponse, LaunchExeRequest, ProcessResponse} from '@/process/process-dto';
+import {
+  CreateProcessResponse,
+  GetProcessesInfoRequest,
+  LaunchExeRequest,
+  ProcessHistoryResponse,
+  ProcessInfoResponse,
+  ProcessResponse,
+  ProcessSamplesQuery,
+  StartSamplerRequest,
+  SuperviseProcessRequest,
+  SuperviseProcessResponse,
+  SupervisedProcessResponse,
+} from '@/process/process-dto';
 import {ExecuteService, IExecuteService} from '@/process/process-model';
 
 @Injectable()
@@ -15,6 +33,10 @@ export class ProcessService {
     private readonly addonProcess: ProcessNativeModule,
     @Inject(Native)
     private readonly addonWindow: WindowNativeModule,
+    @Inject(Native)
+    private readonly addonSampler: ProcessSamplerNativeModule,
+    @Inject(Native)
+    private readonly addonSupervisor: ProcessSupervisorNativeModule,
     @Inject(OS_INJECT)
     public readonly os: NodeJS.Platform,
   ) {
@@ -27,12 +49,62 @@ export class ProcessService {
   }
 
   @Safe400(['win32', 'linux'])
-  public getProcessInfo(pid: number): ProcessResponse {
-    const info = this.addonProcess.getProcessInfo(pid);
-    const wids = this.addonWindow.getWindowsByProcessId(pid);
+  public async getProcessInfo(pid: number): Promise<ProcessResponse> {
+    const [info, wids] = await Promise.all([
+      this.addonProcess.getProcessInfoAsync(pid),
+      this.addonWindow.getWindowsByProcessIdAsync(pid),
+    ]);
     return {
       ...info,
       wids,
     };
   }
+
+  @Safe400(['win32', 'linux'])
+  public async getProcessesInfo(body: GetProcessesInfoRequest): Promise<ProcessInfoResponse[]> {
+    if (this.addonProcess.getProcessesInfoAsync) {
+      return this.addonProcess.getProcessesInfoAsync(body.pids);
+    }
+    const processes = await Promise.all(body.pids.map(async(pid) => {
+      try {
+        return [await this.addonProcess.getProcessInfoAsync(pid)];
+      } catch (e) {
+        this.logger.debug(`Skipping process ${pid}: ${(e as Error).message}`);
+        return [];
+      }
+    }));
+    return processes.flat();
+  }
+
+  @Safe400(['linux'])
+  public startSampler(body: StartSamplerRequest): void {
+    this.addonSampler.startProcessSampler!(body);
+  }
+
+  @Safe400(['linux'])
+  public stopSampler(): void {
+    this.addonSampler.stopProcessSampler!();
+  }
+
+  @Safe400(['linux'])
+  public getSamples(query: ProcessSamplesQuery): ProcessHistoryResponse[] {
+    return this.addonSampler.getProcessSamples!(query.pids, query.limit);
+  }
+
+  @Safe400(['linux'])
+  public getSupervised(): SupervisedProcessResponse[] {
+    return this.addonSupervisor.getSupervisedProcesses!();
+  }
+
+  @Safe400(['linux'])
+  public supervise(body: SuperviseProcessRequest): SuperviseProcessResponse {
+    return this.addonSupervisor.superviseProcess!(body.pid);
+  }
+
+  @Safe400(['linux'])
+  public releaseSupervised(id: number): void {
+    if (!this.addonSupervisor.releaseSupervisedProcess!(id)) {
+      throw new Error(`Process ${id} is not supervised`);
+    }
+  }
 }
@@ -1,7 +1,12 @@
-import {Body, Controller, Get, HttpCode, Param, ParseIntPipe, Patch, Post} from '@nestjs/common';
+import {Body, Controller, Get, HttpCode, Param, ParseIntPipe, Patch, Post, Query} from '@nestjs/common';
 
 import {ApiOperation, ApiResponse, ApiTags} from '@nestjs/swagger';
-import {GetWindowResponseDto, SetWindowPropertiesRequestDto} from '@/window/window-dto';
+import {
+  GetWindowResponseDto,
+  GetWindowsInfoRequestDto,
+  SetWindowPropertiesRequestDto,
+  WindowsByProcessQueryDto,
+} from '@/window/window-dto';
 import {WindowService} from '@/window/window-service';
 
 @ApiTags('Window')
@@ -15,31 +20,52 @@ export class WindowController {
   @Get('by-wid/:wid')
   @ApiResponse({type: GetWindowResponseDto})
   @ApiOperation({summary: 'Gets window information about specified window'})
-  getWindowInfo(@Param('wid', ParseIntPipe) wid: number): GetWindowResponseDto {
+  async getWindowInfo(@Param('wid', ParseIntPipe) wid: number): Promise<GetWindowResponseDto> {
     return this.windowService.getWindowInfo(wid);
   }
 
+  @Post('by-wids')
+  @ApiResponse({type: GetWindowResponseDto, isArray: true})
+  @ApiOperation({summary: 'Gets information about multiple windows in one call. Windows that are not found are skipped'})
+  @HttpCode(200)
+  async getWindowsInfo(@Body() body: GetWindowsInfoRequestDto): Promise<GetWindowResponseDto[]> {
+    return this.windowService.getWindowsInfo(body);
+  }
+
+  @Get('by-pid/:pid')
+  @ApiResponse({type: Number, isArray: true})
+  @ApiOperation({summary: 'Returns ids of windows that belong to the process, optionally with windows of its descendants'})
+  async getWindowsByProcessId(
+    @Param('pid', ParseIntPipe) pid: number,
+    @Query() query: WindowsByProcessQueryDto,
+  ): Promise<number[]> {
+    if (query.descendants) {
+      return this.windowService.getWindowsByProcessTree(pid);
+    }
+    return this.windowService.getWindowsByProcessId(pid);
+  }
+
   @Get('active')
   @ApiResponse({type: GetWindowResponseDto})
   @ApiOperation({summary: 'Gets information about active window'})
-  getActiveWindowInfo(): GetWindowResponseDto {
+  async getActiveWindowInfo(): Promise<GetWindowResponseDto> {
     return this.windowService.getActiveWindowInfo();
   }
 
   @Patch('by-wid/:wid')
   @ApiOperation({summary: 'Set window properties'})
   @HttpCode(204)
-  setWindowProperties(
+  async setWindowProperties(
     @Param('wid', ParseIntPipe) wid: number,
     @Body() body: SetWindowPropertiesRequestDto
-  ): void {
-    this.windowService.setWindowProperties(wid, body);
+  ): Promise<void> {
+    await this.windowService.setWindowProperties(wid, body);
   }
 
   @Post('by-wid/:wid/focus')
   @ApiOperation({summary: 'Focuses (brings to foreground) a window by its id'})
   @HttpCode(204)
-  setWindowActive(@Param('wid', ParseIntPipe) wid: number): void {
-    this.windowService.setWindowActive(wid);
+  async setWindowActive(@Param('wid', ParseIntPipe) wid: number): Promise<void> {
+    await this.windowService.setWindowActive(wid);
   }
 }
@@ -36,20 +36,40 @@ const setWindowsPropertiesRequestSchema = z.object({
   }
 });
 
+const getWindowsInfoRequestSchema = z.object({
+  wids: z.array(widSchema).min(1).max(1000).describe('List of window ids to get information about'),
+}).strict();
+
+const windowsByProcessQuerySchema = z.object({
+  descendants: z.enum(['true', 'false']).default('false').transform((value) => value === 'true')
+    .describe('Also returns windows of child processes and their children, e.g. of apps started through a launcher. ' +
+      'Only supported on Linux'),
+});
+
 class SetWindowPropertiesRequestDto extends createZodDto(setWindowsPropertiesRequestSchema) {}
 class GetWindowResponseDto extends createZodDto(getWindowResponseShema) {}
+class GetWindowsInfoRequestDto extends createZodDto(getWindowsInfoRequestSchema) {}
+class WindowsByProcessQueryDto extends createZodDto(windowsByProcessQuerySchema) {}
 
 type SetWindowPropertiesRequest = z.infer<typeof setWindowsPropertiesRequestSchema>;
 type WindowResponse = z.infer<typeof getWindowResponseShema>;
+type GetWindowsInfoRequest = z.infer<typeof getWindowsInfoRequestSchema>;
+type WindowsByProcessQuery = z.infer<typeof windowsByProcessQuerySchema>;
 
 export {
   boundsSchema,
   setWindowsPropertiesRequestSchema,
+  getWindowsInfoRequestSchema,
+  windowsByProcessQuerySchema,
   GetWindowResponseDto,
+  GetWindowsInfoRequestDto,
   SetWindowPropertiesRequestDto,
+  WindowsByProcessQueryDto,
 };
 
 export type {
   WindowResponse,
   SetWindowPropertiesRequest,
+  GetWindowsInfoRequest,
+  WindowsByProcessQuery,
 };
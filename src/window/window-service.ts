@@ -1,7 +1,7 @@
 /* eslint-disable max-lines */
 import {Inject, Injectable, Logger} from '@nestjs/common';
 import {INativeModule, Native} from '@/native/native-model';
-import {SetWindowPropertiesRequest, WindowResponse} from '@/window/window-dto';
+import {GetWindowsInfoRequest, SetWindowPropertiesRequest, WindowResponse} from '@/window/window-dto';
 import {Safe400} from '@/utils/decorators';
 import {OS_INJECT} from '@/global/global-model';
 
@@ -17,36 +17,57 @@ export class WindowService {
   }
 
   @Safe400(['win32', 'linux'])
-  public getWindowsByProcessId(pid: number): number[] {
-    return this.addon.getWindowsByProcessId(pid);
+  public async getWindowsByProcessId(pid: number): Promise<number[]> {
+    return this.addon.getWindowsByProcessIdAsync(pid);
+  }
+
+  @Safe400(['linux'])
+  public async getWindowsByProcessTree(pid: number): Promise<number[]> {
+    return this.addon.getWindowsByProcessTreeAsync!(pid);
+  }
+
+  @Safe400(['win32', 'linux'])
+  public async getActiveWindowInfo(): Promise<WindowResponse> {
+    const wid = await this.addon.getWindowActiveIdAsync();
+    return this.addon.getWindowInfoAsync(wid);
   }
 
   @Safe400(['win32', 'linux'])
-  public getActiveWindowInfo(): WindowResponse {
-    const wid = this.addon.getWindowActiveId();
-    return this.addon.getWindowInfo(wid);
+  public async setWindowActive(wid: number): Promise<void> {
+    await this.addon.setWindowActiveAsync(wid);
   }
 
   @Safe400(['win32', 'linux'])
-  public setWindowActive(wid: number): void {
-    this.addon.setWindowActive(wid);
+  public async getWindowInfo(wid: number): Promise<WindowResponse> {
+    return this.addon.getWindowInfoAsync(wid);
   }
 
   @Safe400(['win32', 'linux'])
-  public getWindowInfo(wid: number): WindowResponse {
-    return this.addon.getWindowInfo(wid);
+  public async getWindowsInfo(body: GetWindowsInfoRequest): Promise<WindowResponse[]> {
+    if (this.addon.getWindowsInfoAsync) {
+      return this.addon.getWindowsInfoAsync(body.wids);
+    }
+    const windows = await Promise.all(body.wids.map(async(wid) => {
+      try {
+        return [await this.addon.getWindowInfoAsync(wid)];
+      } catch (e) {
+        this.logger.debug(`Skipping window ${wid}: ${(e as Error).message}`);
+        return [];
+      }
+    }));
+    return windows.flat();
   }
 
   @Safe400(['win32', 'linux'])
-  public setWindowProperties(wid: number, windowState: SetWindowPropertiesRequest): void {
+  public async setWindowProperties(wid: number, windowState: SetWindowPropertiesRequest): Promise<void> {
     if (windowState.opacity) {
-      this.addon.setWindowOpacity(wid, windowState.opacity);
+      await this.addon.setWindowOpacityAsync(wid, windowState.opacity);
     }
     if (windowState.bounds) {
-      this.addon.setWindowBounds(wid, windowState.bounds);
+      await this.addon.setWindowBoundsAsync(wid, windowState.bounds);
     }
     if (windowState.state) {
-      this.addon.setWindowState(wid, windowState.state);
+      await this.addon.setWindowStateAsync(wid, windowState.state);
     }
   }
 
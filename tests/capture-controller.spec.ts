@@ -0,0 +1,563 @@
+import {Test, TestingModule} from '@nestjs/testing';
+import {INestApplication, Logger} from '@nestjs/common';
+import request, {Response} from 'supertest';
+import {CaptureController} from '../src/capture/capture-controller';
+import {CaptureService} from '../src/capture/capture-service';
+import {CaptureStreamService} from '../src/capture/capture-stream-service';
+import {MouseService} from '../src/mouse/mouse-service';
+import {CaptureTarget, INativeModule, Native} from '../src/native/native-model';
+import {OS_INJECT} from '../src/global/global-model';
+import {createMockNativeService, createMockLogger, setupValidationPipe} from './test-utils';
+
+describe('CaptureController (e2e)', () => {
+  let app: INestApplication;
+  let logger: jest.Mocked<Logger>;
+  let nativeService: jest.Mocked<INativeModule>;
+
+  beforeAll(async () => {
+    const mockNativeService = createMockNativeService();
+    mockNativeService.captureScreenAsync = jest.fn().mockImplementation(async(target?: CaptureTarget) => ({
+      x: 0,
+      y: 0,
+      width: 2,
+      height: 1,
+      stride: 8,
+      format: 'bgra',
+      data: Buffer.from([1, 2, 3, 255, 4, 5, 6, 255]),
+    }));
+    mockNativeService.captureImageAsync = jest.fn().mockImplementation(async(target, options) => ({
+      width: options.width ?? 2,
+      height: options.height ?? 1,
+      format: options.format,
+      data: Buffer.from([0x89, 0x50, 0x4E, 0x47]),
+    }));
+    mockNativeService.getPixelAsync = jest.fn().mockResolvedValue({r: 255, g: 128, b: 0});
+    mockNativeService.getPixelsAsync = jest.fn().mockImplementation(async(points: unknown[]) => points.map(() => ({r: 1, g: 2, b: 3})));
+    mockNativeService.findTemplateAsync = jest.fn().mockResolvedValue([{x: 100, y: 200, width: 40, height: 20, score: 0.97}]);
+    mockNativeService.waitForPixelAsync = jest.fn().mockResolvedValue({matched: true, x: 12, y: 34, color: {r: 0, g: 255, b: 16}, elapsedMs: 40});
+    mockNativeService.openScreenStream = jest.fn().mockReturnValue({id: 7, x: 0, y: 0, width: 64, height: 32});
+    mockNativeService.closeScreenStream = jest.fn();
+    mockNativeService.startFrameSocket = jest.fn().mockImplementation((options: {name: string; slots: number}) => ({
+      path: `/run/user/1000/http-remote-pc-control/${options.name}`,
+      slots: options.slots,
+      slotSize: 8294400,
+    }));
+    mockNativeService.stopFrameSocket = jest.fn();
+    mockNativeService.waitForIdleAsync = jest.fn().mockResolvedValue({idle: true, elapsedMs: 620, damageEvents: 3});
+
+    const module: TestingModule = await Test.createTestingModule({
+      controllers: [CaptureController],
+      providers: [
+        CaptureService,
+        CaptureStreamService,
+        MouseService,
+        {provide: Native, useValue: mockNativeService},
+        {provide: OS_INJECT, useValue: 'linux'},
+        {provide: Logger, useValue: createMockLogger()},
+      ],
+    })
+      .compile();
+
+    app = module.createNestApplication();
+    setupValidationPipe(app);
+    nativeService = module.get<jest.Mocked<INativeModule>>(Native);
+    logger = module.get<jest.Mocked<Logger>>(Logger);
+
+    await app.init();
+  });
+
+  afterAll(async () => {
+    await app.close();
+  });
+
+  describe('GET /capture', () => {
+    beforeEach(() => {
+      jest.clearAllMocks();
+    });
+
+    it('should return raw pixels of the whole screen', () => {
+      return request(app.getHttpServer())
+        .get('/capture')
+        .buffer(true)
+        .expect(200)
+        .expect('Content-Type', 'application/octet-stream')
+        .expect('X-Image-Width', '2')
+        .expect('X-Image-Height', '1')
+        .expect('X-Image-Stride', '8')
+        .expect('X-Image-Format', 'bgra')
+        .expect((res: Response) => {
+          expect(nativeService.captureScreenAsync).toHaveBeenCalledWith(undefined);
+          expect(Buffer.from(res.body)).toEqual(Buffer.from([1, 2, 3, 255, 4, 5, 6, 255]));
+        });
+    });
+
+    it('should capture monitor', () => {
+      return request(app.getHttpServer())
+        .get('/capture?monitor=3')
+        .expect(200)
+        .then(() => {
+          expect(nativeService.captureScreenAsync).toHaveBeenCalledWith({monitor: 3});
+        });
+    });
+
+    it('should capture area', () => {
+      return request(app.getHttpServer())
+        .get('/capture?x=10&y=-20&width=30&height=40')
+        .expect(200)
+        .then(() => {
+          expect(nativeService.captureScreenAsync).toHaveBeenCalledWith({x: 10, y: -20, width: 30, height: 40});
+        });
+    });
+
+    it('should encode png', () => {
+      return request(app.getHttpServer())
+        .get('/capture?format=png&monitor=1&compression=3')
+        .buffer(true)
+        .expect(200)
+        .expect('Content-Type', 'image/png')
+        .expect('X-Image-Width', '2')
+        .expect('X-Image-Format', 'png')
+        .expect((res: Response) => {
+          expect(nativeService.captureImageAsync).toHaveBeenCalledWith({monitor: 1}, {
+            format: 'png',
+            quality: undefined,
+            compression: 3,
+            width: undefined,
+            height: undefined,
+          });
+          expect(nativeService.captureScreenAsync).not.toHaveBeenCalled();
+          expect(Buffer.from(res.body)).toEqual(Buffer.from([0x89, 0x50, 0x4E, 0x47]));
+        });
+    });
+
+    it('should resize jpeg', () => {
+      return request(app.getHttpServer())
+        .get('/capture?format=jpeg&quality=60&resizeWidth=640')
+        .expect(200)
+        .expect('Content-Type', 'image/jpeg')
+        .expect('X-Image-Width', '640')
+        .then(() => {
+          expect(nativeService.captureImageAsync).toHaveBeenCalledWith(undefined, expect.objectContaining({
+            format: 'jpeg',
+            quality: 60,
+            width: 640,
+          }));
+        });
+    });
+
+    it('should return 400 for resized raw capture', () => {
+      return request(app.getHttpServer())
+        .get('/capture?resizeWidth=640')
+        .expect(400);
+    });
+
+    it('should return 400 for unknown format', () => {
+      return request(app.getHttpServer())
+        .get('/capture?format=gif')
+        .expect(400);
+    });
+
+    it('should return 400 for incomplete area', () => {
+      return request(app.getHttpServer())
+        .get('/capture?x=10&y=20')
+        .expect(400)
+        .expect((res: Response) => {
+          expect(res.body.message[0]).toContain('together');
+          expect(nativeService.captureScreenAsync).not.toHaveBeenCalled();
+        });
+    });
+
+    it('should return 400 for monitor combined with area', () => {
+      return request(app.getHttpServer())
+        .get('/capture?monitor=1&x=0&y=0&width=1&height=1')
+        .expect(400);
+    });
+
+    it('should return 400 for non positive width', () => {
+      return request(app.getHttpServer())
+        .get('/capture?x=0&y=0&width=0&height=1')
+        .expect(400);
+    });
+  });
+
+  describe('GET /capture/stream', () => {
+    const jpeg = Buffer.from([0xFF, 0xD8, 0xFF, 0xD9]);
+    const collect = (res: NodeJS.ReadableStream, callback: (err: Error | null, body: string) => void): void => {
+      const chunks: Buffer[] = [];
+      res.on('data', (chunk: Buffer) => chunks.push(chunk));
+      res.on('end', () => callback(null, Buffer.concat(chunks).toString('latin1')));
+    };
+
+    beforeEach(() => {
+      jest.clearAllMocks();
+      // Second frame fails, which ends the response
+      nativeService.nextScreenFrameAsync = jest.fn()
+        .mockResolvedValueOnce({full: true, tiles: [{x: 0, y: 0, width: 64, height: 32, data: jpeg}]})
+        .mockRejectedValueOnce(new Error('Screen stream 7 is closed'));
+    });
+
+    it('should send whole frames as MJPEG', () => {
+      return request(app.getHttpServer())
+        .get('/capture/stream?monitor=1&maxFps=5')
+        .buffer(true)
+        .parse(collect)
+        .expect(200)
+        .expect('Content-Type', 'multipart/x-mixed-replace; boundary=frame')
+        .expect('X-Image-Width', '64')
+        .expect('X-Image-Height', '32')
+        .expect((res: Response) => {
+          expect(nativeService.openScreenStream).toHaveBeenCalledWith({monitor: 1}, {
+            tiles: false,
+            tileSize: 128,
+            quality: 70,
+            maxFps: 5,
+          });
+          expect(nativeService.nextScreenFrameAsync).toHaveBeenNthCalledWith(1, 7, true);
+          expect(res.body).toContain('--frame\r\nContent-Type: image/jpeg\r\nContent-Length: 4\r\n\r\n');
+          expect(res.body).toContain(jpeg.toString('latin1'));
+          expect(res.body).not.toContain('X-Tile-X');
+          expect(nativeService.closeScreenStream).toHaveBeenCalledWith(7);
+        });
+    });
+
+    it('should send tiles with their positions', () => {
+      return request(app.getHttpServer())
+        .get('/capture/stream?mode=tiles&tileSize=32')
+        .buffer(true)
+        .parse(collect)
+        .expect(200)
+        .expect('Content-Type', 'multipart/mixed; boundary=frame')
+        .expect((res: Response) => {
+          expect(nativeService.openScreenStream).toHaveBeenCalledWith(undefined, {
+            tiles: true,
+            tileSize: 32,
+            quality: 70,
+            maxFps: 10,
+          });
+          expect(res.body).toContain('X-Frame: 1\r\nX-Frame-Full: true\r\nX-Tile-X: 0\r\nX-Tile-Y: 0\r\nX-Tile-Width: 64\r\nX-Tile-Height: 32');
+        });
+    });
+
+    it('should return 400 for monitor combined with area', () => {
+      return request(app.getHttpServer())
+        .get('/capture/stream?monitor=1&x=0&y=0&width=10&height=10')
+        .expect(400)
+        .expect(() => {
+          expect(nativeService.openScreenStream).not.toHaveBeenCalled();
+        });
+    });
+  });
+
+  describe('GET /capture/pixel', () => {
+    beforeEach(() => {
+      jest.clearAllMocks();
+    });
+
+    it('should return pixel color in hex', () => {
+      return request(app.getHttpServer())
+        .get('/capture/pixel?x=10&y=20')
+        .expect(200)
+        .expect((res: Response) => {
+          expect(nativeService.getPixelAsync).toHaveBeenCalledWith(10, 20);
+          expect(res.body).toEqual({x: 10, y: 20, color: '#ff8000'});
+        });
+    });
+
+    it('should return 400 for negative coordinates', () => {
+      return request(app.getHttpServer())
+        .get('/capture/pixel?x=-1&y=20')
+        .expect(400);
+    });
+  });
+
+  describe('POST /capture/pixels', () => {
+    beforeEach(() => {
+      jest.clearAllMocks();
+    });
+
+    it('should return colors in the order of points', () => {
+      const points = [{x: 1, y: 2}, {x: 300, y: 400}];
+      return request(app.getHttpServer())
+        .post('/capture/pixels')
+        .send({points})
+        .expect(200)
+        .expect((res: Response) => {
+          expect(nativeService.getPixelsAsync).toHaveBeenCalledWith(points);
+          expect(res.body).toEqual([{x: 1, y: 2, color: '#010203'}, {x: 300, y: 400, color: '#010203'}]);
+        });
+    });
+
+    it('should return 400 for empty points', () => {
+      return request(app.getHttpServer())
+        .post('/capture/pixels')
+        .send({points: []})
+        .expect(400);
+    });
+  });
+
+  describe('POST /capture/pixel/wait', () => {
+    beforeEach(() => {
+      jest.clearAllMocks();
+    });
+
+    it('should pass region and parsed color to native', () => {
+      return request(app.getHttpServer())
+        .post('/capture/pixel/wait')
+        .send({region: {x: 10, y: 20, width: 30, height: 40}, color: '#00FF10', timeoutMs: 1000})
+        .expect(200)
+        .expect((res: Response) => {
+          expect(nativeService.waitForPixelAsync).toHaveBeenCalledWith({
+            region: {x: 10, y: 20, width: 30, height: 40},
+            color: {r: 0, g: 255, b: 16},
+            tolerance: 0,
+            timeoutMs: 1000,
+            intervalMs: 50,
+          });
+          expect(res.body).toEqual({matched: true, x: 12, y: 34, color: '#00ff10', elapsedMs: 40});
+        });
+    });
+
+    it('should return matched = false on timeout', () => {
+      nativeService.waitForPixelAsync!.mockResolvedValueOnce({matched: false, elapsedMs: 1000});
+      return request(app.getHttpServer())
+        .post('/capture/pixel/wait')
+        .send({region: {x: 0, y: 0, width: 1, height: 1}, color: '#000000', tolerance: 5, timeoutMs: 1000})
+        .expect(200)
+        .expect((res: Response) => {
+          expect(res.body).toEqual({matched: false, elapsedMs: 1000});
+        });
+    });
+
+    it('should return 400 for invalid color', () => {
+      return request(app.getHttpServer())
+        .post('/capture/pixel/wait')
+        .send({region: {x: 0, y: 0, width: 1, height: 1}, color: 'red', timeoutMs: 1000})
+        .expect(400)
+        .expect(() => {
+          expect(nativeService.waitForPixelAsync).not.toHaveBeenCalled();
+        });
+    });
+
+    it('should return 400 for too large region', () => {
+      return request(app.getHttpServer())
+        .post('/capture/pixel/wait')
+        .send({region: {x: 0, y: 0, width: 4000, height: 4000}, color: '#000000', timeoutMs: 1000})
+        .expect(400);
+    });
+  });
+
+  describe('POST /capture/idle', () => {
+    beforeEach(() => {
+      jest.clearAllMocks();
+    });
+
+    it('should wait for a window with default quiet period', () => {
+      return request(app.getHttpServer())
+        .post('/capture/idle')
+        .send({wid: 123, timeoutMs: 5000})
+        .expect(200)
+        .expect((res: Response) => {
+          expect(nativeService.waitForIdleAsync).toHaveBeenCalledWith({
+            wid: 123,
+            region: undefined,
+            quietMs: 500,
+            timeoutMs: 5000,
+          });
+          expect(res.body).toEqual({idle: true, elapsedMs: 620, damageEvents: 3});
+        });
+    });
+
+    it('should wait for a screen region', () => {
+      nativeService.waitForIdleAsync!.mockResolvedValueOnce({idle: false, elapsedMs: 1000, damageEvents: 40});
+      return request(app.getHttpServer())
+        .post('/capture/idle')
+        .send({region: {x: 10, y: 20, width: 300, height: 200}, quietMs: 200, timeoutMs: 1000})
+        .expect(200)
+        .expect((res: Response) => {
+          expect(nativeService.waitForIdleAsync).toHaveBeenCalledWith({
+            wid: undefined,
+            region: {x: 10, y: 20, width: 300, height: 200},
+            quietMs: 200,
+            timeoutMs: 1000,
+          });
+          expect(res.body).toEqual({idle: false, elapsedMs: 1000, damageEvents: 40});
+        });
+    });
+
+    it('should return 400 when both wid and region are given', () => {
+      return request(app.getHttpServer())
+        .post('/capture/idle')
+        .send({wid: 123, region: {x: 0, y: 0, width: 1, height: 1}, timeoutMs: 1000})
+        .expect(400)
+        .expect(() => {
+          expect(nativeService.waitForIdleAsync).not.toHaveBeenCalled();
+        });
+    });
+
+    it('should return 400 when neither wid nor region is given', () => {
+      return request(app.getHttpServer())
+        .post('/capture/idle')
+        .send({timeoutMs: 1000})
+        .expect(400);
+    });
+  });
+
+  describe('POST /capture/socket', () => {
+    beforeEach(() => {
+      jest.clearAllMocks();
+    });
+
+    it('should start frame socket with default name and slots', () => {
+      return request(app.getHttpServer())
+        .post('/capture/socket')
+        .send({})
+        .expect(200)
+        .expect((res: Response) => {
+          expect(nativeService.startFrameSocket).toHaveBeenCalledWith({name: 'screen-frames.sock', slots: 4});
+          expect(res.body).toEqual({
+            path: '/run/user/1000/http-remote-pc-control/screen-frames.sock',
+            slots: 4,
+            slotSize: 8294400,
+          });
+        });
+    });
+
+    it('should pass socket name to native', () => {
+      return request(app.getHttpServer())
+        .post('/capture/socket')
+        .send({name: 'frames.sock', slots: 2})
+        .expect(200)
+        .expect(() => {
+          expect(nativeService.startFrameSocket).toHaveBeenCalledWith({name: 'frames.sock', slots: 2});
+        });
+    });
+
+    it('should return 400 for absolute socket path', () => {
+      return request(app.getHttpServer())
+        .post('/capture/socket')
+        .send({path: '/run/user/1000/bus'})
+        .expect(400)
+        .expect(() => {
+          expect(nativeService.startFrameSocket).not.toHaveBeenCalled();
+        });
+    });
+
+    it('should return 400 for socket name with a directory', () => {
+      return request(app.getHttpServer())
+        .post('/capture/socket')
+        .send({name: 'pulse/native'})
+        .expect(400)
+        .expect(() => {
+          expect(nativeService.startFrameSocket).not.toHaveBeenCalled();
+        });
+    });
+
+    it('should return 400 for socket name leaving the runtime directory', () => {
+      return request(app.getHttpServer())
+        .post('/capture/socket')
+        .send({name: '..'})
+        .expect(400)
+        .expect(() => {
+          expect(nativeService.startFrameSocket).not.toHaveBeenCalled();
+        });
+    });
+
+    it('should return 400 when native start fails', () => {
+      nativeService.startFrameSocket!.mockImplementationOnce(() => {
+        throw new Error('Frame socket is already listening on /run/user/1000/http-remote-pc-control/a.sock');
+      });
+      return request(app.getHttpServer())
+        .post('/capture/socket')
+        .send({name: 'b.sock', slots: 2})
+        .expect(400);
+    });
+
+    it('should stop frame socket', () => {
+      return request(app.getHttpServer())
+        .delete('/capture/socket')
+        .expect(204)
+        .expect(() => {
+          expect(nativeService.stopFrameSocket).toHaveBeenCalled();
+        });
+    });
+  });
+
+  describe('POST /capture/find', () => {
+    const image = Buffer.from([0x89, 0x50, 0x4E, 0x47]).toString('base64');
+
+    beforeEach(() => {
+      jest.clearAllMocks();
+    });
+
+    it('should pass decoded image and defaults to native', () => {
+      return request(app.getHttpServer())
+        .post('/capture/find')
+        .send({image})
+        .expect(200)
+        .expect((res: Response) => {
+          expect(nativeService.findTemplateAsync).toHaveBeenCalledWith(Buffer.from([0x89, 0x50, 0x4E, 0x47]), {
+            region: undefined,
+            threshold: 0.9,
+            maxResults: 1,
+          });
+          expect(res.body).toEqual([{x: 100, y: 200, width: 40, height: 20, score: 0.97}]);
+        });
+    });
+
+    it('should pass region', () => {
+      return request(app.getHttpServer())
+        .post('/capture/find')
+        .send({image, region: {monitor: 2}, threshold: 0.8, maxResults: 5})
+        .expect(200)
+        .then(() => {
+          expect(nativeService.findTemplateAsync).toHaveBeenCalledWith(expect.any(Buffer), {
+            region: {monitor: 2},
+            threshold: 0.8,
+            maxResults: 5,
+          });
+        });
+    });
+
+    it('should keep the image out of the logs', () => {
+      return request(app.getHttpServer())
+        .post('/capture/find')
+        .send({image})
+        .expect(200)
+        .then(() => {
+          const logged = JSON.stringify([logger.debug.mock.calls, logger.log.mock.calls]);
+          expect(logged).toContain('matchTemplate');
+          expect(logged).not.toContain(image);
+        });
+    });
+
+    it('should return 400 for non base64 image', () => {
+      return request(app.getHttpServer())
+        .post('/capture/find')
+        .send({image: 'not an image!'})
+        .expect(400);
+    });
+
+    it('should click center of the match', () => {
+      return request(app.getHttpServer())
+        .post('/capture/find/click')
+        .send({image})
+        .expect(200)
+        .expect((res: Response) => {
+          expect(res.body.score).toBe(0.97);
+          expect(nativeService.setMousePosition).toHaveBeenCalledWith({x: 120, y: 210});
+          expect(nativeService.setMouseButtonToState).toHaveBeenCalledTimes(2);
+        });
+    });
+
+    it('should return 404 when nothing is found', () => {
+      nativeService.findTemplateAsync!.mockResolvedValueOnce([]);
+      return request(app.getHttpServer())
+        .post('/capture/find/click')
+        .send({image})
+        .expect(404)
+        .expect(() => {
+          expect(nativeService.setMousePosition).not.toHaveBeenCalled();
+        });
+    });
+  });
+});
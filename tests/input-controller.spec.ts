@@ -0,0 +1,157 @@
+import {Test, TestingModule} from '@nestjs/testing';
+import {INestApplication, Logger} from '@nestjs/common';
+import request, {Response} from 'supertest';
+import {InputController} from '../src/input/input-controller';
+import {InputService} from '../src/input/input-service';
+import {INativeModule, Native} from '../src/native/native-model';
+import {OS_INJECT} from '../src/global/global-model';
+import {createMockNativeService, createMockLogger, setupValidationPipe} from './test-utils';
+
+describe('InputController (e2e)', () => {
+  let app: INestApplication;
+  let nativeService: jest.Mocked<INativeModule>;
+
+  beforeAll(async () => {
+    const mockNativeService = createMockNativeService();
+    mockNativeService.playInputTimelineAsync = jest.fn().mockImplementation(async(id, events: unknown[]) => ({
+      cancelled: false,
+      events: events.map((event: any) => ({requestedUs: event.offsetUs, actualUs: event.offsetUs + 5})),
+    }));
+    mockNativeService.cancelInputTimeline = jest.fn().mockImplementation((id: number) => id === 7);
+
+    const module: TestingModule = await Test.createTestingModule({
+      controllers: [InputController],
+      providers: [
+        InputService,
+        {provide: Native, useValue: mockNativeService},
+        {provide: OS_INJECT, useValue: 'linux'},
+        {provide: Logger, useValue: createMockLogger()},
+      ],
+    })
+      .compile();
+
+    app = module.createNestApplication();
+    setupValidationPipe(app);
+    nativeService = module.get<jest.Mocked<INativeModule>>(Native);
+
+    await app.init();
+  });
+
+  afterAll(async () => {
+    await app.close();
+  });
+
+  describe('POST /input/timeline', () => {
+    beforeEach(() => {
+      jest.clearAllMocks();
+    });
+
+    it('should pass events to native and return timings', () => {
+      const events = [
+        {type: 'key', key: 'control', down: true, offsetUs: 0},
+        {type: 'move', x: 10, y: 20, offsetUs: 500},
+        {type: 'button', button: 'LEFT', down: true, offsetUs: 1000},
+        {type: 'text', text: 'hi', offsetUs: 1500},
+      ];
+
+      return request(app.getHttpServer())
+        .post('/input/timeline')
+        .send({id: 42, events})
+        .expect(201)
+        .expect((res: Response) => {
+          expect(nativeService.playInputTimelineAsync).toHaveBeenCalledWith(42, events);
+          expect(res.body).toEqual({
+            id: 42,
+            cancelled: false,
+            events: [
+              {requestedUs: 0, actualUs: 5},
+              {requestedUs: 500, actualUs: 505},
+              {requestedUs: 1000, actualUs: 1005},
+              {requestedUs: 1500, actualUs: 1505},
+            ],
+          });
+        });
+    });
+
+    it('should generate id when it is not provided', () => {
+      return request(app.getHttpServer())
+        .post('/input/timeline')
+        .send({events: [{type: 'key', key: 'a', down: true, offsetUs: 0}]})
+        .expect(201)
+        .expect((res: Response) => {
+          expect(res.body.id).toBeGreaterThan(0x7FFFFFFF);
+          expect(nativeService.playInputTimelineAsync).toHaveBeenCalledWith(res.body.id, expect.any(Array));
+        });
+    });
+
+    it('should return 400 for negative offset', () => {
+      return request(app.getHttpServer())
+        .post('/input/timeline')
+        .send({events: [{type: 'key', key: 'a', down: true, offsetUs: -1}]})
+        .expect(400)
+        .expect((res: Response) => {
+          expect(res.body.message[0]).toContain('offsetUs');
+          expect(nativeService.playInputTimelineAsync).not.toHaveBeenCalled();
+        });
+    });
+
+    it('should return 400 for offset above 10 minutes', () => {
+      return request(app.getHttpServer())
+        .post('/input/timeline')
+        .send({events: [{type: 'key', key: 'a', down: true, offsetUs: 1e15}]})
+        .expect(400)
+        .expect(() => {
+          expect(nativeService.playInputTimelineAsync).not.toHaveBeenCalled();
+        });
+    });
+
+    it('should return 400 for too many events', () => {
+      const events = Array.from({length: 10001}, (_, i) => ({type: 'move', x: i, y: 0, offsetUs: i}));
+      return request(app.getHttpServer())
+        .post('/input/timeline')
+        .send({events})
+        .expect(400)
+        .expect(() => {
+          expect(nativeService.playInputTimelineAsync).not.toHaveBeenCalled();
+        });
+    });
+
+    it('should return 400 for unknown event type', () => {
+      return request(app.getHttpServer())
+        .post('/input/timeline')
+        .send({events: [{type: 'scroll', offsetUs: 0}]})
+        .expect(400);
+    });
+
+    it('should return 400 for empty events', () => {
+      return request(app.getHttpServer())
+        .post('/input/timeline')
+        .send({events: []})
+        .expect(400)
+        .expect((res: Response) => {
+          expect(res.body.message[0]).toContain('events');
+        });
+    });
+  });
+
+  describe('DELETE /input/timeline/:id', () => {
+    beforeEach(() => {
+      jest.clearAllMocks();
+    });
+
+    it('should cancel running timeline', () => {
+      return request(app.getHttpServer())
+        .delete('/input/timeline/7')
+        .expect(204)
+        .then(() => {
+          expect(nativeService.cancelInputTimeline).toHaveBeenCalledWith(7);
+        });
+    });
+
+    it('should return 404 for unknown timeline', () => {
+      return request(app.getHttpServer())
+        .delete('/input/timeline/8')
+        .expect(404);
+    });
+  });
+});
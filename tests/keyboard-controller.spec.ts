@@ -6,6 +6,7 @@ import {KeyboardService} from '../src/keyboard/keyboard-service';
 import {INativeModule, Native} from '../src/native/native-model';
 import {OS_INJECT} from '../src/global/global-model';
 import {RandomService} from '../src/random/random-service';
+import {InputService} from '../src/input/input-service';
 import {createMockNativeService, createMockRandomService, createMockLogger, setupValidationPipe} from './test-utils';
 import {KeyPressRequestDto, TypeTextRequestDto, SetKeyboardLayoutRequestDto} from "../src/keyboard/keyboard-dto";
 
@@ -21,6 +22,7 @@ describe('KeyboardController (e2e)', () => {
       controllers: [KeyboardController],
       providers: [
         KeyboardService,
+        InputService,
         {provide: Native, useValue: mockNativeService},
         {provide: OS_INJECT, useValue: process.platform},
         {provide: Logger, useValue: createMockLogger()},
@@ -64,6 +66,32 @@ describe('KeyboardController (e2e)', () => {
         });
     });
 
+    it('should replay keys as a native timeline when available', () => {
+      nativeService.playInputTimelineAsync = jest.fn().mockResolvedValue({cancelled: false, events: []});
+      const keyPressData: KeyPressRequestDto = {
+        keys: ['a'],
+        holdKeys: ['control'],
+        duration: 50,
+      };
+
+      return request(app.getHttpServer())
+        .post('/keyboard/key-press')
+        .send(keyPressData)
+        .expect(204)
+        .then(() => {
+          expect(nativeService.playInputTimelineAsync).toHaveBeenCalledWith(expect.any(Number), [
+            {type: 'key', key: 'control', down: true, offsetUs: 0},
+            {type: 'key', key: 'a', down: true, offsetUs: 100000},
+            {type: 'key', key: 'a', down: false, offsetUs: 150000},
+            {type: 'key', key: 'control', down: false, offsetUs: 250000},
+          ]);
+          expect(nativeService.keyToggle).not.toHaveBeenCalled();
+        })
+        .finally(() => {
+          delete nativeService.playInputTimelineAsync;
+        });
+    });
+
     it('should handle single key without modifiers', () => {
       const keyPressData: KeyPressRequestDto = {
         keys: ['enter'],
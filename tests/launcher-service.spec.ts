@@ -0,0 +1,85 @@
+import {Test, TestingModule} from '@nestjs/testing';
+import {
+  Logger,
+  RequestTimeoutException,
+  ServiceUnavailableException,
+  UnprocessableEntityException,
+} from '@nestjs/common';
+import {LauncherService} from '../src/process/launcher-service';
+import {INativeModule, Native} from '../src/native/native-model';
+import {LaunchExeRequest} from '../src/process/process-dto';
+import {createMockLogger, createMockNativeService} from './test-utils';
+
+describe('LauncherService', () => {
+  let service: LauncherService;
+  let nativeService: jest.Mocked<INativeModule>;
+
+  const launch: LaunchExeRequest = {
+    path: '/usr/bin/test-app',
+    arguments: ['--verbose'],
+    waitTillFinish: false,
+    waitTimeout: 300,
+  };
+
+  beforeEach(async () => {
+    nativeService = createMockNativeService();
+    nativeService.launchSupervisedProcess = jest.fn().mockReturnValue({id: 7, pid: 123});
+    nativeService.waitForSupervisedExitAsync = jest.fn().mockResolvedValue({exited: false});
+    nativeService.releaseSupervisedProcess = jest.fn().mockReturnValue(true);
+
+    const module: TestingModule = await Test.createTestingModule({
+      providers: [
+        LauncherService,
+        {provide: Native, useValue: nativeService},
+        {provide: Logger, useValue: createMockLogger()},
+      ],
+    }).compile();
+
+    service = module.get<LauncherService>(LauncherService);
+  });
+
+  it('should return pid of a process still running after the timeout', async () => {
+    await expect(service.launchExe(launch)).resolves.toBe(123);
+    expect(nativeService.launchSupervisedProcess).toHaveBeenCalledWith('/usr/bin/test-app', ['--verbose'], undefined);
+    expect(nativeService.waitForSupervisedExitAsync).toHaveBeenCalledWith(7, 300);
+    expect(nativeService.releaseSupervisedProcess).not.toHaveBeenCalled();
+  });
+
+  it('should pass restart policy to the supervisor', async () => {
+    const restart = {policy: 'always' as const, maxRestarts: 3, backoffMs: 500};
+    await service.launchExe({...launch, restart});
+    expect(nativeService.launchSupervisedProcess).toHaveBeenCalledWith('/usr/bin/test-app', ['--verbose'], restart);
+  });
+
+  it('should throw timeout when waiting for a process that is still running', async () => {
+    await expect(service.launchExe({...launch, waitTillFinish: true})).rejects.toBeInstanceOf(RequestTimeoutException);
+  });
+
+  it('should resolve and release a process that has finished', async () => {
+    nativeService.waitForSupervisedExitAsync!.mockResolvedValueOnce(
+      {exited: true, pid: 123, code: 0, signal: null, time: 1700000000000, restarting: false});
+    await expect(service.launchExe({...launch, waitTillFinish: true})).resolves.toBe(123);
+    expect(nativeService.releaseSupervisedProcess).toHaveBeenCalledWith(7);
+  });
+
+  it('should report exit code of a failed process', async () => {
+    nativeService.waitForSupervisedExitAsync!.mockResolvedValueOnce(
+      {exited: true, pid: 123, code: 2, signal: null, time: 1700000000000, restarting: false});
+    await expect(service.launchExe(launch)).rejects.toThrow(new UnprocessableEntityException('Process exit with code 2'));
+  });
+
+  it('should report signal and keep supervising a process that is restarting', async () => {
+    nativeService.waitForSupervisedExitAsync!.mockResolvedValueOnce(
+      {exited: true, pid: 123, code: null, signal: 11, time: 1700000000000, restarting: true});
+    await expect(service.launchExe(launch)).rejects.toThrow(new UnprocessableEntityException('Process killed by signal 11'));
+    expect(nativeService.releaseSupervisedProcess).not.toHaveBeenCalled();
+  });
+
+  it('should throw unavailable when the executable can not be started', async () => {
+    nativeService.launchSupervisedProcess!.mockImplementationOnce(() => {
+      throw new Error('Failed to launch /usr/bin/test-app: No such file or directory');
+    });
+    await expect(service.launchExe(launch)).rejects.toBeInstanceOf(ServiceUnavailableException);
+    expect(nativeService.waitForSupervisedExitAsync).not.toHaveBeenCalled();
+  });
+});
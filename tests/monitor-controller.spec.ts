@@ -42,21 +42,47 @@ describe('MonitorController (e2e)', () => {
     });
 
     it('should return list of monitors', () => {
+      const supported = ['win32', 'linux'].includes(process.platform);
       return request(app.getHttpServer())
         .get('/monitor')
-        .expect(process.platform == 'win32' ? 200 : 400)
+        .expect(supported ? 200 : 400)
         .expect((res: Response) => {
-          if (process.platform == 'win32') {
+          if (supported) {
             expect(Array.isArray(res.body)).toBe(true);
             expect(res.body).toEqual([1, 2]);
             expect(nativeService.getMonitors).toHaveBeenCalled();
           } else {
-            expect(res.body.message).toBe('Unsupported method getMonitors on platform linux');
+            expect(res.body.message).toBe(`Unsupported method getMonitors on platform ${process.platform}`);
           }
         });
     });
   });
 
+  describe('GET /monitor/window/:wid', () => {
+    beforeEach(() => {
+      jest.clearAllMocks();
+    });
+
+    it('should return monitor of the window', () => {
+      const supported = ['win32', 'linux'].includes(process.platform);
+      return request(app.getHttpServer())
+        .get('/monitor/window/123')
+        .expect(supported ? 200 : 400)
+        .expect((res: Response) => {
+          if (supported) {
+            expect(res.text).toBe('1');
+            expect(nativeService.getMonitorFromWindow).toHaveBeenCalledWith(123);
+          }
+        });
+    });
+
+    it('should return 400 for invalid window ID', () => {
+      return request(app.getHttpServer())
+        .get('/monitor/window/abc')
+        .expect(400);
+    });
+  });
+
   describe('GET /monitor/:mid/info', () => {
     beforeEach(() => {
       jest.clearAllMocks();
@@ -153,6 +153,27 @@ describe('MouseController (e2e)', () => {
         });
     });
 
+    it('should use native human move when available', () => {
+      nativeService.mouseMoveHumanAsync = jest.fn().mockResolvedValue(undefined);
+      const moveData: MouseMoveHumanRequestDto = {
+        x: 100,
+        y: 200,
+        curveIntensity: 0.5,
+      };
+
+      return request(app.getHttpServer())
+        .post('/mouse/move-human')
+        .send(moveData)
+        .expect(204)
+        .then(() => {
+          expect(nativeService.mouseMoveHumanAsync).toHaveBeenCalledWith(expect.objectContaining(moveData));
+          expect(nativeService.setMousePosition).not.toHaveBeenCalled();
+        })
+        .finally(() => {
+          delete nativeService.mouseMoveHumanAsync;
+        });
+    });
+
     it('should return 400 for missing y', () => {
       const moveData = {
         x: 100,
@@ -47,6 +47,15 @@ describe('NativeService', () => {
       expect(windowInfo.bounds).toHaveProperty('height');
     });
 
+    it('should get window info asynchronously', async () => {
+      const windowInfo = await nativeService.getWindowInfoAsync(windowId);
+      expect(windowInfo.bounds).toEqual(nativeService.getWindowInfo(windowId).bounds);
+    });
+
+    it('should reject async call of a missing window', async () => {
+      await expect(nativeService.getWindowInfoAsync(0x7fffffff)).rejects.toThrow();
+    });
+
     it('should set window bounds', async () => {
       const originalBounds = nativeService.getWindowInfo(windowId).bounds;
       const newBounds = {
@@ -98,7 +107,7 @@ describe('NativeService', () => {
 
   describe('Monitor Management', () => {
 
-    if (process.platform === 'win32') {
+    if (process.platform === 'win32' || process.platform === 'linux') {
       it('should get monitors', () => {
         const monitors = nativeService.getMonitors!();
         expect(Array.isArray(monitors)).toBe(true);
@@ -115,6 +124,7 @@ describe('NativeService', () => {
       it('should get monitor from window', () => {
         const monitorId = nativeService.getMonitorFromWindow!(windowId);
         expect(typeof monitorId).toBe('number');
+        expect(nativeService.getMonitors!()).toContain(monitorId);
       });
     }
   });
@@ -184,6 +194,12 @@ describe('NativeService', () => {
       nativeService.typeString('Test');
     });
 
+    if (process.platform === 'linux') {
+      it('should type characters missing in keyboard layout', () => {
+        nativeService.typeString('Привет, 世界 ✓');
+      });
+    }
+
     it('should set keyboard layout', () => {
       nativeService.setKeyboardLayout('us');
     });
@@ -215,6 +231,15 @@ describe('NativeService', () => {
       expect(Math.abs(updatedPos.y - newPos.y)).toBeLessThanOrEqual(2);
     });
 
+    it('should keep order of async mouse moves', async () => {
+      const originalPos = await nativeService.getMousePositionAsync();
+      const first = nativeService.setMousePositionAsync({x: originalPos.x + 10, y: originalPos.y});
+      const second = nativeService.setMousePositionAsync({x: originalPos.x + 20, y: originalPos.y});
+      await Promise.all([first, second]);
+      const updatedPos = await nativeService.getMousePositionAsync();
+      expect(Math.abs(updatedPos.x - (originalPos.x + 20))).toBeLessThanOrEqual(2);
+    });
+
     it('should simulate mouse button press', () => {
       // Test left button down/up
       nativeService.setMouseButtonToState(MouseButton.LEFT, true);
@@ -13,6 +13,18 @@ describe('ProcessController (e2e)', () => {
   const createTestApp = async () => {
     jest.resetModules();
     const mockNativeService = createMockNativeService();
+    mockNativeService.startProcessSampler = jest.fn();
+    mockNativeService.stopProcessSampler = jest.fn();
+    mockNativeService.getSupervisedProcesses = jest.fn().mockReturnValue([{
+      id: 1, pid: 123, path: '/usr/bin/test-app', running: false, restarts: 2, restartPending: true,
+      lastExit: {pid: 123, code: 1, signal: null, time: 1700000000000},
+    }]);
+    mockNativeService.superviseProcess = jest.fn().mockReturnValue({id: 2, pid: 456});
+    mockNativeService.releaseSupervisedProcess = jest.fn().mockReturnValue(true);
+    mockNativeService.getProcessSamples = jest.fn().mockReturnValue([{
+      pid: 123,
+      samples: [{time: 1700000000000, cpu: 12.5, residentBytes: 1000000, proportionalBytes: 800000, threadCount: 5}],
+    }]);
 
     const mockExecutionService: jest.Mocked<IExecuteService> = {
       launchExe: jest.fn().mockResolvedValue(123),
@@ -27,7 +39,7 @@ describe('ProcessController (e2e)', () => {
         ProcessService,
         {provide: Native, useValue: mockNativeService},
         {provide: ExecuteService, useValue: mockExecutionService},
-        {provide: OS_INJECT, useValue: process.platform},
+        {provide: OS_INJECT, useValue: 'linux'},
         {provide: Logger, useValue: createMockLogger()},
       ],
     })
@@ -78,6 +90,223 @@ describe('ProcessController (e2e)', () => {
     // });
   });
 
+  describe('POST /process/sampler', () => {
+    it('should start sampling every process with defaults', async () => {
+      const { app, nativeService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .post('/process/sampler')
+          .send({})
+          .expect(204)
+          .then(() => {
+            expect(nativeService.startProcessSampler).toHaveBeenCalledWith({intervalMs: 1000, historySize: 60, proportional: false});
+          });
+    });
+
+    it('should start sampling given processes', async () => {
+      const { app, nativeService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .post('/process/sampler')
+          .send({pids: [123, 456], intervalMs: 250, historySize: 10, proportional: true})
+          .expect(204)
+          .then(() => {
+            expect(nativeService.startProcessSampler).toHaveBeenCalledWith({pids: [123, 456], intervalMs: 250, historySize: 10, proportional: true});
+          });
+    });
+
+    it('should return 400 for too short interval', async () => {
+      const { app, nativeService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .post('/process/sampler')
+          .send({intervalMs: 10})
+          .expect(400)
+          .then(() => {
+            expect(nativeService.startProcessSampler).not.toHaveBeenCalled();
+          });
+    });
+  });
+
+  describe('DELETE /process/sampler', () => {
+    it('should stop sampling', async () => {
+      const { app, nativeService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .delete('/process/sampler')
+          .expect(204)
+          .then(() => {
+            expect(nativeService.stopProcessSampler).toHaveBeenCalled();
+            expect(nativeService.getProcessInfo).not.toHaveBeenCalled();
+          });
+    });
+  });
+
+  describe('GET /process/samples', () => {
+    it('should return history of every sampled process', async () => {
+      const { app, nativeService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .get('/process/samples')
+          .expect(200)
+          .expect((res: Response) => {
+            expect(res.body[0].pid).toBe(123);
+            expect(res.body[0].samples[0].cpu).toBe(12.5);
+            expect(nativeService.getProcessSamples).toHaveBeenCalledWith(undefined, undefined);
+          });
+    });
+
+    it('should parse pids and limit', async () => {
+      const { app, nativeService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .get('/process/samples?pids=123,456&limit=5')
+          .expect(200)
+          .then(() => {
+            expect(nativeService.getProcessSamples).toHaveBeenCalledWith([123, 456], 5);
+          });
+    });
+
+    it('should return 400 when sampler is not running', async () => {
+      const { app, nativeService } = await createTestApp();
+      nativeService.getProcessSamples!.mockImplementationOnce(() => {
+        throw new Error('Process sampler is not running');
+      });
+
+      return request(app.getHttpServer())
+          .get('/process/samples')
+          .expect(400);
+    });
+
+    it('should return 400 for malformed pids', async () => {
+      const { app } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .get('/process/samples?pids=12,abc')
+          .expect(400);
+    });
+  });
+
+  describe('GET /process/supervised', () => {
+    it('should list supervised processes', async () => {
+      const { app, nativeService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .get('/process/supervised')
+          .expect(200)
+          .expect((res: Response) => {
+            expect(res.body).toHaveLength(1);
+            expect(res.body[0]).toMatchObject({id: 1, pid: 123, restartPending: true, lastExit: {code: 1}});
+            expect(nativeService.getSupervisedProcesses).toHaveBeenCalled();
+          });
+    });
+  });
+
+  describe('POST /process/supervised', () => {
+    it('should adopt a running process', async () => {
+      const { app, nativeService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .post('/process/supervised')
+          .send({pid: 456})
+          .expect(201)
+          .expect((res: Response) => {
+            expect(res.body).toEqual({id: 2, pid: 456});
+            expect(nativeService.superviseProcess).toHaveBeenCalledWith(456);
+          });
+    });
+
+    it('should return 400 for invalid pid', async () => {
+      const { app, nativeService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .post('/process/supervised')
+          .send({pid: -1})
+          .expect(400)
+          .then(() => {
+            expect(nativeService.superviseProcess).not.toHaveBeenCalled();
+          });
+    });
+  });
+
+  describe('DELETE /process/supervised/:id', () => {
+    it('should release a supervised process', async () => {
+      const { app, nativeService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .delete('/process/supervised/1')
+          .expect(204)
+          .then(() => {
+            expect(nativeService.releaseSupervisedProcess).toHaveBeenCalledWith(1);
+          });
+    });
+
+    it('should return 400 when the id is not supervised', async () => {
+      const { app, nativeService } = await createTestApp();
+      nativeService.releaseSupervisedProcess!.mockReturnValueOnce(false);
+
+      return request(app.getHttpServer())
+          .delete('/process/supervised/99')
+          .expect(400);
+    });
+  });
+
+  describe('POST /process/by-pids', () => {
+    it('should return info for all requested processes', async () => {
+      const { app, nativeService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .post('/process/by-pids')
+          .send({pids: [123, 456]})
+          .expect(200)
+          .expect((res: Response) => {
+            expect(res.body).toHaveLength(2);
+            expect(res.body[0]).toHaveProperty('pid');
+            expect(res.body[0]).toHaveProperty('memory');
+            expect(res.body[0]).not.toHaveProperty('wids');
+            expect(nativeService.getProcessInfo).toHaveBeenCalledTimes(2);
+          });
+    });
+
+    it('should read all processes in one native call when available', async () => {
+      const { app, nativeService } = await createTestApp();
+      nativeService.getProcessesInfoAsync = jest.fn().mockResolvedValue([]);
+
+      return request(app.getHttpServer())
+          .post('/process/by-pids')
+          .send({pids: [123, 456]})
+          .expect(200)
+          .expect((res: Response) => {
+            expect(res.body).toEqual([]);
+            expect(nativeService.getProcessesInfoAsync).toHaveBeenCalledWith([123, 456]);
+          });
+    });
+
+    it('should skip processes that are not found', async () => {
+      const { app, nativeService } = await createTestApp();
+      nativeService.getProcessInfo.mockImplementationOnce(() => {
+        throw new Error('Failed to open process stat file');
+      });
+
+      return request(app.getHttpServer())
+          .post('/process/by-pids')
+          .send({pids: [999, 123]})
+          .expect(200)
+          .expect((res: Response) => {
+            expect(res.body).toHaveLength(1);
+          });
+    });
+
+    it('should return 400 for empty list', async () => {
+      const { app } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .post('/process/by-pids')
+          .send({pids: []})
+          .expect(400);
+    });
+  });
+
   describe('POST /process', () => {
     it('should launch new process', async () => {
       const { app, executionService } = await createTestApp();
@@ -97,6 +326,32 @@ describe('ProcessController (e2e)', () => {
           });
     });
 
+    it('should fill restart policy defaults', async () => {
+      const { app, executionService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .post('/process')
+          .send({path: '/usr/bin/test-app', restart: {policy: 'on-failure'}})
+          .expect(201)
+          .then(() => {
+            expect(executionService.launchExe).toHaveBeenCalledWith(expect.objectContaining({
+              restart: {policy: 'on-failure', maxRestarts: 5, backoffMs: 1000},
+            }));
+          });
+    });
+
+    it('should return 400 for unknown restart policy', async () => {
+      const { app, executionService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .post('/process')
+          .send({path: '/usr/bin/test-app', restart: {policy: 'sometimes'}})
+          .expect(400)
+          .then(() => {
+            expect(executionService.launchExe).not.toHaveBeenCalled();
+          });
+    });
+
     it('should return 400 for missing path', async () => {
       const { app } = await createTestApp();
       const processData = {
@@ -124,7 +379,29 @@ describe('ProcessController (e2e)', () => {
           .delete('/process?name=test-app')
           .expect(204)
           .then((data) => {
-            expect(executionService.killExeByName).toHaveBeenCalledWith('test-app');
+            expect(executionService.killExeByName).toHaveBeenCalledWith('test-app', 0);
+          });
+    });
+
+    it('should pass grace period to kill by name', async () => {
+      const { app, executionService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .delete('/process?name=test-app&graceMs=2000')
+          .expect(204)
+          .then(() => {
+            expect(executionService.killExeByName).toHaveBeenCalledWith('test-app', 2000);
+          });
+    });
+
+    it('should return 400 for grace period over a minute', async () => {
+      const { app, executionService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .delete('/process?name=test-app&graceMs=60001')
+          .expect(400)
+          .then(() => {
+            expect(executionService.killExeByName).not.toHaveBeenCalled();
           });
     });
 
@@ -188,7 +465,18 @@ describe('ProcessController (e2e)', () => {
           .delete('/process/123')
           .expect(204)
           .then(() => {
-            expect(executionService.killExeByPid).toHaveBeenCalledWith(123);
+            expect(executionService.killExeByPid).toHaveBeenCalledWith(123, 0);
+          });
+    });
+
+    it('should pass grace period to kill by PID', async () => {
+      const { app, executionService } = await createTestApp();
+
+      return request(app.getHttpServer())
+          .delete('/process/123?graceMs=500')
+          .expect(204)
+          .then(() => {
+            expect(executionService.killExeByPid).toHaveBeenCalledWith(123, 500);
           });
     });
 
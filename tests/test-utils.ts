@@ -1,12 +1,14 @@
 import {INativeModule} from '../src/native/native-model';
+import {withAsyncFallbacks} from '../src/native/native-async';
 import {RandomService} from '../src/random/random-service';
 import {ZodValidationPipe} from '@anatine/zod-nestjs';
 import {INestApplication} from '@nestjs/common';
 
 /**
- * Creates a comprehensive mock for the native service
+ * Creates a comprehensive mock for the native service.
+ * Async variants delegate to the sync mocks, so assertions and mockImplementation on the sync ones apply to both
  */
-export const createMockNativeService = (): jest.Mocked<INativeModule> => ({
+export const createMockNativeService = (): jest.Mocked<INativeModule> => withAsyncFallbacks({
   path: '/mock/path/native.node',
   
   // Window methods
@@ -22,6 +24,14 @@ export const createMockNativeService = (): jest.Mocked<INativeModule> => ({
     title: 'Test Window',
     parentWid: 0
   }),
+  getWindowsInfo: jest.fn().mockReturnValue([{
+    wid: 123,
+    pid: 456,
+    bounds: {x: 0, y: 0, width: 800, height: 600},
+    opacity: 1,
+    title: 'Test Window',
+    parentWid: 0
+  }]),
   setWindowBounds: jest.fn(),
   setWindowOpacity: jest.fn(),
   setWindowAttached: jest.fn(),
@@ -68,7 +78,7 @@ export const createMockNativeService = (): jest.Mocked<INativeModule> => ({
   setMouseButtonToState: jest.fn(),
   setMousePosition: jest.fn(),
   getMousePosition: jest.fn().mockReturnValue({x: 100, y: 200}),
-});
+}) as jest.Mocked<INativeModule>;
 
 /**
  * Creates a mock for RandomService
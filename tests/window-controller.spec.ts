@@ -14,6 +14,7 @@ describe('WindowController (e2e)', () => {
 
   beforeAll(async () => {
     const mockNativeService = createMockNativeService();
+    mockNativeService.getWindowsByProcessTreeAsync = jest.fn().mockResolvedValue([123, 456, 789]);
 
     const module: TestingModule = await Test.createTestingModule({
       controllers: [WindowController],
@@ -55,6 +56,65 @@ describe('WindowController (e2e)', () => {
     });
   });
 
+  describe('GET /window/by-pid/:pid', () => {
+    beforeEach(() => {
+      jest.clearAllMocks();
+    });
+
+    it('should return windows of the process', () => {
+      return request(app.getHttpServer())
+        .get('/window/by-pid/1234')
+        .expect(200)
+        .expect((res: Response) => {
+          expect(res.body).toEqual([123, 456]);
+          expect(nativeService.getWindowsByProcessId).toHaveBeenCalledWith(1234);
+          expect(nativeService.getWindowsByProcessTreeAsync).not.toHaveBeenCalled();
+        });
+    });
+
+    describe('with descendants', () => {
+      // Process tree lookup is Linux only, the rest of the suite runs on the current platform
+      let linuxApp: INestApplication;
+
+      beforeAll(async () => {
+        const module: TestingModule = await Test.createTestingModule({
+          controllers: [WindowController],
+          providers: [
+            WindowService,
+            {provide: Native, useValue: nativeService},
+            {provide: OS_INJECT, useValue: 'linux'},
+            {provide: Logger, useValue: createMockLogger()},
+          ],
+        })
+          .compile();
+
+        linuxApp = module.createNestApplication();
+        setupValidationPipe(linuxApp);
+        await linuxApp.init();
+      });
+
+      afterAll(async () => {
+        await linuxApp.close();
+      });
+
+      it('should return windows of the process tree', () => {
+        return request(linuxApp.getHttpServer())
+          .get('/window/by-pid/1234?descendants=true')
+          .expect(200)
+          .expect((res: Response) => {
+            expect(res.body).toEqual([123, 456, 789]);
+            expect(nativeService.getWindowsByProcessTreeAsync).toHaveBeenCalledWith(1234);
+          });
+      });
+    });
+
+    it('should return 400 for invalid descendants flag', () => {
+      return request(app.getHttpServer())
+        .get('/window/by-pid/1234?descendants=yes')
+        .expect(400);
+    });
+  });
+
   describe('GET /window/by-wid/:wid', () => {
     beforeEach(() => {
       jest.clearAllMocks();
@@ -94,6 +154,39 @@ describe('WindowController (e2e)', () => {
     });
   });
 
+  describe('POST /window/by-wids', () => {
+    beforeEach(() => {
+      jest.clearAllMocks();
+    });
+
+    it('should return info for all requested windows', () => {
+      return request(app.getHttpServer())
+        .post('/window/by-wids')
+        .send({wids: [123, 456]})
+        .expect(200)
+        .expect((res: Response) => {
+          expect(Array.isArray(res.body)).toBe(true);
+          expect(res.body[0]).toHaveProperty('wid');
+          expect(res.body[0]).toHaveProperty('bounds');
+          expect(nativeService.getWindowsInfo).toHaveBeenCalledWith([123, 456]);
+        });
+    });
+
+    it('should return 400 for empty list', () => {
+      return request(app.getHttpServer())
+        .post('/window/by-wids')
+        .send({wids: []})
+        .expect(400);
+    });
+
+    it('should return 400 for non-numeric ids', () => {
+      return request(app.getHttpServer())
+        .post('/window/by-wids')
+        .send({wids: ['abc']})
+        .expect(400);
+    });
+  });
+
   describe('PATCH /window/by-wid/:wid', () => {
     beforeEach(() => {
       jest.clearAllMocks();